@@ -400,6 +400,28 @@ bool dtIntersectSegmentPoly2D(const float* p0, const float* p1,
 							  float& tmin, float& tmax,
 							  int& segMin, int& segMax);
 
+/// Intersects several segments with a convex polygon on the xz-plane, with the same
+/// results as calling #dtIntersectSegmentPoly2D for each segment. The segment data is
+/// passed as separate arrays, so that each polygon edge is tested against all segments
+/// in one loop.
+///  @param[in]		p0x			The x-coordinates of the segment start points. [Size: nsegs]
+///  @param[in]		p0z			The z-coordinates of the segment start points. [Size: nsegs]
+///  @param[in]		dirx		The x-components of the segment directions (end - start). [Size: nsegs]
+///  @param[in]		dirz		The z-components of the segment directions (end - start). [Size: nsegs]
+///  @param[in]		nsegs		The number of segments.
+///  @param[in]		verts		The polygon vertices. [(x, y, z) * @p nverts]
+///  @param[in]		nverts		The number of vertices in the polygon.
+///  @param[out]	tmin		The parameter where each segment enters the polygon. [Size: nsegs]
+///  @param[out]	tmax		The parameter where each segment leaves the polygon. [Size: nsegs]
+///  @param[out]	segMin		The edge each segment enters through, or -1. [Size: nsegs]
+///  @param[out]	segMax		The edge each segment leaves through, or -1. [Size: nsegs]
+///  @param[out]	hit			Non-zero for the segments that intersect the polygon. [Size: nsegs]
+void dtIntersectSegmentsPoly2D(const float* p0x, const float* p0z,
+							   const float* dirx, const float* dirz, const int nsegs,
+							   const float* verts, int nverts,
+							   float* tmin, float* tmax,
+							   int* segMin, int* segMax, unsigned char* hit);
+
 bool dtIntersectSegSeg2D(const float* ap, const float* aq,
 						 const float* bp, const float* bq,
 						 float& s, float& t);
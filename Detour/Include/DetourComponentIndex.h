@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURCOMPONENTINDEX_H
+#define DETOURCOMPONENTINDEX_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// The maximum number of filter classes a component index can track.
+/// @ingroup detour
+static const int DT_MAX_COMPONENT_CLASSES = 4;
+
+/// Keeps the connected components (islands) of a navigation mesh, so that path
+/// queries toward polygons that cannot be reached are rejected without a search.
+/// @ingroup detour
+class dtComponentIndex : public dtTileListener
+{
+public:
+	dtComponentIndex();
+	virtual ~dtComponentIndex();
+
+	/// Initializes the index for all tiles in the navigation mesh and registers it as
+	/// a tile listener so that it is kept up to date.
+	///  @param[in]		nav		The navigation mesh.
+	///  @param[in]		filter	The filter of the first filter class.
+	/// @returns The status flags for the operation.
+	dtStatus init(dtNavMesh* nav, const dtQueryFilter* filter);
+
+	/// Adds a filter class, the components are tracked separately for each class.
+	///  @param[in]		filter	The filter deciding which polygons are part of the components.
+	/// @returns The index of the filter class, or -1 if there are too many classes.
+	int addFilterClass(const dtQueryFilter* filter);
+
+	/// Gets the filter class of the specified filter or an equivalent one. (See: #dtEquivalentFilters)
+	///  @param[in]		filter	The filter to look for.
+	/// @returns The index of the filter class, or -1 if the filter does not match any class.
+	int getFilterClass(const dtQueryFilter* filter) const;
+
+	/// The number of filter classes.
+	int getFilterClassCount() const { return m_classCount; }
+
+	/// Gets the component of a polygon.
+	///  @param[in]		ref			The reference of the polygon.
+	///  @param[in]		filterClass	The filter class. (See: #addFilterClass)
+	/// @returns The component id, or zero if the polygon is not indexed for the class.
+	unsigned int getComponent(dtPolyRef ref, const int filterClass) const;
+
+	/// Returns false if the end polygon can be proven unreachable from the start polygon.
+	///  @param[in]		startRef	The reference of the start polygon.
+	///  @param[in]		endRef		The reference of the end polygon.
+	///  @param[in]		filterClass	The filter class. (See: #addFilterClass)
+	/// @returns False if the polygons are in different components.
+	bool isReachable(dtPolyRef startRef, dtPolyRef endRef, const int filterClass) const;
+
+	/// Recomputes the components of the specified tile, e.g. after changing polygon flags.
+	///  @param[in]		tile	The tile to rebuild.
+	void rebuildTile(const dtMeshTile* tile);
+
+	/// Gets the amount of memory used by the index in bytes.
+	int getMemUsed() const;
+
+	/// @name dtTileListener Implementation
+	///@{
+	virtual void tileAdded(const dtNavMesh* nav, const dtMeshTile* tile);
+	virtual void tileRemoved(const dtNavMesh* nav, const dtMeshTile* tile);
+	///@}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtComponentIndex(const dtComponentIndex&);
+	dtComponentIndex& operator=(const dtComponentIndex&);
+
+	struct dtComponentEdge
+	{
+		unsigned short poly;		///< Index of the polygon in the tile.
+		dtPolyRef neiRef;			///< The polygon in the neighbour tile.
+	};
+
+	struct dtComponentTile
+	{
+		unsigned int salt;				///< Salt of the tile the components were computed for.
+		int polyCount;					///< Number of polygons in the tile.
+		unsigned short* local;			///< Local component per polygon and class. [Size: classCount * polyCount]
+		int localCount[DT_MAX_COMPONENT_CLASSES];	///< Number of local components per class.
+		int base[DT_MAX_COMPONENT_CLASSES];			///< Index of the first local component in the global set.
+		int slotCount;					///< Number of entries of the global set used by the tile, zero if none.
+		dtComponentEdge* edges;			///< Links leaving the tile.
+		int edgeCount;					///< Number of links leaving the tile.
+	};
+
+	void purge();
+	void freeTile(const int tileIndex);
+	bool buildTile(const dtMeshTile* tile);
+	bool buildEdges(const dtMeshTile* tile);
+	void updateTile(const dtMeshTile* tile, const bool removed);
+	bool allocSlots(const int tileIndex);
+	void unionEdges(const int tileIndex, const int toTile);
+	void rebuildComponents();
+	int findRoot(int i);
+
+	dtNavMesh* m_nav;
+	const dtQueryFilter* m_filters[DT_MAX_COMPONENT_CLASSES];
+	int m_classCount;
+	dtComponentTile* m_tiles;
+	int m_maxTiles;
+
+	int* m_parent;				///< Union-find set over the local components of all tiles.
+	int m_parentCount;
+	int m_parentCapacity;
+	int m_liveCount;			///< Number of entries of the union-find set used by the current tiles.
+
+	unsigned short* m_stack;	///< Temporary flood fill stack.
+	int m_stackCapacity;
+};
+
+/// Allocates a component index object using the Detour allocator.
+/// @return An allocated component index object, or null on failure.
+/// @ingroup detour
+dtComponentIndex* dtAllocComponentIndex();
+
+/// Frees the specified component index object using the Detour allocator.
+///  @param[in]		index		A component index object allocated using #dtAllocComponentIndex
+/// @ingroup detour
+void dtFreeComponentIndex(dtComponentIndex* index);
+
+#endif // DETOURCOMPONENTINDEX_H
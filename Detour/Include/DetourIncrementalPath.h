@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURINCREMENTALPATH_H
+#define DETOURINCREMENTALPATH_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// An incremental path search (D* Lite) that keeps its search tree between queries.
+/// @ingroup detour
+class dtIncrementalPathQuery : public dtTileListener
+{
+public:
+	dtIncrementalPathQuery();
+	virtual ~dtIncrementalPathQuery();
+
+	/// Initializes the query object.
+	///  @param[in]		nav			The navigation mesh to search.
+	///  @param[in]		maxNodes	The maximum number of polygons the search tree can hold. [Limit: > 0]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const int maxNodes);
+
+	/// Sets the goal of the searches and discards the search tree.
+	///  @param[in]		goalRef		The reference id of the goal polygon.
+	///  @param[in]		goalPos		A position within the goal polygon. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the searches. The pointer is stored.
+	/// @returns The status flags for the operation.
+	dtStatus setGoal(dtPolyRef goalRef, const float* goalPos, const dtQueryFilter* filter);
+
+	/// Finds a path from the start polygon to the goal, repairing the search tree after
+	/// the changes reported since the previous call.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to goal.)
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	/// @returns The status flags for the query.
+	dtStatus findPath(dtPolyRef startRef, dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Reports that the tiles at the specified grid location were added, removed, rebuilt
+	/// or had their polygon flags changed.
+	///  @param[in]		tx		The tile's x-location.
+	///  @param[in]		ty		The tile's y-location.
+	void markTileChanged(const int tx, const int ty);
+
+	/// Reports the change of a tile. (See: #dtTileListener)
+	virtual void tileAdded(const dtNavMesh* nav, const dtMeshTile* tile);
+
+	/// Reports the change of a tile. (See: #dtTileListener)
+	virtual void tileRemoved(const dtNavMesh* nav, const dtMeshTile* tile);
+
+	/// The reference id of the goal polygon.
+	dtPolyRef getGoalRef() const { return m_goalRef; }
+
+	/// The number of polygons expanded by the last call to #findPath.
+	int getExpandedCount() const { return m_expanded; }
+
+	/// The number of polygons in the search tree.
+	int getNodeCount() const { return m_nodeCount; }
+
+	/// Gets the amount of memory used by the query object in bytes.
+	int getMemUsed() const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtIncrementalPathQuery(const dtIncrementalPathQuery&);
+	dtIncrementalPathQuery& operator=(const dtIncrementalPathQuery&);
+
+	struct dtIncrementalNode
+	{
+		dtPolyRef ref;
+		float pos[3];		///< Position the costs to and from the polygon are measured at.
+		float g;			///< Cost to the goal found by the last expansion.
+		float rhs;			///< Cost to the goal through the best neighbour.
+		float key[2];		///< Priority in the open list.
+		int heapIndex;		///< Index in the open list, or -1.
+	};
+
+	static const int MAX_CHANGED_TILES = 32;
+
+	void purge();
+	void reset();
+	int findNode(dtPolyRef ref) const;
+	int createNode(dtPolyRef ref);
+	void insertNode(const int idx);
+	void removeDeadNodes();
+	void getNodePos(dtPolyRef ref, float* pos) const;
+	float calcRhs(dtPolyRef ref, const float* pos, dtPolyRef* bestRef) const;
+	void updateVertex(const int idx);
+	void updateRef(dtPolyRef ref);
+	void updateNeighbours(const int idx);
+	void calcKey(const int idx, float* key) const;
+	void processChanges();
+	void computeShortestPath();
+
+	bool keyLess(const float* a, const float* b) const;
+	void heapPush(const int idx);
+	void heapRemove(const int idx);
+	void bubbleUp(int i);
+	void trickleDown(int i);
+
+	const dtNavMesh* m_nav;
+	const dtQueryFilter* m_filter;
+	dtIncrementalNode* m_nodes;
+	int* m_table;				///< Open addressed map from polygon references to nodes, -1 for empty slots.
+	int* m_heap;				///< Open list of node indices.
+	int m_maxNodes;
+	int m_nodeCount;
+	int m_tableMask;
+	int m_heapSize;
+
+	dtPolyRef m_goalRef;
+	float m_goalPos[3];
+	dtPolyRef m_startRef;		///< Start of the previous search.
+	float m_startPos[3];
+	float m_km;					///< Sum of the heuristic shifts of the start moves.
+	int m_expanded;
+	bool m_outOfNodes;
+
+	int m_changedTiles[MAX_CHANGED_TILES*2];
+	int m_changedCount;
+	bool m_changeOverflow;		///< Too many changes to track, the search is restarted.
+};
+
+/// Allocates an incremental path query object using the Detour allocator.
+/// @return An allocated query object, or null on failure.
+/// @ingroup detour
+dtIncrementalPathQuery* dtAllocIncrementalPathQuery();
+
+/// Frees the specified incremental path query object using the Detour allocator.
+///  @param[in]		query		A query object allocated using #dtAllocIncrementalPathQuery
+/// @ingroup detour
+void dtFreeIncrementalPathQuery(dtIncrementalPathQuery* query);
+
+#endif // DETOURINCREMENTALPATH_H
@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURLANDMARKTABLE_H
+#define DETOURLANDMARKTABLE_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// The maximum number of landmarks in a landmark table.
+/// @ingroup detour
+static const int DT_MAX_LANDMARKS = 16;
+
+/// A magic number used to detect compatibility of landmark table data.
+/// @ingroup detour
+static const int DT_LANDMARK_MAGIC = 'D'<<24 | 'N'<<16 | 'L'<<8 | 'M';
+
+/// A version number used to detect compatibility of landmark table data.
+/// @ingroup detour
+static const int DT_LANDMARK_VERSION = 2;
+
+/// The distance stored for polygons that cannot be reached from a landmark.
+/// @ingroup detour
+static const float DT_LANDMARK_UNREACHABLE = -1.0f;
+
+/// Stores the distances from a small set of landmark polygons to every polygon of a
+/// navigation mesh, used as an A* heuristic by dtNavMeshQuery. (ALT: A*, landmarks
+/// and the triangle inequality.)
+/// @ingroup detour
+class dtLandmarkTable : public dtTileListener
+{
+public:
+	dtLandmarkTable();
+	virtual ~dtLandmarkTable();
+
+	/// Initializes the table and registers it as a tile listener of the navigation mesh.
+	/// The distances are not computed until #build or #restore is called.
+	///  @param[in]		nav				The navigation mesh.
+	///  @param[in]		filter			The filter used to compute the distances.
+	///  @param[in]		landmarkCount	The number of landmarks. [Limits: 0 < value <= #DT_MAX_LANDMARKS]
+	/// @returns The status flags for the operation.
+	dtStatus init(dtNavMesh* nav, const dtQueryFilter* filter, const int landmarkCount);
+
+	/// Selects the landmarks and computes the distances for all tiles.
+	/// @returns The status flags for the operation.
+	dtStatus build();
+
+	/// Recomputes the distances of the links of a single tile from the distances
+	/// of its neighbour tiles, and passes shorter routes through the tile on to the
+	/// rest of the navigation mesh.
+	///  @param[in]		tile	The tile to rebuild.
+	void rebuildTile(const dtMeshTile* tile);
+
+	/// Gets the distance bounds from each landmark to the specified polygon.
+	/// The first #getLandmarkCount values are the smallest distances of the polygon's
+	/// nodes, and the next #getLandmarkCount values are the largest ones.
+	///  @param[in]		ref		The reference of the polygon.
+	/// @returns The distance bounds [Size: 2 * #getLandmarkCount], or null if the polygon has no distances.
+	inline const float* getPolyDistances(dtPolyRef ref) const
+	{
+		if (!m_nav)
+			return 0;
+		unsigned int salt, it, ip;
+		m_nav->decodePolyId(ref, salt, it, ip);
+		if ((int)it >= m_maxTiles)
+			return 0;
+		const dtLandmarkTile& lt = m_tiles[it];
+		if (!lt.dist || lt.salt != salt || (int)ip >= lt.polyCount)
+			return 0;
+		return &lt.dist[ip*m_landmarkCount*2];
+	}
+
+	/// Returns the lower bound of the cost of moving from one polygon to another,
+	/// given their landmark distances.
+	///  @param[in]		from	The landmark distances of the polygon to move from. (See: #getPolyDistances)
+	///  @param[in]		to		The landmark distances of the polygon to move to. (See: #getPolyDistances)
+	/// @returns The largest amount any landmark is farther from the second polygon than from the first one.
+	inline float getLowerBound(const float* from, const float* to) const
+	{
+		const float* fromMax = from + m_landmarkCount;
+		float h = 0.0f;
+		for (int i = 0; i < m_landmarkCount; ++i)
+		{
+			if (fromMax[i] < 0.0f || to[i] < 0.0f)
+				continue;
+			const float d = to[i] - fromMax[i];
+			if (d > h)
+				h = d;
+		}
+		return h;
+	}
+
+	/// The number of landmarks in the table.
+	int getLandmarkCount() const { return m_landmarkCount; }
+
+	/// Gets the reference of a landmark polygon.
+	dtPolyRef getLandmarkRef(const int i) const { return m_landmarks[i]; }
+
+	/// Gets the size of the buffer required to store the table.
+	int getDataSize() const;
+
+	/// Stores the table to a buffer.
+	///  @param[out]	data		The buffer to store the table to.
+	///  @param[in]		maxDataSize	The size of the buffer. (See: #getDataSize)
+	/// @returns The status flags for the operation.
+	dtStatus store(unsigned char* data, const int maxDataSize) const;
+
+	/// Restores the table from a buffer created with #store.
+	/// Tiles whose links do not match the stored ones are rebuilt from their neighbours.
+	///  @param[in]		data		The stored table.
+	///  @param[in]		dataSize	The size of the stored data.
+	/// @returns The status flags for the operation.
+	dtStatus restore(const unsigned char* data, const int dataSize);
+
+	/// Gets the amount of memory used by the table in bytes.
+	int getMemUsed() const;
+
+	/// @name dtTileListener Implementation
+	///@{
+	virtual void tileAdded(const dtNavMesh* nav, const dtMeshTile* tile);
+	virtual void tileRemoved(const dtNavMesh* nav, const dtMeshTile* tile);
+	///@}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtLandmarkTable(const dtLandmarkTable&);
+	dtLandmarkTable& operator=(const dtLandmarkTable&);
+
+	/// A search node: the link through which a polygon is entered and the node position
+	/// dtNavMeshQuery gives the polygon when it enters it through the link.
+	struct dtLandmarkNode
+	{
+		int tile;					///< Index of the tile of the link.
+		unsigned int link;			///< Index of the link in the tile.
+		unsigned int poly;			///< Index of the polygon the link belongs to.
+		float pos[3];				///< Node position.
+	};
+
+	struct dtLandmarkTile
+	{
+		unsigned int salt;			///< Salt of the tile the distances were computed for.
+		int polyCount;				///< Number of polygons in the tile.
+		int linkCount;				///< Number of links in the tile.
+		float* dist;				///< Distance bounds of the polygons. [Size: polyCount * landmarkCount * 2]
+		float* linkDist;			///< Distances of the nodes entered through the links of the tile. [Size: linkCount * landmarkCount]
+		int* firstNode;				///< Index of the first node of each polygon. [Size: polyCount + 1]
+		dtLandmarkNode* nodes;		///< Nodes of the polygons of the tile.
+		int nodeCapacity;			///< Capacity of the nodes array.
+		bool dirty;					///< True if the distance bounds of the tile need updating.
+	};
+
+	void purge();
+	bool allocTile(const dtMeshTile* tile);
+	void freeTile(const int tileIndex);
+	bool buildNodes(const dtMeshTile* tile);
+	bool buildNeighbourNodes(const dtMeshTile* tile, const int skipTile);
+	void updateBounds(const int tileIndex);
+	void updateDirtyBounds();
+	bool isLandmarkCandidate(const dtMeshTile* tile, const int polyIndex) const;
+	bool pushPolyNodes(const int landmark, const int tileIndex, const unsigned int polyIndex, const bool seed);
+	bool searchFrom(const int landmark, const dtPolyRef ref);
+	bool seedTile(const dtMeshTile* tile, const int landmark);
+	bool runDijkstra(const int landmark);
+	float* getNodeDist(const dtLandmarkNode& node, const int landmark) const;
+
+	dtNavMesh* m_nav;
+	const dtQueryFilter* m_filter;
+	dtLandmarkTile* m_tiles;
+	int m_maxTiles;
+	int m_landmarkCount;
+	dtPolyRef m_landmarks[DT_MAX_LANDMARKS];
+
+	struct dtLandmarkHeapItem
+	{
+		float cost;
+		int tile;
+		int node;
+	};
+	dtLandmarkHeapItem* m_heap;		///< Open list of the distance searches.
+	int m_heapSize;
+	int m_heapCapacity;
+
+	bool pushHeap(const float cost, const int tile, const int node);
+	dtLandmarkHeapItem popHeap();
+};
+
+/// Allocates a landmark table object using the Detour allocator.
+/// @return An allocated landmark table object, or null on failure.
+/// @ingroup detour
+dtLandmarkTable* dtAllocLandmarkTable();
+
+/// Frees the specified landmark table object using the Detour allocator.
+///  @param[in]		table		A landmark table object allocated using #dtAllocLandmarkTable
+/// @ingroup detour
+void dtFreeLandmarkTable(dtLandmarkTable* table);
+
+#endif // DETOURLANDMARKTABLE_H
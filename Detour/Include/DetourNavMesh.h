@@ -70,7 +70,11 @@ static const int DT_VERTS_PER_POLYGON = 6;
 static const int DT_NAVMESH_MAGIC = 'D'<<24 | 'N'<<16 | 'A'<<8 | 'V';
 
 /// A version number used to detect compatibility of navigation tile data.
-static const int DT_NAVMESH_VERSION = 7;
+static const int DT_NAVMESH_VERSION = 8;
+
+/// The oldest navigation tile data version that can still be loaded.
+/// (Version 7 tiles have a shorter header and no 4-wide bounding volume tree.)
+static const int DT_NAVMESH_MIN_VERSION = 7;
 
 /// A magic number used to detect the compatibility of navigation tile states.
 static const int DT_NAVMESH_STATE_MAGIC = 'D'<<24 | 'N'<<16 | 'M'<<8 | 'S';
@@ -94,6 +98,10 @@ static const unsigned int DT_OFFMESH_CON_BIDIR = 1;
 /// @ingroup detour
 static const int DT_MAX_AREAS = 64;
 
+/// The maximum number of tile listeners a navigation mesh can notify.
+/// @ingroup detour
+static const int DT_MAX_TILE_LISTENERS = 8;
+
 /// Tile flags used for various functions and fields.
 /// For an example, see dtNavMesh::addTile().
 enum dtTileFlags
@@ -102,6 +110,22 @@ enum dtTileFlags
 	DT_TILE_FREE_DATA = 0x01
 };
 
+/// Navigation mesh options. (See: dtNavMeshParams::flags)
+enum dtNavMeshFlags
+{
+	/// Each tile keeps a table of the portal geometry of its links,
+	/// so queries do not have to rebuild the portals from the polygon edges.
+	DT_NAVMESH_PORTAL_TABLE = 0x01,
+
+	/// Each tile keeps a grid of the polygons overlapping each cell on the xz-plane,
+	/// so a position can be located without searching the tile.
+	DT_NAVMESH_POLY_GRID = 0x02,
+
+	/// Each tile keeps precomputed data of its detail triangles, and a grid of the triangles
+	/// of large polygons, so height queries do not have to test every triangle of a polygon.
+	DT_NAVMESH_DETAIL_PLANES = 0x04
+};
+
 /// Vertex flags returned by dtNavMeshQuery::findStraightPath.
 enum dtStraightPathFlags
 {
@@ -118,10 +142,12 @@ enum dtStraightPathOptions
 };
 
 
-/// Options for dtNavMeshQuery::initSlicedFindPath and updateSlicedFindPath
+/// Options for dtNavMeshQuery::findPath, initSlicedFindPath and updateSlicedFindPath
 enum dtFindPathOptions
 {
-	DT_FINDPATH_ANY_ANGLE	= 0x02		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_ANY_ANGLE		= 0x02,		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_BIDIRECTIONAL	= 0x04,		///< search from both the start and the end polygon and join the two frontiers (cannot be combined with #DT_FINDPATH_ANY_ANGLE)
+	DT_FINDPATH_ANYTIME			= 0x08		///< keep improving a weighted sliced search after the first path is found
 };
 
 /// Options for dtNavMeshQuery::raycast
@@ -209,6 +235,66 @@ struct dtLink
 	unsigned char bmax;				///< If a boundary link, defines the maximum sub-edge area.
 };
 
+/// Portal geometry of a link, clamped to the link's sub-edge area.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile, #DT_NAVMESH_PORTAL_TABLE
+struct dtLinkPortal
+{
+	float left[3];					///< The left portal vertex.
+	float right[3];					///< The right portal vertex.
+	float mid[3];					///< The portal midpoint.
+};
+
+/// A uniform grid over a tile on the xz-plane, listing the polygons that overlap each cell.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile, #DT_NAVMESH_POLY_GRID
+struct dtPolyGrid
+{
+	float bmin[3];					///< The minimum bounds of the grid. (The minimum bounds of the tile.)
+	float cellSize;					///< The size of the grid cells on the xz-plane.
+	int width;						///< The number of cells along the x-axis.
+	int height;						///< The number of cells along the z-axis.
+	unsigned int* cells;			///< The first entry of each cell in #polys. [Size: width * height + 1]
+	unsigned short* polys;			///< The indices of the polygons overlapping each cell.
+	int memSize;					///< The size of the grid allocation in bytes.
+};
+
+/// A detail triangle prepared for height queries: the first vertex, the edges from it and
+/// the denominator of the barycentric coordinates on the xz-plane.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtDetailPlanes
+struct dtDetailTriPlane
+{
+	float a[3];						///< The first vertex of the triangle.
+	float ac[3];					///< The edge from the first to the third vertex.
+	float ab[3];					///< The edge from the first to the second vertex.
+	float denom;					///< The barycentric denominator, zero if the triangle has no area on the xz-plane.
+};
+
+/// A uniform grid over the detail triangles of a polygon on the xz-plane.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtDetailPlanes
+struct dtDetailTriGrid
+{
+	float bmin[2];					///< The minimum bounds of the grid on the xz-plane.
+	float invCellSize;				///< The inverse of the cell size.
+	unsigned short width;			///< The number of cells along the x-axis, zero if the polygon has no grid.
+	unsigned short height;			///< The number of cells along the z-axis.
+	unsigned int firstCell;			///< The index of the first cell in dtDetailPlanes::cells. The grid has (width * height + 1) entries there.
+};
+
+/// Precomputed height query data of the detail meshes of a tile.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile, #DT_NAVMESH_DETAIL_PLANES
+struct dtDetailPlanes
+{
+	dtDetailTriPlane* planes;		///< The detail triangles, indexed like dtMeshTile::detailTris. [Size: dtMeshHeader::detailTriCount]
+	dtDetailTriGrid* grids;			///< The triangle grid of each polygon. [Size: dtMeshHeader::polyCount]
+	unsigned int* cells;			///< The first entry of each grid cell in #tris.
+	unsigned char* tris;			///< The triangles overlapping each grid cell, indexed within the polygon's detail mesh.
+	int memSize;					///< The size of the allocation in bytes.
+};
+
 /// Bounding volume node.
 /// @note This structure is rarely if ever used by the end user.
 /// @see dtMeshTile
@@ -219,6 +305,24 @@ struct dtBVNode
 	int i;							///< The node's index. (Negative for escape sequence.)
 };
 
+/// The number of children of a dtBVWideNode.
+static const int DT_BVWIDE_CHILDREN = 4;
+
+/// Node of the 4-wide bounding volume tree.
+/// The bounds of the four children are stored per axis, so they can be tested together.
+/// Unused child slots have empty bounds and a zero child.
+/// @note This structure is rarely if ever used by the end user.
+/// @see dtMeshTile
+struct dtBVWideNode
+{
+	unsigned short bmin[3][DT_BVWIDE_CHILDREN];	///< Minimum bounds of the children's AABBs. [(x, y, z) * 4]
+	unsigned short bmax[3][DT_BVWIDE_CHILDREN];	///< Maximum bounds of the children's AABBs. [(x, y, z) * 4]
+
+	/// The children. Positive values are node indices, negative values are leaves
+	/// with the polygon index (-child - 1), zero marks an unused slot.
+	int child[DT_BVWIDE_CHILDREN];
+};
+
 /// Defines an navigation mesh off-mesh connection within a dtMeshTile object.
 /// An off-mesh connection is a user defined traversable connection made up to two vertices.
 struct dtOffMeshConnection
@@ -274,6 +378,10 @@ struct dtMeshHeader
 	
 	/// The bounding volume quantization factor. 
 	float bvQuantFactor;
+
+	/// The number of 4-wide bounding volume nodes. (Zero if the tile has no 4-wide tree.)
+	/// @note Only present in version 8 and later, see #dtGetMeshHeaderSize.
+	int bvWideNodeCount;
 };
 
 /// Defines a navigation mesh tile.
@@ -287,6 +395,19 @@ struct dtMeshTile
 	dtPoly* polys;						///< The tile polygons. [Size: dtMeshHeader::polyCount]
 	float* verts;						///< The tile vertices. [(x, y, z) * dtMeshHeader::vertCount]
 	dtLink* links;						///< The tile links. [Size: dtMeshHeader::maxLinkCount]
+
+	/// The portal geometry of the tile links, indexed like #links. [Size: dtMeshHeader::maxLinkCount]
+	/// (Will be null unless the mesh was created with #DT_NAVMESH_PORTAL_TABLE.)
+	dtLinkPortal* portals;
+
+	/// The grid of the tile polygons on the xz-plane.
+	/// (Will be null unless the mesh was created with #DT_NAVMESH_POLY_GRID.)
+	dtPolyGrid* polyGrid;
+
+	/// The height query data of the detail meshes.
+	/// (Will be null unless the mesh was created with #DT_NAVMESH_DETAIL_PLANES.)
+	dtDetailPlanes* detailPlanes;
+
 	dtPolyDetail* detailMeshes;			///< The tile's detail sub-meshes. [Size: dtMeshHeader::detailMeshCount]
 	
 	/// The detail mesh's unique vertices. [(x, y, z) * dtMeshHeader::detailVertCount]
@@ -301,6 +422,10 @@ struct dtMeshTile
 	dtBVNode* bvTree;
 
 	dtOffMeshConnection* offMeshCons;		///< The tile off-mesh connections. [Size: dtMeshHeader::offMeshConCount]
+
+	/// The tile 4-wide bounding volume nodes. [Size: dtMeshHeader::bvWideNodeCount]
+	/// (Will be null if the tile was built without the 4-wide tree.)
+	dtBVWideNode* bvWideTree;
 		
 	unsigned char* data;					///< The tile data. (Not directly accessed under normal situations.)
 	int dataSize;							///< Size of the tile data.
@@ -320,8 +445,15 @@ inline int dtGetDetailTriEdgeFlags(unsigned char triFlags, int edgeIndex)
 	return (triFlags >> (edgeIndex * 2)) & 0x3;
 }
 
+/// Gets the size of the header at the start of the tile data.
+/// @param[in]	version		The tile data format version. [Limits: #DT_NAVMESH_MIN_VERSION <= value <= #DT_NAVMESH_VERSION]
+/// @return The aligned size of the header in bytes.
+int dtGetMeshHeaderSize(int version);
+
 /// Configuration parameters used to define multi-tile navigation meshes.
 /// The values are used to allocate space during the initialization of a navigation mesh.
+/// Clear the structure (e.g. with memset) before filling it in, so that the optional
+/// fields default to zero: no optional tables and an automatic poly grid cell size.
 /// @see dtNavMesh::init()
 /// @ingroup detour
 struct dtNavMeshParams
@@ -331,6 +463,30 @@ struct dtNavMeshParams
 	float tileHeight;				///< The height of each tile. (Along the z-axis.)
 	int maxTiles;					///< The maximum number of tiles the navigation mesh can contain. This and maxPolys are used to calculate how many bits are needed to identify tiles and polygons uniquely.
 	int maxPolys;					///< The maximum number of polygons each tile can contain. This and maxTiles are used to calculate how many bits are needed to identify tiles and polygons uniquely.
+	int flags;						///< Navigation mesh options, zero for none. Unknown bits are rejected. (See: #dtNavMeshFlags)
+	float polyGridCellSize;			///< The cell size of the polygon grids, zero picks about one cell per polygon. (See: #DT_NAVMESH_POLY_GRID)
+};
+
+class dtNavMesh;
+
+/// Receives notifications when tiles are added to or removed from a navigation mesh.
+/// Used to keep data derived from the tiles up to date. (See: dtNavMesh::addTileListener)
+/// @ingroup detour
+class dtTileListener
+{
+public:
+	virtual ~dtTileListener();
+
+	/// Called after a tile has been added and linked to its neighbours.
+	///  @param[in]		nav		The navigation mesh the tile was added to.
+	///  @param[in]		tile	The new tile.
+	virtual void tileAdded(const dtNavMesh* nav, const dtMeshTile* tile) = 0;
+
+	/// Called when a tile is removed, after its neighbours have been unlinked from it
+	/// but before the tile data is released.
+	///  @param[in]		nav		The navigation mesh the tile is removed from.
+	///  @param[in]		tile	The tile being removed.
+	virtual void tileRemoved(const dtNavMesh* nav, const dtMeshTile* tile) = 0;
 };
 
 /// A navigation mesh based on tiles of convex polygons.
@@ -376,6 +532,15 @@ public:
 	/// @return The status flags for the operation.
 	dtStatus removeTile(dtTileRef ref, unsigned char** data, int* dataSize);
 
+	/// Registers a listener to be notified when tiles are added or removed.
+	///  @param[in]		listener	The listener to add.
+	/// @return The status flags for the operation.
+	dtStatus addTileListener(dtTileListener* listener);
+
+	/// Unregisters a listener previously added with #addTileListener.
+	///  @param[in]		listener	The listener to remove.
+	void removeTileListener(dtTileListener* listener);
+
 	/// @}
 
 	/// @{
@@ -424,6 +589,14 @@ public:
 	/// The maximum number of tiles supported by the navigation mesh.
 	/// @return The maximum number of tiles supported by the navigation mesh.
 	int getMaxTiles() const;
+
+	/// The memory used by the polygon grids of all tiles. (See: #DT_NAVMESH_POLY_GRID)
+	/// @return The size of the polygon grids in bytes.
+	int getPolyGridMemUsed() const;
+
+	/// The memory used by the detail triangle data of all tiles. (See: #DT_NAVMESH_DETAIL_PLANES)
+	/// @return The size of the detail triangle data in bytes.
+	int getDetailPlanesMemUsed() const;
 	
 	/// Gets the tile at the specified index.
 	///  @param[in]	i		The tile index. [Limit: 0 >= index < #getMaxTiles()]
@@ -666,6 +839,9 @@ private:
 	dtMeshTile** m_posLookup;			///< Tile hash lookup. 哈希桶
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
+
+	dtTileListener* m_listeners[DT_MAX_TILE_LISTENERS];	///< Listeners notified of tile changes.
+	int m_listenerCount;				///< Number of registered listeners.
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
@@ -101,6 +101,10 @@ struct dtNavMeshCreateParams
 	/// @note The BVTree is not normally needed for layered navigation meshes.
 	bool buildBvTree;
 
+	/// True if a 4-wide bounding volume tree should also be built for the tile, so polygon
+	/// queries can test four bounds at once. (Requires #buildBvTree.)
+	bool buildWideBvTree;
+
 	/// @}
 };
 
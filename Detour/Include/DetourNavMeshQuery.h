@@ -20,7 +20,9 @@
 #define DETOURNAVMESHQUERY_H
 
 #include "DetourNavMesh.h"
+#include "DetourCommon.h"
 #include "DetourStatus.h"
+#include "DetourTime.h"
 
 
 // Define DT_VIRTUAL_QUERYFILTER if you wish to derive a custom filter from dtQueryFilter.
@@ -119,6 +121,48 @@ public:
 
 };
 
+#ifndef DT_VIRTUAL_QUERYFILTER
+// The default implementation is defined here so that it is inlined into all the
+// modules searching the navigation mesh, not only dtNavMeshQuery.
+inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
+									  const dtMeshTile* /*tile*/,
+									  const dtPoly* poly) const
+{
+	return (poly->flags & m_includeFlags) != 0 && (poly->flags & m_excludeFlags) == 0;
+}
+
+inline float dtQueryFilter::getCost(const float* pa, const float* pb,
+									const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
+									const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
+									const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
+{
+	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
+}
+#endif
+
+/// Returns true if two filters are known to pass the same polygons.
+/// Data built for one filter, such as a dtPolyAreaTable, dtWallDistanceField or
+/// a dtComponentIndex class, can then be used for queries with the other.
+/// Unless DT_VIRTUAL_QUERYFILTER is defined, the polygons a filter passes only depend
+/// on its include and exclude flags, so filters with the same flags are equivalent.
+/// Otherwise only a filter is equivalent to itself.
+///  @param[in]		a	The first filter.
+///  @param[in]		b	The second filter.
+/// @ingroup detour
+inline bool dtEquivalentFilters(const dtQueryFilter* a, const dtQueryFilter* b)
+{
+	if (!a || !b)
+		return false;
+	if (a == b)
+		return true;
+#ifndef DT_VIRTUAL_QUERYFILTER
+	return a->getIncludeFlags() == b->getIncludeFlags() &&
+		   a->getExcludeFlags() == b->getExcludeFlags();
+#else
+	return false;
+#endif
+}
+
 /// Provides information about raycast hit
 /// filled by dtNavMeshQuery::raycast
 /// @ingroup detour
@@ -159,6 +203,26 @@ public:
 	virtual void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count) = 0;
 };
 
+/// Receives the vertices of a straight path as they are found.
+/// Used by dtNavMeshQuery::findStraightPath.
+/// @ingroup detour
+class dtStraightPathSink
+{
+public:
+	virtual ~dtStraightPathSink();
+
+	/// Called for each new vertex of the straight path, in order from the start.
+	///  @param[in]		pos		The position of the vertex. [(x, y, z)]
+	///  @param[in]		flags	Flags describing the vertex. (See: #dtStraightPathFlags)
+	///  @param[in]		ref		The reference id of the polygon that is being entered at the vertex.
+	/// @returns False to stop the query after this vertex.
+	virtual bool appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref) = 0;
+
+	/// Called instead of #appendVertex when a vertex is at the position of the previous
+	/// one. The previous vertex takes the new flags and polygon reference.
+	virtual void updateVertex(const unsigned char flags, const dtPolyRef ref) = 0;
+};
+
 /// Provides the ability to perform pathfinding related queries against
 /// a navigation mesh.
 /// @ingroup detour
@@ -170,9 +234,11 @@ public:
 	
 	/// Initializes the query object.
 	///  @param[in]		nav			Pointer to the dtNavMesh object to use for all queries.
-	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= 65535]
+	///  @param[in]		maxNodes		Maximum number of search nodes. [Limits: 0 < value <= 65535]
+	///  @param[in]		maxSpillNodes	Number of extra search nodes allocated on demand when a search runs
+	///  								out of nodes. [Limits: 0 <= @p maxNodes + value <= 65535]
 	/// @returns The status flags for the query.
-	dtStatus init(const dtNavMesh* nav, const int maxNodes);
+	dtStatus init(const dtNavMesh* nav, const int maxNodes, const int maxSpillNodes = 0);
 	
 	/// @name Standard Pathfinding Functions
 	/// @{
@@ -187,10 +253,32 @@ public:
 	///  							[(polyRef) * @p pathCount]
 	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
 	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		options		Query options. Only #DT_FINDPATH_BIDIRECTIONAL is used. (see: #dtFindPathOptions)
+	///  @param[in]		heuristicWeight	The weight of the search heuristic. [Limit: >= 1]
 	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
 					  const float* startPos, const float* endPos,
 					  const dtQueryFilter* filter,
-					  dtPolyRef* path, int* pathCount, const int maxPath) const;
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const unsigned int options = 0, const float heuristicWeight = 1.0f) const;
+
+	/// Finds the cheapest path from the start polygon to any of the goal polygons, using a single search.
+	///  @param[in]		startRef		The refrence id of the start polygon.
+	///  @param[in]		startPos		A position within the start polygon. [(x, y, z)]
+	///  @param[in]		goalRefs		The reference ids of the goal polygons. [(polyRef) * @p goalCount]
+	///  @param[in]		goalPositions	A position within each goal polygon. [(x, y, z) * @p goalCount]
+	///  @param[in]		goalCount		The number of goals. [Limit: > 0]
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[out]	path			An ordered list of polygon references representing the path. (Start to goal.) 
+	///  								[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount		The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath			The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[out]	goalIndex		The index of the goal the path leads to, or -1 if no goal was reached. [opt]
+	/// @returns The status flags for the query.
+	dtStatus findPathToAny(dtPolyRef startRef, const float* startPos,
+						   const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount,
+						   const dtQueryFilter* filter,
+						   dtPolyRef* path, int* pathCount, const int maxPath,
+						   int* goalIndex = 0) const;
 
 	/// Finds the straight path from the start to the end position within the polygon corridor.
 	///  @param[in]		startPos			Path start position. [(x, y, z)]
@@ -209,6 +297,19 @@ public:
 							  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
 							  int* straightPathCount, const int maxStraightPath, const int options = 0) const;
 
+	/// Finds the straight path from the start to the end position within the polygon corridor,
+	/// passing each vertex to a sink as soon as it is found.
+	///  @param[in]		startPos			Path start position. [(x, y, z)]
+	///  @param[in]		endPos				Path end position. [(x, y, z)]
+	///  @param[in]		path				An array of polygon references that represent the path corridor.
+	///  @param[in]		pathSize			The number of polygons in the @p path array.
+	///  @param[in]		sink				Receives the vertices of the straight path.
+	///  @param[in]		options				Query options. (see: #dtStraightPathOptions)
+	/// @returns The status flags for the query.
+	dtStatus findStraightPath(const float* startPos, const float* endPos,
+							  const dtPolyRef* path, const int pathSize,
+							  dtStraightPathSink* sink, const int options = 0) const;
+
 	///@}
 	/// @name Sliced Pathfinding Functions
 	/// Common use case:
@@ -224,10 +325,13 @@ public:
 	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
 	///  @param[in]		filter		The polygon filter to apply to the query.
 	///  @param[in]		options		query options (see: #dtFindPathOptions)
+	///  							#DT_FINDPATH_ANY_ANGLE and #DT_FINDPATH_BIDIRECTIONAL cannot be combined.
+	///  @param[in]		heuristicWeight	The weight of the search heuristic. [Limit: >= 1]
 	/// @returns The status flags for the query.
 	dtStatus initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef,
 								const float* startPos, const float* endPos,
-								const dtQueryFilter* filter, const unsigned int options = 0);
+								const dtQueryFilter* filter, const unsigned int options = 0,
+								const float heuristicWeight = 1.0f);
 
 	/// Updates an in-progress sliced path query.
 	///  @param[in]		maxIter		The maximum number of iterations to perform.
@@ -235,6 +339,20 @@ public:
 	/// @returns The status flags for the query.
 	dtStatus updateSlicedFindPath(const int maxIter, int* doneIters);
 
+	/// Updates an in-progress sliced path query until it completes or the deadline passes.
+	///  @param[in]		deadline		The time to stop the update by, in microseconds. (see: #dtGetTimeUsec)
+	///  @param[out]	doneIters		The actual number of iterations completed. [opt]
+	///  @param[out]	doneTimeUsec	The actual time spent, in microseconds. [opt]
+	///  @param[in]		checkIters		The number of iterations between the clock checks. [Limit: > 0]
+	/// @returns The status flags for the query.
+	dtStatus updateSlicedFindPathTimed(const dtTimeVal deadline, int* doneIters, int* doneTimeUsec,
+									   const int checkIters = 16);
+
+	/// Gets the cost bound of the best path found by the sliced path query so far.
+	/// @return The factor by which the cost of the path can exceed the optimal cost,
+	/// or FLT_MAX if the end polygon has not been reached yet. Valid until the query is finalized.
+	float getSlicedFindPathBound() const { return m_query.costBound; }
+
 	/// Finalizes and returns the results of a sliced path query.
 	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
 	///  							[(polyRef) * @p pathCount]
@@ -294,6 +412,21 @@ public:
 								  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
 								  int* resultCount, const int maxResult) const;
 	
+	/// Computes the path cost from each source to each target position, running one Dijkstra search per source.
+	///  @param[in]		sourceRefs			The reference ids of the source polygons. [(polyRef) * @p sourceCount]
+	///  @param[in]		sourcePositions		A position within each source polygon. [(x, y, z) * @p sourceCount]
+	///  @param[in]		sourceCount			The number of sources.
+	///  @param[in]		targetRefs			The reference ids of the target polygons. [(polyRef) * @p targetCount]
+	///  @param[in]		targetPositions		A position within each target polygon. [(x, y, z) * @p targetCount]
+	///  @param[in]		targetCount			The number of targets.
+	///  @param[in]		filter				The polygon filter to apply to the query.
+	///  @param[out]	costs				The path costs, row by row, FLT_MAX if a target was not reached.
+	///  									[(cost) * @p sourceCount * @p targetCount]
+	/// @returns The status flags for the query.
+	dtStatus computeCostMatrix(const dtPolyRef* sourceRefs, const float* sourcePositions, const int sourceCount,
+							   const dtPolyRef* targetRefs, const float* targetPositions, const int targetCount,
+							   const dtQueryFilter* filter, float* costs) const;
+	
 	/// Gets a path from the explored nodes in the previous search.
 	///  @param[in]		endRef		The reference id of the end polygon.
 	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.)
@@ -339,6 +472,30 @@ public:
 							 const dtQueryFilter* filter,
 							 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const;
 
+	/// Finds the polygons nearest to a batch of points.
+	///  @param[in]		centers		The centers of the search boxes. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of points.
+	///  @param[in]		halfExtents	The search distance along each axis, shared by all points. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	nearestRefs	The reference id of the nearest polygon for each point. Set to 0 if no polygon is found. [(polyRef) * @p count]
+	///  @param[out]	nearestPts	The nearest point on the polygon for each point. Unchanged if no polygon is found. [opt] [(x, y, z) * @p count]
+	///  @param[out]	isOverPoly	Set for each point to true if its X/Z coordinate lies inside the polygon. Unchanged if no polygon is found. [opt] [(isOverPoly) * @p count]
+	/// @returns The status flags for the query.
+	dtStatus findNearestPolys(const float* centers, const int count, const float* halfExtents,
+							  const dtQueryFilter* filter,
+							  dtPolyRef* nearestRefs, float* nearestPts, bool* isOverPoly) const;
+
+	/// Finds the polygon a position is on: the polygon that contains the position on the
+	/// xz-plane and whose surface is nearest to it in height.
+	///  @param[in]		pos				The position to locate. [(x, y, z)]
+	///  @param[in]		maxHeightDiff	The maximum height difference between the position and the polygon surface.
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[out]	ref				The reference id of the polygon. Will be set to 0 if no polygon is found.
+	///  @param[out]	height			The height of the polygon surface at the position. Unchanged if no polygon is found. [opt]
+	/// @returns The status flags for the query.
+	dtStatus findPolyAt(const float* pos, const float maxHeightDiff, const dtQueryFilter* filter,
+						dtPolyRef* ref, float* height = 0) const;
+
 	/// 找到点的 x/z 在导航网格上对应的 y 的值
 	/// @param center 查询的中心点，[(x, y, z)] 其中 y 是参考的 y 值
 	/// @param halfExtents 搜索的外扩半径
@@ -346,6 +503,17 @@ public:
 	/// @param height 查找到的高度的结果
 	/// @return 本次查询的状态
 	dtStatus findPositionHeight(const float *center, const float *halfExtents, const dtQueryFilter *filter, float *height) const;
+
+	/// Finds the height of the navigation mesh below or above a batch of points.
+	///  @param[in]		centers		The points to sample, the y-values are the reference heights. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of points.
+	///  @param[in]		halfExtents	The search distance along each axis. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	heights		The height for each point. Unchanged for points without a polygon. [(height) * @p count]
+	///  @param[out]	found		Set for each point to true if a height was found, false otherwise. [opt] [(found) * @p count]
+	/// @returns The status flags for the query.
+	dtStatus findPositionHeights(const float* centers, const int count, const float* halfExtents,
+								 const dtQueryFilter* filter, float* heights, bool* found) const;
 	
 	/// Finds polygons that overlap the search box.
 	///  @param[in]		center		The center of the search box. [(x, y, z)]
@@ -430,6 +598,23 @@ public:
 					 const dtQueryFilter* filter, const unsigned int options,
 					 dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
 
+	/// Casts several 'walkability' rays that start in the same polygon. The rays
+	/// that are in the same polygon are tested against its edges together, which is
+	/// cheaper than calling #raycast for each ray when the rays are close together.
+	///  @param[in]		startRef	The reference id of the polygon containing all start positions.
+	///  @param[in]		startPos	The start positions of the rays. [(x, y, z) * @p rayCount]
+	///  @param[in]		endPos		The positions to cast the rays toward. [(x, y, z) * @p rayCount]
+	///  @param[in]		rayCount	The number of rays.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		options		govern how the raycast behaves. See dtRaycastOptions
+	///  @param[out]	hits		The raycast hit structures, one per ray. [Size: @p rayCount]
+	///  @param[out]	rayStatus	The status flags of each ray. [opt] [Size: @p rayCount]
+	///  @param[in]		prevRef		parent of start ref. Used during for cost calculation [opt]
+	/// @returns The status flags for the query.
+	dtStatus raycastBatch(dtPolyRef startRef, const float* startPos, const float* endPos, const int rayCount,
+						  const dtQueryFilter* filter, const unsigned int options,
+						  dtRaycastHit* hits, dtStatus* rayStatus = 0, dtPolyRef prevRef = 0) const;
+
 
 	/// Finds the distance from the specified position to the nearest polygon wall.
 	///  @param[in]		startRef		The reference id of the polygon containing @p centerPos.
@@ -459,7 +644,8 @@ public:
 								 const int maxSegments) const;
 
 	/// Returns random location on navmesh.
-	/// Polygons are chosen weighted by area. The search runs in linear related to number of polygon.
+	/// Polygons are chosen weighted by area. The search runs in linear related to number of polygon,
+	/// or in logarithmic time with a matching polygon area table. (See: #setPolyAreaTable)
 	///  @param[in]		filter			The polygon filter to apply to the query.
 	///  @param[in]		frand			Function returning a random number [0..1).
 	///  @param[out]	randomRef		The reference id of the random location.
@@ -482,6 +668,28 @@ public:
 	dtStatus findRandomPointAroundCircle(dtPolyRef startRef, const float* centerPos, const float maxRadius,
 										 const dtQueryFilter* filter, float (*frand)(),
 										 dtPolyRef* randomRef, float* randomPt) const;
+
+	/// Returns random location on navmesh near the specified location, sampled from the polygon
+	/// area table instead of searching the circle. Polygons are chosen weighted by area.
+	/// The location is within the circle on the xz-plane, within @p maxHeight of the center
+	/// vertically, and on a polygon connected to the start polygon. Unlike with
+	/// #findRandomPointAroundCircle, the connection may leave the circle, so the location can
+	/// be behind a wall or on another floor within the height range.
+	/// Needs a polygon area table and a component index matching the filter, and a circle at
+	/// least a tile wide. Otherwise, or when no location is found with a few tries, the
+	/// location is picked by #findRandomPointAroundCircle. (See: #setPolyAreaTable, #setComponentIndex)
+	///  @param[in]		startRef		The reference id of the polygon the location must be connected to.
+	///  @param[in]		centerPos		The center of the circle. [(x, y, z)]
+	///  @param[in]		maxRadius		The radius of the circle. [Units: wu]
+	///  @param[in]		maxHeight		The maximum height difference to the center. [Units: wu]
+	///  @param[in]		filter			The polygon filter to apply to the query.
+	///  @param[in]		frand			Function returning a random number [0..1).
+	///  @param[out]	randomRef		The reference id of the random location.
+	///  @param[out]	randomPt		The random location. [(x, y, z)]
+	/// @returns The status flags for the query.
+	dtStatus sampleRandomPointAroundCircle(dtPolyRef startRef, const float* centerPos, const float maxRadius,
+										   const float maxHeight, const dtQueryFilter* filter, float (*frand)(),
+										   dtPolyRef* randomRef, float* randomPt) const;
 	
 	/// Finds the closest point on the specified polygon.
 	///  @param[in]		ref			The reference id of the polygon.
@@ -515,6 +723,13 @@ public:
 	///  @param[in]		filter		The filter to apply.
 	bool isValidPolyRef(dtPolyRef ref, const dtQueryFilter* filter) const;
 
+	/// Returns false if the end polygon is known to be unreachable from the start polygon.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	/// @returns False if the component index proves the end polygon unreachable.
+	bool isReachable(dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter) const;
+
 	/// Returns true if the polygon reference is in the closed list. 
 	///  @param[in]		ref		The reference id of the polygon to check.
 	/// @returns True if the polygon is in closed list.
@@ -528,9 +743,88 @@ public:
 	/// @return The navigation mesh the query object is using.
 	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
 
+	/// Sets the landmark table used to improve the heuristic of the path searches.
+	///  @param[in]		landmarks	The landmark table, or null to use the straight line distance only. [opt]
+	void setLandmarkTable(const class dtLandmarkTable* landmarks) { m_landmarks = landmarks; }
+
+	/// Gets the landmark table used by the path searches.
+	/// @return The landmark table, or null if none is set.
+	const class dtLandmarkTable* getLandmarkTable() const { return m_landmarks; }
+
+	/// Sets the component index used to reject path searches toward unreachable polygons.
+	/// A rejected search returns a partial path holding only the start polygon.
+	///  @param[in]		components	The component index, or null to search without it. [opt]
+	void setComponentIndex(const class dtComponentIndex* components) { m_components = components; }
+
+	/// Gets the component index used by the path searches.
+	/// @return The component index, or null if none is set.
+	const class dtComponentIndex* getComponentIndex() const { return m_components; }
+
+	/// Sets the polygon area table used to pick random locations.
+	///  @param[in]		areas		The polygon area table, or null to sum the areas on each query. [opt]
+	void setPolyAreaTable(const class dtPolyAreaTable* areas) { m_areas = areas; }
+
+	/// Gets the polygon area table used to pick random locations.
+	/// @return The polygon area table, or null if none is set.
+	const class dtPolyAreaTable* getPolyAreaTable() const { return m_areas; }
+
+	/// Sets the wall distance field used to speed up the wall distance queries.
+	///  @param[in]		walls		The wall distance field, or null to always search. [opt]
+	void setWallDistanceField(const class dtWallDistanceField* walls) { m_walls = walls; }
+
+	/// Gets the wall distance field used by the wall distance queries.
+	/// @return The wall distance field, or null if none is set.
+	const class dtWallDistanceField* getWallDistanceField() const { return m_walls; }
+
+	/// @}
+	/// @name Filter Templates
+	/// These functions take the filter as a template parameter, so that the calls to
+	/// passFilter and getCost are resolved at compile time and can be inlined. The
+	/// filter type needs the passFilter and getCost methods of dtQueryFilter with the
+	/// same signatures, it does not have to derive from it. The non-template versions
+	/// of the functions use these with dtQueryFilter.
+	///
+	/// The definitions are in DetourNavMeshQueryTemplates.h, include it to use them with
+	/// your own filter type. The component index is only used with dtQueryFilter itself.
+	/// @{
+
+	/// Finds a path from the start polygon to the end polygon. (See: #findPath)
+	template <class Filter>
+	dtStatus findPathT(dtPolyRef startRef, dtPolyRef endRef,
+					   const float* startPos, const float* endPos,
+					   const Filter* filter,
+					   dtPolyRef* path, int* pathCount, const int maxPath,
+					   const float heuristicWeight = 1.0f) const;
+
+	/// Casts a 'walkability' ray along the surface of the navigation mesh. (See: #raycast)
+	template <class Filter>
+	dtStatus raycastT(dtPolyRef startRef, const float* startPos, const float* endPos,
+					  const Filter* filter, const unsigned int options,
+					  dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
+
+	/// Casts several 'walkability' rays from the same polygon. (See: #raycastBatch)
+	template <class Filter>
+	dtStatus raycastBatchT(dtPolyRef startRef, const float* startPos, const float* endPos, const int rayCount,
+						   const Filter* filter, const unsigned int options,
+						   dtRaycastHit* hits, dtStatus* rayStatus = 0, dtPolyRef prevRef = 0) const;
+
+	/// Finds the polygon nearest to the specified center point. (See: #findNearestPoly)
+	template <class Filter>
+	dtStatus findNearestPolyT(const float* center, const float* halfExtents,
+							  const Filter* filter,
+							  dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly = 0) const;
+
+	/// Finds polygons that overlap the search box. (See: #queryPolygons)
+	template <class Filter>
+	dtStatus queryPolygonsT(const float* center, const float* halfExtents,
+							const Filter* filter, dtPolyQuery* query) const;
+
 	/// @}
 	
 private:
+	// The landmark table measures its distances between the node positions of the path searches.
+	friend class dtLandmarkTable;
+
 	// Explicitly disabled copy constructor and copy assignment operator
 	dtNavMeshQuery(const dtNavMeshQuery&);
 	dtNavMeshQuery& operator=(const dtNavMeshQuery&);
@@ -538,34 +832,113 @@ private:
 	/// Queries polygons within a tile.
 	void queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 							 const dtQueryFilter* filter, dtPolyQuery* query) const;
+	template <class Filter>
+	void queryPolygonsInTileT(const dtMeshTile* tile, const float* qmin, const float* qmax,
+							  const Filter* filter, dtPolyQuery* query) const;
+
+	/// Finds the nearest polygon by visiting the bounding volume tree nodes of the
+	/// tiles nearest first. Gives the same result as queryPolygons with @p query.
+	template <class Filter>
+	void findNearestPolyInTilesT(const float* center, const float* halfExtents,
+								 const Filter* filter, class dtFindNearestPolyQuery* query) const;
+	template <class Filter>
+	void findNearestPolyInSubtreeT(const struct dtNearestPolyNode& item, const Filter* filter,
+								   class dtFindNearestPolyQuery* query, int* bestTile, int* bestNode) const;
+
+	// The component index only knows dtQueryFilter, other filters are assumed to reach everything.
+	template <class Filter>
+	bool isReachableT(dtPolyRef /*startRef*/, dtPolyRef /*endRef*/, const Filter* /*filter*/) const { return true; }
+	bool isReachableT(dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter) const
+	{
+		return isReachable(startRef, endRef, filter);
+	}
+
+	// Returns the polygon a raycast continues into through the edge it leaves the current polygon by,
+	// or 0 if it hits a wall there.
+	template <class Filter>
+	dtPolyRef raycastNextPoly(const dtMeshTile* tile, const dtPoly* poly, const int segMax, const float tmax,
+							  const float* startPos, const float* endPos, const Filter* filter,
+							  const dtMeshTile** nextTile, const dtPoly** nextPoly) const;
 
 	/// Returns portal points between two polygons.
 	dtStatus getPortalPoints(dtPolyRef from, dtPolyRef to, float* left, float* right,
 							 unsigned char& fromType, unsigned char& toType) const;
-	dtStatus getPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
-							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
-							 float* left, float* right) const;
+	static dtStatus getPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+									dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
+									float* left, float* right);
 	
 	/// Returns edge mid point between two polygons.
 	dtStatus getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mid) const;
-	dtStatus getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
-							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
-							 float* mid) const;
+	static dtStatus getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+									dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
+									float* mid);
+
+	/// Returns portal points of a link of the 'from' polygon, read from the tile's portal table when present.
+	inline dtStatus getLinkPortalPoints(const unsigned int link,
+										dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+										dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
+										float* left, float* right) const
+	{
+		if (!fromTile->portals)
+			return getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right);
+		const dtLinkPortal* portal = &fromTile->portals[link];
+		left[0] = portal->left[0]; left[1] = portal->left[1]; left[2] = portal->left[2];
+		right[0] = portal->right[0]; right[1] = portal->right[1]; right[2] = portal->right[2];
+		return DT_SUCCESS;
+	}
+
+	/// Returns edge mid point of a link of the 'from' polygon, read from the tile's portal table when present.
+	static inline dtStatus getLinkMidPoint(const unsigned int link,
+										   dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+										   dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
+										   float* mid)
+	{
+		if (!fromTile->portals)
+			return getEdgeMidPoint(from, fromPoly, fromTile, to, toPoly, toTile, mid);
+		const dtLinkPortal* portal = &fromTile->portals[link];
+		mid[0] = portal->mid[0]; mid[1] = portal->mid[1]; mid[2] = portal->mid[2];
+		return DT_SUCCESS;
+	}
 	
 	// Appends vertex to a straight path
 	dtStatus appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref,
-						  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-						  int* straightPathCount, const int maxStraightPath) const;
+						  dtStraightPathSink* sink, float* lastPos, int* vertexCount) const;
 
 	// Appends intermediate portal points to a straight path.
 	dtStatus appendPortals(const int startIdx, const int endIdx, const float* endPos, const dtPolyRef* path,
-						   float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-						   int* straightPathCount, const int maxStraightPath, const int options) const;
+						   dtStraightPathSink* sink, float* lastPos, int* vertexCount, const int options) const;
+
+	// Runs a Dijkstra search from a single source until all targets are settled.
+	dtStatus computeCostRow(dtPolyRef sourceRef, const float* sourcePos,
+							const dtPolyRef* targetRefs, const float* targetPositions, const int targetCount,
+							const dtQueryFilter* filter, float* costs) const;
+
+	// Returns the estimated cost from a node to the goal of a path search, or from the goal when searching backward.
+	float getHeuristic(dtPolyRef ref, const float* pos, const float* goalDist, const float* goalPos,
+					   const bool backward = false) const;
+
+	// Picks a random point on a polygon.
+	void randomPointInPoly(dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly, float (*frand)(), float* pt) const;
+
+	// Picks a random point within the circle and height range using the polygon area table and the
+	// component index. Returns false if no point was found with a few tries.
+	bool sampleConnectedPointAroundCircle(dtPolyRef startRef, const float* centerPos, const float maxRadius,
+										  const float maxHeight, const dtQueryFilter* filter, float (*frand)(),
+										  dtPolyRef* randomRef, float* randomPt) const;
+
+	// Searches for the nearest wall within the radius, sets hit if one was found.
+	dtStatus findDistanceToWallInRadius(dtPolyRef startRef, const float* centerPos, const float maxRadius,
+										const dtQueryFilter* filter,
+										float* hitDist, float* hitPos, float* hitNormal, bool* hit) const;
 
 	// Gets the path leading to the specified end node.
 	dtStatus getPathToNode(struct dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const;
 	
 	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
+	const class dtLandmarkTable* m_landmarks;	///< Pointer to the landmark table used by the path searches. [opt]
+	const class dtComponentIndex* m_components;	///< Pointer to the component index used by the path searches. [opt]
+	const class dtPolyAreaTable* m_areas;		///< Pointer to the polygon area table used to pick random locations. [opt]
+	const class dtWallDistanceField* m_walls;	///< Pointer to the wall distance field used by the wall distance queries. [opt]
 
 	struct dtQueryData
 	{
@@ -577,12 +950,36 @@ private:
 		const dtQueryFilter* filter;
 		unsigned int options;
 		float raycastLimitSqr;
+		struct dtNode* meetNode[2];		///< Forward and backward nodes where the bidirectional search met.
+		float meetCost;					///< Cost of the best path found by the bidirectional search.
+		float heuristicWeight;			///< Weight of the heuristic in the current search round.
+		float costBound;				///< Cost bound of the best path found so far, FLT_MAX if none.
 	};
 	dtQueryData m_query;				///< Sliced query state.
 
+	// Ends a round of an anytime search and starts the next one with a lower heuristic weight.
+	// Returns false if the round was run without weight and the path is optimal.
+	bool nextAnytimeRound(const float* endDist);
+
+	// Seeds both frontiers of a bidirectional search.
+	void initBidirectional(dtQueryData& query) const;
+
+	// Runs a bidirectional search until the frontiers prove the best join, or until maxIter nodes are expanded.
+	dtStatus updateBidirectional(dtQueryData& query, const int maxIter, int* doneIters) const;
+
+	// Expands the best node of the forward (side 0) or backward (side 1) frontier.
+	bool expandBidirectional(dtQueryData& query, const int side) const;
+
+	// Records the join of a forward and backward node if it improves the best path.
+	void joinBidirectional(dtQueryData& query, struct dtNode* fwdNode, struct dtNode* bwdNode) const;
+
+	// Gets the path found by a bidirectional search.
+	dtStatus getBidirectionalPath(const dtQueryData& query, dtPolyRef* path, int* pathCount, int maxPath) const;
+
 	class dtNodePool* m_tinyNodePool;	///< Pointer to small node pool.
 	class dtNodePool* m_nodePool;		///< Pointer to node pool.
 	class dtNodeQueue* m_openList;		///< Pointer to open list queue.
+	class dtNodeQueue* m_backOpenList;	///< Pointer to the open list of the backward search.
 };
 
 /// Allocates a query object using the Detour allocator.
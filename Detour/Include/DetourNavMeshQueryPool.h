@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHQUERYPOOL_H
+#define DETOURNAVMESHQUERYPOOL_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// A fixed set of query objects bound to the same navigation mesh, leased to
+/// threads running queries concurrently.
+/// @ingroup detour
+class dtNavMeshQueryPool
+{
+public:
+	dtNavMeshQueryPool();
+	~dtNavMeshQueryPool();
+
+	/// Initializes the pool and all of its query objects.
+	///  @param[in]		nav			The navigation mesh the queries use.
+	///  @param[in]		maxQueries	The number of query objects. [Limit: > 0]
+	///  @param[in]		maxNodes	Maximum number of search nodes of each query. [Limits: 0 < value <= 65535]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const int maxQueries, const int maxNodes);
+
+	/// Leases a query object. Safe to call from any thread.
+	/// @returns A query object for exclusive use by the caller, or null if all are leased.
+	dtNavMeshQuery* acquire();
+
+	/// Returns a leased query object to the pool. Safe to call from any thread.
+	///  @param[in]		query		A query object returned by #acquire.
+	void release(dtNavMeshQuery* query);
+
+	/// The number of query objects in the pool.
+	int getMaxQueries() const { return m_maxQueries; }
+
+	/// Gets a query object by index, e.g. to configure it after #init.
+	/// Not safe while the pool is in use by other threads.
+	dtNavMeshQuery* getQuery(const int i) const { return m_queries[i]; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshQueryPool(const dtNavMeshQueryPool&);
+	dtNavMeshQueryPool& operator=(const dtNavMeshQueryPool&);
+
+	void purge();
+
+	dtNavMeshQuery** m_queries;
+	volatile long* m_leased;		///< Non-zero for each query object currently leased.
+	int m_maxQueries;
+};
+
+/// Leases a query object from a pool for the lifetime of the lease object.
+/// @ingroup detour
+class dtNavMeshQueryLease
+{
+public:
+	explicit dtNavMeshQueryLease(dtNavMeshQueryPool* pool) : m_pool(pool), m_query(pool->acquire()) {}
+	~dtNavMeshQueryLease() { if (m_query) m_pool->release(m_query); }
+
+	/// The leased query object, or null if the pool had none left.
+	dtNavMeshQuery* get() const { return m_query; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshQueryLease(const dtNavMeshQueryLease&);
+	dtNavMeshQueryLease& operator=(const dtNavMeshQueryLease&);
+
+	dtNavMeshQueryPool* m_pool;
+	dtNavMeshQuery* m_query;
+};
+
+/// Allocates a query pool object using the Detour allocator.
+/// @return An allocated query pool object, or null on failure.
+/// @ingroup detour
+dtNavMeshQueryPool* dtAllocNavMeshQueryPool();
+
+/// Frees the specified query pool object using the Detour allocator.
+///  @param[in]		pool		A query pool object allocated using #dtAllocNavMeshQueryPool
+/// @ingroup detour
+void dtFreeNavMeshQueryPool(dtNavMeshQueryPool* pool);
+
+#endif // DETOURNAVMESHQUERYPOOL_H
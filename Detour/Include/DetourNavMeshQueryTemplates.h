@@ -0,0 +1,1354 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURNAVMESHQUERYTEMPLATES_H
+#define DETOURNAVMESHQUERYTEMPLATES_H
+
+// Definitions of the filter templates of dtNavMeshQuery. Include this header to call
+// findPathT, raycastT, findNearestPolyT or queryPolygonsT with your own filter type.
+
+#include <float.h>
+#include <string.h>
+#include "DetourNavMeshQuery.h"
+#include "DetourNavMesh.h"
+#include "DetourLandmarkTable.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAssert.h"
+
+// The 4-wide bounding volume tree tests its children with SSE2 or NEON when available.
+// Define DT_BVWIDE_NO_SIMD to use the portable version.
+#if !defined(DT_BVWIDE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define DT_BVWIDE_SSE2
+#elif !defined(DT_BVWIDE_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define DT_BVWIDE_NEON
+#endif
+
+// Quantizes a query box to the bounding volume tree space of a tile.
+inline void dtQuantizeQueryBounds(const dtMeshTile* tile, const float* qmin, const float* qmax,
+								  unsigned short* bmin, unsigned short* bmax)
+{
+	const float* tbmin = tile->header->bmin;
+	const float* tbmax = tile->header->bmax;
+	const float qfac = tile->header->bvQuantFactor;
+
+	// dtClamp query box to world box.
+	float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
+	float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
+	float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
+	float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
+	// Quantize
+	bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
+	bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
+	bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
+	bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
+	bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
+	bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
+}
+
+// Returns a mask of the children of a 4-wide node whose bounds overlap the quantized query box.
+inline unsigned int dtOverlapQuantBoundsWide(const unsigned short* qmin, const unsigned short* qmax, const dtBVWideNode* node)
+{
+	// For unsigned values a <= b exactly when the saturated a - b is zero, so a child overlaps
+	// when all the saturated differences of its lane are zero.
+#if defined(DT_BVWIDE_SSE2)
+	const __m128i qminxy = _mm_set_epi16((short)qmin[1], (short)qmin[1], (short)qmin[1], (short)qmin[1],
+										 (short)qmin[0], (short)qmin[0], (short)qmin[0], (short)qmin[0]);
+	const __m128i qmaxxy = _mm_set_epi16((short)qmax[1], (short)qmax[1], (short)qmax[1], (short)qmax[1],
+										 (short)qmax[0], (short)qmax[0], (short)qmax[0], (short)qmax[0]);
+	const __m128i bminxy = _mm_loadu_si128((const __m128i*)&node->bmin[0][0]);
+	const __m128i bmaxxy = _mm_loadu_si128((const __m128i*)&node->bmax[0][0]);
+	const __m128i bminz = _mm_loadl_epi64((const __m128i*)&node->bmin[2][0]);
+	const __m128i bmaxz = _mm_loadl_epi64((const __m128i*)&node->bmax[2][0]);
+
+	__m128i sep = _mm_or_si128(_mm_subs_epu16(qminxy, bmaxxy), _mm_subs_epu16(bminxy, qmaxxy));
+	sep = _mm_or_si128(sep, _mm_srli_si128(sep, 8));
+	sep = _mm_or_si128(sep, _mm_subs_epu16(_mm_set1_epi16((short)qmin[2]), bmaxz));
+	sep = _mm_or_si128(sep, _mm_subs_epu16(bminz, _mm_set1_epi16((short)qmax[2])));
+
+	// Two mask bits per lane, keep one for each child.
+	const int bits = _mm_movemask_epi8(_mm_cmpeq_epi16(sep, _mm_setzero_si128()));
+	return (unsigned int)((bits & 1) | ((bits >> 1) & 2) | ((bits >> 2) & 4) | ((bits >> 3) & 8));
+#elif defined(DT_BVWIDE_NEON)
+	const uint16x8_t qminxy = vcombine_u16(vdup_n_u16(qmin[0]), vdup_n_u16(qmin[1]));
+	const uint16x8_t qmaxxy = vcombine_u16(vdup_n_u16(qmax[0]), vdup_n_u16(qmax[1]));
+	const uint16x8_t sepxy = vorrq_u16(vqsubq_u16(qminxy, vld1q_u16(&node->bmax[0][0])),
+									   vqsubq_u16(vld1q_u16(&node->bmin[0][0]), qmaxxy));
+	uint16x4_t sep = vorr_u16(vget_low_u16(sepxy), vget_high_u16(sepxy));
+	sep = vorr_u16(sep, vqsub_u16(vdup_n_u16(qmin[2]), vld1_u16(&node->bmax[2][0])));
+	sep = vorr_u16(sep, vqsub_u16(vld1_u16(&node->bmin[2][0]), vdup_n_u16(qmax[2])));
+
+	static const unsigned short childBits[DT_BVWIDE_CHILDREN] = { 1, 2, 4, 8 };
+	uint16x4_t bits = vand_u16(vceq_u16(sep, vdup_n_u16(0)), vld1_u16(childBits));
+	bits = vpadd_u16(bits, bits);
+	bits = vpadd_u16(bits, bits);
+	return vget_lane_u16(bits, 0);
+#else
+	unsigned int mask = 0;
+	for (int k = 0; k < DT_BVWIDE_CHILDREN; ++k)
+	{
+		bool overlap = true;
+		for (int j = 0; j < 3; ++j)
+			overlap = overlap && qmin[j] <= node->bmax[j][k] && qmax[j] >= node->bmin[j][k];
+		if (overlap)
+			mask |= 1u << k;
+	}
+	return mask;
+#endif
+}
+
+// 查找最近的 poly 的查询方法类
+class dtFindNearestPolyQuery : public dtPolyQuery
+{
+	const dtNavMeshQuery* m_query;
+	const float* m_center;
+	float m_nearestDistanceSqr;
+	dtPolyRef m_nearestRef;
+	float m_nearestPoint[3];
+	bool m_overPoly; // 记录 center 是否在最近的 poly 上
+
+public:
+	dtFindNearestPolyQuery(const dtNavMeshQuery* query, const float* center)
+		: m_query(query), m_center(center), m_nearestDistanceSqr(FLT_MAX), m_nearestRef(0), m_nearestPoint(), m_overPoly(false)
+	{
+	}
+
+	virtual ~dtFindNearestPolyQuery();
+
+	dtPolyRef nearestRef() const { return m_nearestRef; }
+	const float* nearestPoint() const { return m_nearestPoint; }
+	bool isOverPoly() const { return m_overPoly; }
+
+	// 批量查询时每个采样点使用一个默认构造的对象，再通过 reset 设置
+	dtFindNearestPolyQuery()
+		: m_query(0), m_center(0), m_nearestDistanceSqr(FLT_MAX), m_nearestRef(0), m_nearestPoint(), m_overPoly(false)
+	{
+	}
+
+	void reset(const dtNavMeshQuery* query, const float* center)
+	{
+		m_query = query;
+		m_center = center;
+		m_nearestDistanceSqr = FLT_MAX;
+		m_nearestRef = 0;
+		m_overPoly = false;
+	}
+
+	// 从所有符合条件的 poly 中找到最近的
+	// tile 处理中的 tile 的指针
+	// polys 已经找到的所有 poly 的数组
+	// refs 已经找到的所有符合要求的 poly 的 ref 的数组
+	void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count)
+	{
+		dtIgnoreUnused(polys); // polys 没用，忽略警告提示
+
+		// 处理 count 个 poly
+		for (int i = 0; i < count; ++i)
+			processPoly(tile, refs[i]);
+	}
+
+	float nearestDistanceSqr() const { return m_nearestDistanceSqr; }
+
+	// Keeps the polygon if it is nearer than the current one, or as near and winsTies is set.
+	// Returns true if the polygon was kept.
+	bool processPoly(const dtMeshTile* tile, const dtPolyRef ref, const bool winsTies = false)
+	{
+		float closestPtPoly[3];
+		float diff[3];
+		bool posOverPoly = false;
+		float d;
+
+		// 计算 center 到 poly 上的投影点
+		// posOverPoly 的意思不是点是否直接在 poly 上，而是 center 在 poly 上的投影是否在 poly 内部
+		m_query->closestPointOnPoly(ref, m_center, closestPtPoly, &posOverPoly);
+
+		// If a point is directly over a polygon and closer than
+		// climb height, favor that instead of straight line nearest point.
+		// 分情况计算实际距离
+		// 如果点在 poly 上的投影在 poly 内部
+		dtVsub(diff, m_center, closestPtPoly);
+		if (posOverPoly)
+		{
+			d = dtAbs(diff[1]) - tile->header->walkableClimb; // 计算 center 到投影点的 y 轴坐标差与可攀爬高度的差值
+			d = d > 0 ? d*d : 0;			
+		}
+		else
+		{
+			d = dtVlenSqr(diff);
+		}
+
+		// 比较并保存最短距离
+		if (d < m_nearestDistanceSqr || (winsTies && d == m_nearestDistanceSqr))
+		{
+			dtVcopy(m_nearestPoint, closestPtPoly);
+
+			m_nearestDistanceSqr = d;
+			m_nearestRef = ref;
+			m_overPoly = posOverPoly;
+			return true;
+		}
+		return false;
+	}
+};
+
+// Returns a lower bound of the distance dtFindNearestPolyQuery measures from the center
+// to any polygon in a bounding volume tree node.
+inline float dtNearestPolyBound(const dtMeshTile* tile, const dtBVNode* node, const float* center)
+{
+	const float* tbmin = tile->header->bmin;
+	const float cs = 1.0f / tile->header->bvQuantFactor;
+	float d[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		// The node bounds are truncated from the detail vertices, pad them by a cell.
+		const float lo = tbmin[i] + (float)((int)node->bmin[i] - 1) * cs;
+		const float hi = tbmin[i] + (float)((int)node->bmax[i] + 1) * cs;
+		d[i] = center[i] < lo ? lo - center[i] : (center[i] > hi ? center[i] - hi : 0.0f);
+	}
+	// Only the height counts when the center may be over a polygon of the node.
+	if (d[0] == 0.0f && d[2] == 0.0f)
+	{
+		const float h = d[1] - tile->header->walkableClimb;
+		return h > 0.0f ? h*h : 0.0f;
+	}
+	return dtVlenSqr(d);
+}
+
+// A bounding volume tree node waiting to be visited by findNearestPolyT.
+struct dtNearestPolyNode
+{
+	float bound;				// Lower bound of the distance to the polygons of the node.
+	const dtMeshTile* tile;		// The tile of the node.
+	int node;					// The index of the node in the tile's tree.
+	int tileIndex;				// The order in which queryPolygons visits the tile.
+	unsigned short qmin[3];		// The search box quantized to the tile.
+	unsigned short qmax[3];
+};
+
+// A fixed size min-heap of nodes ordered by their bound.
+class dtNearestPolyHeap
+{
+public:
+	enum { MAX_NODES = 64 };
+
+	dtNearestPolyHeap() : m_size(0) {}
+
+	bool empty() const { return m_size == 0; }
+	bool full() const { return m_size == MAX_NODES; }
+
+	void push(const dtNearestPolyNode& node)
+	{
+		int i = m_size++;
+		while (i > 0)
+		{
+			const int parent = (i-1)/2;
+			if (m_heap[parent].bound <= node.bound)
+				break;
+			m_heap[i] = m_heap[parent];
+			i = parent;
+		}
+		m_heap[i] = node;
+	}
+
+	dtNearestPolyNode pop()
+	{
+		const dtNearestPolyNode result = m_heap[0];
+		const dtNearestPolyNode& last = m_heap[--m_size];
+		int i = 0;
+		for (;;)
+		{
+			int child = i*2+1;
+			if (child >= m_size)
+				break;
+			if (child+1 < m_size && m_heap[child+1].bound < m_heap[child].bound)
+				child++;
+			if (last.bound <= m_heap[child].bound)
+				break;
+			m_heap[i] = m_heap[child];
+			i = child;
+		}
+		m_heap[i] = last;
+		return result;
+	}
+
+private:
+	dtNearestPolyNode m_heap[MAX_NODES];
+	int m_size;
+};
+
+template <class Filter>
+dtStatus dtNavMeshQuery::findPathT(dtPolyRef startRef, dtPolyRef endRef,
+								   const float* startPos, const float* endPos,
+								   const Filter* filter,
+								   dtPolyRef* path, int* pathCount, const int maxPath,
+								   const float heuristicWeight) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+	
+	// Validate input
+	// 检查输入参数的合法性
+	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !path || maxPath <= 0 ||
+		!dtMathIsfinite(heuristicWeight) || heuristicWeight < 1.0f)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// 如果开始等于结束，那么直接返回寻路成功
+	if (startRef == endRef)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS;
+	}
+
+	// The end polygon is on another island, the best partial path is the start polygon.
+	if (!isReachableT(startRef, endRef, filter))
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS | DT_PARTIAL_RESULT;
+	}
+
+	// 清理池，理论上来说清理放在每次的最后更好吧？
+	m_nodePool->clear();
+	m_openList->clear();
+
+	const float* endDist = m_landmarks ? m_landmarks->getPolyDistances(endRef) : 0;
+
+	// 初始化寻路的起始点
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = getHeuristic(startRef, startPos, endDist, endPos) * heuristicWeight;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+	
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+	
+	bool outOfNodes = false;
+
+	// A* 寻路的过程
+	while (!m_openList->empty())
+	{
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		
+		// Reached the goal, stop searching.
+		if (bestNode->id == endRef)
+		{
+			lastBestNode = bestNode;
+			break;
+		}
+		
+		// Get current poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+		
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+			
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+			
+			// Get neighbour poly and tile.
+			// The API input has been cheked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
+			
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// deal explicitly with crossing tile boundaries
+			unsigned char crossSide = 0;
+			if (bestTile->links[i].side != 0xff)
+				crossSide = bestTile->links[i].side >> 1;
+
+			// get the node
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, crossSide);
+			if (!neighbourNode)
+			{
+				outOfNodes = true;
+				continue;
+			}
+			
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getLinkMidPoint(i, bestRef, bestPoly, bestTile,
+								neighbourRef, neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			// Calculate cost and heuristic.
+			float cost = 0;
+			float heuristic = 0;
+			
+			// Special case for last node.
+			if (neighbourRef == endRef)
+			{
+				// Cost
+				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				const float endCost = filter->getCost(neighbourNode->pos, endPos,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly,
+													  0, 0, 0);
+				
+				cost = bestNode->cost + curCost + endCost;
+				heuristic = 0;
+			}
+			else
+			{
+				// Cost
+				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				cost = bestNode->cost + curCost;
+				heuristic = getHeuristic(neighbourRef, neighbourNode->pos, endDist, endPos) * heuristicWeight;
+			}
+
+			const float total = cost + heuristic;
+			
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+			
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+			
+			// Update nearest node to target so far.
+			if (heuristic < lastBestNodeCost)
+			{
+				lastBestNodeCost = heuristic;
+				lastBestNode = neighbourNode;
+			}
+		}
+	}
+
+	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+
+	if (lastBestNode->id != endRef)
+		status |= DT_PARTIAL_RESULT;
+
+	if (outOfNodes)
+		status |= DT_OUT_OF_NODES;
+	
+	return status;
+}
+
+template <class Filter>
+dtPolyRef dtNavMeshQuery::raycastNextPoly(const dtMeshTile* tile, const dtPoly* poly, const int segMax, const float tmax,
+										  const float* startPos, const float* endPos, const Filter* filter,
+										  const dtMeshTile** nextTile, const dtPoly** nextPoly) const
+{
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtLink* link = &tile->links[i];
+
+		// Find link which contains this edge.
+		if ((int)link->edge != segMax)
+			continue;
+
+		// Get pointer to the next polygon.
+		*nextTile = 0;
+		*nextPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(link->ref, nextTile, nextPoly);
+
+		// Skip off-mesh connections.
+		if ((*nextPoly)->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+
+		// Skip links based on filter.
+		if (!filter->passFilter(link->ref, *nextTile, *nextPoly))
+			continue;
+
+		// If the link is internal, just return the ref.
+		if (link->side == 0xff)
+			return link->ref;
+
+		// If the link is at tile boundary,
+
+		// Check if the link spans the whole edge, and accept.
+		if (link->bmin == 0 && link->bmax == 255)
+			return link->ref;
+
+		// Check for partial edge links.
+		const int v0 = poly->verts[link->edge];
+		const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
+		const float* left = &tile->verts[v0*3];
+		const float* right = &tile->verts[v1*3];
+
+		// Check that the intersection lies inside the link portal.
+		if (link->side == 0 || link->side == 4)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
+			float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
+
+			// Find Z intersection.
+			float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
+			if (z >= lmin && z <= lmax)
+				return link->ref;
+		}
+		else if (link->side == 2 || link->side == 6)
+		{
+			// Calculate link size.
+			const float s = 1.0f/255.0f;
+			float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
+			float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
+			if (lmin > lmax) dtSwap(lmin, lmax);
+
+			// Find X intersection.
+			float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
+			if (x >= lmin && x <= lmax)
+				return link->ref;
+		}
+	}
+	
+	return 0;
+}
+
+template <class Filter>
+dtStatus dtNavMeshQuery::raycastT(dtPolyRef startRef, const float* startPos, const float* endPos,
+								  const Filter* filter, const unsigned int options,
+								  dtRaycastHit* hit, dtPolyRef prevRef) const
+{
+	dtAssert(m_nav);
+
+	if (!hit)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	hit->t = 0;
+	hit->pathCount = 0;
+	hit->pathCost = 0;
+	dtVset(hit->hitNormal, 0, 0, 0);
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter ||
+		(prevRef && !m_nav->isValidPolyRef(prevRef)))
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
+	float dir[3], curPos[3], lastPos[3];
+	float verts[DT_VERTS_PER_POLYGON*3+3];	
+	int n = 0;
+
+	dtVcopy(curPos, startPos);
+	dtVsub(dir, endPos, startPos);
+
+	dtStatus status = DT_SUCCESS;
+
+	const dtMeshTile* prevTile, *tile, *nextTile;
+	const dtPoly* prevPoly, *poly, *nextPoly;
+	dtPolyRef curRef;
+
+	// The API input has been checked already, skip checking internal data.
+	curRef = startRef;
+	tile = 0;
+	poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(curRef, &tile, &poly);
+	nextTile = prevTile = tile;
+	nextPoly = prevPoly = poly;
+	if (prevRef)
+		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+
+	while (curRef)
+	{
+		// Cast ray against current polygon.
+		
+		// Collect vertices.
+		int nv = 0;
+		for (int i = 0; i < (int)poly->vertCount; ++i)
+		{
+			dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
+			nv++;
+		}
+		
+		float tmin, tmax;
+		int segMin, segMax;
+		if (!dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax))
+		{
+			// Could not hit the polygon, keep the old t and report hit.
+			hit->pathCount = n;
+			return status;
+		}
+
+		hit->hitEdgeIndex = segMax;
+
+		// Keep track of furthest t so far.
+		if (tmax > hit->t)
+			hit->t = tmax;
+		
+		// Store visited polygons.
+		if (n < hit->maxPath)
+			hit->path[n++] = curRef;
+		else
+			status |= DT_BUFFER_TOO_SMALL;
+
+		// Ray end is completely inside the polygon.
+		if (segMax == -1)
+		{
+			hit->t = FLT_MAX;
+			hit->pathCount = n;
+			
+			// add the cost
+			if (options & DT_RAYCAST_USE_COSTS)
+				hit->pathCost += filter->getCost(curPos, endPos, prevRef, prevTile, prevPoly, curRef, tile, poly, curRef, tile, poly);
+			return status;
+		}
+
+		// Follow neighbours.
+		const dtPolyRef nextRef = raycastNextPoly(tile, poly, segMax, tmax, startPos, endPos, filter, &nextTile, &nextPoly);
+		
+		// add the cost
+		if (options & DT_RAYCAST_USE_COSTS)
+		{
+			// compute the intersection point at the furthest end of the polygon
+			// and correct the height (since the raycast moves in 2d)
+			dtVcopy(lastPos, curPos);
+			dtVmad(curPos, startPos, dir, hit->t);
+			float* e1 = &verts[segMax*3];
+			float* e2 = &verts[((segMax+1)%nv)*3];
+			float eDir[3], diff[3];
+			dtVsub(eDir, e2, e1);
+			dtVsub(diff, curPos, e1);
+			float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
+			curPos[1] = e1[1] + eDir[1] * s;
+
+			hit->pathCost += filter->getCost(lastPos, curPos, prevRef, prevTile, prevPoly, curRef, tile, poly, nextRef, nextTile, nextPoly);
+		}
+
+		if (!nextRef)
+		{
+			// No neighbour, we hit a wall.
+			
+			// Calculate hit normal.
+			const int a = segMax;
+			const int b = segMax+1 < nv ? segMax+1 : 0;
+			const float* va = &verts[a*3];
+			const float* vb = &verts[b*3];
+			const float dx = vb[0] - va[0];
+			const float dz = vb[2] - va[2];
+			hit->hitNormal[0] = dz;
+			hit->hitNormal[1] = 0;
+			hit->hitNormal[2] = -dx;
+			dtVnormalize(hit->hitNormal);
+			
+			hit->pathCount = n;
+			return status;
+		}
+
+		// No hit, advance to neighbour polygon.
+		prevRef = curRef;
+		curRef = nextRef;
+		prevTile = tile;
+		tile = nextTile;
+		prevPoly = poly;
+		poly = nextPoly;
+	}
+	
+	hit->pathCount = n;
+	
+	return status;
+}
+
+template <class Filter>
+dtStatus dtNavMeshQuery::raycastBatchT(dtPolyRef startRef, const float* startPos, const float* endPos, const int rayCount,
+									   const Filter* filter, const unsigned int options,
+									   dtRaycastHit* hits, dtStatus* rayStatus, dtPolyRef prevRef) const
+{
+	dtAssert(m_nav);
+
+	if (!hits || rayCount < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	for (int i = 0; i < rayCount; ++i)
+	{
+		hits[i].t = 0;
+		hits[i].pathCount = 0;
+		hits[i].pathCost = 0;
+		dtVset(hits[i].hitNormal, 0, 0, 0);
+	}
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!startPos || !endPos || !filter ||
+		(prevRef && !m_nav->isValidPolyRef(prevRef)))
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	for (int i = 0; i < rayCount; ++i)
+	{
+		if (!dtVisfinite(&startPos[i*3]) || !dtVisfinite(&endPos[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	static const int BATCH_SIZE = 32;
+
+	// Per ray state, the same as the locals of raycastT.
+	dtPolyRef curRefs[BATCH_SIZE], prevRefs[BATCH_SIZE];
+	const dtMeshTile* tiles[BATCH_SIZE], *prevTiles[BATCH_SIZE], *nextTiles[BATCH_SIZE];
+	const dtPoly* polys[BATCH_SIZE], *prevPolys[BATCH_SIZE], *nextPolys[BATCH_SIZE];
+	float curPos[BATCH_SIZE*3];
+	int counts[BATCH_SIZE];
+	dtStatus statuses[BATCH_SIZE];
+
+	// Segments of the rays that are in the current polygon.
+	int group[BATCH_SIZE];
+	float p0x[BATCH_SIZE], p0z[BATCH_SIZE], dirx[BATCH_SIZE], dirz[BATCH_SIZE];
+	float tmins[BATCH_SIZE], tmaxs[BATCH_SIZE];
+	int segMins[BATCH_SIZE], segMaxs[BATCH_SIZE];
+	unsigned char inside[BATCH_SIZE];
+
+	float verts[DT_VERTS_PER_POLYGON*3+3];
+
+	// The API input has been checked already, skip checking internal data.
+	const dtMeshTile* startTile = 0;
+	const dtPoly* startPoly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(startRef, &startTile, &startPoly);
+	const dtMeshTile* startPrevTile = startTile;
+	const dtPoly* startPrevPoly = startPoly;
+	if (prevRef)
+		m_nav->getTileAndPolyByRefUnsafe(prevRef, &startPrevTile, &startPrevPoly);
+
+	dtStatus status = DT_SUCCESS;
+
+	for (int base = 0; base < rayCount; base += BATCH_SIZE)
+	{
+		const int nrays = dtMin(BATCH_SIZE, rayCount - base);
+		for (int i = 0; i < nrays; ++i)
+		{
+			curRefs[i] = startRef;
+			tiles[i] = nextTiles[i] = startTile;
+			polys[i] = nextPolys[i] = startPoly;
+			prevRefs[i] = prevRef;
+			prevTiles[i] = startPrevTile;
+			prevPolys[i] = startPrevPoly;
+			dtVcopy(&curPos[i*3], &startPos[(base+i)*3]);
+			counts[i] = 0;
+			statuses[i] = DT_SUCCESS;
+		}
+
+		int live = nrays;
+		while (live > 0)
+		{
+			// Collect the live rays that are in the same polygon as the first one,
+			// rays that spread apart are handled in later iterations.
+			dtPolyRef curRef = 0;
+			int ngroup = 0;
+			for (int i = 0; i < nrays; ++i)
+			{
+				if (!curRefs[i])
+					continue;
+				if (!curRef)
+					curRef = curRefs[i];
+				if (curRefs[i] == curRef)
+					group[ngroup++] = i;
+			}
+
+			const dtMeshTile* tile = tiles[group[0]];
+			const dtPoly* poly = polys[group[0]];
+
+			// Collect vertices.
+			int nv = 0;
+			for (int i = 0; i < (int)poly->vertCount; ++i)
+			{
+				dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
+				nv++;
+			}
+
+			// Cast the rays against the polygon.
+			for (int k = 0; k < ngroup; ++k)
+			{
+				const float* sp = &startPos[(base+group[k])*3];
+				const float* ep = &endPos[(base+group[k])*3];
+				p0x[k] = sp[0];
+				p0z[k] = sp[2];
+				dirx[k] = ep[0] - sp[0];
+				dirz[k] = ep[2] - sp[2];
+			}
+			dtIntersectSegmentsPoly2D(p0x, p0z, dirx, dirz, ngroup, verts, nv, tmins, tmaxs, segMins, segMaxs, inside);
+
+			for (int k = 0; k < ngroup; ++k)
+			{
+				const int i = group[k];
+				dtRaycastHit* hit = &hits[base+i];
+				const float* sp = &startPos[(base+i)*3];
+				const float* ep = &endPos[(base+i)*3];
+
+				if (!inside[k])
+				{
+					// Could not hit the polygon, keep the old t and report hit.
+					curRefs[i] = 0;
+					live--;
+					continue;
+				}
+
+				const int segMax = segMaxs[k];
+				const float tmax = tmaxs[k];
+				hit->hitEdgeIndex = segMax;
+
+				// Keep track of furthest t so far.
+				if (tmax > hit->t)
+					hit->t = tmax;
+
+				// Store visited polygons.
+				if (counts[i] < hit->maxPath)
+					hit->path[counts[i]++] = curRef;
+				else
+					statuses[i] |= DT_BUFFER_TOO_SMALL;
+
+				// Ray end is completely inside the polygon.
+				if (segMax == -1)
+				{
+					hit->t = FLT_MAX;
+
+					// add the cost
+					if (options & DT_RAYCAST_USE_COSTS)
+						hit->pathCost += filter->getCost(&curPos[i*3], ep, prevRefs[i], prevTiles[i], prevPolys[i], curRef, tile, poly, curRef, tile, poly);
+					curRefs[i] = 0;
+					live--;
+					continue;
+				}
+
+				// Follow neighbours.
+				const dtPolyRef nextRef = raycastNextPoly(tile, poly, segMax, tmax, sp, ep, filter, &nextTiles[i], &nextPolys[i]);
+
+				// add the cost
+				if (options & DT_RAYCAST_USE_COSTS)
+				{
+					// compute the intersection point at the furthest end of the polygon
+					// and correct the height (since the raycast moves in 2d)
+					float dir[3], lastPos[3];
+					float* pos = &curPos[i*3];
+					dtVsub(dir, ep, sp);
+					dtVcopy(lastPos, pos);
+					dtVmad(pos, sp, dir, hit->t);
+					float* e1 = &verts[segMax*3];
+					float* e2 = &verts[((segMax+1)%nv)*3];
+					float eDir[3], diff[3];
+					dtVsub(eDir, e2, e1);
+					dtVsub(diff, pos, e1);
+					float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
+					pos[1] = e1[1] + eDir[1] * s;
+
+					hit->pathCost += filter->getCost(lastPos, pos, prevRefs[i], prevTiles[i], prevPolys[i], curRef, tile, poly, nextRef, nextTiles[i], nextPolys[i]);
+				}
+
+				if (!nextRef)
+				{
+					// No neighbour, we hit a wall.
+
+					// Calculate hit normal.
+					const int a = segMax;
+					const int b = segMax+1 < nv ? segMax+1 : 0;
+					const float* va = &verts[a*3];
+					const float* vb = &verts[b*3];
+					const float dx = vb[0] - va[0];
+					const float dz = vb[2] - va[2];
+					hit->hitNormal[0] = dz;
+					hit->hitNormal[1] = 0;
+					hit->hitNormal[2] = -dx;
+					dtVnormalize(hit->hitNormal);
+
+					curRefs[i] = 0;
+					live--;
+					continue;
+				}
+
+				// No hit, advance to neighbour polygon.
+				prevRefs[i] = curRef;
+				curRefs[i] = nextRef;
+				prevTiles[i] = tile;
+				tiles[i] = nextTiles[i];
+				prevPolys[i] = poly;
+				polys[i] = nextPolys[i];
+			}
+		}
+
+		for (int i = 0; i < nrays; ++i)
+		{
+			hits[base+i].pathCount = counts[i];
+			if (rayStatus)
+				rayStatus[base+i] = statuses[i];
+			status |= statuses[i] & DT_STATUS_DETAIL_MASK;
+		}
+	}
+
+	return status;
+}
+
+template <class Filter>
+dtStatus dtNavMeshQuery::findNearestPolyT(const float* center, const float* halfExtents,
+										  const Filter* filter,
+										  dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const
+{
+	dtAssert(m_nav);
+
+	if (!nearestRef)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (!center || !dtVisfinite(center) || !halfExtents || !dtVisfinite(halfExtents) || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	dtFindNearestPolyQuery query(this, center); // 创建一个查询最近 poly 的 query 对象
+
+	findNearestPolyInTilesT(center, halfExtents, filter, &query);
+
+	*nearestRef = query.nearestRef(); // 获取查询到的结果
+	
+	// Only override nearestPt if we actually found a poly so the nearest point
+	// is valid.
+	if (nearestPt && *nearestRef)
+	{
+		dtVcopy(nearestPt, query.nearestPoint());
+		if (isOverPoly)
+			*isOverPoly = query.isOverPoly();
+	}
+	
+	return DT_SUCCESS;
+}
+
+template <class Filter>
+void dtNavMeshQuery::findNearestPolyInTilesT(const float* center, const float* halfExtents,
+											  const Filter* filter, dtFindNearestPolyQuery* query) const
+{
+	float bmin[3], bmax[3];
+	dtVsub(bmin, center, halfExtents);
+	dtVadd(bmax, center, halfExtents);
+
+	int minx, miny, maxx, maxy;
+	m_nav->calcTileLoc(bmin, &minx, &miny);
+	m_nav->calcTileLoc(bmax, &maxx, &maxy);
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	// queryPolygons keeps the first of the polygons at the nearest distance. Ties are
+	// resolved the same way here by comparing the order of the tile and of the node
+	// within the tile in which queryPolygons would visit the polygons.
+	int bestTile = 0x7fffffff;
+	int bestNode = 0x7fffffff;
+
+	dtNearestPolyHeap heap;
+	int tileIndex = 0;
+	for (int y = miny; y <= maxy; ++y)
+	{
+		for (int x = minx; x <= maxx; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j, ++tileIndex)
+			{
+				const dtMeshTile* tile = neis[j];
+				const dtPolyRef base = m_nav->getPolyRefBase(tile);
+
+				if (!tile->bvTree)
+				{
+					// Without a tree there is nothing to bound, test the polygons right away.
+					for (int i = 0; i < tile->header->polyCount; ++i)
+					{
+						const dtPoly* p = &tile->polys[i];
+						if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+							continue;
+						const dtPolyRef ref = base | (dtPolyRef)i;
+						if (!filter->passFilter(ref, tile, p))
+							continue;
+						float pmin[3], pmax[3];
+						dtVcopy(pmin, &tile->verts[p->verts[0]*3]);
+						dtVcopy(pmax, &tile->verts[p->verts[0]*3]);
+						for (int k = 1; k < p->vertCount; ++k)
+						{
+							dtVmin(pmin, &tile->verts[p->verts[k]*3]);
+							dtVmax(pmax, &tile->verts[p->verts[k]*3]);
+						}
+						if (!dtOverlapBounds(bmin, bmax, pmin, pmax))
+							continue;
+						const bool winsTies = tileIndex < bestTile || (tileIndex == bestTile && i < bestNode);
+						if (query->processPoly(tile, ref, winsTies))
+						{
+							bestTile = tileIndex;
+							bestNode = i;
+						}
+					}
+					continue;
+				}
+
+				dtNearestPolyNode root;
+				root.tile = tile;
+				root.node = 0;
+				root.tileIndex = tileIndex;
+				dtQuantizeQueryBounds(tile, bmin, bmax, root.qmin, root.qmax);
+				if (!tile->header->bvNodeCount || !dtOverlapQuantBounds(root.qmin, root.qmax, tile->bvTree[0].bmin, tile->bvTree[0].bmax))
+					continue;
+				root.bound = dtNearestPolyBound(tile, &tile->bvTree[0], center);
+				if (heap.full())
+					findNearestPolyInSubtreeT(root, filter, query, &bestTile, &bestNode);
+				else
+					heap.push(root);
+			}
+		}
+	}
+
+	// Visit the nodes nearest first, until no node can hold a nearer polygon.
+	while (!heap.empty())
+	{
+		const dtNearestPolyNode item = heap.pop();
+		if (item.bound > query->nearestDistanceSqr())
+			break;
+
+		const dtBVNode* node = &item.tile->bvTree[item.node];
+		if (node->i >= 0)
+		{
+			findNearestPolyInSubtreeT(item, filter, query, &bestTile, &bestNode);
+			continue;
+		}
+
+		// Push the children that overlap the search box.
+		const int end = item.node - node->i;
+		int child = item.node + 1;
+		while (child < end)
+		{
+			const dtBVNode* childNode = &item.tile->bvTree[child];
+			if (dtOverlapQuantBounds(item.qmin, item.qmax, childNode->bmin, childNode->bmax))
+			{
+				dtNearestPolyNode next = item;
+				next.node = child;
+				next.bound = dtNearestPolyBound(item.tile, childNode, center);
+				if (next.bound <= query->nearestDistanceSqr())
+				{
+					if (heap.full())
+						findNearestPolyInSubtreeT(next, filter, query, &bestTile, &bestNode);
+					else
+						heap.push(next);
+				}
+			}
+			child += childNode->i >= 0 ? 1 : -childNode->i;
+		}
+	}
+}
+
+template <class Filter>
+void dtNavMeshQuery::findNearestPolyInSubtreeT(const dtNearestPolyNode& item, const Filter* filter,
+												dtFindNearestPolyQuery* query, int* bestTile, int* bestNode) const
+{
+	const dtMeshTile* tile = item.tile;
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	const int end = tile->bvTree[item.node].i >= 0 ? item.node + 1 : item.node - tile->bvTree[item.node].i;
+
+	int i = item.node;
+	while (i < end)
+	{
+		const dtBVNode* node = &tile->bvTree[i];
+		const bool overlap = dtOverlapQuantBounds(item.qmin, item.qmax, node->bmin, node->bmax);
+		const bool isLeafNode = node->i >= 0;
+
+		if (isLeafNode && overlap)
+		{
+			const dtPolyRef ref = base | (dtPolyRef)node->i;
+			if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+			{
+				const bool winsTies = item.tileIndex < *bestTile || (item.tileIndex == *bestTile && i < *bestNode);
+				if (query->processPoly(tile, ref, winsTies))
+				{
+					*bestTile = item.tileIndex;
+					*bestNode = i;
+				}
+			}
+		}
+
+		if (overlap || isLeafNode)
+			i++;
+		else
+			i -= node->i;
+	}
+}
+
+template <class Filter>
+dtStatus dtNavMeshQuery::queryPolygonsT(const float* center, const float* halfExtents,
+										const Filter* filter, dtPolyQuery* query) const
+{
+	dtAssert(m_nav);
+
+	if (!center || !dtVisfinite(center) || !halfExtents || !dtVisfinite(halfExtents) ||	!filter || !query)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// 通过中心点 center 和外扩查询半径 halfExtents 来计算出了左下点 bmin 和右上点 bmax，通过 bmin 和 bmax 确定了一个范围
+	// halfExtents 在测试 demo 中是固定值 {2, 4, 2}，实际使用中可能需要考虑这个值的设定
+	// halfExtents 的单位是米
+	// bmin 的值为 {center.x - 2, center.y - 4, center.z - 2}
+	// bmax 的值为 {center.x + 2, center.y + 4, center.z + 2}
+	float bmin[3], bmax[3];
+	dtVsub(bmin, center, halfExtents);
+	dtVadd(bmax, center, halfExtents);
+	
+	// Find tiles the query touches.
+	// 计算 bmin 和 bmax 框定的范围对应的 tile 的范围，tile 是个 2D 概念
+	// 如果 halfExtents 设置正常，那么 minx/maxx, miny/maxy 应该大致相等
+	// 理论上来说 halfExtents 应该只用处理极端情况即可，比如在 tile 边缘之类的
+	int minx, miny, maxx, maxy;
+	m_nav->calcTileLoc(bmin, &minx, &miny); // 计算 bmin 在将地图以 tile 划分的坐标轴中的 x 和 y
+	m_nav->calcTileLoc(bmax, &maxx, &maxy); // 计算 bmax 在将地图以 tile 划分的坐标轴中的 x 和 y
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	// 遍历 bmin 到 bmax 之间的每一个 tile 进行查找
+	// 如果搜索外扩半径很小的话，这里需要查找的 tile 很少
+	for (int y = miny; y <= maxy; ++y)
+	{
+		for (int x = minx; x <= maxx; ++x)
+		{
+			// 拿到 x/y 位置上的所有 tile, 因为 tile 是 2D 概念，所以有可能有多层 tile 重叠在一个 2D 坐标点上
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				// 查找 tile 中的 poly，找到离 center 最近的
+				queryPolygonsInTileT(neis[j], bmin, bmax, filter, query);
+			}
+		}
+	}
+	
+	return DT_SUCCESS;
+}
+
+template <class Filter>
+void dtNavMeshQuery::queryPolygonsInTileT(const dtMeshTile* tile, const float* qmin, const float* qmax,
+										  const Filter* filter, dtPolyQuery* query) const
+{
+	dtAssert(m_nav);
+	static const int batchSize = 32; // 每一批处理 32 个搜索到的 poly
+	dtPolyRef polyRefs[batchSize];
+	dtPoly* polys[batchSize];
+	int n = 0;
+
+	if (tile->bvWideTree)
+	{
+		// Calculate quantized box
+		unsigned short bmin[3], bmax[3];
+		dtQuantizeQueryBounds(tile, qmin, qmax, bmin, bmax);
+
+		// Traverse tree depth-first. The children are pushed in reverse, so the polygons
+		// come out in the same order as from the binary tree. The tree is balanced, which
+		// keeps the stack far below its size for any polygon count.
+		static const int stackSize = 64;
+		int stack[stackSize];
+		int nstack = 0;
+		stack[nstack++] = 0;
+		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+		while (nstack > 0)
+		{
+			const int item = stack[--nstack];
+			if (item < 0)
+			{
+				const int ip = -item - 1;
+				dtPolyRef ref = base | (dtPolyRef)ip;
+				if (filter->passFilter(ref, tile, &tile->polys[ip]))
+				{
+					polyRefs[n] = ref;
+					polys[n] = &tile->polys[ip];
+
+					if (n == batchSize - 1)
+					{
+						query->process(tile, polys, polyRefs, batchSize);
+						n = 0;
+					}
+					else
+					{
+						n++;
+					}
+				}
+				continue;
+			}
+
+			const dtBVWideNode* node = &tile->bvWideTree[item];
+			const unsigned int mask = dtOverlapQuantBoundsWide(bmin, bmax, node);
+			dtAssert(nstack + DT_BVWIDE_CHILDREN <= stackSize);
+			for (int k = DT_BVWIDE_CHILDREN-1; k >= 0; --k)
+			{
+				if ((mask & (1u << k)) && node->child[k])
+					stack[nstack++] = node->child[k];
+			}
+		}
+	}
+	// 似乎是包围体树的使用开关判断
+	// 根据是否使用包围体树，对 tile 内部的所有 poly 做一次遍历
+	else if (tile->bvTree)
+	{
+		const dtBVNode* node = &tile->bvTree[0];
+		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+
+		// Calculate quantized box
+		unsigned short bmin[3], bmax[3];
+		dtQuantizeQueryBounds(tile, qmin, qmax, bmin, bmax);
+
+		// Traverse tree
+		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+		while (node < end)
+		{
+			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
+			const bool isLeafNode = node->i >= 0;
+
+			if (isLeafNode && overlap)
+			{
+				dtPolyRef ref = base | (dtPolyRef)node->i;
+				if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+				{
+					polyRefs[n] = ref;
+					polys[n] = &tile->polys[node->i];
+
+					if (n == batchSize - 1)
+					{
+						query->process(tile, polys, polyRefs, batchSize);
+						n = 0;
+					}
+					else
+					{
+						n++;
+					}
+				}
+			}
+
+			if (overlap || isLeafNode)
+				node++;
+			else
+			{
+				const int escapeIndex = -node->i;
+				node += escapeIndex;
+			}
+		}
+	}
+	else
+	{
+		float bmin[3], bmax[3];
+		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+
+		// 遍历 tile 中所有的 poly
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			dtPoly* p = &tile->polys[i];
+			// Do not return off-mesh connection polygons.
+			if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+			// Must pass filter
+			const dtPolyRef ref = base | (dtPolyRef)i;
+			if (!filter->passFilter(ref, tile, p))
+				continue;
+			// Calc polygon bounds.
+			// 拿到 poly 的边界点
+			const float* v = &tile->verts[p->verts[0]*3];
+			dtVcopy(bmin, v);
+			dtVcopy(bmax, v);
+
+			// 遍历 poly 的所有顶点，找到最小点和最大点
+			for (int j = 1; j < p->vertCount; ++j)
+			{
+				v = &tile->verts[p->verts[j]*3];
+				dtVmin(bmin, v);
+				dtVmax(bmax, v);
+			}
+
+			// 判断 poly 和 param 要找的范围是否重叠
+			if (dtOverlapBounds(qmin, qmax, bmin, bmax))
+			{
+				polyRefs[n] = ref;
+				polys[n] = p;
+
+				if (n == batchSize - 1)
+				{
+					query->process(tile, polys, polyRefs, batchSize);
+					n = 0;
+				}
+				else
+				{
+					n++;
+				}
+			}
+		}
+	}
+
+	// Process the last polygons that didn't make a full batch.
+	if (n > 0)
+		query->process(tile, polys, polyRefs, n);
+}
+
+#endif // DETOURNAVMESHQUERYTEMPLATES_H
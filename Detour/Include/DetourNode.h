@@ -20,6 +20,7 @@
 #define DETOURNODE_H
 
 #include "DetourNavMesh.h"
+#include "DetourCommon.h"
 
 enum dtNodeFlags
 {
@@ -49,10 +50,21 @@ struct dtNode
 static const int DT_MAX_STATES_PER_NODE = 1 << DT_NODE_STATE_BITS;	// number of extra states per node. See dtNode::state
 
 // 寻路点池
+/// Stores the search nodes of the path queries and maps polygon references to them.
+///
+/// The nodes are found through an open addressed hash table with linear probing. The
+/// table keeps the polygon references apart from the nodes, so probing does not touch
+/// the node data. When the pool is created with spill nodes, nodes beyond @p maxNodes
+/// are allocated in chunks on demand instead of failing, the chunks are kept for the
+/// following searches.
 class dtNodePool
 {
 public:
-	dtNodePool(int maxNodes, int hashSize);
+	/// @param[in]	maxNodes		The number of nodes allocated up front.
+	/// @param[in]	hashSize		The minimum number of hash table slots. [Limit: power of 2]
+	/// @param[in]	maxSpillNodes	The number of extra nodes that may be allocated on demand.
+	///								[Limit: @p maxNodes + @p maxSpillNodes <= DT_NULL_IDX]
+	dtNodePool(int maxNodes, int hashSize, int maxSpillNodes = 0);
 	~dtNodePool();
 	void clear();
 
@@ -65,54 +77,86 @@ public:
 	inline unsigned int getNodeIdx(const dtNode* node) const
 	{
 		if (!node) return 0;
-		return (unsigned int)(node - m_nodes) + 1;
+		if (node >= m_nodes && node < m_nodes + m_maxNodes)
+			return (unsigned int)(node - m_nodes) + 1;
+		return getSpillNodeIdx(node);
 	}
 
 	inline dtNode* getNodeAtIdx(unsigned int idx)
 	{
 		if (!idx) return 0;
-		return &m_nodes[idx - 1];
+		idx--;
+		if (idx < (unsigned int)m_maxNodes)
+			return &m_nodes[idx];
+		idx -= m_maxNodes;
+		return &m_spill[idx / DT_NODE_SPILL_CHUNK][idx % DT_NODE_SPILL_CHUNK];
 	}
 
 	inline const dtNode* getNodeAtIdx(unsigned int idx) const
 	{
-		if (!idx) return 0;
-		return &m_nodes[idx - 1];
+		return const_cast<dtNodePool*>(this)->getNodeAtIdx(idx);
 	}
 	
-	inline int getMemUsed() const
-	{
-		return sizeof(*this) +
-			sizeof(dtNode)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_maxNodes +
-			sizeof(dtNodeIndex)*m_hashSize;
-	}
+	/// Gets the number of bytes currently allocated by the pool, including spill chunks.
+	int getMemUsed() const;
 	
+	/// The number of nodes allocated up front.
 	inline int getMaxNodes() const { return m_maxNodes; }
+
+	/// The number of extra nodes that may be allocated on demand.
+	inline int getMaxSpillNodes() const { return m_maxSpillNodes; }
+
+	/// The largest number of nodes used by a search since the pool was created or the
+	/// peak was reset. Useful for sizing the pool from real searches.
+	inline int getPeakNodeCount() const { return dtMax(m_peakNodeCount, m_nodeCount); }
+
+	/// Resets the peak node count to the current node count.
+	inline void resetPeakNodeCount() { m_peakNodeCount = m_nodeCount; }
 	
+	/// The number of hash table slots. Each slot holds at most one node, so all nodes
+	/// can be visited with getFirst() for each slot, and getNext() ends the chain.
 	inline int getHashSize() const { return m_hashSize; }
-	inline dtNodeIndex getFirst(int bucket) const { return m_first[bucket]; }
-	inline dtNodeIndex getNext(int i) const { return m_next[i]; }
+	inline dtNodeIndex getFirst(int bucket) const
+	{
+		return m_slotNodes[bucket] == DT_NODE_SLOT_EMPTY ? DT_NULL_IDX : (dtNodeIndex)(m_slotNodes[bucket] & 0xffff);
+	}
+	inline dtNodeIndex getNext(int /*i*/) const { return DT_NULL_IDX; }
 	inline int getNodeCount() const { return m_nodeCount; }
 	
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtNodePool(const dtNodePool&);
 	dtNodePool& operator=(const dtNodePool&);
+
+	static const int DT_NODE_SPILL_CHUNK = 256;
+	static const unsigned int DT_NODE_SLOT_EMPTY = 0xffffffff;
+
+	unsigned int getSpillNodeIdx(const dtNode* node) const;
+	dtNode* allocNode();
+	bool growTable();
 	
 	dtNode* m_nodes; // 所有 node 的集合
-	dtNodeIndex* m_first;
-	dtNodeIndex* m_next;
+	dtNode** m_spill;				///< Spill chunks, allocated on demand. [Size: ceil(maxSpillNodes / DT_NODE_SPILL_CHUNK)]
+	dtPolyRef* m_slotRefs;			///< Polygon reference of each hash table slot.
+	unsigned int* m_slotNodes;		///< Node index and state (bits 16-17) of each slot, or DT_NODE_SLOT_EMPTY.
 	const int m_maxNodes;
-	const int m_hashSize;
+	const int m_maxSpillNodes;
+	int m_hashSize;
 	int m_nodeCount;
+	int m_peakNodeCount;
+	int m_spillChunkCount;			///< Number of allocated spill chunks.
 };
 
-class dtNodeQueue
+// Selects the open list implementation used by the path searches. Define this
+// to replace the default binary heap. (See dtNodeQueue.)
+//#define DT_NODE_QUEUE_DARY 1
+
+/// The default open list, a binary heap of node pointers ordered by dtNode::total.
+class dtBinaryNodeQueue
 {
 public:
-	dtNodeQueue(int n);
-	~dtNodeQueue();
+	dtBinaryNodeQueue(int n);
+	~dtBinaryNodeQueue();
 	
 	inline void clear() { m_size = 0; }
 	
@@ -156,8 +200,8 @@ public:
 	
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
-	dtNodeQueue(const dtNodeQueue&);
-	dtNodeQueue& operator=(const dtNodeQueue&);
+	dtBinaryNodeQueue(const dtBinaryNodeQueue&);
+	dtBinaryNodeQueue& operator=(const dtBinaryNodeQueue&);
 
 	void bubbleUp(int i, dtNode* node);
 	void trickleDown(int i, dtNode* node);
@@ -165,7 +209,97 @@ private:
 	dtNode** m_heap;
 	const int m_capacity;
 	int m_size;
-};		
+};
+
+/// An open list stored as a 4-ary heap. Each entry keeps a copy of dtNode::total next to
+/// the node pointer, so sifting compares costs without touching the nodes, and the wider
+/// heap is about half as deep as the binary one.
+class dtDaryNodeQueue
+{
+public:
+	dtDaryNodeQueue(int n);
+	~dtDaryNodeQueue();
+
+	inline void clear() { m_size = 0; }
+
+	inline dtNode* top() { return m_heap[0].node; }
+
+	inline dtNode* pop()
+	{
+		dtNode* result = m_heap[0].node;
+		m_size--;
+		if (m_size > 0)
+			trickleDown(0, m_heap[m_size]);
+		return result;
+	}
+
+	inline void push(dtNode* node)
+	{
+		dtItem item;
+		item.total = node->total;
+		item.node = node;
+		m_size++;
+		bubbleUp(m_size-1, item);
+	}
+
+	inline void modify(dtNode* node)
+	{
+		for (int i = 0; i < m_size; ++i)
+		{
+			if (m_heap[i].node == node)
+			{
+				m_heap[i].total = node->total;
+				bubbleUp(i, m_heap[i]);
+				return;
+			}
+		}
+	}
+
+	inline bool empty() const { return m_size == 0; }
+
+	inline int getMemUsed() const
+	{
+		return sizeof(*this) +
+		sizeof(dtItem) * (m_capacity + 1);
+	}
+
+	inline int getCapacity() const { return m_capacity; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtDaryNodeQueue(const dtDaryNodeQueue&);
+	dtDaryNodeQueue& operator=(const dtDaryNodeQueue&);
+
+	struct dtItem
+	{
+		float total;		///< Copy of dtNode::total.
+		dtNode* node;
+	};
+
+	void bubbleUp(int i, dtItem item);
+	void trickleDown(int i, dtItem item);
+
+	dtItem* m_heap;
+	const int m_capacity;
+	int m_size;
+};
+
+/// The open list used by the path searches. The binary heap is used unless
+/// DT_NODE_QUEUE_DARY is defined.
+#if defined(DT_NODE_QUEUE_DARY)
+class dtNodeQueue : public dtDaryNodeQueue
+{
+public:
+	dtNodeQueue(int n) : dtDaryNodeQueue(n) {}
+};
+#else
+class dtNodeQueue : public dtBinaryNodeQueue
+{
+public:
+	dtNodeQueue(int n) : dtBinaryNodeQueue(n) {}
+};
+#endif
+
 
 
 #endif // DETOURNODE_H
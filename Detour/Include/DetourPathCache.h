@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURPATHCACHE_H
+#define DETOURPATHCACHE_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// Computes a hash of the settings of a query filter, used to tell path cache
+/// entries of different filters apart.
+///  @param[in]		filter		The filter to hash.
+/// @returns The hash of the include and exclude flags and the area costs of the filter.
+/// @ingroup detour
+unsigned int dtHashQueryFilter(const dtQueryFilter* filter);
+
+/// A least recently used cache of polygon corridors found by path queries.
+/// @ingroup detour
+class dtPathCache
+{
+public:
+	dtPathCache();
+	~dtPathCache();
+
+	/// Initializes the cache.
+	///  @param[in]		maxEntries		The maximum number of cached paths. [Limit: > 0]
+	///  @param[in]		maxPathLength	The maximum number of polygons of a cached path. [Limit: > 0]
+	/// @returns The status flags for the operation.
+	dtStatus init(const int maxEntries, const int maxPathLength);
+
+	/// Finds a path from the start polygon to the end polygon, using the cached path if there is a valid one.
+	/// Arguments are the same as for dtNavMeshQuery::findPath.
+	///  @param[in]		query		The query object used when the path is not cached.
+	/// @returns The status flags for the query.
+	dtStatus findPath(const dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  const dtQueryFilter* filter,
+					  dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Looks up a cached path.
+	///  @param[in]		nav			The navigation mesh used to validate the cached path.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		filterHash	The hash of the filter. (See: #dtHashQueryFilter)
+	///  @param[out]	path		The cached path. [(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons in the path.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold.
+	/// @returns True if a valid path was found.
+	bool find(const dtNavMesh* nav, dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash,
+			  dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Stores a path in the cache, evicting the least recently used path if the cache is full.
+	///  @param[in]		filterHash	The hash of the filter used to find the path. (See: #dtHashQueryFilter)
+	///  @param[in]		path		The path, from the start to the end polygon. [(polyRef) * @p pathCount]
+	///  @param[in]		pathCount	The number of polygons in the path.
+	void store(const unsigned int filterHash, const dtPolyRef* path, const int pathCount);
+
+	/// Removes all cached paths.
+	void clear();
+
+	/// The number of cached paths.
+	int getEntryCount() const { return m_entryCount; }
+
+	/// The number of lookups that returned a cached path.
+	int getHitCount() const { return m_hits; }
+
+	/// The number of lookups that did not return a cached path.
+	int getMissCount() const { return m_misses; }
+
+	/// Gets the amount of memory used by the cache in bytes.
+	int getMemUsed() const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPathCache(const dtPathCache&);
+	dtPathCache& operator=(const dtPathCache&);
+
+	struct dtPathCacheEntry
+	{
+		dtPolyRef startRef;
+		dtPolyRef endRef;
+		unsigned int filterHash;
+		int pathCount;
+		int prev, next;			///< Neighbours in the recently used list, or the free list.
+		int hashNext;			///< Next entry in the same hash bucket.
+	};
+
+	void purge();
+	int findEntry(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const;
+	void removeEntry(const int idx);
+	void unlinkEntry(const int idx);
+	void linkFront(const int idx);
+	unsigned int hashKey(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const;
+
+	dtPathCacheEntry* m_entries;
+	dtPolyRef* m_paths;			///< Paths of the entries. [Size: maxEntries * maxPathLength]
+	int* m_buckets;
+	int m_maxEntries;
+	int m_maxPathLength;
+	int m_bucketMask;
+	int m_entryCount;
+	int m_head, m_tail;			///< Most and least recently used entry.
+	int m_free;					///< First unused entry.
+	int m_hits, m_misses;
+};
+
+/// Allocates a path cache object using the Detour allocator.
+/// @return An allocated path cache object, or null on failure.
+/// @ingroup detour
+dtPathCache* dtAllocPathCache();
+
+/// Frees the specified path cache object using the Detour allocator.
+///  @param[in]		cache		A path cache object allocated using #dtAllocPathCache
+/// @ingroup detour
+void dtFreePathCache(dtPathCache* cache);
+
+#endif // DETOURPATHCACHE_H
@@ -0,0 +1,115 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURPOLYAREATABLE_H
+#define DETOURPOLYAREATABLE_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// Keeps cumulative polygon areas per tile and a prefix of the tile areas, so that
+/// polygons can be sampled weighted by area with two binary searches.
+/// @ingroup detour
+class dtPolyAreaTable : public dtTileListener
+{
+public:
+	dtPolyAreaTable();
+	virtual ~dtPolyAreaTable();
+
+	/// Initializes the table for all tiles in the navigation mesh and registers it as
+	/// a tile listener so that it is kept up to date.
+	///  @param[in]		nav		The navigation mesh.
+	///  @param[in]		filter	The filter deciding which polygons can be sampled.
+	/// @returns The status flags for the operation.
+	dtStatus init(dtNavMesh* nav, const dtQueryFilter* filter);
+
+	/// Returns true if the table was built for the specified filter or an equivalent one.
+	/// (See: #dtEquivalentFilters)
+	///  @param[in]		filter	The filter to check.
+	bool matchesFilter(const dtQueryFilter* filter) const;
+
+	/// Gets the total area of the polygons in the table.
+	float getTotalArea() const;
+
+	/// Gets the area of the polygons of a tile.
+	///  @param[in]		tile	The tile.
+	/// @returns The area of the tile polygons passing the filter.
+	float getTileArea(const dtMeshTile* tile) const;
+
+	/// Picks a polygon of the navigation mesh weighted by area.
+	///  @param[in]		u		A random number. [Limits: 0 <= value < 1]
+	/// @returns The reference of the polygon, or zero if the table is empty.
+	dtPolyRef samplePoly(const float u) const;
+
+	/// Picks a polygon of a tile weighted by area.
+	///  @param[in]		tile	The tile.
+	///  @param[in]		u		A random number. [Limits: 0 <= value < 1]
+	/// @returns The reference of the polygon, or zero if the tile has no area.
+	dtPolyRef samplePolyInTile(const dtMeshTile* tile, const float u) const;
+
+	/// Recomputes the areas of the specified tile, e.g. after changing polygon flags.
+	///  @param[in]		tile	The tile to rebuild.
+	void rebuildTile(const dtMeshTile* tile);
+
+	/// Gets the amount of memory used by the table in bytes.
+	int getMemUsed() const;
+
+	/// @name dtTileListener Implementation
+	///@{
+	virtual void tileAdded(const dtNavMesh* nav, const dtMeshTile* tile);
+	virtual void tileRemoved(const dtNavMesh* nav, const dtMeshTile* tile);
+	///@}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPolyAreaTable(const dtPolyAreaTable&);
+	dtPolyAreaTable& operator=(const dtPolyAreaTable&);
+
+	struct dtAreaTile
+	{
+		unsigned int salt;		///< Salt of the tile the areas were computed for.
+		int polyCount;			///< Number of polygons in the tile.
+		float* cdf;				///< Cumulative polygon area. [Size: polyCount]
+	};
+
+	void purge();
+	void freeTile(const int tileIndex);
+	bool buildTile(const dtMeshTile* tile);
+	void rebuildPrefix();
+	int getTileIndex(const dtMeshTile* tile) const;
+
+	dtNavMesh* m_nav;
+	const dtQueryFilter* m_filter;
+	dtAreaTile* m_tiles;
+	int m_maxTiles;
+	float* m_tileCdf;			///< Cumulative tile area over the tile indices. [Size: m_maxTiles]
+};
+
+/// Allocates a polygon area table object using the Detour allocator.
+/// @return An allocated polygon area table object, or null on failure.
+/// @ingroup detour
+dtPolyAreaTable* dtAllocPolyAreaTable();
+
+/// Frees the specified polygon area table object using the Detour allocator.
+///  @param[in]		table		A polygon area table object allocated using #dtAllocPolyAreaTable
+/// @ingroup detour
+void dtFreePolyAreaTable(dtPolyAreaTable* table);
+
+#endif // DETOURPOLYAREATABLE_H
@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTILEGRAPH_H
+#define DETOURTILEGRAPH_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// The maximum number of entrances a single tile can have in a tile graph.
+/// @ingroup detour
+static const int DT_TILEGRAPH_MAX_ENTRANCES = 255;
+
+/// A tile entrance: a run of contiguous portals leading to the same neighbour tile.
+/// @ingroup detour
+struct dtTileEntrance
+{
+	dtPolyRef ref;			///< The polygon on this side of the representative portal.
+	dtPolyRef neiRef;		///< The polygon on the neighbour side of the representative portal.
+	float pos[3];			///< The mid point of the representative portal. [(x, y, z)]
+	int neiTile;			///< The index of the neighbour tile.
+	int firstPortal;		///< The index of the first polygon of the run in the tile's portal polygon list.
+	int portalCount;		///< The number of portals in the run.
+};
+
+/// A hierarchical (HPA*) abstract graph built over the tiles of a navigation mesh.
+///
+/// Each tile is summarized by its entrances and the traversal costs between them.
+/// Long queries are first solved on this small graph to get a tile corridor, and
+/// then refined into a polygon path one tile at a time.
+///
+/// The graph registers itself as a tile listener of the navigation mesh, so it must
+/// be destroyed before the navigation mesh it was initialized with.
+/// @ingroup detour
+class dtTileGraph : public dtTileListener
+{
+public:
+	dtTileGraph();
+
+	/// Unregisters the graph from the navigation mesh passed to #init.
+	virtual ~dtTileGraph();
+
+	/// Initializes the graph, builds it for all tiles in the navigation mesh and
+	/// registers it as a tile listener so that it is kept up to date.
+	///  @param[in]		nav			The navigation mesh to build the graph for.
+	///  @param[in]		filter		The filter used for the precomputed costs and the queries.
+	///  @param[in]		maxNodes	Maximum number of search nodes. [Limits: 0 < value <= 65535]
+	/// @returns The status flags for the operation.
+	dtStatus init(dtNavMesh* nav, const dtQueryFilter* filter, const int maxNodes);
+
+	/// Finds a path from the start polygon to the end polygon using the abstract graph.
+	///  @param[in]		query		The query object used to refine the path within tiles.
+	///  @param[in]		startRef	The refrence id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.)
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	/// @returns The status flags for the query.
+	dtStatus findPath(dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Finds the sequence of tiles a path from the start to the end polygon passes through.
+	///  @param[in]		startRef	The refrence id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[out]	tiles		The references of the tiles along the corridor. [(tileRef) * @p tileCount]
+	///  @param[out]	tileCount	The number of tiles returned in the @p tiles array.
+	///  @param[in]		maxTiles	The maximum number of tiles the @p tiles array can hold.
+	/// @returns The status flags for the query.
+	dtStatus findTileCorridor(dtPolyRef startRef, dtPolyRef endRef,
+							  const float* startPos, const float* endPos,
+							  dtTileRef* tiles, int* tileCount, const int maxTiles);
+
+	/// Rebuilds the entrances and costs of the specified tile.
+	///  @param[in]		tile	The tile to rebuild.
+	void rebuildTile(const dtMeshTile* tile);
+
+	/// Gets the entrances of the tile at the specified index.
+	///  @param[in]		tileIndex	The index of the tile.
+	///  @param[out]	count		The number of entrances.
+	/// @returns The entrances of the tile.
+	const dtTileEntrance* getTileEntrances(const int tileIndex, int* count) const;
+
+	/// Gets the traversal cost between two entrances of the same tile.
+	/// @returns The cost, or FLT_MAX if the second entrance cannot be reached from the first.
+	float getEntranceCost(const int tileIndex, const int from, const int to) const;
+
+	/// Gets the amount of memory used by the graph in bytes.
+	int getMemUsed() const;
+
+	/// @name dtTileListener Implementation
+	///@{
+	virtual void tileAdded(const dtNavMesh* nav, const dtMeshTile* tile);
+	virtual void tileRemoved(const dtNavMesh* nav, const dtMeshTile* tile);
+	///@}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtTileGraph(const dtTileGraph&);
+	dtTileGraph& operator=(const dtTileGraph&);
+
+	struct dtGraphTile
+	{
+		dtTileEntrance* entrances;	///< Entrances of the tile.
+		float* costs;				///< Costs between entrances. [Size: entranceCount * entranceCount]
+		dtPolyRef* portalRefs;		///< The polygons on this side of the portals of each entrance run.
+		int entranceCount;			///< Number of entrances.
+	};
+
+	void purge();
+	void clearTile(const int tileIndex);
+	void rebuildNeighbours(const dtMeshTile* tile);
+
+	// Computes the costs from a position to the target polygons, searching only within the tile.
+	void searchTile(const dtMeshTile* tile, dtPolyRef startRef, const float* startPos,
+					const dtTileEntrance* targets, const int ntargets, float* costs);
+
+	// Runs the abstract search. Returns the abstract goal node, or null if no route was found.
+	struct dtNode* searchGraph(dtPolyRef startRef, dtPolyRef endRef,
+							   const float* startPos, const float* endPos);
+
+	dtNavMesh* m_nav;
+	const dtQueryFilter* m_filter;
+	dtGraphTile* m_tiles;
+	int m_maxTiles;
+
+	float* m_startCosts;			///< Temporary costs from the start to the start tile entrances.
+	float* m_endCosts;				///< Temporary costs from the end tile entrances to the end.
+
+	class dtNodePool* m_nodePool;
+	class dtNodeQueue* m_openList;
+};
+
+/// Allocates a tile graph object using the Detour allocator.
+/// @return An allocated tile graph object, or null on failure.
+/// @ingroup detour
+dtTileGraph* dtAllocTileGraph();
+
+/// Frees the specified tile graph object using the Detour allocator.
+///  @param[in]		graph		A tile graph object allocated using #dtAllocTileGraph
+/// @ingroup detour
+void dtFreeTileGraph(dtTileGraph* graph);
+
+#endif // DETOURTILEGRAPH_H
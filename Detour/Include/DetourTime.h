@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTIME_H
+#define DETOURTIME_H
+
+#if defined(_MSC_VER) && _MSC_VER < 1600
+typedef __int64 dtTimeVal;
+#else
+#include <stdint.h>
+typedef int64_t dtTimeVal;
+#endif
+
+/// A clock function.
+///  @return The current time in microseconds, measured from an arbitrary but fixed point.
+///  @see dtTimeSetCustom
+typedef dtTimeVal (dtTimeFunc)();
+
+/// Sets the clock used by the time budgeted Detour queries.
+/// Passing null restores the default monotonic system clock.
+///  @param[in]		timeFunc	The clock function to be used by #dtGetTimeUsec.
+void dtTimeSetCustom(dtTimeFunc* timeFunc);
+
+/// Gets the current time.
+///  @return The current time in microseconds, measured from an arbitrary but fixed point.
+///  @see dtTimeSetCustom
+dtTimeVal dtGetTimeUsec();
+
+#endif // DETOURTIME_H
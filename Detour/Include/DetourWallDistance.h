@@ -0,0 +1,123 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#ifndef DETOURWALLDISTANCE_H
+#define DETOURWALLDISTANCE_H
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourStatus.h"
+
+/// Keeps the distance from the center of each polygon to the nearest wall, so that
+/// wall distance queries can be answered or bounded without a search.
+/// @ingroup detour
+class dtWallDistanceField : public dtTileListener
+{
+public:
+	dtWallDistanceField();
+	virtual ~dtWallDistanceField();
+
+	/// Initializes the field for all tiles in the navigation mesh and registers it as
+	/// a tile listener so that it is kept up to date.
+	///  @param[in]		nav			The navigation mesh.
+	///  @param[in]		filter		The filter deciding which polygon edges are walls.
+	///  @param[in]		maxDist		The maximum distance stored in the field. [Limit: > 0] [Units: wu]
+	///  @param[in]		maxNodes	The maximum number of search nodes used to compute a distance. [Limits: 0 < value <= 65535]
+	/// @returns The status flags for the operation.
+	dtStatus init(dtNavMesh* nav, const dtQueryFilter* filter, const float maxDist, const int maxNodes = 512);
+
+	/// Returns true if the field was built for the specified filter or an equivalent one.
+	/// (See: #dtEquivalentFilters)
+	///  @param[in]		filter	The filter to check.
+	bool matchesFilter(const dtQueryFilter* filter) const;
+
+	/// The maximum distance stored in the field. [Units: wu]
+	float getMaxDistance() const { return m_maxDist; }
+
+	/// Gets the distance from the center of a polygon to the nearest wall.
+	///  @param[in]		ref		The reference of the polygon.
+	///  @param[out]	dist	The distance, or the maximum distance if there is no closer wall. [Units: wu]
+	/// @returns False if the polygon is not in the field.
+	bool getPolyWallDistance(dtPolyRef ref, float* dist) const;
+
+	/// Gets the smallest distance to a wall from any point of a polygon, e.g. to add
+	/// clearance to path costs.
+	///  @param[in]		ref		The reference of the polygon.
+	/// @returns The clearance of the polygon, or zero if the polygon is not in the field. [Units: wu]
+	float getPolyClearance(dtPolyRef ref) const;
+
+	/// Gets the range the distance from a location to the nearest wall is in.
+	///  @param[in]		ref			The reference of the polygon containing the location.
+	///  @param[in]		pos			The location. [(x, y, z)]
+	///  @param[out]	minDist		The lower bound of the wall distance. [Units: wu]
+	///  @param[out]	maxDist		The upper bound of the wall distance, or FLT_MAX if there
+	///  							is no wall within the maximum distance of the field. [Units: wu]
+	/// @returns False if the polygon is not in the field.
+	bool getDistanceBounds(dtPolyRef ref, const float* pos, float* minDist, float* maxDist) const;
+
+	/// Recomputes the distances of the specified tile, e.g. after changing polygon flags.
+	///  @param[in]		tile	The tile to rebuild.
+	void rebuildTile(const dtMeshTile* tile);
+
+	/// Gets the amount of memory used by the field in bytes.
+	int getMemUsed() const;
+
+	/// @name dtTileListener Implementation
+	///@{
+	virtual void tileAdded(const dtNavMesh* nav, const dtMeshTile* tile);
+	virtual void tileRemoved(const dtNavMesh* nav, const dtMeshTile* tile);
+	///@}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtWallDistanceField(const dtWallDistanceField&);
+	dtWallDistanceField& operator=(const dtWallDistanceField&);
+
+	struct dtWallTile
+	{
+		unsigned int salt;		///< Salt of the tile the distances were computed for.
+		int polyCount;			///< Number of polygons in the tile.
+		float* dist;			///< Wall distance and radius per polygon. [(dist, radius) * polyCount]
+	};
+
+	void purge();
+	void freeTile(const int tileIndex);
+	bool buildTile(const dtMeshTile* tile);
+	void rebuildNeighbours(const dtMeshTile* tile);
+	const float* getPolyData(dtPolyRef ref, const dtMeshTile** tile, const dtPoly** poly) const;
+
+	dtNavMesh* m_nav;
+	dtNavMeshQuery* m_query;	///< Query used to compute the distances.
+	const dtQueryFilter* m_filter;
+	float m_maxDist;
+	dtWallTile* m_tiles;
+	int m_maxTiles;
+};
+
+/// Allocates a wall distance field object using the Detour allocator.
+/// @return An allocated wall distance field object, or null on failure.
+/// @ingroup detour
+dtWallDistanceField* dtAllocWallDistanceField();
+
+/// Frees the specified wall distance field object using the Detour allocator.
+///  @param[in]		field		A wall distance field object allocated using #dtAllocWallDistanceField
+/// @ingroup detour
+void dtFreeWallDistanceField(dtWallDistanceField* field);
+
+#endif // DETOURWALLDISTANCE_H
@@ -167,6 +167,87 @@ bool dtIntersectSegmentPoly2D(const float* p0, const float* p1,
 	return true;
 }
 
+/// @par
+///
+/// The segments are copied to local blocks padded to a multiple of four, so that the
+/// compiler knows they do not alias the outputs and needs no scalar remainder loop.
+/// The loop over the segments of a block has no branches, and is vectorized by
+/// optimizing compilers.
+void dtIntersectSegmentsPoly2D(const float* p0x, const float* p0z,
+							   const float* dirx, const float* dirz, const int nsegs,
+							   const float* verts, int nverts,
+							   float* tmin, float* tmax,
+							   int* segMin, int* segMax, unsigned char* hit)
+{
+	static const float EPS = 0.00000001f;
+	static const int BLOCK_SIZE = 32;
+
+	float blockP0x[BLOCK_SIZE], blockP0z[BLOCK_SIZE], blockDirx[BLOCK_SIZE], blockDirz[BLOCK_SIZE];
+	float blockMin[BLOCK_SIZE], blockMax[BLOCK_SIZE];
+	int blockSegMin[BLOCK_SIZE], blockSegMax[BLOCK_SIZE], blockHit[BLOCK_SIZE];
+
+	for (int base = 0; base < nsegs; base += BLOCK_SIZE)
+	{
+		const int n = dtMin(BLOCK_SIZE, nsegs - base);
+		const int npadded = (n + 3) & ~3;
+
+		for (int k = 0; k < npadded; ++k)
+		{
+			// The padding segments are degenerate and never hit.
+			const bool pad = k >= n;
+			blockP0x[k] = pad ? 0.0f : p0x[base+k];
+			blockP0z[k] = pad ? 0.0f : p0z[base+k];
+			blockDirx[k] = pad ? 0.0f : dirx[base+k];
+			blockDirz[k] = pad ? 0.0f : dirz[base+k];
+			blockMin[k] = 0;
+			blockMax[k] = 1;
+			blockSegMin[k] = -1;
+			blockSegMax[k] = -1;
+			blockHit[k] = 1;
+		}
+
+		for (int i = 0, j = nverts-1; i < nverts; j=i++)
+		{
+			// The edge is shared by all segments.
+			const float vjx = verts[j*3+0];
+			const float vjz = verts[j*3+2];
+			const float edgex = verts[i*3+0] - vjx;
+			const float edgez = verts[i*3+2] - vjz;
+
+			// Same operations as dtIntersectSegmentPoly2D, with the branches replaced by
+			// selects and the early outs by clearing the hit flag.
+			for (int k = 0; k < npadded; ++k)
+			{
+				const float num = edgez*(blockP0x[k] - vjx) - edgex*(blockP0z[k] - vjz);
+				const float den = blockDirz[k]*edgex - blockDirx[k]*edgez;
+				const float t = num / den;
+				// S is nearly parallel to this edge, and misses the polygon if it is outside the edge.
+				const int parallel = fabsf(den) < EPS;
+				const int live = blockHit[k] & !parallel;
+				// S is entering or leaving across this edge.
+				const int enter = live & (den < 0) & (t > blockMin[k]);
+				const int leave = live & (den >= 0) & (t < blockMax[k]);
+				// S enters after leaving or leaves before entering the polygon.
+				const int miss = (parallel & (num < 0)) | (enter & (t > blockMax[k])) | (leave & (t < blockMin[k]));
+				blockMin[k] = enter ? t : blockMin[k];
+				blockSegMin[k] = enter ? j : blockSegMin[k];
+				blockMax[k] = leave ? t : blockMax[k];
+				blockSegMax[k] = leave ? j : blockSegMax[k];
+				blockHit[k] &= !miss;
+			}
+		}
+
+		for (int k = 0; k < n; ++k)
+		{
+			tmin[base+k] = blockMin[k];
+			tmax[base+k] = blockMax[k];
+			segMin[base+k] = blockSegMin[k];
+			segMax[base+k] = blockSegMax[k];
+			hit[base+k] = (unsigned char)blockHit[k];
+		}
+	}
+}
+
 float dtDistancePtSegSqr2D(const float* pt, const float* p, const float* q, float& t)
 {
 	float pqx = q[0] - p[0];
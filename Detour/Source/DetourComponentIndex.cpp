@@ -0,0 +1,601 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourComponentIndex.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+// Local component of polygons excluded by the filter class.
+static const unsigned short DT_NULL_COMPONENT = 0xffff;
+
+dtComponentIndex* dtAllocComponentIndex()
+{
+	void* mem = dtAlloc(sizeof(dtComponentIndex), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtComponentIndex;
+}
+
+void dtFreeComponentIndex(dtComponentIndex* index)
+{
+	if (!index) return;
+	index->~dtComponentIndex();
+	dtFree(index);
+}
+
+/// @class dtComponentIndex
+///
+/// Each tile is labeled into local components with a flood fill over its internal
+/// links, and the links leaving the tile are cached. The local components of all
+/// tiles are then merged over the cached links into global components. When a tile
+/// is added, removed or rebuilt, only the tile is labeled again and the neighbours
+/// refresh their cached links. Adding links can only merge components, so the new
+/// links are merged into the existing set. Components running through a removed or
+/// rebuilt tile may split; those are reset and merged again over the links of the
+/// tiles they span, the other components are left as they are.
+///
+/// Links are treated as undirected, so one-way off-mesh connections connect their
+/// components in both directions. The index can therefore report two polygons as
+/// reachable when they are not, but never the opposite.
+///
+/// Connectivity depends on which polygons pass the filter, so the components are
+/// kept per filter class, see addFilterClass(). The filter pointers are stored and
+/// must stay valid for the lifetime of the index. Changing polygon flags does not
+/// notify the index; call rebuildTile() for the tiles affected.
+///
+/// Assign the index to a query with dtNavMeshQuery::setComponentIndex() to reject
+/// unreachable path queries early.
+///
+/// @see dtNavMeshQuery, #dtAllocComponentIndex
+
+dtComponentIndex::dtComponentIndex() :
+	m_nav(0),
+	m_classCount(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_parent(0),
+	m_parentCount(0),
+	m_parentCapacity(0),
+	m_liveCount(0),
+	m_stack(0),
+	m_stackCapacity(0)
+{
+	memset(m_filters, 0, sizeof(m_filters));
+}
+
+dtComponentIndex::~dtComponentIndex()
+{
+	purge();
+}
+
+void dtComponentIndex::purge()
+{
+	if (m_nav)
+		m_nav->removeTileListener(this);
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(i);
+	dtFree(m_tiles);
+	m_tiles = 0;
+	m_maxTiles = 0;
+	dtFree(m_parent);
+	m_parent = 0;
+	m_parentCount = 0;
+	m_parentCapacity = 0;
+	m_liveCount = 0;
+	dtFree(m_stack);
+	m_stack = 0;
+	m_stackCapacity = 0;
+	memset(m_filters, 0, sizeof(m_filters));
+	m_classCount = 0;
+	m_nav = 0;
+}
+
+dtStatus dtComponentIndex::init(dtNavMesh* nav, const dtQueryFilter* filter)
+{
+	if (!nav || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtComponentTile*)dtAlloc(sizeof(dtComponentTile)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtComponentTile)*m_maxTiles);
+
+	m_nav = nav;
+	m_filters[0] = filter;
+	m_classCount = 1;
+
+	dtStatus status = m_nav->addTileListener(this);
+	if (dtStatusFailed(status))
+	{
+		m_nav = 0;
+		return status;
+	}
+
+	const dtNavMesh* cnav = m_nav;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (tile->header && !buildTile(tile))
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	rebuildComponents();
+
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// Adding a class relabels all tiles.
+int dtComponentIndex::addFilterClass(const dtQueryFilter* filter)
+{
+	if (!m_nav || !filter || m_classCount >= DT_MAX_COMPONENT_CLASSES)
+		return -1;
+
+	const int filterClass = m_classCount;
+	m_filters[m_classCount++] = filter;
+
+	const dtNavMesh* cnav = m_nav;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (tile->header)
+			buildTile(tile);
+	}
+	rebuildComponents();
+
+	return filterClass;
+}
+
+/// @par
+///
+/// A class registered with the same filter object is preferred over an equivalent one.
+int dtComponentIndex::getFilterClass(const dtQueryFilter* filter) const
+{
+	if (!filter)
+		return -1;
+	for (int i = 0; i < m_classCount; ++i)
+	{
+		if (m_filters[i] == filter)
+			return i;
+	}
+	for (int i = 0; i < m_classCount; ++i)
+	{
+		if (dtEquivalentFilters(m_filters[i], filter))
+			return i;
+	}
+	return -1;
+}
+
+void dtComponentIndex::freeTile(const int tileIndex)
+{
+	dtComponentTile& ct = m_tiles[tileIndex];
+	m_liveCount -= ct.slotCount;
+	dtFree(ct.local);
+	dtFree(ct.edges);
+	memset(&ct, 0, sizeof(dtComponentTile));
+}
+
+bool dtComponentIndex::buildTile(const dtMeshTile* tile)
+{
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(base);
+	const int polyCount = tile->header->polyCount;
+
+	freeTile((int)tileIndex);
+	dtComponentTile& ct = m_tiles[tileIndex];
+	if (!polyCount)
+		return true;
+
+	ct.local = (unsigned short*)dtAlloc(sizeof(unsigned short)*polyCount*m_classCount, DT_ALLOC_PERM);
+	if (!ct.local)
+		return false;
+	ct.salt = tile->salt;
+	ct.polyCount = polyCount;
+
+	if (m_stackCapacity < polyCount)
+	{
+		dtFree(m_stack);
+		m_stack = (unsigned short*)dtAlloc(sizeof(unsigned short)*polyCount, DT_ALLOC_PERM);
+		m_stackCapacity = m_stack ? polyCount : 0;
+		if (!m_stack)
+		{
+			freeTile((int)tileIndex);
+			return false;
+		}
+	}
+
+	if (!buildEdges(tile))
+	{
+		freeTile((int)tileIndex);
+		return false;
+	}
+
+	// Flood fill the local components of each class.
+	for (int c = 0; c < m_classCount; ++c)
+	{
+		const dtQueryFilter* filter = m_filters[c];
+		unsigned short* local = &ct.local[c*polyCount];
+		for (int i = 0; i < polyCount; ++i)
+			local[i] = DT_NULL_COMPONENT;
+
+		int count = 0;
+		for (int i = 0; i < polyCount; ++i)
+		{
+			if (local[i] != DT_NULL_COMPONENT)
+				continue;
+			if (!filter->passFilter(base | (dtPolyRef)i, tile, &tile->polys[i]))
+				continue;
+
+			const unsigned short comp = (unsigned short)count++;
+			local[i] = comp;
+			int nstack = 0;
+			m_stack[nstack++] = (unsigned short)i;
+			while (nstack > 0)
+			{
+				const dtPoly* poly = &tile->polys[m_stack[--nstack]];
+				for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+				{
+					const dtPolyRef neiRef = tile->links[j].ref;
+					if (!neiRef || m_nav->decodePolyIdTile(neiRef) != tileIndex)
+						continue;
+					const unsigned int nei = m_nav->decodePolyIdPoly(neiRef);
+					if (local[nei] != DT_NULL_COMPONENT)
+						continue;
+					if (!filter->passFilter(neiRef, tile, &tile->polys[nei]))
+						continue;
+					local[nei] = comp;
+					m_stack[nstack++] = (unsigned short)nei;
+				}
+			}
+		}
+		ct.localCount[c] = count;
+	}
+
+	return true;
+}
+
+// Caches the links leaving the tile.
+bool dtComponentIndex::buildEdges(const dtMeshTile* tile)
+{
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(m_nav->getTileRef(tile));
+	dtComponentTile& ct = m_tiles[tileIndex];
+	dtFree(ct.edges);
+	ct.edges = 0;
+	ct.edgeCount = 0;
+	if (!ct.local)
+		return true;
+
+	int edgeCount = 0;
+	for (int i = 0; i < ct.polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtPolyRef neiRef = tile->links[j].ref;
+			if (neiRef && m_nav->decodePolyIdTile(neiRef) != tileIndex)
+				edgeCount++;
+		}
+	}
+	if (!edgeCount)
+		return true;
+
+	ct.edges = (dtComponentEdge*)dtAlloc(sizeof(dtComponentEdge)*edgeCount, DT_ALLOC_PERM);
+	if (!ct.edges)
+		return false;
+	for (int i = 0; i < ct.polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtPolyRef neiRef = tile->links[j].ref;
+			if (!neiRef || m_nav->decodePolyIdTile(neiRef) == tileIndex)
+				continue;
+			dtComponentEdge& edge = ct.edges[ct.edgeCount++];
+			edge.poly = (unsigned short)i;
+			edge.neiRef = neiRef;
+		}
+	}
+	return true;
+}
+
+int dtComponentIndex::findRoot(int i)
+{
+	while (m_parent[i] != i)
+	{
+		m_parent[i] = m_parent[m_parent[i]];
+		i = m_parent[i];
+	}
+	return i;
+}
+
+// Appends the local components of the tile to the global set, each in a set of its own.
+bool dtComponentIndex::allocSlots(const int tileIndex)
+{
+	dtComponentTile& ct = m_tiles[tileIndex];
+	if (!ct.local)
+		return true;
+	int count = 0;
+	for (int c = 0; c < m_classCount; ++c)
+		count += ct.localCount[c];
+
+	if (m_parentCount + count > m_parentCapacity)
+	{
+		const int capacity = dtMax(m_parentCount + count, m_parentCapacity*2);
+		int* parent = (int*)dtAlloc(sizeof(int)*capacity, DT_ALLOC_PERM);
+		if (!parent)
+			return false;
+		if (m_parentCount)
+			memcpy(parent, m_parent, sizeof(int)*m_parentCount);
+		dtFree(m_parent);
+		m_parent = parent;
+		m_parentCapacity = capacity;
+	}
+
+	for (int c = 0; c < m_classCount; ++c)
+	{
+		ct.base[c] = m_parentCount;
+		for (int i = 0; i < ct.localCount[c]; ++i)
+			m_parent[m_parentCount + i] = m_parentCount + i;
+		m_parentCount += ct.localCount[c];
+	}
+	ct.slotCount = count;
+	m_liveCount += count;
+	return true;
+}
+
+// Merges the components over the links leaving the tile, optionally only the links into another tile.
+void dtComponentIndex::unionEdges(const int tileIndex, const int toTile)
+{
+	const dtComponentTile& ct = m_tiles[tileIndex];
+	if (!ct.slotCount)
+		return;
+	for (int j = 0; j < ct.edgeCount; ++j)
+	{
+		const dtComponentEdge& edge = ct.edges[j];
+		unsigned int salt, it, ip;
+		m_nav->decodePolyId(edge.neiRef, salt, it, ip);
+		if (toTile >= 0 && (int)it != toTile)
+			continue;
+		const dtComponentTile& nt = m_tiles[it];
+		if (!nt.slotCount || nt.salt != salt || (int)ip >= nt.polyCount)
+			continue;
+		for (int c = 0; c < m_classCount; ++c)
+		{
+			const unsigned short a = ct.local[c*ct.polyCount + edge.poly];
+			const unsigned short b = nt.local[c*nt.polyCount + ip];
+			if (a == DT_NULL_COMPONENT || b == DT_NULL_COMPONENT)
+				continue;
+			const int ra = findRoot(ct.base[c] + a);
+			const int rb = findRoot(nt.base[c] + b);
+			if (ra != rb)
+				m_parent[dtMax(ra, rb)] = dtMin(ra, rb);
+		}
+	}
+}
+
+void dtComponentIndex::rebuildComponents()
+{
+	int count = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		dtComponentTile& ct = m_tiles[i];
+		ct.slotCount = 0;
+		if (!ct.local)
+			continue;
+		for (int c = 0; c < m_classCount; ++c)
+		{
+			ct.base[c] = count;
+			ct.slotCount += ct.localCount[c];
+			count += ct.localCount[c];
+		}
+	}
+
+	if (count > m_parentCapacity)
+	{
+		dtFree(m_parent);
+		m_parentCapacity = dtMax(count, m_parentCapacity*2);
+		m_parent = (int*)dtAlloc(sizeof(int)*m_parentCapacity, DT_ALLOC_PERM);
+		if (!m_parent)
+		{
+			for (int i = 0; i < m_maxTiles; ++i)
+				m_tiles[i].slotCount = 0;
+			m_parentCapacity = 0;
+			m_parentCount = 0;
+			m_liveCount = 0;
+			return;
+		}
+	}
+	m_parentCount = count;
+	m_liveCount = count;
+	for (int i = 0; i < count; ++i)
+		m_parent[i] = i;
+
+	for (int i = 0; i < m_maxTiles; ++i)
+		unionEdges(i, -1);
+
+	// Flatten so that lookups are a single indirection.
+	for (int i = 0; i < count; ++i)
+		m_parent[i] = m_parent[m_parent[i]];
+}
+
+/// @par
+///
+/// The tile is labeled again, or dropped if it was removed. Components that ran
+/// through the tile are reset and merged again over the links of all tiles they
+/// spanned, since the change may split them.
+void dtComponentIndex::updateTile(const dtMeshTile* tile, const bool removed)
+{
+	static const int MAX_NEIS = 32;
+	const int tileIndex = (int)m_nav->decodePolyIdTile(m_nav->getTileRef(tile));
+	const dtComponentTile& ct = m_tiles[tileIndex];
+	const bool hadSlots = ct.slotCount != 0;
+
+	// Find the tiles spanned by the components of the tile, and reset those components.
+	unsigned char* affected = 0;
+	if (hadSlots)
+	{
+		affected = (unsigned char*)dtAlloc(m_maxTiles + m_parentCount*2, DT_ALLOC_TEMP);
+		if (affected)
+		{
+			unsigned char* roots = affected + m_maxTiles;
+			unsigned char* reset = roots + m_parentCount;
+			memset(affected, 0, m_maxTiles + m_parentCount*2);
+			for (int c = 0; c < m_classCount; ++c)
+			{
+				for (int i = 0; i < ct.localCount[c]; ++i)
+					roots[findRoot(ct.base[c] + i)] = 1;
+			}
+			for (int t = 0; t < m_maxTiles; ++t)
+			{
+				const dtComponentTile& tt = m_tiles[t];
+				for (int c = 0; c < m_classCount && tt.slotCount; ++c)
+				{
+					for (int i = 0; i < tt.localCount[c]; ++i)
+					{
+						const int slot = tt.base[c] + i;
+						if (roots[findRoot(slot)])
+						{
+							reset[slot] = 1;
+							affected[t] = 1;
+						}
+					}
+				}
+			}
+			for (int i = 0; i < m_parentCount; ++i)
+			{
+				if (reset[i])
+					m_parent[i] = i;
+			}
+		}
+	}
+
+	if (removed)
+		freeTile(tileIndex);
+	else
+		buildTile(tile);
+
+	// The neighbours gained or lost the links into the tile.
+	int neiIndices[MAX_NEIS*9];
+	int nneiIndices = 0;
+	const dtMeshTile* neis[MAX_NEIS];
+	for (int y = tile->header->y-1; y <= tile->header->y+1; ++y)
+	{
+		for (int x = tile->header->x-1; x <= tile->header->x+1; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				if (neis[j] == tile)
+					continue;
+				buildEdges(neis[j]);
+				neiIndices[nneiIndices++] = (int)m_nav->decodePolyIdTile(m_nav->getTileRef(neis[j]));
+			}
+		}
+	}
+
+	if ((hadSlots && !affected) || !allocSlots(tileIndex))
+	{
+		dtFree(affected);
+		rebuildComponents();
+		return;
+	}
+
+	if (affected)
+	{
+		for (int t = 0; t < m_maxTiles; ++t)
+		{
+			if (affected[t])
+				unionEdges(t, -1);
+		}
+		dtFree(affected);
+	}
+	unionEdges(tileIndex, -1);
+	for (int i = 0; i < nneiIndices; ++i)
+		unionEdges(neiIndices[i], tileIndex);
+
+	// Reclaim the entries of the removed and relabeled tiles once they outnumber the used ones.
+	if (m_parentCount - m_liveCount > dtMax(m_liveCount, 256))
+		rebuildComponents();
+}
+
+void dtComponentIndex::rebuildTile(const dtMeshTile* tile)
+{
+	if (!m_tiles || !tile || !tile->header)
+		return;
+	updateTile(tile, false);
+}
+
+void dtComponentIndex::tileAdded(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	updateTile(tile, false);
+}
+
+void dtComponentIndex::tileRemoved(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	updateTile(tile, true);
+}
+
+unsigned int dtComponentIndex::getComponent(dtPolyRef ref, const int filterClass) const
+{
+	if (!m_nav || !m_parent || filterClass < 0 || filterClass >= m_classCount)
+		return 0;
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId(ref, salt, it, ip);
+	if ((int)it >= m_maxTiles)
+		return 0;
+	const dtComponentTile& ct = m_tiles[it];
+	if (!ct.slotCount || ct.salt != salt || (int)ip >= ct.polyCount)
+		return 0;
+	const unsigned short local = ct.local[filterClass*ct.polyCount + ip];
+	if (local == DT_NULL_COMPONENT)
+		return 0;
+	int i = ct.base[filterClass] + local;
+	while (m_parent[i] != i)
+		i = m_parent[i];
+	return (unsigned int)i + 1;
+}
+
+/// @par
+///
+/// Polygons that are not indexed for the class, e.g. because the filter excludes
+/// them, are reported as reachable so that the search decides.
+bool dtComponentIndex::isReachable(dtPolyRef startRef, dtPolyRef endRef, const int filterClass) const
+{
+	const unsigned int a = getComponent(startRef, filterClass);
+	const unsigned int b = getComponent(endRef, filterClass);
+	if (!a || !b)
+		return true;
+	return a == b;
+}
+
+int dtComponentIndex::getMemUsed() const
+{
+	int mem = sizeof(*this) + sizeof(dtComponentTile)*m_maxTiles +
+		sizeof(int)*m_parentCapacity + sizeof(unsigned short)*m_stackCapacity;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtComponentTile& ct = m_tiles[i];
+		mem += sizeof(unsigned short)*ct.polyCount*m_classCount + sizeof(dtComponentEdge)*ct.edgeCount;
+	}
+	return mem;
+}
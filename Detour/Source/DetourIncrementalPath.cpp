@@ -0,0 +1,676 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <float.h>
+#include <string.h>
+#include "DetourIncrementalPath.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+static const float DT_INCREMENTAL_INF = FLT_MAX;
+static const float DT_INCREMENTAL_H_SCALE = 0.999f; // Search heuristic scale, same as dtNavMeshQuery.
+
+static unsigned int dtHashIncrementalRef(dtPolyRef ref)
+{
+#ifdef DT_POLYREF64
+	const unsigned int h = (unsigned int)(ref ^ (ref >> 32));
+#else
+	const unsigned int h = (unsigned int)ref;
+#endif
+	return h * 2654435761u;
+}
+
+// Finds the midpoint of the portal from one polygon to another. Fails if the
+// polygons are not linked both ways, one-way off-mesh connections are not followed.
+static bool dtGetPortalMid(dtPolyRef fromRef, const dtMeshTile* fromTile, const dtPoly* fromPoly,
+						   dtPolyRef toRef, const dtMeshTile* toTile, const dtPoly* toPoly,
+						   const dtLink& link, float* mid)
+{
+	const dtLink* back = 0;
+	for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+	{
+		if (toTile->links[i].ref == fromRef)
+		{
+			back = &toTile->links[i];
+			break;
+		}
+	}
+	if (!back)
+		return false;
+
+	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(mid, &fromTile->verts[fromPoly->verts[link.edge]*3]);
+		return true;
+	}
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(mid, &toTile->verts[toPoly->verts[back->edge]*3]);
+		return true;
+	}
+
+	const float* v0 = &fromTile->verts[fromPoly->verts[link.edge]*3];
+	const float* v1 = &fromTile->verts[fromPoly->verts[(link.edge+1) % (int)fromPoly->vertCount]*3];
+	float tmin = 0.0f, tmax = 1.0f;
+	if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		tmin = link.bmin*s;
+		tmax = link.bmax*s;
+	}
+	dtVlerp(mid, v0, v1, (tmin + tmax)*0.5f);
+	dtIgnoreUnused(toRef);
+	return true;
+}
+
+dtIncrementalPathQuery* dtAllocIncrementalPathQuery()
+{
+	void* mem = dtAlloc(sizeof(dtIncrementalPathQuery), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtIncrementalPathQuery;
+}
+
+void dtFreeIncrementalPathQuery(dtIncrementalPathQuery* query)
+{
+	if (!query) return;
+	query->~dtIncrementalPathQuery();
+	dtFree(query);
+}
+
+/// @class dtIncrementalPathQuery
+///
+/// The query searches backwards from the goal, so the costs to the goal stored
+/// in the search tree stay valid while the start moves along the path. When
+/// tiles change, only the polygons whose cost to the goal depends on the change
+/// are searched again. Repeated calls to #findPath with the same goal are much
+/// cheaper than new dtNavMeshQuery::findPath calls, as long as the changes are
+/// local.
+///
+/// The costs are measured between the polygon centers and the midpoints of the
+/// portals between them, with the goal polygon measured at the goal position.
+/// The paths can therefore differ slightly from the ones found by
+/// dtNavMeshQuery::findPath. Polygons are only connected when they link to each
+/// other, so one-way off-mesh connections are not used.
+///
+/// Changes to the navigation mesh are reported with #markTileChanged, or by
+/// registering the query as a tile listener of the navigation mesh with
+/// dtNavMesh::addTileListener. Removed polygons are detected by the salt of
+/// their references, and their nodes are freed for the polygons added later.
+/// Polygon flag changes are only seen in the reported tiles.
+///
+/// @see dtNavMeshQuery::findPath, #dtAllocIncrementalPathQuery
+
+dtIncrementalPathQuery::dtIncrementalPathQuery() :
+	m_nav(0),
+	m_filter(0),
+	m_nodes(0),
+	m_table(0),
+	m_heap(0),
+	m_maxNodes(0),
+	m_nodeCount(0),
+	m_tableMask(0),
+	m_heapSize(0),
+	m_goalRef(0),
+	m_startRef(0),
+	m_km(0),
+	m_expanded(0),
+	m_outOfNodes(false),
+	m_changedCount(0),
+	m_changeOverflow(false)
+{
+	dtVset(m_goalPos, 0, 0, 0);
+	dtVset(m_startPos, 0, 0, 0);
+}
+
+dtIncrementalPathQuery::~dtIncrementalPathQuery()
+{
+	purge();
+}
+
+void dtIncrementalPathQuery::purge()
+{
+	dtFree(m_nodes);
+	m_nodes = 0;
+	dtFree(m_table);
+	m_table = 0;
+	dtFree(m_heap);
+	m_heap = 0;
+	m_maxNodes = 0;
+	m_nodeCount = 0;
+	m_tableMask = 0;
+	m_heapSize = 0;
+	m_goalRef = 0;
+}
+
+dtStatus dtIncrementalPathQuery::init(const dtNavMesh* nav, const int maxNodes)
+{
+	if (!nav || maxNodes <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	// Keep the table at most half full so that the probe sequences stay short.
+	const int tableSize = (int)dtNextPow2((unsigned int)maxNodes*2);
+	m_nodes = (dtIncrementalNode*)dtAlloc(sizeof(dtIncrementalNode)*maxNodes, DT_ALLOC_PERM);
+	m_table = (int*)dtAlloc(sizeof(int)*tableSize, DT_ALLOC_PERM);
+	m_heap = (int*)dtAlloc(sizeof(int)*maxNodes, DT_ALLOC_PERM);
+	if (!m_nodes || !m_table || !m_heap)
+	{
+		purge();
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	m_nav = nav;
+	m_maxNodes = maxNodes;
+	m_tableMask = tableSize-1;
+	memset(m_table, 0xff, sizeof(int)*tableSize);
+
+	return DT_SUCCESS;
+}
+
+int dtIncrementalPathQuery::getMemUsed() const
+{
+	return (int)sizeof(*this) +
+		(int)(sizeof(dtIncrementalNode) + sizeof(int)) * m_maxNodes +
+		(int)sizeof(int) * (m_tableMask+1);
+}
+
+void dtIncrementalPathQuery::reset()
+{
+	memset(m_table, 0xff, sizeof(int)*(m_tableMask+1));
+	m_nodeCount = 0;
+	m_heapSize = 0;
+	m_startRef = 0;
+	m_km = 0;
+	m_outOfNodes = false;
+	m_changedCount = 0;
+	m_changeOverflow = false;
+
+	const int goal = createNode(m_goalRef);
+	m_nodes[goal].rhs = 0;
+	calcKey(goal, m_nodes[goal].key);
+	heapPush(goal);
+}
+
+dtStatus dtIncrementalPathQuery::setGoal(dtPolyRef goalRef, const float* goalPos, const dtQueryFilter* filter)
+{
+	if (!m_nodes || !m_nav->isValidPolyRef(goalRef) || !goalPos || !dtVisfinite(goalPos) || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_goalRef = goalRef;
+	dtVcopy(m_goalPos, goalPos);
+	m_filter = filter;
+	reset();
+
+	return DT_SUCCESS;
+}
+
+void dtIncrementalPathQuery::markTileChanged(const int tx, const int ty)
+{
+	for (int i = 0; i < m_changedCount; ++i)
+	{
+		if (m_changedTiles[i*2+0] == tx && m_changedTiles[i*2+1] == ty)
+			return;
+	}
+	if (m_changedCount >= MAX_CHANGED_TILES)
+	{
+		m_changeOverflow = true;
+		return;
+	}
+	m_changedTiles[m_changedCount*2+0] = tx;
+	m_changedTiles[m_changedCount*2+1] = ty;
+	m_changedCount++;
+}
+
+void dtIncrementalPathQuery::tileAdded(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	markTileChanged(tile->header->x, tile->header->y);
+}
+
+void dtIncrementalPathQuery::tileRemoved(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	markTileChanged(tile->header->x, tile->header->y);
+}
+
+int dtIncrementalPathQuery::findNode(dtPolyRef ref) const
+{
+	unsigned int slot = dtHashIncrementalRef(ref) & (unsigned int)m_tableMask;
+	while (m_table[slot] != -1)
+	{
+		if (m_nodes[m_table[slot]].ref == ref)
+			return m_table[slot];
+		slot = (slot+1) & (unsigned int)m_tableMask;
+	}
+	return -1;
+}
+
+int dtIncrementalPathQuery::createNode(dtPolyRef ref)
+{
+	int idx = findNode(ref);
+	if (idx != -1)
+		return idx;
+	if (m_nodeCount >= m_maxNodes)
+	{
+		m_outOfNodes = true;
+		return -1;
+	}
+
+	idx = m_nodeCount++;
+	dtIncrementalNode& node = m_nodes[idx];
+	node.ref = ref;
+	getNodePos(ref, node.pos);
+	node.g = DT_INCREMENTAL_INF;
+	node.rhs = DT_INCREMENTAL_INF;
+	node.key[0] = node.key[1] = DT_INCREMENTAL_INF;
+	node.heapIndex = -1;
+	insertNode(idx);
+	return idx;
+}
+
+void dtIncrementalPathQuery::insertNode(const int idx)
+{
+	unsigned int slot = dtHashIncrementalRef(m_nodes[idx].ref) & (unsigned int)m_tableMask;
+	while (m_table[slot] != -1)
+		slot = (slot+1) & (unsigned int)m_tableMask;
+	m_table[slot] = idx;
+}
+
+// Drops the nodes of the polygons removed from the navigation mesh. The remaining
+// nodes are moved to the front of the array and the table is rebuilt, so the nodes
+// are reused by the polygons added in their place.
+void dtIncrementalPathQuery::removeDeadNodes()
+{
+	int deadCount = 0;
+	for (int i = 0; i < m_nodeCount; ++i)
+	{
+		dtIncrementalNode& node = m_nodes[i];
+		if (m_nav->isValidPolyRef(node.ref))
+			continue;
+		if (node.heapIndex != -1)
+			heapRemove(i);
+		node.ref = 0;
+		deadCount++;
+	}
+	if (!deadCount)
+		return;
+
+	int n = 0;
+	for (int i = 0; i < m_nodeCount; ++i)
+	{
+		if (!m_nodes[i].ref)
+			continue;
+		if (i != n)
+		{
+			m_nodes[n] = m_nodes[i];
+			if (m_nodes[n].heapIndex != -1)
+				m_heap[m_nodes[n].heapIndex] = n;
+		}
+		n++;
+	}
+	m_nodeCount = n;
+
+	memset(m_table, 0xff, sizeof(int)*(m_tableMask+1));
+	for (int i = 0; i < m_nodeCount; ++i)
+		insertNode(i);
+}
+
+void dtIncrementalPathQuery::getNodePos(dtPolyRef ref, float* pos) const
+{
+	if (ref == m_goalRef)
+	{
+		dtVcopy(pos, m_goalPos);
+		return;
+	}
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	dtCalcPolyCenter(pos, poly->verts, (int)poly->vertCount, tile->verts);
+}
+
+float dtIncrementalPathQuery::calcRhs(dtPolyRef ref, const float* pos, dtPolyRef* bestRef) const
+{
+	if (bestRef)
+		*bestRef = 0;
+	if (ref == m_goalRef)
+		return 0.0f;
+
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	if (!m_filter->passFilter(ref, tile, poly))
+		return DT_INCREMENTAL_INF;
+
+	float best = DT_INCREMENTAL_INF;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtPolyRef neiRef = tile->links[i].ref;
+		if (!neiRef)
+			continue;
+		const int nei = findNode(neiRef);
+		if (nei == -1 || m_nodes[nei].g >= best)
+			continue;
+
+		const dtMeshTile* neiTile = 0;
+		const dtPoly* neiPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(neiRef, &neiTile, &neiPoly);
+		if (!m_filter->passFilter(neiRef, neiTile, neiPoly))
+			continue;
+		float mid[3];
+		if (!dtGetPortalMid(ref, tile, poly, neiRef, neiTile, neiPoly, tile->links[i], mid))
+			continue;
+
+		const float cost = m_filter->getCost(pos, mid, 0, 0, 0, ref, tile, poly, neiRef, neiTile, neiPoly) +
+						   m_filter->getCost(mid, m_nodes[nei].pos, ref, tile, poly, neiRef, neiTile, neiPoly, 0, 0, 0);
+		if (cost + m_nodes[nei].g < best)
+		{
+			best = cost + m_nodes[nei].g;
+			if (bestRef)
+				*bestRef = neiRef;
+		}
+	}
+	return best;
+}
+
+void dtIncrementalPathQuery::calcKey(const int idx, float* key) const
+{
+	const dtIncrementalNode& node = m_nodes[idx];
+	const float g = dtMin(node.g, node.rhs);
+	if (g >= DT_INCREMENTAL_INF)
+	{
+		key[0] = key[1] = DT_INCREMENTAL_INF;
+		return;
+	}
+	key[0] = g + dtVdist(m_startPos, node.pos)*DT_INCREMENTAL_H_SCALE + m_km;
+	key[1] = g;
+}
+
+void dtIncrementalPathQuery::updateVertex(const int idx)
+{
+	dtIncrementalNode& node = m_nodes[idx];
+	if (node.ref != m_goalRef)
+		node.rhs = calcRhs(node.ref, node.pos, 0);
+	if (node.heapIndex != -1)
+		heapRemove(idx);
+	if (node.g != node.rhs)
+	{
+		calcKey(idx, node.key);
+		heapPush(idx);
+	}
+}
+
+void dtIncrementalPathQuery::updateRef(dtPolyRef ref)
+{
+	int idx = findNode(ref);
+	if (idx == -1)
+	{
+		// Only polygons that can reach the goal are added to the search tree.
+		float pos[3];
+		getNodePos(ref, pos);
+		if (calcRhs(ref, pos, 0) >= DT_INCREMENTAL_INF)
+			return;
+		idx = createNode(ref);
+		if (idx == -1)
+			return;
+	}
+	updateVertex(idx);
+}
+
+void dtIncrementalPathQuery::updateNeighbours(const int idx)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(m_nodes[idx].ref, &tile, &poly);
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtPolyRef neiRef = tile->links[i].ref;
+		if (neiRef && neiRef != m_goalRef)
+			updateRef(neiRef);
+	}
+}
+
+void dtIncrementalPathQuery::processChanges()
+{
+	removeDeadNodes();
+
+	// The links of the polygons in and next to the changed tiles may have changed.
+	const int nodeCount = m_nodeCount;
+	for (int i = 0; i < nodeCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(m_nodes[i].ref, &tile, &poly);
+		for (int j = 0; j < m_changedCount; ++j)
+		{
+			if (dtAbs(tile->header->x - m_changedTiles[j*2+0]) <= 1 &&
+				dtAbs(tile->header->y - m_changedTiles[j*2+1]) <= 1)
+			{
+				updateVertex(i);
+				break;
+			}
+		}
+	}
+
+	// Polygons added to the changed tiles may open new routes.
+	static const int MAX_TILES = 32;
+	const dtMeshTile* tiles[MAX_TILES];
+	for (int j = 0; j < m_changedCount; ++j)
+	{
+		const int ntiles = m_nav->getTilesAt(m_changedTiles[j*2+0], m_changedTiles[j*2+1], tiles, MAX_TILES);
+		for (int k = 0; k < ntiles; ++k)
+		{
+			const dtPolyRef base = m_nav->getPolyRefBase(tiles[k]);
+			for (int p = 0; p < tiles[k]->header->polyCount; ++p)
+				updateRef(base | (dtPolyRef)p);
+		}
+	}
+
+	m_changedCount = 0;
+}
+
+void dtIncrementalPathQuery::computeShortestPath()
+{
+	const int start = findNode(m_startRef);
+	dtAssert(start != -1);
+
+	float startKey[2];
+	while (m_heapSize > 0)
+	{
+		const int top = m_heap[0];
+		calcKey(start, startKey);
+		if (!keyLess(m_nodes[top].key, startKey) && m_nodes[start].rhs == m_nodes[start].g)
+			break;
+
+		dtIncrementalNode& node = m_nodes[top];
+		float key[2];
+		calcKey(top, key);
+		if (keyLess(node.key, key))
+		{
+			// The key is out of date since the start moved.
+			node.key[0] = key[0];
+			node.key[1] = key[1];
+			heapRemove(top);
+			heapPush(top);
+		}
+		else if (node.g > node.rhs)
+		{
+			// The cost to the goal has dropped, pass it on.
+			node.g = node.rhs;
+			heapRemove(top);
+			updateNeighbours(top);
+			m_expanded++;
+		}
+		else
+		{
+			// The cost to the goal has grown, search the polygon and its neighbours again.
+			node.g = DT_INCREMENTAL_INF;
+			updateVertex(top);
+			updateNeighbours(top);
+			m_expanded++;
+		}
+	}
+}
+
+/// @par
+///
+/// If the goal cannot be reached, the path only contains the start polygon and
+/// #DT_PARTIAL_RESULT is set. If the goal polygon has been removed from the
+/// navigation mesh, the query fails and a new goal has to be set with #setGoal.
+///
+/// The search tree is kept for the next call. When it runs out of nodes, the
+/// result has #DT_OUT_OF_NODES set; call #setGoal again to start over.
+dtStatus dtIncrementalPathQuery::findPath(dtPolyRef startRef, dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+
+	if (!m_goalRef || !m_nav->isValidPolyRef(startRef) || !path || maxPath <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (!m_nav->isValidPolyRef(m_goalRef))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_expanded = 0;
+	if (m_changeOverflow)
+		reset();
+	else if (m_changedCount > 0)
+		processChanges();
+
+	if (startRef == m_goalRef)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS;
+	}
+
+	// Moving the start lowers the estimates of all keys in the open list by at most
+	// the distance moved, which is added to the keys computed from now on instead.
+	float startPos[3];
+	getNodePos(startRef, startPos);
+	if (m_startRef)
+		m_km += dtVdist(m_startPos, startPos)*DT_INCREMENTAL_H_SCALE;
+	m_startRef = startRef;
+	dtVcopy(m_startPos, startPos);
+
+	const int start = createNode(startRef);
+	if (start == -1)
+		return DT_FAILURE | DT_OUT_OF_NODES;
+	if (m_nodes[start].heapIndex == -1 && m_nodes[start].g >= DT_INCREMENTAL_INF)
+		updateVertex(start);
+
+	computeShortestPath();
+
+	dtStatus status = DT_SUCCESS;
+	if (m_outOfNodes)
+		status |= DT_OUT_OF_NODES;
+
+	// Follow the cheapest neighbours to the goal.
+	int n = 0;
+	dtPolyRef cur = startRef;
+	while (cur)
+	{
+		if (n >= maxPath)
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+			break;
+		}
+		path[n++] = cur;
+		if (cur == m_goalRef)
+			break;
+		const int idx = findNode(cur);
+		dtPolyRef next = 0;
+		if (idx != -1 && m_nodes[idx].g < DT_INCREMENTAL_INF)
+			calcRhs(cur, m_nodes[idx].pos, &next);
+		cur = next;
+	}
+	if (path[n-1] != m_goalRef && !(status & DT_BUFFER_TOO_SMALL))
+	{
+		// The goal cannot be reached.
+		n = 1;
+		status |= DT_PARTIAL_RESULT;
+	}
+
+	*pathCount = n;
+	return status;
+}
+
+bool dtIncrementalPathQuery::keyLess(const float* a, const float* b) const
+{
+	return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+}
+
+void dtIncrementalPathQuery::heapPush(const int idx)
+{
+	const int i = m_heapSize++;
+	m_heap[i] = idx;
+	m_nodes[idx].heapIndex = i;
+	bubbleUp(i);
+}
+
+void dtIncrementalPathQuery::heapRemove(const int idx)
+{
+	const int i = m_nodes[idx].heapIndex;
+	dtAssert(i != -1);
+	m_nodes[idx].heapIndex = -1;
+	m_heapSize--;
+	if (i == m_heapSize)
+		return;
+	m_heap[i] = m_heap[m_heapSize];
+	m_nodes[m_heap[i]].heapIndex = i;
+	bubbleUp(i);
+	trickleDown(m_nodes[m_heap[i]].heapIndex);
+}
+
+void dtIncrementalPathQuery::bubbleUp(int i)
+{
+	const int idx = m_heap[i];
+	while (i > 0)
+	{
+		const int parent = (i-1)/2;
+		if (!keyLess(m_nodes[idx].key, m_nodes[m_heap[parent]].key))
+			break;
+		m_heap[i] = m_heap[parent];
+		m_nodes[m_heap[i]].heapIndex = i;
+		i = parent;
+	}
+	m_heap[i] = idx;
+	m_nodes[idx].heapIndex = i;
+}
+
+void dtIncrementalPathQuery::trickleDown(int i)
+{
+	const int idx = m_heap[i];
+	for (;;)
+	{
+		int child = i*2+1;
+		if (child >= m_heapSize)
+			break;
+		if (child+1 < m_heapSize && keyLess(m_nodes[m_heap[child+1]].key, m_nodes[m_heap[child]].key))
+			child++;
+		if (!keyLess(m_nodes[m_heap[child]].key, m_nodes[idx].key))
+			break;
+		m_heap[i] = m_heap[child];
+		m_nodes[m_heap[i]].heapIndex = i;
+		i = child;
+	}
+	m_heap[i] = idx;
+	m_nodes[idx].heapIndex = i;
+}
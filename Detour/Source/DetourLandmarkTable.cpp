@@ -0,0 +1,954 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <float.h>
+#include <string.h>
+#include "DetourLandmarkTable.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+struct dtLandmarkTableHeader
+{
+	int magic;
+	int version;
+	int landmarkCount;
+	int tileCount;
+	dtPolyRef landmarks[DT_MAX_LANDMARKS];
+};
+
+struct dtLandmarkTileHeader
+{
+	dtTileRef tileRef;
+	int polyCount;
+	int linkCount;
+};
+
+// Identifies a stored link, the link indices depend on the order the tiles were added in.
+struct dtLandmarkLinkHeader
+{
+	dtPolyRef ref;
+	unsigned int poly;
+	unsigned int edge;
+};
+
+static const int MAX_AROUND_TILES = 256;
+
+// Gets the tiles of all layers in the 3x3 tile area centered on the tile.
+static int getTilesAround(const dtNavMesh* nav, const dtMeshTile* tile, const dtMeshTile** tiles, const int maxTiles)
+{
+	int n = 0;
+	for (int y = -1; y <= 1; ++y)
+	{
+		for (int x = -1; x <= 1; ++x)
+			n += nav->getTilesAt(tile->header->x + x, tile->header->y + y, tiles + n, maxTiles - n);
+	}
+	return n;
+}
+
+dtLandmarkTable* dtAllocLandmarkTable()
+{
+	void* mem = dtAlloc(sizeof(dtLandmarkTable), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtLandmarkTable;
+}
+
+void dtFreeLandmarkTable(dtLandmarkTable* table)
+{
+	if (!table) return;
+	table->~dtLandmarkTable();
+	dtFree(table);
+}
+
+/// @class dtLandmarkTable
+///
+/// The table stores, for a few landmark polygons, the shortest path cost from the
+/// landmark to every polygon of the navigation mesh. By the triangle inequality,
+/// the amount a landmark is farther from the goal than from the current polygon is
+/// a lower bound of the cost between the two, which is usually a much tighter
+/// estimate than the straight line distance in meshes with walls and corridors.
+///
+/// Assign the table to a query with dtNavMeshQuery::setLandmarkTable() to use it as
+/// the heuristic of dtNavMeshQuery::findPath() and the sliced path search.
+///
+/// The distances are measured on the nodes the path searches use: a polygon is
+/// entered at the mid point of the link it is entered through, and moving from a
+/// node to the next one costs what the filter returns for the segment between
+/// them. A polygon is entered through any of its links, so the table keeps the
+/// distance of each link and bounds the polygon by the smallest and the largest of
+/// them. The bound only uses the distances from the landmarks, because links can
+/// be one-way. With the filter passed to init() the bound never overestimates, and
+/// the path searches find paths as cheap as without the table. Queries using other
+/// area costs may get more expensive paths. Any-angle searches do not use the
+/// table, their shortcuts are cheaper than the nodes allow.
+///
+/// The table registers itself as a tile listener. Added tiles get their distances
+/// from the neighbour tiles and pass shorter routes on to the rest of the mesh,
+/// removed tiles are dropped. The bound stays valid, but after large changes the
+/// landmarks may be poorly placed; call build() again. Call build() as well after
+/// changing polygon flags or areas.
+///
+/// @see dtNavMeshQuery, #dtAllocLandmarkTable
+
+dtLandmarkTable::dtLandmarkTable() :
+	m_nav(0),
+	m_filter(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_landmarkCount(0),
+	m_heap(0),
+	m_heapSize(0),
+	m_heapCapacity(0)
+{
+	memset(m_landmarks, 0, sizeof(m_landmarks));
+}
+
+dtLandmarkTable::~dtLandmarkTable()
+{
+	purge();
+}
+
+void dtLandmarkTable::purge()
+{
+	if (m_nav)
+		m_nav->removeTileListener(this);
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(i);
+	dtFree(m_tiles);
+	m_tiles = 0;
+	m_maxTiles = 0;
+	dtFree(m_heap);
+	m_heap = 0;
+	m_heapSize = 0;
+	m_heapCapacity = 0;
+	m_landmarkCount = 0;
+	memset(m_landmarks, 0, sizeof(m_landmarks));
+	m_nav = 0;
+	m_filter = 0;
+}
+
+dtStatus dtLandmarkTable::init(dtNavMesh* nav, const dtQueryFilter* filter, const int landmarkCount)
+{
+	if (!nav || !filter || landmarkCount <= 0 || landmarkCount > DT_MAX_LANDMARKS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtLandmarkTile*)dtAlloc(sizeof(dtLandmarkTile)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtLandmarkTile)*m_maxTiles);
+
+	m_heapCapacity = 256;
+	m_heap = (dtLandmarkHeapItem*)dtAlloc(sizeof(dtLandmarkHeapItem)*m_heapCapacity, DT_ALLOC_PERM);
+	if (!m_heap)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	m_nav = nav;
+	m_filter = filter;
+	m_landmarkCount = landmarkCount;
+
+	dtStatus status = m_nav->addTileListener(this);
+	if (dtStatusFailed(status))
+	{
+		m_nav = 0;
+		return status;
+	}
+
+	return DT_SUCCESS;
+}
+
+bool dtLandmarkTable::allocTile(const dtMeshTile* tile)
+{
+	const int tileIndex = (int)m_nav->decodePolyIdTile(m_nav->getTileRef(tile));
+	dtLandmarkTile& lt = m_tiles[tileIndex];
+	const int polyCount = tile->header->polyCount;
+	const int linkCount = tile->header->maxLinkCount;
+	if (!lt.dist || lt.polyCount != polyCount || lt.linkCount != linkCount)
+	{
+		freeTile(tileIndex);
+		if (!polyCount)
+			return false;
+		lt.dist = (float*)dtAlloc(sizeof(float)*polyCount*m_landmarkCount*2, DT_ALLOC_PERM);
+		lt.linkDist = (float*)dtAlloc(sizeof(float)*dtMax(linkCount, 1)*m_landmarkCount, DT_ALLOC_PERM);
+		lt.firstNode = (int*)dtAlloc(sizeof(int)*(polyCount+1), DT_ALLOC_PERM);
+		if (!lt.dist || !lt.linkDist || !lt.firstNode)
+		{
+			freeTile(tileIndex);
+			return false;
+		}
+		memset(lt.firstNode, 0, sizeof(int)*(polyCount+1));
+	}
+	lt.salt = tile->salt;
+	lt.polyCount = polyCount;
+	lt.linkCount = linkCount;
+	lt.dirty = true;
+	for (int i = 0; i < polyCount*m_landmarkCount*2; ++i)
+		lt.dist[i] = DT_LANDMARK_UNREACHABLE;
+	for (int i = 0; i < linkCount*m_landmarkCount; ++i)
+		lt.linkDist[i] = DT_LANDMARK_UNREACHABLE;
+	return true;
+}
+
+void dtLandmarkTable::freeTile(const int tileIndex)
+{
+	dtLandmarkTile& lt = m_tiles[tileIndex];
+	dtFree(lt.dist);
+	dtFree(lt.linkDist);
+	dtFree(lt.firstNode);
+	dtFree(lt.nodes);
+	memset(&lt, 0, sizeof(lt));
+}
+
+/// @par
+///
+/// The nodes of a polygon are the links pointing to it, from this tile or one of
+/// the tiles around it. The node positions match dtNavMeshQuery::getLinkMidPoint().
+bool dtLandmarkTable::buildNodes(const dtMeshTile* tile)
+{
+	const dtNavMesh* cnav = m_nav;
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(base);
+	dtLandmarkTile& lt = m_tiles[tileIndex];
+	if (!lt.dist)
+		return true;
+
+	const dtMeshTile* tiles[MAX_AROUND_TILES];
+	const int ntiles = getTilesAround(cnav, tile, tiles, MAX_AROUND_TILES);
+
+	// Count the links into each polygon of the tile.
+	memset(lt.firstNode, 0, sizeof(int)*(lt.polyCount+1));
+	for (int i = 0; i < ntiles; ++i)
+	{
+		const dtMeshTile* fromTile = tiles[i];
+		const dtPolyRef fromBase = m_nav->getPolyRefBase(fromTile);
+		for (int j = 0; j < fromTile->header->polyCount; ++j)
+		{
+			const dtPoly* fromPoly = &fromTile->polys[j];
+			if (!m_filter->passFilter(fromBase | (dtPolyRef)j, fromTile, fromPoly))
+				continue;
+			for (unsigned int k = fromPoly->firstLink; k != DT_NULL_LINK; k = fromTile->links[k].next)
+			{
+				const dtPolyRef ref = fromTile->links[k].ref;
+				if (ref && m_nav->decodePolyIdTile(ref) == tileIndex)
+					lt.firstNode[m_nav->decodePolyIdPoly(ref)]++;
+			}
+		}
+	}
+
+	// Turn the counts into the ends of the node ranges, the nodes are filled in backwards.
+	int nodeCount = 0;
+	for (int i = 0; i < lt.polyCount; ++i)
+	{
+		nodeCount += lt.firstNode[i];
+		lt.firstNode[i] = nodeCount;
+	}
+	lt.firstNode[lt.polyCount] = nodeCount;
+
+	if (nodeCount > lt.nodeCapacity)
+	{
+		dtFree(lt.nodes);
+		lt.nodeCapacity = 0;
+		lt.nodes = (dtLandmarkNode*)dtAlloc(sizeof(dtLandmarkNode)*nodeCount, DT_ALLOC_PERM);
+		if (!lt.nodes)
+		{
+			memset(lt.firstNode, 0, sizeof(int)*(lt.polyCount+1));
+			return false;
+		}
+		lt.nodeCapacity = nodeCount;
+	}
+
+	for (int i = 0; i < ntiles; ++i)
+	{
+		const dtMeshTile* fromTile = tiles[i];
+		const dtPolyRef fromBase = m_nav->getPolyRefBase(fromTile);
+		const int fromIndex = (int)m_nav->decodePolyIdTile(fromBase);
+		for (int j = 0; j < fromTile->header->polyCount; ++j)
+		{
+			const dtPolyRef fromRef = fromBase | (dtPolyRef)j;
+			const dtPoly* fromPoly = &fromTile->polys[j];
+			if (!m_filter->passFilter(fromRef, fromTile, fromPoly))
+				continue;
+			for (unsigned int k = fromPoly->firstLink; k != DT_NULL_LINK; k = fromTile->links[k].next)
+			{
+				const dtPolyRef ref = fromTile->links[k].ref;
+				if (!ref || m_nav->decodePolyIdTile(ref) != tileIndex)
+					continue;
+				const unsigned int ip = m_nav->decodePolyIdPoly(ref);
+				dtLandmarkNode& node = lt.nodes[--lt.firstNode[ip]];
+				node.tile = fromIndex;
+				node.link = k;
+				node.poly = (unsigned int)j;
+				dtNavMeshQuery::getLinkMidPoint(k, fromRef, fromPoly, fromTile, ref, &tile->polys[ip], tile, node.pos);
+			}
+		}
+	}
+
+	lt.dirty = true;
+	return true;
+}
+
+bool dtLandmarkTable::buildNeighbourNodes(const dtMeshTile* tile, const int skipTile)
+{
+	const dtMeshTile* tiles[MAX_AROUND_TILES];
+	const int ntiles = getTilesAround(m_nav, tile, tiles, MAX_AROUND_TILES);
+	bool ok = true;
+	for (int i = 0; i < ntiles; ++i)
+	{
+		if ((int)m_nav->decodePolyIdTile(m_nav->getTileRef(tiles[i])) != skipTile && !buildNodes(tiles[i]))
+			ok = false;
+	}
+	return ok;
+}
+
+float* dtLandmarkTable::getNodeDist(const dtLandmarkNode& node, const int landmark) const
+{
+	const dtLandmarkTile& lt = m_tiles[node.tile];
+	if (!lt.linkDist)
+		return 0;
+	return &lt.linkDist[node.link*m_landmarkCount + landmark];
+}
+
+void dtLandmarkTable::updateBounds(const int tileIndex)
+{
+	dtLandmarkTile& lt = m_tiles[tileIndex];
+	lt.dirty = false;
+	if (!lt.dist)
+		return;
+	for (int i = 0; i < lt.polyCount; ++i)
+	{
+		float* minDist = &lt.dist[i*m_landmarkCount*2];
+		float* maxDist = minDist + m_landmarkCount;
+		for (int k = 0; k < m_landmarkCount; ++k)
+		{
+			float dmin = DT_LANDMARK_UNREACHABLE;
+			float dmax = DT_LANDMARK_UNREACHABLE;
+			bool reachable = lt.firstNode[i] < lt.firstNode[i+1];
+			for (int j = lt.firstNode[i]; j < lt.firstNode[i+1]; ++j)
+			{
+				const float* d = getNodeDist(lt.nodes[j], k);
+				if (!d || *d < 0.0f)
+				{
+					// The polygon may be entered at a node the landmark does not reach.
+					reachable = false;
+					continue;
+				}
+				if (dmin < 0.0f || *d < dmin)
+					dmin = *d;
+				if (*d > dmax)
+					dmax = *d;
+			}
+			minDist[k] = dmin;
+			maxDist[k] = reachable ? dmax : DT_LANDMARK_UNREACHABLE;
+		}
+	}
+}
+
+void dtLandmarkTable::updateDirtyBounds()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_tiles[i].dirty)
+			updateBounds(i);
+	}
+}
+
+bool dtLandmarkTable::pushHeap(const float cost, const int tile, const int node)
+{
+	if (m_heapSize >= m_heapCapacity)
+	{
+		const int capacity = m_heapCapacity*2;
+		dtLandmarkHeapItem* heap = (dtLandmarkHeapItem*)dtAlloc(sizeof(dtLandmarkHeapItem)*capacity, DT_ALLOC_TEMP);
+		if (!heap)
+			return false;
+		memcpy(heap, m_heap, sizeof(dtLandmarkHeapItem)*m_heapSize);
+		dtFree(m_heap);
+		m_heap = heap;
+		m_heapCapacity = capacity;
+	}
+
+	int i = m_heapSize++;
+	while (i > 0)
+	{
+		const int parent = (i-1)/2;
+		if (m_heap[parent].cost <= cost)
+			break;
+		m_heap[i] = m_heap[parent];
+		i = parent;
+	}
+	m_heap[i].cost = cost;
+	m_heap[i].tile = tile;
+	m_heap[i].node = node;
+	return true;
+}
+
+dtLandmarkTable::dtLandmarkHeapItem dtLandmarkTable::popHeap()
+{
+	dtAssert(m_heapSize > 0);
+	const dtLandmarkHeapItem top = m_heap[0];
+	const dtLandmarkHeapItem last = m_heap[--m_heapSize];
+	int i = 0;
+	for (;;)
+	{
+		int child = i*2+1;
+		if (child >= m_heapSize)
+			break;
+		if (child+1 < m_heapSize && m_heap[child+1].cost < m_heap[child].cost)
+			child++;
+		if (last.cost <= m_heap[child].cost)
+			break;
+		m_heap[i] = m_heap[child];
+		i = child;
+	}
+	if (m_heapSize > 0)
+		m_heap[i] = last;
+	return top;
+}
+
+bool dtLandmarkTable::pushPolyNodes(const int landmark, const int tileIndex, const unsigned int polyIndex, const bool seed)
+{
+	dtLandmarkTile& lt = m_tiles[tileIndex];
+	if (!lt.firstNode || (int)polyIndex >= lt.polyCount)
+		return true;
+	for (int i = lt.firstNode[polyIndex]; i < lt.firstNode[polyIndex+1]; ++i)
+	{
+		float* d = getNodeDist(lt.nodes[i], landmark);
+		if (!d)
+			continue;
+		if (seed)
+		{
+			*d = 0.0f;
+			lt.dirty = true;
+		}
+		else if (*d < 0.0f)
+		{
+			continue;
+		}
+		if (!pushHeap(*d, tileIndex, i))
+			return false;
+	}
+	return true;
+}
+
+/// @par
+///
+/// Lowers the distances reachable from the nodes in the open list. Starting from
+/// distances no other node can improve, the result is the shortest distances.
+bool dtLandmarkTable::runDijkstra(const int landmark)
+{
+	const dtNavMesh* cnav = m_nav;
+
+	while (m_heapSize > 0)
+	{
+		const dtLandmarkHeapItem best = popHeap();
+		const dtLandmarkNode& bestNode = m_tiles[best.tile].nodes[best.node];
+		const float* bestDist = getNodeDist(bestNode, landmark);
+		if (!bestDist || best.cost > *bestDist)
+			continue;
+
+		// The polygon the node enters.
+		const dtPolyRef bestRef = cnav->getTile(bestNode.tile)->links[bestNode.link].ref;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		cnav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			const dtPolyRef neiRef = bestTile->links[i].ref;
+			if (!neiRef)
+				continue;
+
+			unsigned int neiSalt, neiIt, neiIp;
+			m_nav->decodePolyId(neiRef, neiSalt, neiIt, neiIp);
+			dtLandmarkTile& lt = m_tiles[neiIt];
+			if (!lt.dist || lt.salt != neiSalt)
+				continue;
+
+			const dtMeshTile* neiTile = 0;
+			const dtPoly* neiPoly = 0;
+			cnav->getTileAndPolyByRefUnsafe(neiRef, &neiTile, &neiPoly);
+			if (!m_filter->passFilter(neiRef, neiTile, neiPoly))
+				continue;
+
+			// The search keeps the node position a polygon was first reached at,
+			// so the neighbour may be entered at any of its nodes.
+			for (int j = lt.firstNode[neiIp]; j < lt.firstNode[neiIp+1]; ++j)
+			{
+				const dtLandmarkNode& neiNode = lt.nodes[j];
+				float* dist = getNodeDist(neiNode, landmark);
+				if (!dist)
+					continue;
+
+				// The forward search charges the move to the current polygon and the
+				// backward search to the next one, use the cheaper of the two.
+				const float ca = m_filter->getCost(bestNode.pos, neiNode.pos, 0, 0, 0,
+												   bestRef, bestTile, bestPoly, neiRef, neiTile, neiPoly);
+				const float cb = m_filter->getCost(bestNode.pos, neiNode.pos, bestRef, bestTile, bestPoly,
+												   neiRef, neiTile, neiPoly, 0, 0, 0);
+				const float cost = best.cost + dtMin(ca, cb);
+				if (*dist >= 0.0f && cost >= *dist)
+					continue;
+				*dist = cost;
+				lt.dirty = true;
+				if (!pushHeap(cost, (int)neiIt, j))
+				{
+					m_heapSize = 0;
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool dtLandmarkTable::seedTile(const dtMeshTile* tile, const int landmark)
+{
+	const dtNavMesh* cnav = m_nav;
+
+	m_heapSize = 0;
+
+	// The landmark may live in the tile.
+	const dtPolyRef landmarkRef = m_landmarks[landmark];
+	if (landmarkRef && cnav->isValidPolyRef(landmarkRef))
+	{
+		if (!pushPolyNodes(landmark, (int)m_nav->decodePolyIdTile(landmarkRef), m_nav->decodePolyIdPoly(landmarkRef), true))
+			return false;
+	}
+
+	// The new links lead into the tiles around, continue from every polygon
+	// linking to a polygon there.
+	const dtMeshTile* tiles[MAX_AROUND_TILES];
+	const int ntiles = getTilesAround(cnav, tile, tiles, MAX_AROUND_TILES);
+	for (int i = 0; i < ntiles; ++i)
+	{
+		const dtLandmarkTile& lt = m_tiles[m_nav->decodePolyIdTile(m_nav->getTileRef(tiles[i]))];
+		if (!lt.dist)
+			continue;
+		for (int j = 0; j < lt.firstNode[lt.polyCount]; ++j)
+		{
+			if (!pushPolyNodes(landmark, lt.nodes[j].tile, lt.nodes[j].poly, false))
+				return false;
+		}
+	}
+
+	return runDijkstra(landmark);
+}
+
+
+bool dtLandmarkTable::isLandmarkCandidate(const dtMeshTile* tile, const int polyIndex) const
+{
+	const dtPoly* poly = &tile->polys[polyIndex];
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+		return false;
+	return m_filter->passFilter(m_nav->getPolyRefBase(tile) | (dtPolyRef)polyIndex, tile, poly);
+}
+
+bool dtLandmarkTable::searchFrom(const int landmark, const dtPolyRef ref)
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		dtLandmarkTile& lt = m_tiles[i];
+		for (int j = 0; j < lt.linkCount; ++j)
+			lt.linkDist[j*m_landmarkCount + landmark] = DT_LANDMARK_UNREACHABLE;
+		lt.dirty = lt.dist != 0;
+	}
+
+	m_heapSize = 0;
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId(ref, salt, it, ip);
+	if (!pushPolyNodes(landmark, (int)it, ip, true) || !runDijkstra(landmark))
+		return false;
+	updateDirtyBounds();
+	return true;
+}
+
+/// @par
+///
+/// The landmarks are chosen by farthest point sampling. The first landmark is the
+/// polygon farthest from an arbitrary polygon, and each next one is the polygon
+/// farthest from all landmarks chosen so far. Polygons none of the landmarks can
+/// reach are picked first, so that each island gets a landmark while there are
+/// landmarks left.
+///
+/// The cost is proportional to the number of landmarks times the number of links
+/// in the navigation mesh.
+dtStatus dtLandmarkTable::build()
+{
+	if (!m_nav || !m_tiles)
+		return DT_FAILURE;
+
+	const dtNavMesh* cnav = m_nav;
+
+	memset(m_landmarks, 0, sizeof(m_landmarks));
+
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (!tile->header)
+		{
+			freeTile(i);
+			continue;
+		}
+		if (!allocTile(tile) && tile->header->polyCount)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	dtPolyRef seedRef = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (!m_tiles[i].dist)
+			continue;
+		if (!buildNodes(tile))
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		for (int j = 0; j < tile->header->polyCount && !seedRef; ++j)
+		{
+			if (isLandmarkCandidate(tile, j))
+				seedRef = m_nav->getPolyRefBase(tile) | (dtPolyRef)j;
+		}
+	}
+	if (!seedRef)
+		return DT_SUCCESS;
+
+	// Search from the seed, then move the first landmark to the far end of its island.
+	if (!searchFrom(0, seedRef))
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	for (int k = 0; k < m_landmarkCount; ++k)
+	{
+		dtPolyRef bestRef = 0;
+		float bestDist = 0.0f;
+		for (int i = 0; i < m_maxTiles; ++i)
+		{
+			const dtMeshTile* tile = cnav->getTile(i);
+			const dtLandmarkTile& lt = m_tiles[i];
+			if (!tile->header || !lt.dist)
+				continue;
+			for (int j = 0; j < lt.polyCount; ++j)
+			{
+				if (!isLandmarkCandidate(tile, j))
+					continue;
+				// Distance to the closest landmark so far, the seed stands in for the first one.
+				const float* dist = &lt.dist[j*m_landmarkCount*2];
+				float d = FLT_MAX;
+				for (int l = 0; l < dtMax(k, 1); ++l)
+				{
+					if (dist[l] >= 0.0f && dist[l] < d)
+						d = dist[l];
+				}
+				if (d > bestDist)
+				{
+					bestDist = d;
+					bestRef = m_nav->getPolyRefBase(tile) | (dtPolyRef)j;
+				}
+			}
+		}
+		if (!bestRef)
+		{
+			if (k == 0)
+				bestRef = seedRef;
+			else
+				break;
+		}
+
+		m_landmarks[k] = bestRef;
+		if (!searchFrom(k, bestRef))
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// The distances are continued from the polygons around the tile, or from the
+/// landmark if it is located in the tile. Where the tile opens a shorter route,
+/// the distances of the other tiles are lowered as well.
+void dtLandmarkTable::rebuildTile(const dtMeshTile* tile)
+{
+	if (!m_tiles || !tile || !tile->header)
+		return;
+	if (!allocTile(tile))
+		return;
+
+	const dtNavMesh* cnav = m_nav;
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(m_nav->getTileRef(tile));
+
+	// The links from the tiles around into the tile are new, the link slots may hold old distances.
+	const dtMeshTile* tiles[MAX_AROUND_TILES];
+	const int ntiles = getTilesAround(cnav, tile, tiles, MAX_AROUND_TILES);
+	for (int i = 0; i < ntiles; ++i)
+	{
+		const dtMeshTile* nei = tiles[i];
+		dtLandmarkTile& lt = m_tiles[m_nav->decodePolyIdTile(m_nav->getTileRef(nei))];
+		if (nei == tile || !lt.linkDist)
+			continue;
+		for (int j = 0; j < nei->header->polyCount; ++j)
+		{
+			for (unsigned int k = nei->polys[j].firstLink; k != DT_NULL_LINK; k = nei->links[k].next)
+			{
+				if (nei->links[k].ref && m_nav->decodePolyIdTile(nei->links[k].ref) == tileIndex)
+				{
+					for (int l = 0; l < m_landmarkCount; ++l)
+						lt.linkDist[k*m_landmarkCount + l] = DT_LANDMARK_UNREACHABLE;
+				}
+			}
+		}
+	}
+
+	if (!buildNeighbourNodes(tile, -1))
+		return;
+
+	for (int k = 0; k < m_landmarkCount; ++k)
+	{
+		if (!m_landmarks[k])
+			continue;
+		if (!seedTile(tile, k))
+		{
+			m_heapSize = 0;
+			break;
+		}
+	}
+	updateDirtyBounds();
+}
+
+void dtLandmarkTable::tileAdded(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	rebuildTile(tile);
+}
+
+void dtLandmarkTable::tileRemoved(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	if (!m_tiles)
+		return;
+	const int tileIndex = (int)m_nav->decodePolyIdTile(m_nav->getTileRef(tile));
+	freeTile(tileIndex);
+	// The polygons around lose the nodes entered from the tile.
+	buildNeighbourNodes(tile, tileIndex);
+	updateDirtyBounds();
+}
+
+static int getLinkCount(const dtMeshTile* tile)
+{
+	int n = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		for (unsigned int j = tile->polys[i].firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+			n++;
+	}
+	return n;
+}
+
+int dtLandmarkTable::getDataSize() const
+{
+	const dtNavMesh* cnav = m_nav;
+	const int linkSize = (int)(sizeof(dtLandmarkLinkHeader) + sizeof(float)*m_landmarkCount);
+	int size = sizeof(dtLandmarkTableHeader);
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (!m_tiles[i].dist)
+			continue;
+		size += sizeof(dtLandmarkTileHeader) + linkSize*getLinkCount(cnav->getTile(i));
+	}
+	return size;
+}
+
+/// @par
+///
+/// Each tile is stored with its tile reference and each link with the polygon
+/// reference it points to, so the data can be restored only for the same tiles of
+/// the same navigation mesh. Store the table next to the tiles, e.g. after the
+/// navigation mesh tiles in a save file.
+///
+/// The data uses the byte order and the polygon reference size of the platform.
+dtStatus dtLandmarkTable::store(unsigned char* data, const int maxDataSize) const
+{
+	if (!m_nav || !data)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (maxDataSize < getDataSize())
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	const dtNavMesh* cnav = m_nav;
+
+	dtLandmarkTableHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = DT_LANDMARK_MAGIC;
+	header.version = DT_LANDMARK_VERSION;
+	header.landmarkCount = m_landmarkCount;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_tiles[i].dist)
+			header.tileCount++;
+	}
+	memcpy(header.landmarks, m_landmarks, sizeof(m_landmarks));
+
+	unsigned char* d = data;
+	memcpy(d, &header, sizeof(header));
+	d += sizeof(header);
+
+	const int distSize = (int)sizeof(float)*m_landmarkCount;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtLandmarkTile& lt = m_tiles[i];
+		if (!lt.dist)
+			continue;
+		const dtMeshTile* tile = cnav->getTile(i);
+		dtLandmarkTileHeader tileHeader;
+		memset(&tileHeader, 0, sizeof(tileHeader));
+		tileHeader.tileRef = (dtTileRef)m_nav->encodePolyId(lt.salt, i, 0);
+		tileHeader.polyCount = lt.polyCount;
+		tileHeader.linkCount = getLinkCount(tile);
+		memcpy(d, &tileHeader, sizeof(tileHeader));
+		d += sizeof(tileHeader);
+
+		for (int j = 0; j < tile->header->polyCount; ++j)
+		{
+			for (unsigned int k = tile->polys[j].firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				dtLandmarkLinkHeader linkHeader;
+				memset(&linkHeader, 0, sizeof(linkHeader));
+				linkHeader.ref = tile->links[k].ref;
+				linkHeader.poly = (unsigned int)j;
+				linkHeader.edge = tile->links[k].edge;
+				memcpy(d, &linkHeader, sizeof(linkHeader));
+				d += sizeof(linkHeader);
+				memcpy(d, &lt.linkDist[k*m_landmarkCount], distSize);
+				d += distSize;
+			}
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtLandmarkTable::restore(const unsigned char* data, const int dataSize)
+{
+	if (!m_nav || !data || dataSize < (int)sizeof(dtLandmarkTableHeader))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtLandmarkTableHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != DT_LANDMARK_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header.version != DT_LANDMARK_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+	if (header.landmarkCount != m_landmarkCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtNavMesh* cnav = m_nav;
+
+	// Number of links restored per tile.
+	int* restored = (int*)dtAlloc(sizeof(int)*m_maxTiles, DT_ALLOC_TEMP);
+	if (!restored)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(restored, 0, sizeof(int)*m_maxTiles);
+
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(i);
+	memcpy(m_landmarks, header.landmarks, sizeof(m_landmarks));
+
+	const size_t distSize = sizeof(float)*m_landmarkCount;
+	const size_t linkSize = sizeof(dtLandmarkLinkHeader) + distSize;
+	const unsigned char* d = data + sizeof(header);
+	const unsigned char* end = data + dataSize;
+	for (int i = 0; i < header.tileCount; ++i)
+	{
+		dtLandmarkTileHeader tileHeader;
+		if ((size_t)(end - d) < sizeof(tileHeader))
+		{
+			dtFree(restored);
+			return DT_FAILURE | DT_INVALID_PARAM;
+		}
+		memcpy(&tileHeader, d, sizeof(tileHeader));
+		d += sizeof(tileHeader);
+		// Check the counts against the remaining data before using them, they are not trusted.
+		if (tileHeader.polyCount < 0 || tileHeader.linkCount < 0 ||
+			(size_t)tileHeader.linkCount > (size_t)(end - d) / linkSize)
+		{
+			dtFree(restored);
+			return DT_FAILURE | DT_INVALID_PARAM;
+		}
+
+		const dtMeshTile* tile = cnav->getTileByRef(tileHeader.tileRef);
+		const bool match = tile && tile->header && tile->header->polyCount == tileHeader.polyCount && allocTile(tile);
+		const int tileIndex = (int)m_nav->decodePolyIdTile(tileHeader.tileRef);
+		for (int j = 0; j < tileHeader.linkCount; ++j)
+		{
+			dtLandmarkLinkHeader linkHeader;
+			memcpy(&linkHeader, d, sizeof(linkHeader));
+			d += sizeof(linkHeader);
+			if (match && linkHeader.poly < (unsigned int)tile->header->polyCount)
+			{
+				// Find the same link, the links of a polygon are ordered by the tile adding order.
+				const dtPoly* poly = &tile->polys[linkHeader.poly];
+				for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+				{
+					if (tile->links[k].ref == linkHeader.ref && tile->links[k].edge == linkHeader.edge)
+					{
+						memcpy(&m_tiles[tileIndex].linkDist[k*m_landmarkCount], d, distSize);
+						restored[tileIndex]++;
+						break;
+					}
+				}
+			}
+			d += distSize;
+		}
+	}
+
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (tile->header && !m_tiles[i].dist)
+			allocTile(tile);
+	}
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_tiles[i].dist)
+			buildNodes(cnav->getTile(i));
+	}
+	updateDirtyBounds();
+
+	// Tiles that changed since the table was stored, or whose neighbours changed.
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (m_tiles[i].dist && restored[i] != getLinkCount(tile))
+			rebuildTile(tile);
+	}
+
+	dtFree(restored);
+
+	return DT_SUCCESS;
+}
+
+int dtLandmarkTable::getMemUsed() const
+{
+	int mem = sizeof(*this) + sizeof(dtLandmarkTile)*m_maxTiles + sizeof(dtLandmarkHeapItem)*m_heapCapacity;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtLandmarkTile& lt = m_tiles[i];
+		if (!lt.dist)
+			continue;
+		mem += sizeof(float)*lt.polyCount*m_landmarkCount*2 + sizeof(float)*lt.linkCount*m_landmarkCount;
+		mem += sizeof(int)*(lt.polyCount+1) + sizeof(dtLandmarkNode)*lt.nodeCapacity;
+	}
+	return mem;
+}
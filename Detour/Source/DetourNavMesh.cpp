@@ -17,6 +17,7 @@
 //
 
 #include <float.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include "DetourNavMesh.h"
@@ -134,6 +135,415 @@ inline void freeLink(dtMeshTile* tile, unsigned int link)
 	tile->linksFreeList = link;
 }
 
+// Stores the portal of a polygon edge link, matching dtNavMeshQuery::getPortalPoints().
+inline void storeEdgePortal(dtMeshTile* tile, unsigned int idx, const dtPoly* poly)
+{
+	if (!tile->portals)
+		return;
+	const dtLink* link = &tile->links[idx];
+	dtLinkPortal* portal = &tile->portals[idx];
+	const float* va = &tile->verts[poly->verts[link->edge]*3];
+	const float* vb = &tile->verts[poly->verts[(link->edge+1) % (int)poly->vertCount]*3];
+	if (link->side != 0xff && (link->bmin != 0 || link->bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		dtVlerp(portal->left, va, vb, link->bmin*s);
+		dtVlerp(portal->right, va, vb, link->bmax*s);
+	}
+	else
+	{
+		dtVcopy(portal->left, va);
+		dtVcopy(portal->right, vb);
+	}
+	portal->mid[0] = (portal->left[0]+portal->right[0])*0.5f;
+	portal->mid[1] = (portal->left[1]+portal->right[1])*0.5f;
+	portal->mid[2] = (portal->left[2]+portal->right[2])*0.5f;
+}
+
+// Stores the portal of a link to or from an off-mesh connection, which collapses to the connection end point.
+inline void storePointPortal(dtMeshTile* tile, unsigned int idx, const float* pos)
+{
+	if (!tile->portals)
+		return;
+	dtLinkPortal* portal = &tile->portals[idx];
+	dtVcopy(portal->left, pos);
+	dtVcopy(portal->right, pos);
+	dtVcopy(portal->mid, pos);
+}
+
+// Returns the range of polygon grid cells covered by the bounds of a polygon.
+inline void calcPolyGridCells(const dtPolyGrid* grid, const float* verts, const dtPoly* poly,
+							  int* minx, int* minz, int* maxx, int* maxz)
+{
+	const float* v = &verts[poly->verts[0]*3];
+	float bmin[2] = { v[0], v[2] };
+	float bmax[2] = { v[0], v[2] };
+	for (int i = 1; i < (int)poly->vertCount; ++i)
+	{
+		v = &verts[poly->verts[i]*3];
+		bmin[0] = dtMin(bmin[0], v[0]);
+		bmin[1] = dtMin(bmin[1], v[2]);
+		bmax[0] = dtMax(bmax[0], v[0]);
+		bmax[1] = dtMax(bmax[1], v[2]);
+	}
+	const float ics = 1.0f / grid->cellSize;
+	*minx = dtClamp((int)dtMathFloorf((bmin[0] - grid->bmin[0]) * ics), 0, grid->width-1);
+	*minz = dtClamp((int)dtMathFloorf((bmin[1] - grid->bmin[2]) * ics), 0, grid->height-1);
+	*maxx = dtClamp((int)dtMathFloorf((bmax[0] - grid->bmin[0]) * ics), 0, grid->width-1);
+	*maxz = dtClamp((int)dtMathFloorf((bmax[1] - grid->bmin[2]) * ics), 0, grid->height-1);
+}
+
+// Builds the grid of the polygons overlapping each cell of a tile.
+static dtPolyGrid* buildPolyGrid(const dtMeshHeader* header, const float* verts, const dtPoly* polys, float cellSize)
+{
+	static const int MAX_GRID_SIZE = 256;
+
+	const float sizex = header->bmax[0] - header->bmin[0];
+	const float sizez = header->bmax[2] - header->bmin[2];
+	if (cellSize <= 0.0f)
+	{
+		// About one cell per polygon.
+		const float n = dtMathCeilf(dtMathSqrtf((float)dtMax(header->polyCount, 1)));
+		cellSize = dtMax(sizex, sizez) / n;
+	}
+	// Use larger cells rather than more than MAX_GRID_SIZE along a side.
+	cellSize = dtMax(cellSize, dtMax(sizex, sizez) / MAX_GRID_SIZE);
+	if (!(cellSize > 0.0f))
+		cellSize = 1.0f;
+
+	dtPolyGrid layout;
+	memset(&layout, 0, sizeof(layout));
+	dtVcopy(layout.bmin, header->bmin);
+	layout.cellSize = cellSize;
+	layout.width = dtClamp((int)dtMathCeilf(sizex / cellSize), 1, MAX_GRID_SIZE);
+	layout.height = dtClamp((int)dtMathCeilf(sizez / cellSize), 1, MAX_GRID_SIZE);
+	const int ncells = layout.width * layout.height;
+
+	// Count the entries to size the allocation.
+	int nentries = 0;
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		if (polys[i].getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		int minx, minz, maxx, maxz;
+		calcPolyGridCells(&layout, verts, &polys[i], &minx, &minz, &maxx, &maxz);
+		nentries += (maxx - minx + 1) * (maxz - minz + 1);
+	}
+
+	const int gridSize = dtAlign4(sizeof(dtPolyGrid));
+	const int cellsSize = dtAlign4(sizeof(unsigned int)*(ncells+1));
+	const int polysSize = dtAlign4(sizeof(unsigned short)*nentries);
+	unsigned char* data = (unsigned char*)dtAlloc(gridSize + cellsSize + polysSize, DT_ALLOC_PERM);
+	if (!data)
+		return 0;
+
+	dtPolyGrid* grid = (dtPolyGrid*)data;
+	*grid = layout;
+	grid->cells = (unsigned int*)(data + gridSize);
+	grid->polys = (unsigned short*)(data + gridSize + cellsSize);
+	grid->memSize = gridSize + cellsSize + polysSize;
+
+	// Count the polygons of each cell and turn the counts into the first entry of each cell.
+	memset(grid->cells, 0, sizeof(unsigned int)*(ncells+1));
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		if (polys[i].getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		int minx, minz, maxx, maxz;
+		calcPolyGridCells(grid, verts, &polys[i], &minx, &minz, &maxx, &maxz);
+		for (int z = minz; z <= maxz; ++z)
+			for (int x = minx; x <= maxx; ++x)
+				grid->cells[z*grid->width + x]++;
+	}
+	unsigned int first = 0;
+	for (int i = 0; i < ncells; ++i)
+	{
+		const unsigned int n = grid->cells[i];
+		grid->cells[i] = first;
+		first += n;
+	}
+	grid->cells[ncells] = first;
+
+	// Store the polygons, advancing the first entry of each cell past them,
+	// then shift the cells back so they start at their first entry again.
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		if (polys[i].getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		int minx, minz, maxx, maxz;
+		calcPolyGridCells(grid, verts, &polys[i], &minx, &minz, &maxx, &maxz);
+		for (int z = minz; z <= maxz; ++z)
+			for (int x = minx; x <= maxx; ++x)
+				grid->polys[grid->cells[z*grid->width + x]++] = (unsigned short)i;
+	}
+	for (int i = ncells-1; i > 0; --i)
+		grid->cells[i] = grid->cells[i-1];
+	grid->cells[0] = 0;
+
+	return grid;
+}
+
+// Detail meshes with fewer triangles than this are searched without a grid.
+static const int DETAIL_GRID_MIN_TRIS = 16;
+// The maximum number of cells along each side of a detail triangle grid.
+static const int DETAIL_GRID_MAX_SIZE = 16;
+
+inline const float* getDetailTriVertex(const dtMeshTile* tile, const dtPoly* poly, const dtPolyDetail* pd, const unsigned char i)
+{
+	if (i < poly->vertCount)
+		return &tile->verts[poly->verts[i]*3];
+	return &tile->detailVerts[(pd->vertBase+(i-poly->vertCount))*3];
+}
+
+inline int getDetailGridCell(const float v, const float bmin, const float invCellSize, const int size)
+{
+	return dtClamp((int)dtMathFloorf((v - bmin) * invCellSize), 0, size-1);
+}
+
+// Returns the range of cells of a triangle grid covered by the bounds of a detail triangle.
+inline void calcDetailGridCells(const dtDetailTriGrid* grid, const float* va, const float* vb, const float* vc,
+								int* minx, int* minz, int* maxx, int* maxz)
+{
+	*minx = getDetailGridCell(dtMin(va[0], dtMin(vb[0], vc[0])), grid->bmin[0], grid->invCellSize, grid->width);
+	*minz = getDetailGridCell(dtMin(va[2], dtMin(vb[2], vc[2])), grid->bmin[1], grid->invCellSize, grid->height);
+	*maxx = getDetailGridCell(dtMax(va[0], dtMax(vb[0], vc[0])), grid->bmin[0], grid->invCellSize, grid->width);
+	*maxz = getDetailGridCell(dtMax(va[2], dtMax(vb[2], vc[2])), grid->bmin[1], grid->invCellSize, grid->height);
+}
+
+// Sets up the triangle grid of a polygon, or leaves it empty if the polygon has few triangles.
+static void calcDetailTriGrid(const dtMeshTile* tile, const dtPoly* poly, const dtPolyDetail* pd, dtDetailTriGrid* grid)
+{
+	memset(grid, 0, sizeof(dtDetailTriGrid));
+	if (pd->triCount < DETAIL_GRID_MIN_TRIS)
+		return;
+
+	float bmin[2] = { FLT_MAX, FLT_MAX };
+	float bmax[2] = { -FLT_MAX, -FLT_MAX };
+	for (int j = 0; j < pd->triCount; ++j)
+	{
+		const unsigned char* t = &tile->detailTris[(pd->triBase+j)*4];
+		for (int k = 0; k < 3; ++k)
+		{
+			const float* v = getDetailTriVertex(tile, poly, pd, t[k]);
+			bmin[0] = dtMin(bmin[0], v[0]);
+			bmin[1] = dtMin(bmin[1], v[2]);
+			bmax[0] = dtMax(bmax[0], v[0]);
+			bmax[1] = dtMax(bmax[1], v[2]);
+		}
+	}
+	const float size = dtMax(bmax[0] - bmin[0], bmax[1] - bmin[1]);
+	if (!(size > 0.0f))
+		return;
+
+	// About one cell per triangle.
+	const float n = dtMin(dtMathCeilf(dtMathSqrtf((float)pd->triCount)), (float)DETAIL_GRID_MAX_SIZE);
+	grid->bmin[0] = bmin[0];
+	grid->bmin[1] = bmin[1];
+	grid->invCellSize = n / size;
+	grid->width = (unsigned short)dtClamp((int)dtMathCeilf((bmax[0] - bmin[0]) * grid->invCellSize), 1, DETAIL_GRID_MAX_SIZE);
+	grid->height = (unsigned short)dtClamp((int)dtMathCeilf((bmax[1] - bmin[1]) * grid->invCellSize), 1, DETAIL_GRID_MAX_SIZE);
+}
+
+// Builds the height query data of the detail meshes of a tile.
+static dtDetailPlanes* buildDetailPlanes(const dtMeshHeader* header, const dtMeshTile* tile)
+{
+	const int npolys = dtMin(header->polyCount, header->detailMeshCount);
+
+	// Count the grid cells and entries to size the allocation.
+	int ncells = 0;
+	int nentries = 0;
+	for (int i = 0; i < npolys; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		const dtPolyDetail* pd = &tile->detailMeshes[i];
+		dtDetailTriGrid grid;
+		calcDetailTriGrid(tile, poly, pd, &grid);
+		if (!grid.width)
+			continue;
+		ncells += grid.width * grid.height + 1;
+		for (int j = 0; j < pd->triCount; ++j)
+		{
+			const unsigned char* t = &tile->detailTris[(pd->triBase+j)*4];
+			int minx, minz, maxx, maxz;
+			calcDetailGridCells(&grid, getDetailTriVertex(tile, poly, pd, t[0]), getDetailTriVertex(tile, poly, pd, t[1]),
+								getDetailTriVertex(tile, poly, pd, t[2]), &minx, &minz, &maxx, &maxz);
+			nentries += (maxx - minx + 1) * (maxz - minz + 1);
+		}
+	}
+
+	const int headerSize = dtAlign4(sizeof(dtDetailPlanes));
+	const int planesSize = dtAlign4(sizeof(dtDetailTriPlane)*header->detailTriCount);
+	const int gridsSize = dtAlign4(sizeof(dtDetailTriGrid)*header->polyCount);
+	const int cellsSize = dtAlign4(sizeof(unsigned int)*ncells);
+	const int trisSize = dtAlign4(sizeof(unsigned char)*nentries);
+	const int memSize = headerSize + planesSize + gridsSize + cellsSize + trisSize;
+	unsigned char* data = (unsigned char*)dtAlloc(memSize, DT_ALLOC_PERM);
+	if (!data)
+		return 0;
+	memset(data, 0, memSize);
+
+	unsigned char* d = data;
+	dtDetailPlanes* dp = dtGetThenAdvanceBufferPointer<dtDetailPlanes>(d, headerSize);
+	dp->planes = dtGetThenAdvanceBufferPointer<dtDetailTriPlane>(d, planesSize);
+	dp->grids = dtGetThenAdvanceBufferPointer<dtDetailTriGrid>(d, gridsSize);
+	dp->cells = dtGetThenAdvanceBufferPointer<unsigned int>(d, cellsSize);
+	dp->tris = dtGetThenAdvanceBufferPointer<unsigned char>(d, trisSize);
+	dp->memSize = memSize;
+
+	unsigned int cellIndex = 0;
+	unsigned int entry = 0;
+	for (int i = 0; i < npolys; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			continue;
+		const dtPolyDetail* pd = &tile->detailMeshes[i];
+
+		// The same arithmetic as the start of dtClosestHeightPointTriangle.
+		for (int j = 0; j < pd->triCount; ++j)
+		{
+			const unsigned char* t = &tile->detailTris[(pd->triBase+j)*4];
+			const float* a = getDetailTriVertex(tile, poly, pd, t[0]);
+			const float* b = getDetailTriVertex(tile, poly, pd, t[1]);
+			const float* c = getDetailTriVertex(tile, poly, pd, t[2]);
+			dtDetailTriPlane* plane = &dp->planes[pd->triBase+j];
+			dtVcopy(plane->a, a);
+			dtVsub(plane->ac, c, a);
+			dtVsub(plane->ab, b, a);
+			const float denom = plane->ac[0] * plane->ab[2] - plane->ac[2] * plane->ab[0];
+			plane->denom = dtMathFabsf(denom) < 1e-6f ? 0.0f : denom;
+		}
+
+		dtDetailTriGrid* grid = &dp->grids[i];
+		calcDetailTriGrid(tile, poly, pd, grid);
+		if (!grid->width)
+			continue;
+
+		// Count the triangles of each cell, turn the counts into the first entry of each
+		// cell, store the triangles in order and shift the cells back to their first entry.
+		const int n = grid->width * grid->height;
+		unsigned int* cells = &dp->cells[cellIndex];
+		grid->firstCell = cellIndex;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			for (int j = 0; j < pd->triCount; ++j)
+			{
+				const unsigned char* t = &tile->detailTris[(pd->triBase+j)*4];
+				int minx, minz, maxx, maxz;
+				calcDetailGridCells(grid, getDetailTriVertex(tile, poly, pd, t[0]), getDetailTriVertex(tile, poly, pd, t[1]),
+									getDetailTriVertex(tile, poly, pd, t[2]), &minx, &minz, &maxx, &maxz);
+				for (int z = minz; z <= maxz; ++z)
+				{
+					for (int x = minx; x <= maxx; ++x)
+					{
+						if (pass == 0)
+							cells[z*grid->width + x]++;
+						else
+							dp->tris[cells[z*grid->width + x]++] = (unsigned char)j;
+					}
+				}
+			}
+			if (pass == 0)
+			{
+				unsigned int first = entry;
+				for (int k = 0; k < n; ++k)
+				{
+					const unsigned int count = cells[k];
+					cells[k] = first;
+					first += count;
+				}
+				cells[n] = first;
+			}
+		}
+		for (int k = n-1; k > 0; --k)
+			cells[k] = cells[k-1];
+		cells[0] = entry;
+
+		entry = cells[n];
+		cellIndex += n + 1;
+	}
+
+	return dp;
+}
+
+// Returns the height of a prepared detail triangle at the position, with the same
+// arithmetic and results as dtClosestHeightPointTriangle.
+inline bool getDetailTriHeight(const dtDetailTriPlane* tri, const float* p, float* h)
+{
+	float denom = tri->denom;
+	if (denom == 0.0f)
+		return false;
+
+	const float v2x = p[0] - tri->a[0];
+	const float v2z = p[2] - tri->a[2];
+	float u = tri->ab[2] * v2x - tri->ab[0] * v2z;
+	float v = tri->ac[0] * v2z - tri->ac[2] * v2x;
+
+	if (denom < 0)
+	{
+		denom = -denom;
+		u = -u;
+		v = -v;
+	}
+
+	if (u >= 0.0f && v >= 0.0f && (u + v) <= denom)
+	{
+		*h = tri->a[1] + (tri->ac[1] * u + tri->ab[1] * v) / denom;
+		return true;
+	}
+	return false;
+}
+
+// Finds the height of a polygon's detail mesh at the position using the prepared triangles.
+static bool getDetailPlanesHeight(const dtDetailPlanes* dp, const unsigned int ip, const dtPolyDetail* pd,
+								  const float* pos, float* height)
+{
+	const dtDetailTriPlane* planes = &dp->planes[pd->triBase];
+	const dtDetailTriGrid* grid = &dp->grids[ip];
+	if (!grid->width)
+	{
+		for (int j = 0; j < pd->triCount; ++j)
+		{
+			if (getDetailTriHeight(&planes[j], pos, height))
+				return true;
+		}
+		return false;
+	}
+
+	// Each triangle containing the position is listed in its cell, in detail mesh order,
+	// so the first hit is the same triangle the plain search finds.
+	const int x = getDetailGridCell(pos[0], grid->bmin[0], grid->invCellSize, grid->width);
+	const int z = getDetailGridCell(pos[2], grid->bmin[1], grid->invCellSize, grid->height);
+	const unsigned int* cell = &dp->cells[grid->firstCell + z*grid->width + x];
+	for (unsigned int k = cell[0]; k < cell[1]; ++k)
+	{
+		if (getDetailTriHeight(&planes[dp->tris[k]], pos, height))
+			return true;
+	}
+	return false;
+}
+
+// Frees the optional tables of a tile that live outside the tile data.
+inline void freeTileTables(dtMeshTile* tile)
+{
+	dtFree(tile->portals);
+	tile->portals = 0;
+	dtFree(tile->polyGrid);
+	tile->polyGrid = 0;
+	dtFree(tile->detailPlanes);
+	tile->detailPlanes = 0;
+}
+
+
+int dtGetMeshHeaderSize(const int version)
+{
+	// Version 7 headers end before dtMeshHeader::bvWideNodeCount.
+	if (version < 8)
+		return dtAlign4(offsetof(dtMeshHeader, bvWideNodeCount));
+	return dtAlign4(sizeof(dtMeshHeader));
+}
 
 dtNavMesh* dtAllocNavMesh()
 {
@@ -184,6 +594,18 @@ Notes:
 - This class does not implement any asynchronous methods. So the ::dtStatus result of all methods will 
   always contain either a success or failure flag.
 
+Thread safety:
+
+- The const methods only read the mesh, and any number of threads can call them at the same time,
+  including through dtNavMeshQuery objects bound to the mesh. (Use one query object per thread, see
+  dtNavMeshQueryPool.)
+- init(), addTile(), removeTile(), setPolyFlags(), setPolyArea(), restoreTileState(),
+  addTileListener() and removeTileListener() modify the mesh. They must not run concurrently with
+  each other or with any reader, so guard them with a reader-writer lock or run them between query
+  batches. Tile listeners are called on the thread modifying the mesh.
+- Polygon references stay valid across modifications only as far as their salt allows; validate
+  references held across a modification with isValidPolyRef().
+
 @see dtNavMeshQuery, dtCreateNavMeshData, dtNavMeshCreateParams, #dtAllocNavMesh, #dtFreeNavMesh
 */
 
@@ -195,7 +617,8 @@ dtNavMesh::dtNavMesh() :
 	m_tileLutMask(0),
 	m_posLookup(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tiles(0),
+	m_listenerCount(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -218,13 +641,25 @@ dtNavMesh::~dtNavMesh()
 			m_tiles[i].data = 0;
 			m_tiles[i].dataSize = 0;
 		}
+		freeTileTables(&m_tiles[i]);
 	}
 	dtFree(m_posLookup);
 	dtFree(m_tiles);
 }
 		
+/// @par
+///
+/// Unknown bits in dtNavMeshParams::flags, and a negative or non-finite
+/// dtNavMeshParams::polyGridCellSize, are rejected with #DT_INVALID_PARAM,
+/// so parameters left uninitialized are caught instead of enabling tables at random.
 dtStatus dtNavMesh::init(const dtNavMeshParams* params)
 {
+	static const int knownFlags = DT_NAVMESH_PORTAL_TABLE | DT_NAVMESH_POLY_GRID | DT_NAVMESH_DETAIL_PLANES;
+	if (params->flags & ~knownFlags)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (!dtMathIsfinite(params->polyGridCellSize) || params->polyGridCellSize < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
 	memcpy(&m_params, params, sizeof(dtNavMeshParams));
 	dtVcopy(m_orig, params->orig);
 	m_tileWidth = params->tileWidth;
@@ -273,7 +708,7 @@ dtStatus dtNavMesh::init(unsigned char* data, const int dataSize, const int flag
 	dtMeshHeader* header = (dtMeshHeader*)data;
 	if (header->magic != DT_NAVMESH_MAGIC)
 		return DT_FAILURE | DT_WRONG_MAGIC;
-	if (header->version != DT_NAVMESH_VERSION)
+	if (header->version < DT_NAVMESH_MIN_VERSION || header->version > DT_NAVMESH_VERSION)
 		return DT_FAILURE | DT_WRONG_VERSION;
 
 	dtNavMeshParams params;
@@ -282,6 +717,8 @@ dtStatus dtNavMesh::init(unsigned char* data, const int dataSize, const int flag
 	params.tileHeight = header->bmax[2] - header->bmin[2];
 	params.maxTiles = 1;
 	params.maxPolys = header->polyCount;
+	params.flags = 0;
+	params.polyGridCellSize = 0;
 	
 	dtStatus status = init(&params);
 	if (dtStatusFailed(status))
@@ -451,6 +888,7 @@ void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 						link->bmin = (unsigned char)roundf(dtClamp(tmin, 0.0f, 1.0f) * 255.0f);
 						link->bmax = (unsigned char)roundf(dtClamp(tmax, 0.0f, 1.0f) * 255.0f);
 					}
+					storeEdgePortal(tile, idx, poly);
 				}
 			}
 		}
@@ -503,6 +941,7 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 			// Add to linked list.
 			link->next = targetPoly->firstLink;
 			targetPoly->firstLink = idx;
+			storePointPortal(target, idx, v);
 		}
 		
 		// Link target poly to off-mesh connection.
@@ -521,6 +960,7 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 				// Add to linked list.
 				link->next = landPoly->firstLink;
 				landPoly->firstLink = tidx;
+				storePointPortal(tile, tidx, v);
 			}
 		}
 	}
@@ -559,6 +999,7 @@ void dtNavMesh::connectIntLinks(dtMeshTile* tile)
 				// Add to linked list.
 				link->next = poly->firstLink;
 				poly->firstLink = idx;
+				storeEdgePortal(tile, idx, poly);
 			}
 		}			
 	}
@@ -602,6 +1043,7 @@ void dtNavMesh::baseOffMeshLinks(dtMeshTile* tile)
 			// Add to linked list.
 			link->next = poly->firstLink;
 			poly->firstLink = idx;
+			storePointPortal(tile, idx, v);
 		}
 
 		// Start end-point is always connect back to off-mesh connection. 
@@ -618,6 +1060,7 @@ void dtNavMesh::baseOffMeshLinks(dtMeshTile* tile)
 			// Add to linked list.
 			link->next = landPoly->firstLink;
 			landPoly->firstLink = tidx;
+			storePointPortal(tile, tidx, v);
 		}
 	}
 }
@@ -703,8 +1146,13 @@ bool dtNavMesh::getPolyHeight(const dtMeshTile* tile, const dtPoly* poly, const
 		return true;
 	
 	// Find height at the location.
+	if (tile->detailPlanes)
+	{
+		if (getDetailPlanesHeight(tile->detailPlanes, ip, pd, pos, height))
+			return true;
+	}
 	// 遍历 poly 上的所有三角形
-	for (int j = 0; j < pd->triCount; ++j)
+	else for (int j = 0; j < pd->triCount; ++j)
 	{
 		const unsigned char* t = &tile->detailTris[(pd->triBase+j)*4];
 		const float* v[3];
@@ -924,7 +1372,7 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags, dtTile
 	dtMeshHeader* header = (dtMeshHeader*)data;
 	if (header->magic != DT_NAVMESH_MAGIC)
 		return DT_FAILURE | DT_WRONG_MAGIC;
-	if (header->version != DT_NAVMESH_VERSION)
+	if (header->version < DT_NAVMESH_MIN_VERSION || header->version > DT_NAVMESH_VERSION)
 		return DT_FAILURE | DT_WRONG_VERSION;
 
 #ifndef DT_POLYREF64
@@ -982,14 +1430,10 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags, dtTile
 	// Make sure we could allocate a tile.
 	if (!tile)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	
-	// Insert tile into the position lut.
-	int h = computeTileHash(header->x, header->y, m_tileLutMask); // 计算哈希值
-	tile->next = m_posLookup[h];
-	m_posLookup[h] = tile; // 将 tile 放在哈希桶最前面
-	
+
 	// Patch header pointers.
-	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
+	const int headerSize = dtGetMeshHeaderSize(header->version);
+	const int bvWideNodeCount = header->version >= 8 ? header->bvWideNodeCount : 0;
 	const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
 	const int polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
 	const int linksSize = dtAlign4(sizeof(dtLink)*(header->maxLinkCount));
@@ -998,6 +1442,7 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags, dtTile
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
 	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
 	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	const int bvWideTreeSize = dtAlign4(sizeof(dtBVWideNode)*bvWideNodeCount);
 	
 	unsigned char* d = data + headerSize;
 	tile->verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
@@ -1008,10 +1453,46 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags, dtTile
 	tile->detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	tile->bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
 	tile->offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
+	tile->bvWideTree = dtGetThenAdvanceBufferPointer<dtBVWideNode>(d, bvWideTreeSize);
 
 	// If there are no items in the bvtree, reset the tree pointer.
 	if (!bvtreeSize)
 		tile->bvTree = 0;
+	if (!bvWideTreeSize)
+		tile->bvWideTree = 0;
+
+	// Build the optional tables, they live outside the tile data so the data layout stays the same.
+	tile->portals = 0;
+	tile->polyGrid = 0;
+	tile->detailPlanes = 0;
+	bool tablesOk = true;
+	if (m_params.flags & DT_NAVMESH_PORTAL_TABLE)
+	{
+		tile->portals = (dtLinkPortal*)dtAlloc(sizeof(dtLinkPortal)*header->maxLinkCount, DT_ALLOC_PERM);
+		tablesOk = tile->portals != 0;
+	}
+	if (tablesOk && (m_params.flags & DT_NAVMESH_POLY_GRID))
+	{
+		tile->polyGrid = buildPolyGrid(header, tile->verts, tile->polys, m_params.polyGridCellSize);
+		tablesOk = tile->polyGrid != 0;
+	}
+	if (tablesOk && (m_params.flags & DT_NAVMESH_DETAIL_PLANES))
+	{
+		tile->detailPlanes = buildDetailPlanes(header, tile);
+		tablesOk = tile->detailPlanes != 0;
+	}
+	if (!tablesOk)
+	{
+		freeTileTables(tile);
+		tile->next = m_nextFree;
+		m_nextFree = tile;
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	
+	// Insert tile into the position lut.
+	int h = computeTileHash(header->x, header->y, m_tileLutMask); // 计算哈希值
+	tile->next = m_posLookup[h];
+	m_posLookup[h] = tile; // 将 tile 放在哈希桶最前面
 
 	// Build links freelist
 	tile->linksFreeList = 0;
@@ -1064,6 +1545,9 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags, dtTile
 		}
 	}
 	
+	for (int i = 0; i < m_listenerCount; ++i)
+		m_listeners[i]->tileAdded(this, tile);
+	
 	if (result)
 		*result = getTileRef(tile);
 	
@@ -1196,6 +1680,28 @@ int dtNavMesh::getMaxTiles() const
 	return m_maxTiles;
 }
 
+int dtNavMesh::getDetailPlanesMemUsed() const
+{
+	int size = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_tiles[i].header && m_tiles[i].detailPlanes)
+			size += m_tiles[i].detailPlanes->memSize;
+	}
+	return size;
+}
+
+int dtNavMesh::getPolyGridMemUsed() const
+{
+	int size = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		if (m_tiles[i].header && m_tiles[i].polyGrid)
+			size += m_tiles[i].polyGrid->memSize;
+	}
+	return size;
+}
+
 dtMeshTile* dtNavMesh::getTile(int i)
 {
 	return &m_tiles[i];
@@ -1309,6 +1815,9 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 		for (int j = 0; j < nneis; ++j)
 			unconnectLinks(neis[j], tile);
 	}
+
+	for (int i = 0; i < m_listenerCount; ++i)
+		m_listeners[i]->tileRemoved(this, tile);
 		
 	// Reset tile.
 	if (tile->flags & DT_TILE_FREE_DATA)
@@ -1332,11 +1841,13 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	tile->polys = 0;
 	tile->verts = 0;
 	tile->links = 0;
+	freeTileTables(tile);
 	tile->detailMeshes = 0;
 	tile->detailVerts = 0;
 	tile->detailTris = 0;
 	tile->bvTree = 0;
 	tile->offMeshCons = 0;
+	tile->bvWideTree = 0;
 
 	// Update salt, salt should never be zero.
 #ifdef DT_POLYREF64
@@ -1354,6 +1865,44 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	return DT_SUCCESS;
 }
 
+dtTileListener::~dtTileListener()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+/// @par
+///
+/// The listener is not owned by the navigation mesh and must stay alive
+/// until it is removed with #removeTileListener or the mesh is destroyed.
+/// Tiles already in the mesh are not reported to a new listener.
+dtStatus dtNavMesh::addTileListener(dtTileListener* listener)
+{
+	if (!listener)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	for (int i = 0; i < m_listenerCount; ++i)
+	{
+		if (m_listeners[i] == listener)
+			return DT_SUCCESS;
+	}
+	if (m_listenerCount >= DT_MAX_TILE_LISTENERS)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	m_listeners[m_listenerCount++] = listener;
+	return DT_SUCCESS;
+}
+
+void dtNavMesh::removeTileListener(dtTileListener* listener)
+{
+	for (int i = 0; i < m_listenerCount; ++i)
+	{
+		if (m_listeners[i] == listener)
+		{
+			m_listeners[i] = m_listeners[m_listenerCount-1];
+			m_listenerCount--;
+			return;
+		}
+	}
+}
+
 dtTileRef dtNavMesh::getTileRef(const dtMeshTile* tile) const
 {
 	if (!tile) return 0;
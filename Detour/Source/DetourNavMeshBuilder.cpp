@@ -168,7 +168,98 @@ static void subdivide(BVItem* items, int nitems, int imin, int imax, int& curNod
 	}
 }
 
-static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nnodes*/)
+// Returns the number of 4-wide nodes collapsed from a binary subtree of the specified
+// number of leaves. subdivide() always splits at the middle, so the shape only depends on the count.
+static int countBVWideNodes(const int nitems)
+{
+	if (nitems < 1)
+		return 0;
+	if (nitems == 1)
+		return 1;
+	int count = 1;
+	const int sides[2] = { nitems/2, nitems - nitems/2 };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (sides[i] < 2)
+			continue;
+		const int half = sides[i]/2;
+		if (half > 1)
+			count += countBVWideNodes(half);
+		if (sides[i] - half > 1)
+			count += countBVWideNodes(sides[i] - half);
+	}
+	return count;
+}
+
+// Returns the index of the node following the subtree of a node in escape order.
+inline int bvSubtreeEnd(const dtBVNode* nodes, const int inode)
+{
+	return nodes[inode].i >= 0 ? inode + 1 : inode - nodes[inode].i;
+}
+
+// Collapses the binary subtree at the specified node into 4-wide nodes, each taking the
+// grandchildren of a binary node. The leaves keep their left-to-right order.
+static void collapseBVTree(const dtBVNode* nodes, const int inode, dtBVWideNode* wideNodes, int& curWideNode)
+{
+	dtBVWideNode& wide = wideNodes[curWideNode++];
+
+	int slots[DT_BVWIDE_CHILDREN];
+	int nslots = 0;
+	if (nodes[inode].i >= 0)
+	{
+		slots[nslots++] = inode;
+	}
+	else
+	{
+		const int children[2] = { inode + 1, bvSubtreeEnd(nodes, inode + 1) };
+		for (int i = 0; i < 2; ++i)
+		{
+			const int c = children[i];
+			if (nodes[c].i >= 0)
+			{
+				slots[nslots++] = c;
+			}
+			else
+			{
+				slots[nslots++] = c + 1;
+				slots[nslots++] = bvSubtreeEnd(nodes, c + 1);
+			}
+		}
+	}
+
+	for (int k = 0; k < DT_BVWIDE_CHILDREN; ++k)
+	{
+		if (k >= nslots)
+		{
+			// Empty bounds.
+			for (int j = 0; j < 3; ++j)
+			{
+				wide.bmin[j][k] = 0xffff;
+				wide.bmax[j][k] = 0;
+			}
+			wide.child[k] = 0;
+			continue;
+		}
+
+		const dtBVNode& node = nodes[slots[k]];
+		for (int j = 0; j < 3; ++j)
+		{
+			wide.bmin[j][k] = node.bmin[j];
+			wide.bmax[j][k] = node.bmax[j];
+		}
+		if (node.i >= 0)
+		{
+			wide.child[k] = -(node.i + 1);
+		}
+		else
+		{
+			wide.child[k] = curWideNode;
+			collapseBVTree(nodes, slots[k], wideNodes, curWideNode);
+		}
+	}
+}
+
+static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nnodes*/, dtBVWideNode* wideNodes)
 {
 	// Build tree
 	float quantFactor = 1 / params->cs;
@@ -236,6 +327,14 @@ static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nn
 	subdivide(items, params->polyCount, 0, params->polyCount, curNode, nodes);
 	
 	dtFree(items);
+
+	// Collapse the tree into the 4-wide layout.
+	if (wideNodes && params->polyCount > 0)
+	{
+		int curWideNode = 0;
+		collapseBVTree(nodes, 0, wideNodes, curWideNode);
+		dtAssert(curWideNode == countBVWideNodes(params->polyCount));
+	}
 	
 	return curNode;
 }
@@ -433,10 +532,12 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*detailTriCount);
 	const int bvTreeSize = params->buildBvTree ? dtAlign4(sizeof(dtBVNode)*params->polyCount*2) : 0;
 	const int offMeshConsSize = dtAlign4(sizeof(dtOffMeshConnection)*storedOffMeshConCount);
+	const int bvWideNodeCount = params->buildBvTree && params->buildWideBvTree ? countBVWideNodes(params->polyCount) : 0;
+	const int bvWideTreeSize = dtAlign4(sizeof(dtBVWideNode)*bvWideNodeCount);
 	
 	const int dataSize = headerSize + vertsSize + polysSize + linksSize +
 						 detailMeshesSize + detailVertsSize + detailTrisSize +
-						 bvTreeSize + offMeshConsSize;
+						 bvTreeSize + offMeshConsSize + bvWideTreeSize;
 						 
 	unsigned char* data = (unsigned char*)dtAlloc(sizeof(unsigned char)*dataSize, DT_ALLOC_PERM);
 	if (!data)
@@ -457,6 +558,7 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	unsigned char* navDTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	dtBVNode* navBvtree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvTreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshConsSize);
+	dtBVWideNode* navBvWideTree = dtGetThenAdvanceBufferPointer<dtBVWideNode>(d, bvWideTreeSize);
 	
 	
 	// Store header
@@ -481,6 +583,7 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	header->walkableClimb = params->walkableClimb;
 	header->offMeshConCount = storedOffMeshConCount;
 	header->bvNodeCount = params->buildBvTree ? params->polyCount*2 : 0;
+	header->bvWideNodeCount = bvWideNodeCount;
 	
 	const int offMeshVertsBase = params->vertCount;
 	const int offMeshPolyBase = params->polyCount;
@@ -624,7 +727,7 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 	// Store and create BVtree.
 	if (params->buildBvTree)
 	{
-		createBVTree(params, navBvtree, 2*params->polyCount);
+		createBVTree(params, navBvtree, 2*params->polyCount, bvWideNodeCount ? navBvWideTree : 0);
 	}
 	
 	// Store Off-Mesh connections.
@@ -662,15 +765,15 @@ bool dtNavMeshHeaderSwapEndian(unsigned char* data, const int /*dataSize*/)
 	dtMeshHeader* header = (dtMeshHeader*)data;
 	
 	int swappedMagic = DT_NAVMESH_MAGIC;
-	int swappedVersion = DT_NAVMESH_VERSION;
 	dtSwapEndian(&swappedMagic);
-	dtSwapEndian(&swappedVersion);
 	
-	if ((header->magic != DT_NAVMESH_MAGIC || header->version != DT_NAVMESH_VERSION) &&
-		(header->magic != swappedMagic || header->version != swappedVersion))
-	{
+	int version = header->version;
+	if (header->magic == swappedMagic)
+		dtSwapEndian(&version);
+	else if (header->magic != DT_NAVMESH_MAGIC)
+		return false;
+	if (version < DT_NAVMESH_MIN_VERSION || version > DT_NAVMESH_VERSION)
 		return false;
-	}
 		
 	dtSwapEndian(&header->magic);
 	dtSwapEndian(&header->version);
@@ -697,6 +800,8 @@ bool dtNavMeshHeaderSwapEndian(unsigned char* data, const int /*dataSize*/)
 	dtSwapEndian(&header->bmax[1]);
 	dtSwapEndian(&header->bmax[2]);
 	dtSwapEndian(&header->bvQuantFactor);
+	if (version >= 8)
+		dtSwapEndian(&header->bvWideNodeCount);
 
 	// Freelist index and pointers are updated when tile is added, no need to swap.
 
@@ -715,11 +820,12 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	dtMeshHeader* header = (dtMeshHeader*)data;
 	if (header->magic != DT_NAVMESH_MAGIC)
 		return false;
-	if (header->version != DT_NAVMESH_VERSION)
+	if (header->version < DT_NAVMESH_MIN_VERSION || header->version > DT_NAVMESH_VERSION)
 		return false;
 	
 	// Patch header pointers.
-	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
+	const int headerSize = dtGetMeshHeaderSize(header->version);
+	const int bvWideNodeCount = header->version >= 8 ? header->bvWideNodeCount : 0;
 	const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
 	const int polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
 	const int linksSize = dtAlign4(sizeof(dtLink)*(header->maxLinkCount));
@@ -728,6 +834,7 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	const int detailTrisSize = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
 	const int bvtreeSize = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
 	const int offMeshLinksSize = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	const int bvWideTreeSize = dtAlign4(sizeof(dtBVWideNode)*bvWideNodeCount);
 	
 	unsigned char* d = data + headerSize;
 	float* verts = dtGetThenAdvanceBufferPointer<float>(d, vertsSize);
@@ -740,6 +847,7 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 	//unsigned char* detailTris = dtGetThenAdvanceBufferPointer<unsigned char>(d, detailTrisSize);
 	dtBVNode* bvTree = dtGetThenAdvanceBufferPointer<dtBVNode>(d, bvtreeSize);
 	dtOffMeshConnection* offMeshCons = dtGetThenAdvanceBufferPointer<dtOffMeshConnection>(d, offMeshLinksSize);
+	dtBVWideNode* bvWideTree = dtGetThenAdvanceBufferPointer<dtBVWideNode>(d, bvWideTreeSize);
 	
 	// Vertices
 	for (int i = 0; i < header->vertCount*3; ++i)
@@ -797,6 +905,22 @@ bool dtNavMeshDataSwapEndian(unsigned char* data, const int /*dataSize*/)
 		dtSwapEndian(&con->rad);
 		dtSwapEndian(&con->poly);
 	}
+
+	// 4-wide BV-tree
+	for (int i = 0; i < bvWideNodeCount; ++i)
+	{
+		dtBVWideNode* node = &bvWideTree[i];
+		for (int j = 0; j < 3; ++j)
+		{
+			for (int k = 0; k < DT_BVWIDE_CHILDREN; ++k)
+			{
+				dtSwapEndian(&node->bmin[j][k]);
+				dtSwapEndian(&node->bmax[j][k]);
+			}
+		}
+		for (int k = 0; k < DT_BVWIDE_CHILDREN; ++k)
+			dtSwapEndian(&node->child[k]);
+	}
 	
 	return true;
 }
@@ -17,9 +17,15 @@
 //
 
 #include <float.h>
+#include <stdlib.h>
 #include <string.h>
 #include "DetourNavMeshQuery.h"
+#include "DetourNavMeshQueryTemplates.h"
 #include "DetourNavMesh.h"
+#include "DetourLandmarkTable.h"
+#include "DetourComponentIndex.h"
+#include "DetourPolyAreaTable.h"
+#include "DetourWallDistance.h"
 #include "DetourNode.h"
 #include "DetourCommon.h"
 #include "DetourMath.h"
@@ -83,24 +89,15 @@ float dtQueryFilter::getCost(const float* pa, const float* pb,
 {
 	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
 }
-#else
-inline bool dtQueryFilter::passFilter(const dtPolyRef /*ref*/,
-									  const dtMeshTile* /*tile*/,
-									  const dtPoly* poly) const
-{
-	return (poly->flags & m_includeFlags) != 0 && (poly->flags & m_excludeFlags) == 0;
-}
-
-inline float dtQueryFilter::getCost(const float* pa, const float* pb,
-									const dtPolyRef /*prevRef*/, const dtMeshTile* /*prevTile*/, const dtPoly* /*prevPoly*/,
-									const dtPolyRef /*curRef*/, const dtMeshTile* /*curTile*/, const dtPoly* curPoly,
-									const dtPolyRef /*nextRef*/, const dtMeshTile* /*nextTile*/, const dtPoly* /*nextPoly*/) const
-{
-	return dtVdist(pa, pb) * m_areaCost[curPoly->getArea()];
-}
 #endif	
 	
 static const float H_SCALE = 0.999f; // Search heuristic scale.
+static const float ANYTIME_WEIGHT_DECAY = 0.5f; // Share of the excess heuristic weight kept for the next anytime round.
+static const float ANYTIME_MIN_WEIGHT = 1.05f; // Lower weights are dropped to 1 for the last anytime round.
+
+// Node states used to keep the two frontiers of a bidirectional search apart in the node pool.
+static const unsigned char DT_BIDIR_FORWARD = 0;
+static const unsigned char DT_BIDIR_BACKWARD = 1;
 
 
 dtNavMeshQuery* dtAllocNavMeshQuery()
@@ -132,7 +129,10 @@ dtPolyQuery::~dtPolyQuery()
 ///
 /// Constant member functions can be used by multiple clients without side
 /// effects. (E.g. No change to the closed list. No impact on an in-progress
-/// sliced path query. Etc.)
+/// sliced path query. Etc.) They do use the node pools and open lists of the
+/// query object though, so a query object must not be used by several threads
+/// at the same time. Use one query object per thread, e.g. leased from a
+/// dtNavMeshQueryPool.
 /// 
 /// Walls and portals: A @e wall is a polygon segment that is 
 /// considered impassable. A @e portal is a passable segment between polygons.
@@ -142,9 +142,14 @@ dtPolyQuery::~dtPolyQuery()
 
 dtNavMeshQuery::dtNavMeshQuery() :
 	m_nav(0),
+	m_landmarks(0),
+	m_components(0),
+	m_areas(0),
+	m_walls(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
-	m_openList(0)
+	m_openList(0),
+	m_backOpenList(0)
 {
 	memset(&m_query, 0, sizeof(dtQueryData));
 }
@@ -157,9 +162,12 @@ dtNavMeshQuery::~dtNavMeshQuery()
 		m_nodePool->~dtNodePool();
 	if (m_openList)
 		m_openList->~dtNodeQueue();
+	if (m_backOpenList)
+		m_backOpenList->~dtNodeQueue();
 	dtFree(m_tinyNodePool);
 	dtFree(m_nodePool);
 	dtFree(m_openList);
+	dtFree(m_backOpenList);
 }
 
 /// @par 
@@ -168,14 +176,20 @@ dtNavMeshQuery::~dtNavMeshQuery()
 /// functions are used.
 ///
 /// This function can be used multiple times.
-dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
+///
+/// With @p maxSpillNodes, searches that need more than @p maxNodes nodes allocate
+/// further nodes in small chunks instead of returning #DT_OUT_OF_NODES, and keep them
+/// for later searches. dtNodePool::getPeakNodeCount of #getNodePool tells how many
+/// nodes the searches actually needed.
+dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes, const int maxSpillNodes)
 {
-	if (maxNodes > DT_NULL_IDX || maxNodes > (1 << DT_NODE_PARENT_BITS) - 1)
+	if (maxNodes <= 0 || maxSpillNodes < 0 ||
+		maxNodes + maxSpillNodes > DT_NULL_IDX || maxNodes + maxSpillNodes > (1 << DT_NODE_PARENT_BITS) - 1)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
 	m_nav = nav;
 	
-	if (!m_nodePool || m_nodePool->getMaxNodes() < maxNodes)
+	if (!m_nodePool || m_nodePool->getMaxNodes() < maxNodes || m_nodePool->getMaxSpillNodes() != maxSpillNodes)
 	{
 		if (m_nodePool)
 		{
@@ -183,7 +197,7 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 			dtFree(m_nodePool);
 			m_nodePool = 0;
 		}
-		m_nodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4));
+		m_nodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4), maxSpillNodes);
 		if (!m_nodePool)
 			return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
@@ -203,7 +217,9 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 		m_tinyNodePool->clear();
 	}
 	
-	if (!m_openList || m_openList->getCapacity() < maxNodes)
+	// The open lists must hold every node the pool can hand out.
+	const int maxOpen = maxNodes + maxSpillNodes;
+	if (!m_openList || m_openList->getCapacity() < maxOpen)
 	{
 		if (m_openList)
 		{
@@ -211,7 +227,7 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 			dtFree(m_openList);
 			m_openList = 0;
 		}
-		m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+		m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxOpen);
 		if (!m_openList)
 			return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
@@ -219,6 +235,23 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	{
 		m_openList->clear();
 	}
+
+	if (!m_backOpenList || m_backOpenList->getCapacity() < maxOpen)
+	{
+		if (m_backOpenList)
+		{
+			m_backOpenList->~dtNodeQueue();
+			dtFree(m_backOpenList);
+			m_backOpenList = 0;
+		}
+		m_backOpenList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxOpen);
+		if (!m_backOpenList)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	else
+	{
+		m_backOpenList->clear();
+	}
 	
 	return DT_SUCCESS;
 }
@@ -232,6 +265,20 @@ dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*fr
 	if (!filter || !frand || !randomRef || !randomPt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 
+	// Pick the polygon from the area table if it was built for the filter.
+	if (m_areas && m_areas->matchesFilter(filter))
+	{
+		const dtPolyRef ref = m_areas->samplePoly(frand());
+		if (!ref)
+			return DT_FAILURE;
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+		randomPointInPoly(ref, tile, poly, frand, randomPt);
+		*randomRef = ref;
+		return DT_SUCCESS;
+	}
+
 	// Randomly pick one tile. Assume that all tiles cover roughly the same area.
 	const dtMeshTile* tile = 0;
 	float tsum = 0.0f;
@@ -290,6 +337,15 @@ dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*fr
 	if (!poly)
 		return DT_FAILURE;
 
+	randomPointInPoly(polyRef, tile, poly, frand, randomPt);
+	*randomRef = polyRef;
+
+	return DT_SUCCESS;
+}
+
+void dtNavMeshQuery::randomPointInPoly(dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly,
+									   float (*frand)(), float* pt) const
+{
 	// Randomly pick point on polygon.
 	const float* v = &tile->verts[poly->verts[0]*3];
 	float verts[3*DT_VERTS_PER_POLYGON];
@@ -304,15 +360,112 @@ dtStatus dtNavMeshQuery::findRandomPoint(const dtQueryFilter* filter, float (*fr
 	const float s = frand();
 	const float t = frand();
 	
-	float pt[3];
 	dtRandomPointInConvexPoly(verts, poly->vertCount, areas, s, t, pt);
 	
-	closestPointOnPoly(polyRef, pt, pt, NULL);
-	
-	dtVcopy(randomPt, pt);
-	*randomRef = polyRef;
+	closestPointOnPoly(ref, pt, pt, NULL);
+}
 
-	return DT_SUCCESS;
+// Limits of the number of polygons tried by the sampled random point search before falling back to the search.
+static const int RANDOM_CIRCLE_MIN_TRIES = 8;
+static const int RANDOM_CIRCLE_MAX_TRIES = 64;
+
+static const float DT_PI = 3.14159265f;
+
+// Maximum number of tiles the sampled random point search picks from, larger circles pick from the whole mesh.
+static const int RANDOM_CIRCLE_MAX_TILES = 64;
+
+bool dtNavMeshQuery::sampleConnectedPointAroundCircle(dtPolyRef startRef, const float* centerPos, const float maxRadius,
+													  const float maxHeight, const dtQueryFilter* filter, float (*frand)(),
+													  dtPolyRef* randomRef, float* randomPt) const
+{
+	const int filterClass = m_components->getFilterClass(filter);
+	if (filterClass < 0)
+		return false;
+	const unsigned int startComponent = m_components->getComponent(startRef, filterClass);
+	if (!startComponent)
+		return false;
+
+	// Collect the tiles overlapping the cylinder.
+	const float bmin[3] = { centerPos[0]-maxRadius, centerPos[1]-maxHeight, centerPos[2]-maxRadius };
+	const float bmax[3] = { centerPos[0]+maxRadius, centerPos[1]+maxHeight, centerPos[2]+maxRadius };
+	int minx, miny, maxx, maxy;
+	m_nav->calcTileLoc(bmin, &minx, &miny);
+	m_nav->calcTileLoc(bmax, &maxx, &maxy);
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	const dtMeshTile* tiles[RANDOM_CIRCLE_MAX_TILES];
+	float tileCdf[RANDOM_CIRCLE_MAX_TILES];
+	int ntiles = 0;
+	bool wholeMesh = (maxx-minx+1)*(maxy-miny+1) > RANDOM_CIRCLE_MAX_TILES;
+	float areaSum = 0.0f;
+	for (int y = miny; y <= maxy && !wholeMesh; ++y)
+	{
+		for (int x = minx; x <= maxx && !wholeMesh; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				const dtMeshHeader* header = neis[j]->header;
+				if (header->bmin[1] > bmax[1] || header->bmax[1] < bmin[1])
+					continue;
+				const float area = m_areas->getTileArea(neis[j]);
+				if (area <= 0.0f)
+					continue;
+				if (ntiles >= RANDOM_CIRCLE_MAX_TILES)
+				{
+					wholeMesh = true;
+					break;
+				}
+				areaSum += area;
+				tiles[ntiles] = neis[j];
+				tileCdf[ntiles] = areaSum;
+				ntiles++;
+			}
+		}
+	}
+	if (wholeMesh)
+		areaSum = m_areas->getTotalArea();
+	if (areaSum <= 0.0f)
+		return false;
+
+	// Pick points weighted by area until one lands in the cylinder and is connected to the start.
+	// Try long enough that a miss is unlikely when the circle is mostly covered by the mesh.
+	const float radiusSqr = dtSqr(maxRadius);
+	const float hitRatio = DT_PI*radiusSqr / areaSum;
+	const int maxTries = hitRatio > 0.0f ? (int)dtClamp(9.0f / hitRatio, (float)RANDOM_CIRCLE_MIN_TRIES, (float)RANDOM_CIRCLE_MAX_TRIES)
+										 : RANDOM_CIRCLE_MAX_TRIES;
+	for (int i = 0; i < maxTries; ++i)
+	{
+		dtPolyRef ref = 0;
+		if (wholeMesh)
+		{
+			ref = m_areas->samplePoly(frand());
+		}
+		else
+		{
+			const float target = frand()*areaSum;
+			int k = 0;
+			while (k < ntiles-1 && tileCdf[k] <= target)
+				k++;
+			ref = m_areas->samplePolyInTile(tiles[k], frand());
+		}
+		if (!ref || m_components->getComponent(ref, filterClass) != startComponent)
+			continue;
+
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+		float pt[3];
+		randomPointInPoly(ref, tile, poly, frand, pt);
+		if (dtVdist2DSqr(pt, centerPos) > radiusSqr || dtAbs(pt[1] - centerPos[1]) > maxHeight)
+			continue;
+
+		dtVcopy(randomPt, pt);
+		*randomRef = ref;
+		return true;
+	}
+	return false;
 }
 
 dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const float* centerPos, const float maxRadius,
@@ -424,7 +577,7 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 			
 			// Find edge and calc distance to the edge.
 			float va[3], vb[3];
-			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+			if (!getLinkPortalPoints(i, bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
 				continue;
 			
 			// If the circle is not touching the next polygon, skip it.
@@ -473,31 +626,50 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 	if (!randomPoly)
 		return DT_FAILURE;
 	
-	// Randomly pick point on polygon.
-	const float* v = &randomTile->verts[randomPoly->verts[0]*3];
-	float verts[3*DT_VERTS_PER_POLYGON];
-	float areas[DT_VERTS_PER_POLYGON];
-	dtVcopy(&verts[0*3],v);
-	for (int j = 1; j < randomPoly->vertCount; ++j)
-	{
-		v = &randomTile->verts[randomPoly->verts[j]*3];
-		dtVcopy(&verts[j*3],v);
-	}
-	
-	const float s = frand();
-	const float t = frand();
-	
-	float pt[3];
-	dtRandomPointInConvexPoly(verts, randomPoly->vertCount, areas, s, t, pt);
-	
-	closestPointOnPoly(randomPolyRef, pt, pt, NULL);
-	
-	dtVcopy(randomPt, pt);
+	randomPointInPoly(randomPolyRef, randomTile, randomPoly, frand, randomPt);
 	*randomRef = randomPolyRef;
 	
 	return status;
 }
 
+/// @par
+///
+/// Large circles cover many polygons, picking them from the area table instead of
+/// searching the circle avoids visiting all of them. Only the weaker constraints of
+/// the cylinder and the component of the start polygon are checked.
+dtStatus dtNavMeshQuery::sampleRandomPointAroundCircle(dtPolyRef startRef, const float* centerPos, const float maxRadius,
+													   const float maxHeight, const dtQueryFilter* filter, float (*frand)(),
+													   dtPolyRef* randomRef, float* randomPt) const
+{
+	dtAssert(m_nav);
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) ||
+		!centerPos || !dtVisfinite(centerPos) ||
+		maxRadius < 0 || !dtMathIsfinite(maxRadius) ||
+		maxHeight < 0 || !dtMathIsfinite(maxHeight) ||
+		!filter || !frand || !randomRef || !randomPt)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	const dtMeshTile* startTile = 0;
+	const dtPoly* startPoly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(startRef, &startTile, &startPoly);
+	if (!filter->passFilter(startRef, startTile, startPoly))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const dtNavMeshParams* params = m_nav->getParams();
+	if (m_areas && m_components && m_areas->matchesFilter(filter) &&
+		maxRadius*2.0f >= dtMin(params->tileWidth, params->tileHeight))
+	{
+		if (sampleConnectedPointAroundCircle(startRef, centerPos, maxRadius, maxHeight, filter, frand, randomRef, randomPt))
+			return DT_SUCCESS;
+	}
+
+	return findRandomPointAroundCircle(startRef, centerPos, maxRadius, filter, frand, randomRef, randomPt);
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -621,76 +793,48 @@ dtStatus dtNavMeshQuery::getPolyHeight(dtPolyRef ref, const float* pos, float* h
 		: DT_FAILURE | DT_INVALID_PARAM;
 }
 
-// 查找最近的 poly 的查询方法类
-class dtFindNearestPolyQuery : public dtPolyQuery
+// 批量查询的采样点，按所在的格子排序
+struct dtBatchSample
 {
-	const dtNavMeshQuery* m_query;
-	const float* m_center;
-	float m_nearestDistanceSqr;
-	dtPolyRef m_nearestRef;
-	float m_nearestPoint[3];
-	bool m_overPoly; // 记录 center 是否在最近的 poly 上
+	unsigned int key;
+	int index;
+};
 
-public:
-	dtFindNearestPolyQuery(const dtNavMeshQuery* query, const float* center)
-		: m_query(query), m_center(center), m_nearestDistanceSqr(FLT_MAX), m_nearestRef(0), m_nearestPoint(), m_overPoly(false)
-	{
-	}
+static int compareBatchSample(const void* va, const void* vb)
+{
+	const dtBatchSample* a = (const dtBatchSample*)va;
+	const dtBatchSample* b = (const dtBatchSample*)vb;
+	if (a->key < b->key) return -1;
+	if (a->key > b->key) return 1;
+	return a->index - b->index;
+}
 
-	virtual ~dtFindNearestPolyQuery();
+// Sorts the points of a batched query into cells of an eighth of a tile, so that
+// nearby points are processed together. Returns null if out of memory.
+static dtBatchSample* sortBatchSamples(const dtNavMesh* nav, const float* centers, const int count)
+{
+	static const int CELLS_PER_TILE = 8;
 
-	dtPolyRef nearestRef() const { return m_nearestRef; }
-	const float* nearestPoint() const { return m_nearestPoint; }
-	bool isOverPoly() const { return m_overPoly; }
+	dtBatchSample* samples = (dtBatchSample*)dtAlloc(sizeof(dtBatchSample)*count, DT_ALLOC_TEMP);
+	if (!samples)
+		return 0;
 
-	// 从所有符合条件的 poly 中找到最近的
-	// tile 处理中的 tile 的指针
-	// polys 已经找到的所有 poly 的数组
-	// refs 已经找到的所有符合要求的 poly 的 ref 的数组
-	void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count)
+	const dtNavMeshParams* params = nav->getParams();
+	const float cellWidth = params->tileWidth / CELLS_PER_TILE;
+	const float cellHeight = params->tileHeight / CELLS_PER_TILE;
+	for (int i = 0; i < count; ++i)
 	{
-		dtIgnoreUnused(polys); // polys 没用，忽略警告提示
-
-		// 处理 count 个 poly
-		for (int i = 0; i < count; ++i)
-		{
-			dtPolyRef ref = refs[i];
-			float closestPtPoly[3];
-			float diff[3];
-			bool posOverPoly = false;
-			float d;
-
-			// 计算 center 到 poly 上的投影点
-			// posOverPoly 的意思不是点是否直接在 poly 上，而是 center 在 poly 上的投影是否在 poly 内部
-			m_query->closestPointOnPoly(ref, m_center, closestPtPoly, &posOverPoly);
-
-			// If a point is directly over a polygon and closer than
-			// climb height, favor that instead of straight line nearest point.
-			// 分情况计算实际距离
-			// 如果点在 poly 上的投影在 poly 内部
-			dtVsub(diff, m_center, closestPtPoly);
-			if (posOverPoly)
-			{
-				d = dtAbs(diff[1]) - tile->header->walkableClimb; // 计算 center 到投影点的 y 轴坐标差与可攀爬高度的差值
-				d = d > 0 ? d*d : 0;			
-			}
-			else
-			{
-				d = dtVlenSqr(diff);
-			}
-
-			// 比较并保存最短距离
-			if (d < m_nearestDistanceSqr)
-			{
-				dtVcopy(m_nearestPoint, closestPtPoly);
-
-				m_nearestDistanceSqr = d;
-				m_nearestRef = ref;
-				m_overPoly = posOverPoly;
-			}
-		}
+		const float* center = &centers[i*3];
+		const int cx = (int)dtMathFloorf((center[0] - params->orig[0]) / cellWidth);
+		const int cz = (int)dtMathFloorf((center[2] - params->orig[2]) / cellHeight);
+		samples[i].key = ((unsigned int)cz & 0xffff) << 16 | ((unsigned int)cx & 0xffff);
+		samples[i].index = i;
 	}
-};
+	if (count > 1)
+		qsort(samples, count, sizeof(dtBatchSample), compareBatchSample);
+
+	return samples;
+}
 
 dtFindNearestPolyQuery::~dtFindNearestPolyQuery()
 {
@@ -722,138 +866,236 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfExtents,
 										 const dtQueryFilter* filter,
 										 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const
+{
+	return findNearestPolyT(center, halfExtents, filter, nearestRef, nearestPt, isOverPoly);
+}
+
+/// @par
+///
+/// The points are sorted into cells of an eighth of a tile. For the points of each
+/// cell the tiles are looked up once, and the bounding volume tree of each tile is
+/// walked once with the union of their search boxes. Each polygon found is then
+/// tested against the quantized search box and the tile range of every point,
+/// exactly like #findNearestPoly would test it, and the polygons are visited in the
+/// same order, so the results are identical to calling #findNearestPoly per point.
+///
+/// @note As with #findNearestPoly, @p nearestRefs is set to zero for points without
+/// a polygon in the search box, and @p nearestPts and @p isOverPoly are unchanged.
+///
+dtStatus dtNavMeshQuery::findNearestPolys(const float* centers, const int count, const float* halfExtents,
+										  const dtQueryFilter* filter,
+										  dtPolyRef* nearestRefs, float* nearestPts, bool* isOverPoly) const
 {
 	dtAssert(m_nav);
 
-	if (!nearestRef)
+	if (!centers || count < 0 || !halfExtents || !dtVisfinite(halfExtents) ||
+		halfExtents[0] < 0 || halfExtents[1] < 0 || halfExtents[2] < 0 ||
+		!filter || !nearestRefs)
+	{
 		return DT_FAILURE | DT_INVALID_PARAM;
+	}
 
-	// queryPolygons below will check rest of params
-	
-	dtFindNearestPolyQuery query(this, center); // 创建一个查询最近 poly 的 query 对象
-
-	dtStatus status = queryPolygons(center, halfExtents, filter, &query); // 执行 query 对象关联的查询
-	if (dtStatusFailed(status))
-		return status;
-
-	*nearestRef = query.nearestRef(); // 获取查询到的结果
-	
-	// Only override nearestPt if we actually found a poly so the nearest point
-	// is valid.
-	if (nearestPt && *nearestRef)
+	for (int i = 0; i < count; ++i)
 	{
-		dtVcopy(nearestPt, query.nearestPoint());
-		if (isOverPoly)
-			*isOverPoly = query.isOverPoly();
+		if (!dtVisfinite(&centers[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
 	}
-	
-	return DT_SUCCESS;
-}
 
-dtStatus dtNavMeshQuery::findPositionHeight(const float* center, const float* halfExtents, const dtQueryFilter* filter,
-	float* height) const
-{
-	
+	if (!count)
+		return DT_SUCCESS;
 
-	return DT_SUCCESS;
-}
+	static const int MAX_GROUP = 32;
+	static const int MAX_NEIS = 32;
 
-// 查询在 tile 中的所有 poly
-void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
-										 const dtQueryFilter* filter, dtPolyQuery* query) const
-{
-	dtAssert(m_nav);
-	static const int batchSize = 32; // 每一批处理 32 个搜索到的 poly
-	dtPolyRef polyRefs[batchSize];
-	dtPoly* polys[batchSize];
-	int n = 0;
+	dtBatchSample* samples = sortBatchSamples(m_nav, centers, count);
+	if (!samples)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
-	// 似乎是包围体树的使用开关判断
-	// 根据是否使用包围体树，对 tile 内部的所有 poly 做一次遍历
-	if (tile->bvTree)
-	{
-		const dtBVNode* node = &tile->bvTree[0];
-		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
-		const float* tbmin = tile->header->bmin;
-		const float* tbmax = tile->header->bmax;
-		const float qfac = tile->header->bvQuantFactor;
-
-		// Calculate quantized box
-		unsigned short bmin[3], bmax[3];
-		// dtClamp query box to world box.
-		float minx = dtClamp(qmin[0], tbmin[0], tbmax[0]) - tbmin[0];
-		float miny = dtClamp(qmin[1], tbmin[1], tbmax[1]) - tbmin[1];
-		float minz = dtClamp(qmin[2], tbmin[2], tbmax[2]) - tbmin[2];
-		float maxx = dtClamp(qmax[0], tbmin[0], tbmax[0]) - tbmin[0];
-		float maxy = dtClamp(qmax[1], tbmin[1], tbmax[1]) - tbmin[1];
-		float maxz = dtClamp(qmax[2], tbmin[2], tbmax[2]) - tbmin[2];
-		// Quantize
-		bmin[0] = (unsigned short)(qfac * minx) & 0xfffe;
-		bmin[1] = (unsigned short)(qfac * miny) & 0xfffe;
-		bmin[2] = (unsigned short)(qfac * minz) & 0xfffe;
-		bmax[0] = (unsigned short)(qfac * maxx + 1) | 1;
-		bmax[1] = (unsigned short)(qfac * maxy + 1) | 1;
-		bmax[2] = (unsigned short)(qfac * maxz + 1) | 1;
-
-		// Traverse tree
-		const dtPolyRef base = m_nav->getPolyRefBase(tile);
-		while (node < end)
+	dtFindNearestPolyQuery results[MAX_GROUP];
+	int group[MAX_GROUP];
+	float qmins[MAX_GROUP*3], qmaxs[MAX_GROUP*3];
+	int tileRanges[MAX_GROUP*4];
+	unsigned short quantMins[MAX_GROUP*3], quantMaxs[MAX_GROUP*3];
+	const dtMeshTile* neis[MAX_NEIS];
+
+	int i = 0;
+	while (i < count)
+	{
+		// Collect the points of the same cell.
+		int n = 0;
+		float bmin[3], bmax[3];
+		dtVsub(bmin, &centers[samples[i].index*3], halfExtents);
+		dtVadd(bmax, &centers[samples[i].index*3], halfExtents);
+		const unsigned int key = samples[i].key;
+		while (i < count && n < MAX_GROUP && samples[i].key == key)
 		{
-			const bool overlap = dtOverlapQuantBounds(bmin, bmax, node->bmin, node->bmax);
-			const bool isLeafNode = node->i >= 0;
+			const float* center = &centers[samples[i].index*3];
+			float* qmin = &qmins[n*3];
+			float* qmax = &qmaxs[n*3];
+			dtVsub(qmin, center, halfExtents);
+			dtVadd(qmax, center, halfExtents);
+			dtVmin(bmin, qmin);
+			dtVmax(bmax, qmax);
+			m_nav->calcTileLoc(qmin, &tileRanges[n*4+0], &tileRanges[n*4+1]);
+			m_nav->calcTileLoc(qmax, &tileRanges[n*4+2], &tileRanges[n*4+3]);
+			results[n].reset(this, center);
+			group[n] = samples[i].index;
+			n++;
+			i++;
+		}
+
+		int minx, miny, maxx, maxy;
+		m_nav->calcTileLoc(bmin, &minx, &miny);
+		m_nav->calcTileLoc(bmax, &maxx, &maxy);
 
-			if (isLeafNode && overlap)
+		for (int y = miny; y <= maxy; ++y)
+		{
+			for (int x = minx; x <= maxx; ++x)
 			{
-				dtPolyRef ref = base | (dtPolyRef)node->i;
-				if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+				// Points whose own search box touches this tile location.
+				int active[MAX_GROUP];
+				int nactive = 0;
+				for (int j = 0; j < n; ++j)
 				{
-					polyRefs[n] = ref;
-					polys[n] = &tile->polys[node->i];
+					const int* r = &tileRanges[j*4];
+					if (x >= r[0] && x <= r[2] && y >= r[1] && y <= r[3])
+						active[nactive++] = j;
+				}
+				if (!nactive)
+					continue;
 
-					if (n == batchSize - 1)
+				const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+				for (int k = 0; k < nneis; ++k)
+				{
+					const dtMeshTile* tile = neis[k];
+					const dtPolyRef base = m_nav->getPolyRefBase(tile);
+
+					if (tile->bvTree)
 					{
-						query->process(tile, polys, polyRefs, batchSize);
-						n = 0;
+						unsigned short tbmin[3], tbmax[3];
+						dtQuantizeQueryBounds(tile, bmin, bmax, tbmin, tbmax);
+						for (int j = 0; j < nactive; ++j)
+						{
+							const int a = active[j];
+							dtQuantizeQueryBounds(tile, &qmins[a*3], &qmaxs[a*3], &quantMins[a*3], &quantMaxs[a*3]);
+						}
+
+						const dtBVNode* node = &tile->bvTree[0];
+						const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+						while (node < end)
+						{
+							const bool overlap = dtOverlapQuantBounds(tbmin, tbmax, node->bmin, node->bmax);
+							const bool isLeafNode = node->i >= 0;
+
+							if (isLeafNode && overlap)
+							{
+								const dtPolyRef ref = base | (dtPolyRef)node->i;
+								if (filter->passFilter(ref, tile, &tile->polys[node->i]))
+								{
+									for (int j = 0; j < nactive; ++j)
+									{
+										const int a = active[j];
+										if (dtOverlapQuantBounds(&quantMins[a*3], &quantMaxs[a*3], node->bmin, node->bmax))
+											results[a].processPoly(tile, ref);
+									}
+								}
+							}
+
+							if (overlap || isLeafNode)
+								node++;
+							else
+							{
+								const int escapeIndex = -node->i;
+								node += escapeIndex;
+							}
+						}
 					}
 					else
 					{
-						n++;
+						for (int p = 0; p < tile->header->polyCount; ++p)
+						{
+							const dtPoly* poly = &tile->polys[p];
+							if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+								continue;
+							const dtPolyRef ref = base | (dtPolyRef)p;
+							if (!filter->passFilter(ref, tile, poly))
+								continue;
+
+							float pmin[3], pmax[3];
+							const float* v = &tile->verts[poly->verts[0]*3];
+							dtVcopy(pmin, v);
+							dtVcopy(pmax, v);
+							for (int j = 1; j < poly->vertCount; ++j)
+							{
+								v = &tile->verts[poly->verts[j]*3];
+								dtVmin(pmin, v);
+								dtVmax(pmax, v);
+							}
+
+							for (int j = 0; j < nactive; ++j)
+							{
+								const int a = active[j];
+								if (dtOverlapBounds(&qmins[a*3], &qmaxs[a*3], pmin, pmax))
+									results[a].processPoly(tile, ref);
+							}
+						}
 					}
 				}
 			}
+		}
 
-			if (overlap || isLeafNode)
-				node++;
-			else
+		for (int j = 0; j < n; ++j)
+		{
+			const int idx = group[j];
+			nearestRefs[idx] = results[j].nearestRef();
+			if (nearestPts && nearestRefs[idx])
 			{
-				const int escapeIndex = -node->i;
-				node += escapeIndex;
+				dtVcopy(&nearestPts[idx*3], results[j].nearestPoint());
+				if (isOverPoly)
+					isOverPoly[idx] = results[j].isOverPoly();
 			}
 		}
 	}
-	else
+
+	dtFree(samples);
+
+	return DT_SUCCESS;
+}
+
+// 批量查询高度时，一次包围体树遍历服务一组相邻的采样点
+class dtFindPositionHeightQuery : public dtPolyQuery
+{
+	const dtNavMeshQuery* m_query;
+	const float* m_centers;
+	const float* m_halfExtents;
+	const int* m_samples;
+	int m_sampleCount;
+	float* m_heights;
+	float* m_bestDist;
+
+public:
+	dtFindPositionHeightQuery(const dtNavMeshQuery* query, const float* centers, const float* halfExtents,
+							  const int* samples, const int sampleCount, float* heights, float* bestDist)
+		: m_query(query), m_centers(centers), m_halfExtents(halfExtents),
+		  m_samples(samples), m_sampleCount(sampleCount), m_heights(heights), m_bestDist(bestDist)
 	{
-		float bmin[3], bmax[3];
-		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	}
+
+	virtual ~dtFindPositionHeightQuery();
 
-		// 遍历 tile 中所有的 poly
-		for (int i = 0; i < tile->header->polyCount; ++i)
+	void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count)
+	{
+		for (int i = 0; i < count; ++i)
 		{
-			dtPoly* p = &tile->polys[i];
-			// Do not return off-mesh connection polygons.
+			const dtPoly* p = polys[i];
 			if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
 				continue;
-			// Must pass filter
-			const dtPolyRef ref = base | (dtPolyRef)i;
-			if (!filter->passFilter(ref, tile, p))
-				continue;
-			// Calc polygon bounds.
-			// 拿到 poly 的边界点
+
+			// The polygon bounds are shared by all samples of the group.
+			float bmin[3], bmax[3];
 			const float* v = &tile->verts[p->verts[0]*3];
 			dtVcopy(bmin, v);
 			dtVcopy(bmax, v);
-
-			// 遍历 poly 的所有顶点，找到最小点和最大点
 			for (int j = 1; j < p->vertCount; ++j)
 			{
 				v = &tile->verts[p->verts[j]*3];
@@ -861,28 +1103,143 @@ void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qm
 				dtVmax(bmax, v);
 			}
 
-			// 判断 poly 和 param 要找的范围是否重叠
-			if (dtOverlapBounds(qmin, qmax, bmin, bmax))
+			for (int j = 0; j < m_sampleCount; ++j)
 			{
-				polyRefs[n] = ref;
-				polys[n] = p;
+				const float* center = &m_centers[m_samples[j]*3];
+				float qmin[3], qmax[3];
+				dtVsub(qmin, center, m_halfExtents);
+				dtVadd(qmax, center, m_halfExtents);
+				if (!dtOverlapBounds(qmin, qmax, bmin, bmax))
+					continue;
 
-				if (n == batchSize - 1)
-				{
-					query->process(tile, polys, polyRefs, batchSize);
-					n = 0;
-				}
-				else
+				float h;
+				if (dtStatusFailed(m_query->getPolyHeight(refs[i], center, &h)))
+					continue;
+
+				// Prefer the surface closest to the reference height.
+				const float d = dtAbs(h - center[1]);
+				if (d < m_bestDist[j])
 				{
-					n++;
+					m_bestDist[j] = d;
+					m_heights[m_samples[j]] = h;
 				}
 			}
 		}
 	}
+};
+
+dtFindPositionHeightQuery::~dtFindPositionHeightQuery()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+/// @par
+///
+/// Of all polygons overlapping the search box and containing the point along
+/// the xz-plane, the height of the one closest to the y-value of @p center is used.
+///
+/// Will return #DT_FAILURE if no polygon is found, @p height is unchanged in that case.
+///
+dtStatus dtNavMeshQuery::findPositionHeight(const float* center, const float* halfExtents, const dtQueryFilter* filter,
+	float* height) const
+{
+	if (!height)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	bool found = false;
+	dtStatus status = findPositionHeights(center, 1, halfExtents, filter, height, &found);
+	if (dtStatusFailed(status))
+		return status;
+
+	return found ? DT_SUCCESS : DT_FAILURE;
+}
+
+/// @par
+///
+/// The points are sorted into cells of an eighth of a tile. The points of each cell
+/// share one tile lookup and one bounding volume tree traversal over the union of
+/// their search boxes, and each polygon found is tested against every point of the
+/// cell. Batches of nearby points are therefore much cheaper than calling
+/// #findPositionHeight for each point.
+///
+/// The result for each point is the same as from #findPositionHeight.
+///
+dtStatus dtNavMeshQuery::findPositionHeights(const float* centers, const int count, const float* halfExtents,
+											 const dtQueryFilter* filter, float* heights, bool* found) const
+{
+	dtAssert(m_nav);
+
+	if (!centers || count < 0 || !halfExtents || !dtVisfinite(halfExtents) ||
+		halfExtents[0] < 0 || halfExtents[1] < 0 || halfExtents[2] < 0 ||
+		!filter || !heights)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		if (!dtVisfinite(&centers[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (!count)
+		return DT_SUCCESS;
+
+	static const int MAX_GROUP = 32;
+
+	dtBatchSample* samples = sortBatchSamples(m_nav, centers, count);
+	if (!samples)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	int group[MAX_GROUP];
+	float bestDist[MAX_GROUP];
+	int i = 0;
+	while (i < count)
+	{
+		// Collect the points of the same cell.
+		int n = 0;
+		float bmin[3], bmax[3];
+		dtVsub(bmin, &centers[samples[i].index*3], halfExtents);
+		dtVadd(bmax, &centers[samples[i].index*3], halfExtents);
+		const unsigned int key = samples[i].key;
+		while (i < count && n < MAX_GROUP && samples[i].key == key)
+		{
+			const float* center = &centers[samples[i].index*3];
+			float qmin[3], qmax[3];
+			dtVsub(qmin, center, halfExtents);
+			dtVadd(qmax, center, halfExtents);
+			dtVmin(bmin, qmin);
+			dtVmax(bmax, qmax);
+			group[n] = samples[i].index;
+			bestDist[n] = FLT_MAX;
+			n++;
+			i++;
+		}
+
+		float groupCenter[3], groupExtents[3];
+		dtVlerp(groupCenter, bmin, bmax, 0.5f);
+		dtVsub(groupExtents, bmax, groupCenter);
+
+		dtFindPositionHeightQuery query(this, centers, halfExtents, group, n, heights, bestDist);
+		queryPolygons(groupCenter, groupExtents, filter, &query);
+
+		if (found)
+		{
+			for (int j = 0; j < n; ++j)
+				found[group[j]] = bestDist[j] < FLT_MAX;
+		}
+	}
+
+	dtFree(samples);
 
-	// Process the last polygons that didn't make a full batch.
-	if (n > 0)
-		query->process(tile, polys, polyRefs, n);
+	return DT_SUCCESS;
+}
+
+// 查询在 tile 中的所有 poly
+void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
+										 const dtQueryFilter* filter, dtPolyQuery* query) const
+{
+	queryPolygonsInTileT(tile, qmin, qmax, filter, query);
 }
 
 class dtCollectPolysQuery : public dtPolyQuery
@@ -926,6 +1283,124 @@ dtCollectPolysQuery::~dtCollectPolysQuery()
 	// Defined out of line to fix the weak v-tables warning
 }
 
+class dtFindPolyAtQuery : public dtPolyQuery
+{
+	const dtNavMeshQuery* m_query;
+	const float* m_pos;
+	float m_bestDiff;
+	dtPolyRef m_bestRef;
+	float m_bestHeight;
+
+public:
+	dtFindPolyAtQuery(const dtNavMeshQuery* query, const float* pos, const float maxHeightDiff)
+		: m_query(query), m_pos(pos), m_bestDiff(maxHeightDiff), m_bestRef(0), m_bestHeight(0)
+	{
+	}
+
+	virtual ~dtFindPolyAtQuery();
+
+	dtPolyRef bestRef() const { return m_bestRef; }
+	float bestHeight() const { return m_bestHeight; }
+
+	void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count)
+	{
+		dtIgnoreUnused(tile);
+		dtIgnoreUnused(polys);
+
+		for (int i = 0; i < count; ++i)
+			processPoly(refs[i]);
+	}
+
+	void processPoly(const dtPolyRef ref)
+	{
+		float h;
+		if (dtStatusFailed(m_query->getPolyHeight(ref, m_pos, &h)))
+			return;
+		// Keep the first polygon when several are at the same height, like on a shared edge.
+		const float diff = dtAbs(h - m_pos[1]);
+		if (m_bestRef ? diff < m_bestDiff : diff <= m_bestDiff)
+		{
+			m_bestDiff = diff;
+			m_bestRef = ref;
+			m_bestHeight = h;
+		}
+	}
+};
+
+dtFindPolyAtQuery::~dtFindPolyAtQuery()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+/// @par
+///
+/// With #DT_NAVMESH_POLY_GRID set on the navigation mesh, only the polygons
+/// listed in the grid cell of the position are tested. Otherwise the bounding
+/// volume tree of the tile is searched with a box of zero width around the
+/// position.
+///
+/// A position on the edge between polygons is reported on one of them.
+///
+dtStatus dtNavMeshQuery::findPolyAt(const float* pos, const float maxHeightDiff, const dtQueryFilter* filter,
+									dtPolyRef* ref, float* height) const
+{
+	dtAssert(m_nav);
+
+	if (!ref)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*ref = 0;
+
+	if (!pos || !dtVisfinite(pos) || !(maxHeightDiff >= 0.0f) || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtFindPolyAtQuery query(this, pos, maxHeightDiff);
+
+	int tx, ty;
+	m_nav->calcTileLoc(pos, &tx, &ty);
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	const int nneis = m_nav->getTilesAt(tx, ty, neis, MAX_NEIS);
+	for (int j = 0; j < nneis; ++j)
+	{
+		const dtMeshTile* tile = neis[j];
+		const dtPolyGrid* grid = tile->polyGrid;
+		if (!grid)
+		{
+			float qmin[3], qmax[3];
+			dtVcopy(qmin, pos);
+			dtVcopy(qmax, pos);
+			qmin[1] -= maxHeightDiff;
+			qmax[1] += maxHeightDiff;
+			queryPolygonsInTile(tile, qmin, qmax, filter, &query);
+			continue;
+		}
+
+		// Positions on the tile border may round to a cell outside the grid, the
+		// polygons of the nearest cell are the ones that can contain them.
+		const float ics = 1.0f / grid->cellSize;
+		const int x = dtClamp((int)dtMathFloorf((pos[0] - grid->bmin[0]) * ics), 0, grid->width-1);
+		const int z = dtClamp((int)dtMathFloorf((pos[2] - grid->bmin[2]) * ics), 0, grid->height-1);
+		const int cell = z*grid->width + x;
+
+		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+		for (unsigned int k = grid->cells[cell]; k < grid->cells[cell+1]; ++k)
+		{
+			const int ip = grid->polys[k];
+			const dtPolyRef polyRef = base | (dtPolyRef)ip;
+			if (filter->passFilter(polyRef, tile, &tile->polys[ip]))
+				query.processPoly(polyRef);
+		}
+	}
+
+	*ref = query.bestRef();
+	if (height && *ref)
+		*height = query.bestHeight();
+
+	return DT_SUCCESS;
+}
+
 /// @par 
 ///
 /// If no polygons are found, the function will return #DT_SUCCESS with a
@@ -962,50 +1437,7 @@ dtStatus dtNavMeshQuery::queryPolygons(const float* center, const float* halfExt
 dtStatus dtNavMeshQuery::queryPolygons(const float* center, const float* halfExtents,
 									   const dtQueryFilter* filter, dtPolyQuery* query) const
 {
-	dtAssert(m_nav);
-
-	if (!center || !dtVisfinite(center) || !halfExtents || !dtVisfinite(halfExtents) ||	!filter || !query)
-	{
-		return DT_FAILURE | DT_INVALID_PARAM;
-	}
-
-	// 通过中心点 center 和外扩查询半径 halfExtents 来计算出了左下点 bmin 和右上点 bmax，通过 bmin 和 bmax 确定了一个范围
-	// halfExtents 在测试 demo 中是固定值 {2, 4, 2}，实际使用中可能需要考虑这个值的设定
-	// halfExtents 的单位是米
-	// bmin 的值为 {center.x - 2, center.y - 4, center.z - 2}
-	// bmax 的值为 {center.x + 2, center.y + 4, center.z + 2}
-	float bmin[3], bmax[3];
-	dtVsub(bmin, center, halfExtents);
-	dtVadd(bmax, center, halfExtents);
-	
-	// Find tiles the query touches.
-	// 计算 bmin 和 bmax 框定的范围对应的 tile 的范围，tile 是个 2D 概念
-	// 如果 halfExtents 设置正常，那么 minx/maxx, miny/maxy 应该大致相等
-	// 理论上来说 halfExtents 应该只用处理极端情况即可，比如在 tile 边缘之类的
-	int minx, miny, maxx, maxy;
-	m_nav->calcTileLoc(bmin, &minx, &miny); // 计算 bmin 在将地图以 tile 划分的坐标轴中的 x 和 y
-	m_nav->calcTileLoc(bmax, &maxx, &maxy); // 计算 bmax 在将地图以 tile 划分的坐标轴中的 x 和 y
-
-	static const int MAX_NEIS = 32;
-	const dtMeshTile* neis[MAX_NEIS];
-
-	// 遍历 bmin 到 bmax 之间的每一个 tile 进行查找
-	// 如果搜索外扩半径很小的话，这里需要查找的 tile 很少
-	for (int y = miny; y <= maxy; ++y)
-	{
-		for (int x = minx; x <= maxx; ++x)
-		{
-			// 拿到 x/y 位置上的所有 tile, 因为 tile 是 2D 概念，所以有可能有多层 tile 重叠在一个 2D 坐标点上
-			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
-			for (int j = 0; j < nneis; ++j)
-			{
-				// 查找 tile 中的 poly，找到离 center 最近的
-				queryPolygonsInTile(neis[j], bmin, bmax, filter, query);
-			}
-		}
-	}
-	
-	return DT_SUCCESS;
+	return queryPolygonsT(center, halfExtents, filter, query);
 }
 
 /// @par
@@ -1019,12 +1451,36 @@ dtStatus dtNavMeshQuery::queryPolygons(const float* center, const float* halfExt
 /// The start and end positions are used to calculate traversal costs. 
 /// (The y-values impact the result.)
 ///
+/// When a component index is set and shows that the end polygon is on another
+/// island, the search is skipped and the path only contains the start polygon,
+/// with #DT_PARTIAL_RESULT set. Without the index, the partial path leads to the
+/// polygon closest to the end position instead, at the cost of searching the
+/// whole island of the start polygon. Callers that move toward the closest
+/// reachable point of an unreachable goal, like dtCrowd, should use a query
+/// without a component index.
+///
+/// When #DT_FINDPATH_BIDIRECTIONAL is set, a second A* search is run from the
+/// end polygon toward the start and the two frontiers are joined where they meet.
+/// Each frontier only has to cover about half of the search, which keeps long
+/// cross-tile queries well within the node pool. The backward search follows links
+/// in reverse, so one-way off-mesh connections are only traversed by the forward
+/// search. The search stops when neither frontier can improve the best join, so the
+/// result has the same cost bound as the regular search.
+///
+/// A @p heuristicWeight above 1 runs a weighted A* search, which expands fewer
+/// nodes in exchange for a path whose cost is at most @p heuristicWeight times
+/// the optimal cost. The weight cannot be combined with #DT_FINDPATH_BIDIRECTIONAL.
+///
 /// path 是最终寻路的路径，pathCount 是 path 的长度，dtPolyRef 是 uint 类型，指编号
 dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 								  const float* startPos, const float* endPos,
 								  const dtQueryFilter* filter,
-								  dtPolyRef* path, int* pathCount, const int maxPath) const
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const unsigned int options, const float heuristicWeight) const
 {
+	if (!(options & DT_FINDPATH_BIDIRECTIONAL))
+		return findPathT(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath, heuristicWeight);
+
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
 	dtAssert(m_openList);
@@ -1039,7 +1495,7 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
 		!startPos || !dtVisfinite(startPos) ||
 		!endPos || !dtVisfinite(endPos) ||
-		!filter || !path || maxPath <= 0)
+		!filter || !path || maxPath <= 0 || heuristicWeight != 1.0f)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
@@ -1052,47 +1508,160 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 		return DT_SUCCESS;
 	}
 
-	// 清理池，理论上来说清理放在每次的最后更好吧？
+	// The end polygon is on another island, the best partial path is the start polygon.
+	if (!isReachable(startRef, endRef, filter))
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS | DT_PARTIAL_RESULT;
+	}
+
+	dtQueryData query;
+	memset(&query, 0, sizeof(dtQueryData));
+	query.startRef = startRef;
+	query.endRef = endRef;
+	dtVcopy(query.startPos, startPos);
+	dtVcopy(query.endPos, endPos);
+	query.filter = filter;
+	query.options = options;
+	initBidirectional(query);
+	
+	while (dtStatusInProgress(query.status))
+		updateBidirectional(query, m_nodePool->getMaxNodes(), 0);
+	if (dtStatusFailed(query.status))
+		return query.status;
+	
+	const dtStatus status = getBidirectionalPath(query, path, pathCount, maxPath);
+	return status | (query.status & DT_STATUS_DETAIL_MASK);
+}
+
+// Returns the index of the first goal on the specified polygon, or -1.
+static int dtFindGoal(const dtPolyRef ref, const dtPolyRef* goalRefs, const int goalCount)
+{
+	for (int i = 0; i < goalCount; ++i)
+	{
+		if (goalRefs[i] == ref)
+			return i;
+	}
+	return -1;
+}
+
+// Returns the straight line distance to the nearest goal position.
+static float dtNearestGoalDist(const float* pos, const float* goalPositions, const int goalCount)
+{
+	float best = dtVdistSqr(pos, &goalPositions[0]);
+	for (int i = 1; i < goalCount; ++i)
+		best = dtMin(best, dtVdistSqr(pos, &goalPositions[i*3]));
+	return dtMathSqrtf(best);
+}
+
+/// @par
+///
+/// This is the same A* search as #findPath, with the heuristic taken as the distance
+/// to the nearest goal position. The search stops as soon as the first goal polygon
+/// is taken off the open list, which makes the result the cheapest path to any of
+/// the goals, found at roughly the cost of a single search instead of one search
+/// per goal.
+///
+/// If a polygon is listed as several goals, the position of the first one is used
+/// and its index is reported. If the start polygon is a goal, the path only contains
+/// the start polygon.
+///
+/// If none of the goals can be reached, the path leads to the polygon nearest to any
+/// of the goals, @p goalIndex is set to -1 and the status has #DT_PARTIAL_RESULT set.
+/// A landmark table is not used by this search.
+dtStatus dtNavMeshQuery::findPathToAny(dtPolyRef startRef, const float* startPos,
+									   const dtPolyRef* goalRefs, const float* goalPositions, const int goalCount,
+									   const dtQueryFilter* filter,
+									   dtPolyRef* path, int* pathCount, const int maxPath,
+									   int* goalIndex) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+	if (goalIndex)
+		*goalIndex = -1;
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !startPos || !dtVisfinite(startPos) ||
+		!goalRefs || !goalPositions || goalCount <= 0 ||
+		!filter || !path || maxPath <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	bool anyReachable = false;
+	for (int i = 0; i < goalCount; ++i)
+	{
+		if (!m_nav->isValidPolyRef(goalRefs[i]) || !dtVisfinite(&goalPositions[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+		if (!anyReachable && isReachable(startRef, goalRefs[i], filter))
+			anyReachable = true;
+	}
+
+	const int startGoal = dtFindGoal(startRef, goalRefs, goalCount);
+	if (startGoal >= 0)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		if (goalIndex)
+			*goalIndex = startGoal;
+		return DT_SUCCESS;
+	}
+
+	// All goals are on other islands, the best partial path is the start polygon.
+	if (!anyReachable)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS | DT_PARTIAL_RESULT;
+	}
+
 	m_nodePool->clear();
 	m_openList->clear();
 
-	// 初始化寻路的起始点
 	dtNode* startNode = m_nodePool->getNode(startRef);
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->total = dtNearestGoalDist(startPos, goalPositions, goalCount) * H_SCALE;
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
-	
+
 	dtNode* lastBestNode = startNode;
 	float lastBestNodeCost = startNode->total;
-	
+	int reachedGoal = -1;
+
 	bool outOfNodes = false;
 
-	// A* 寻路的过程
 	while (!m_openList->empty())
 	{
 		// Remove node from open list and put it in closed list.
 		dtNode* bestNode = m_openList->pop();
 		bestNode->flags &= ~DT_NODE_OPEN;
 		bestNode->flags |= DT_NODE_CLOSED;
-		
-		// Reached the goal, stop searching.
-		if (bestNode->id == endRef)
+
+		// Reached the cheapest goal, stop searching.
+		reachedGoal = dtFindGoal(bestNode->id, goalRefs, goalCount);
+		if (reachedGoal >= 0)
 		{
 			lastBestNode = bestNode;
 			break;
 		}
-		
+
 		// Get current poly and tile.
 		// The API input has been cheked already, skip checking internal data.
 		const dtPolyRef bestRef = bestNode->id;
 		const dtMeshTile* bestTile = 0;
 		const dtPoly* bestPoly = 0;
 		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
-		
+
 		// Get parent poly and tile.
 		dtPolyRef parentRef = 0;
 		const dtMeshTile* parentTile = 0;
@@ -1101,21 +1670,21 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
 		if (parentRef)
 			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
-		
+
 		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
 		{
 			dtPolyRef neighbourRef = bestTile->links[i].ref;
-			
+
 			// Skip invalid ids and do not expand back to where we came from.
 			if (!neighbourRef || neighbourRef == parentRef)
 				continue;
-			
+
 			// Get neighbour poly and tile.
 			// The API input has been cheked already, skip checking internal data.
 			const dtMeshTile* neighbourTile = 0;
 			const dtPoly* neighbourPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);			
-			
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
 			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
 				continue;
 
@@ -1131,62 +1700,53 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 				outOfNodes = true;
 				continue;
 			}
-			
+
 			// If the node is visited the first time, calculate node position.
 			if (neighbourNode->flags == 0)
 			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+				getLinkMidPoint(i, bestRef, bestPoly, bestTile,
 								neighbourRef, neighbourPoly, neighbourTile,
 								neighbourNode->pos);
 			}
 
 			// Calculate cost and heuristic.
-			float cost = 0;
+			const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+												  parentRef, parentTile, parentPoly,
+												  bestRef, bestTile, bestPoly,
+												  neighbourRef, neighbourTile, neighbourPoly);
+			float cost = bestNode->cost + curCost;
 			float heuristic = 0;
-			
-			// Special case for last node.
-			if (neighbourRef == endRef)
-			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				const float endCost = filter->getCost(neighbourNode->pos, endPos,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly,
-													  0, 0, 0);
-				
-				cost = bestNode->cost + curCost + endCost;
-				heuristic = 0;
+
+			// Special case for goal nodes, add the cost to the goal position.
+			const int goal = dtFindGoal(neighbourRef, goalRefs, goalCount);
+			if (goal >= 0)
+			{
+				cost += filter->getCost(neighbourNode->pos, &goalPositions[goal*3],
+										bestRef, bestTile, bestPoly,
+										neighbourRef, neighbourTile, neighbourPoly,
+										0, 0, 0);
 			}
 			else
 			{
-				// Cost
-				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
-													  parentRef, parentTile, parentPoly,
-													  bestRef, bestTile, bestPoly,
-													  neighbourRef, neighbourTile, neighbourPoly);
-				cost = bestNode->cost + curCost;
-				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
+				heuristic = dtNearestGoalDist(neighbourNode->pos, goalPositions, goalCount) * H_SCALE;
 			}
 
 			const float total = cost + heuristic;
-			
+
 			// The node is already in open list and the new result is worse, skip.
 			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
 				continue;
 			// The node is already visited and process, and the new result is worse, skip.
 			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
 				continue;
-			
+
 			// Add or update the node.
 			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
 			neighbourNode->id = neighbourRef;
 			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
 			neighbourNode->cost = cost;
 			neighbourNode->total = total;
-			
+
 			if (neighbourNode->flags & DT_NODE_OPEN)
 			{
 				// Already in open, update node location.
@@ -1198,8 +1758,8 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 				neighbourNode->flags |= DT_NODE_OPEN;
 				m_openList->push(neighbourNode);
 			}
-			
-			// Update nearest node to target so far.
+
+			// Update nearest node to any goal so far.
 			if (heuristic < lastBestNodeCost)
 			{
 				lastBestNodeCost = heuristic;
@@ -1210,15 +1770,39 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 
 	dtStatus status = getPathToNode(lastBestNode, path, pathCount, maxPath);
 
-	if (lastBestNode->id != endRef)
+	// The search may run out of nodes with a goal still on the open list.
+	if (reachedGoal < 0)
+		reachedGoal = dtFindGoal(lastBestNode->id, goalRefs, goalCount);
+	if (reachedGoal < 0)
 		status |= DT_PARTIAL_RESULT;
+	else if (goalIndex)
+		*goalIndex = reachedGoal;
 
 	if (outOfNodes)
 		status |= DT_OUT_OF_NODES;
-	
+
 	return status;
 }
 
+/// @par
+///
+/// The estimate is the straight line distance to the goal position, raised to the
+/// landmark lower bound between the polygon and the goal polygon when a landmark
+/// table is set and has distances for both. The backward search of the
+/// bidirectional path search estimates the cost from the goal to the polygon.
+float dtNavMeshQuery::getHeuristic(dtPolyRef ref, const float* pos, const float* goalDist, const float* goalPos,
+								   const bool backward) const
+{
+	float h = dtVdist(pos, goalPos);
+	if (goalDist)
+	{
+		const float* dist = m_landmarks->getPolyDistances(ref);
+		if (dist)
+			h = dtMax(h, backward ? m_landmarks->getLowerBound(goalDist, dist) : m_landmarks->getLowerBound(dist, goalDist));
+	}
+	return h * H_SCALE;
+}
+
 dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const
 {
 	// Find the length of the entire path.
@@ -1268,9 +1852,24 @@ dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pa
 /// The @p filter pointer is stored and used for the duration of the sliced
 /// path query.
 ///
+/// When a component index is set and shows that the end polygon is on another
+/// island, the query completes right away and finalizeSlicedFindPath() returns
+/// the start polygon only, with #DT_PARTIAL_RESULT set. (See: #findPath)
+///
+/// A @p heuristicWeight above 1 runs a weighted A* search, see #findPath.
+/// With #DT_FINDPATH_ANYTIME the search does not stop at the first path. Each
+/// time the end polygon is reached with the current weight, the weight is
+/// lowered and the search continues from the nodes already visited, until a
+/// round without weight proves the path optimal. The query stays in progress
+/// during the refinement, finalizeSlicedFindPath() can be called at any point
+/// to take the best path so far, and getSlicedFindPathBound() tells how far
+/// from optimal it can be. Neither option can be combined with
+/// #DT_FINDPATH_BIDIRECTIONAL.
+///
 dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef,
 											const float* startPos, const float* endPos,
-											const dtQueryFilter* filter, const unsigned int options)
+											const dtQueryFilter* filter, const unsigned int options,
+											const float heuristicWeight)
 {
 	dtAssert(m_nav);
 	dtAssert(m_nodePool);
@@ -1288,15 +1887,23 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 	m_query.filter = filter;
 	m_query.options = options;
 	m_query.raycastLimitSqr = FLT_MAX;
+	m_query.heuristicWeight = heuristicWeight;
+	m_query.costBound = FLT_MAX;
 	
 	// Validate input
 	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
 		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) || !filter)
+		!endPos || !dtVisfinite(endPos) || !filter ||
+		!dtMathIsfinite(heuristicWeight) || heuristicWeight < 1.0f)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 
+	// The bidirectional search has no any-angle, weighted or anytime variant.
+	if ((options & DT_FINDPATH_BIDIRECTIONAL) &&
+		((options & (DT_FINDPATH_ANY_ANGLE | DT_FINDPATH_ANYTIME)) || heuristicWeight != 1.0f))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
 	// trade quality with performance?
 	if (options & DT_FINDPATH_ANY_ANGLE)
 	{
@@ -1309,9 +1916,21 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 
 	if (startRef == endRef)
 	{
+		m_query.costBound = 1.0f;
 		m_query.status = DT_SUCCESS;
 		return DT_SUCCESS;
 	}
+
+	// An unreachable end polygon finishes the query right away with the start polygon only.
+	const bool reachable = isReachable(startRef, endRef, filter);
+	if (!reachable)
+		m_query.options &= ~DT_FINDPATH_BIDIRECTIONAL;
+
+	if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		initBidirectional(m_query);
+		return m_query.status;
+	}
 	
 	m_nodePool->clear();
 	m_openList->clear();
@@ -1320,12 +1939,15 @@ dtStatus dtNavMeshQuery::initSlicedFindPath(dtPolyRef startRef, dtPolyRef endRef
 	dtVcopy(startNode->pos, startPos);
 	startNode->pidx = 0;
 	startNode->cost = 0;
-	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	// The any-angle shortcuts are cheaper than the landmark distances allow.
+	const bool useLandmarks = m_landmarks && !(m_query.options & DT_FINDPATH_ANY_ANGLE);
+	startNode->total = getHeuristic(startRef, startPos,
+									useLandmarks ? m_landmarks->getPolyDistances(endRef) : 0, endPos) * heuristicWeight;
 	startNode->id = startRef;
 	startNode->flags = DT_NODE_OPEN;
 	m_openList->push(startNode);
 	
-	m_query.status = DT_IN_PROGRESS;
+	m_query.status = reachable ? DT_IN_PROGRESS : DT_SUCCESS;
 	m_query.lastBestNode = startNode;
 	m_query.lastBestNodeCost = startNode->total;
 	
@@ -1344,12 +1966,34 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 		return DT_FAILURE;
 	}
 
+	if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+		return updateBidirectional(m_query, maxIter, doneIters);
+
 	dtRaycastHit rayHit;
 	rayHit.maxPath = 0;
+
+	// Fetched per update, the table may change between the updates.
+	const bool useLandmarks = m_landmarks && !(m_query.options & DT_FINDPATH_ANY_ANGLE);
+	const float* endDist = useLandmarks ? m_landmarks->getPolyDistances(m_query.endRef) : 0;
 		
+	const bool anytime = (m_query.options & DT_FINDPATH_ANYTIME) != 0;
+	
 	int iter = 0;
 	while (iter < maxIter && !m_openList->empty())
 	{
+		// An anytime round ends when no open node can lead to a cheaper path than the one found.
+		if (anytime && m_query.lastBestNode->id == m_query.endRef &&
+			m_openList->top()->total >= m_query.lastBestNode->cost)
+		{
+			if (nextAnytimeRound(endDist))
+				continue;
+			const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
+			m_query.status = DT_SUCCESS | details;
+			if (doneIters)
+				*doneIters = iter;
+			return m_query.status;
+		}
+		
 		iter++;
 		
 		// Remove node from open list and put it in closed list.
@@ -1361,6 +2005,9 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 		if (bestNode->id == m_query.endRef)
 		{
 			m_query.lastBestNode = bestNode;
+			if (anytime && nextAnytimeRound(endDist))
+				continue;
+			m_query.costBound = m_query.heuristicWeight;
 			const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
 			m_query.status = DT_SUCCESS | details;
 			if (doneIters)
@@ -1447,7 +2094,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			// If the node is visited the first time, calculate node position.
 			if (neighbourNode->flags == 0)
 			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+				getLinkMidPoint(i, bestRef, bestPoly, bestTile,
 								neighbourRef, neighbourPoly, neighbourTile,
 								neighbourNode->pos);
 			}
@@ -1494,7 +2141,7 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 			}
 			else
 			{
-				heuristic = dtVdist(neighbourNode->pos, m_query.endPos)*H_SCALE;
+				heuristic = getHeuristic(neighbourRef, neighbourNode->pos, endDist, m_query.endPos) * m_query.heuristicWeight;
 			}
 			
 			const float total = cost + heuristic;
@@ -1539,6 +2186,9 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 	// Exhausted all nodes, but could not find path.
 	if (m_openList->empty())
 	{
+		// Every node has been expanded with its lowest cost, a path found by an anytime search is optimal.
+		if (m_query.lastBestNode->id == m_query.endRef)
+			m_query.costBound = 1.0f;
 		const dtStatus details = m_query.status & DT_STATUS_DETAIL_MASK;
 		m_query.status = DT_SUCCESS | details;
 	}
@@ -1549,6 +2199,78 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 	return m_query.status;
 }
 
+/// @par
+///
+/// The path found in a round costs at most the round's weight times the optimal
+/// cost. The next round is keyed with the lowered weight. The visited nodes and
+/// their costs are kept, nodes are reopened as usual when a cheaper route to them
+/// is found, so the rounds after the first one mostly revisit the area around
+/// the current path.
+bool dtNavMeshQuery::nextAnytimeRound(const float* endDist)
+{
+	m_query.costBound = m_query.heuristicWeight;
+	if (m_query.heuristicWeight <= 1.0f)
+		return false;
+	
+	float weight = 1.0f + (m_query.heuristicWeight - 1.0f) * ANYTIME_WEIGHT_DECAY;
+	if (weight < ANYTIME_MIN_WEIGHT)
+		weight = 1.0f;
+	m_query.heuristicWeight = weight;
+	
+	// Rekey the visited nodes with the new weight, so that the costs compared
+	// when the nodes are reached again use the same weight.
+	m_openList->clear();
+	const int nodeCount = m_nodePool->getNodeCount();
+	for (int i = 1; i <= nodeCount; ++i)
+	{
+		dtNode* node = m_nodePool->getNodeAtIdx((unsigned int)i);
+		if (!(node->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)))
+			continue;
+		float heuristic = 0;
+		if (node->id != m_query.endRef)
+			heuristic = getHeuristic(node->id, node->pos, endDist, m_query.endPos) * weight;
+		node->total = node->cost + heuristic;
+		if (node->flags & DT_NODE_OPEN)
+			m_openList->push(node);
+	}
+	
+	return true;
+}
+
+/// @par
+///
+/// The clock is read once before each batch of @p checkIters iterations, so the
+/// deadline can be overrun by the cost of one batch. At least one batch is run
+/// even if the deadline has already passed, so every call makes progress.
+/// Lower @p checkIters to tighten the budget at the expense of more clock reads.
+///
+/// @see dtTimeSetCustom
+dtStatus dtNavMeshQuery::updateSlicedFindPathTimed(const dtTimeVal deadline, int* doneIters, int* doneTimeUsec,
+												   const int checkIters)
+{
+	const dtTimeVal startTime = dtGetTimeUsec();
+	const int batch = dtMax(checkIters, 1);
+	
+	dtStatus status = m_query.status;
+	int iters = 0;
+	dtTimeVal now = startTime;
+	do
+	{
+		int batchIters = 0;
+		status = updateSlicedFindPath(batch, &batchIters);
+		iters += batchIters;
+		now = dtGetTimeUsec();
+	}
+	while (dtStatusInProgress(status) && now < deadline);
+	
+	if (doneIters)
+		*doneIters = iters;
+	if (doneTimeUsec)
+		*doneTimeUsec = (int)(now - startTime);
+	
+	return status;
+}
+
 dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount, const int maxPath)
 {
 	if (!pathCount)
@@ -1573,6 +2295,10 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount,
 		// Special case: the search starts and ends at same poly.
 		path[n++] = m_query.startRef;
 	}
+	else if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+	{
+		m_query.status |= getBidirectionalPath(m_query, path, &n, maxPath) & DT_STATUS_DETAIL_MASK;
+	}
 	else
 	{
 		// Reverse the path.
@@ -1671,7 +2397,11 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing
 		dtNode* node = 0;
 		for (int i = existingSize-1; i >= 0; --i)
 		{
-			m_nodePool->findNodes(existing[i], &node, 1);
+			// The backward nodes of a bidirectional search do not lead back to the start.
+			if (m_query.options & DT_FINDPATH_BIDIRECTIONAL)
+				node = m_nodePool->findNode(existing[i], DT_BIDIR_FORWARD);
+			else
+				m_nodePool->findNodes(existing[i], &node, 1);
 			if (node)
 				break;
 		}
@@ -1741,30 +2471,310 @@ dtStatus dtNavMeshQuery::finalizeSlicedFindPathPartial(const dtPolyRef* existing
 }
 
 
+// Returns true if the polygon has a link leading to the specified polygon.
+static bool hasLinkTo(const dtMeshTile* tile, const dtPoly* poly, const dtPolyRef ref)
+{
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == ref)
+			return true;
+	}
+	return false;
+}
+
+void dtNavMeshQuery::initBidirectional(dtQueryData& query) const
+{
+	m_nodePool->clear();
+	m_openList->clear();
+	m_backOpenList->clear();
+	
+	dtNode* startNode = m_nodePool->getNode(query.startRef, DT_BIDIR_FORWARD);
+	dtVcopy(startNode->pos, query.startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = getHeuristic(query.startRef, query.startPos,
+									m_landmarks ? m_landmarks->getPolyDistances(query.endRef) : 0, query.endPos);
+	startNode->id = query.startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtNode* endNode = m_nodePool->getNode(query.endRef, DT_BIDIR_BACKWARD);
+	dtVcopy(endNode->pos, query.endPos);
+	endNode->pidx = 0;
+	endNode->cost = 0;
+	endNode->total = getHeuristic(query.endRef, query.endPos,
+								  m_landmarks ? m_landmarks->getPolyDistances(query.startRef) : 0, query.startPos, true);
+	endNode->id = query.endRef;
+	endNode->flags = DT_NODE_OPEN;
+	m_backOpenList->push(endNode);
+
+	query.status = DT_IN_PROGRESS;
+	query.lastBestNode = startNode;
+	query.lastBestNodeCost = startNode->total;
+	query.meetNode[0] = 0;
+	query.meetNode[1] = 0;
+	query.meetCost = FLT_MAX;
+}
+
+/// @par
+///
+/// The frontier with the lower top total is expanded first. The search is done when
+/// the best join costs no more than the top of either (non-empty) frontier, since every
+/// path not yet found has to pass through both of them. An empty frontier does not end
+/// the search on its own, because the backward search cannot follow one-way links.
+dtStatus dtNavMeshQuery::updateBidirectional(dtQueryData& query, const int maxIter, int* doneIters) const
+{
+	int iter = 0;
+	while (iter < maxIter)
+	{
+		const bool fwdEmpty = m_openList->empty();
+		const bool bwdEmpty = m_backOpenList->empty();
+		const float fwdTop = fwdEmpty ? FLT_MAX : m_openList->top()->total;
+		const float bwdTop = bwdEmpty ? FLT_MAX : m_backOpenList->top()->total;
+		
+		if ((fwdEmpty && bwdEmpty) ||
+			(!fwdEmpty && fwdTop >= query.meetCost) ||
+			(!bwdEmpty && bwdTop >= query.meetCost))
+		{
+			const dtStatus details = query.status & DT_STATUS_DETAIL_MASK;
+			query.status = DT_SUCCESS | details;
+			break;
+		}
+		
+		iter++;
+		
+		const int side = (!fwdEmpty && fwdTop <= bwdTop) ? DT_BIDIR_FORWARD : DT_BIDIR_BACKWARD;
+		if (!expandBidirectional(query, side))
+		{
+			// The polygon has disappeared during the sliced query, fail.
+			query.status = DT_FAILURE;
+			break;
+		}
+	}
+	
+	if (doneIters)
+		*doneIters = iter;
+	
+	return query.status;
+}
+
+bool dtNavMeshQuery::expandBidirectional(dtQueryData& query, const int side) const
+{
+	const bool forward = side == DT_BIDIR_FORWARD;
+	dtNodeQueue* openList = forward ? m_openList : m_backOpenList;
+	const unsigned char state = forward ? DT_BIDIR_FORWARD : DT_BIDIR_BACKWARD;
+	const unsigned char otherState = forward ? DT_BIDIR_BACKWARD : DT_BIDIR_FORWARD;
+	const float* goalPos = forward ? query.endPos : query.startPos;
+	const float* goalDist = m_landmarks ? m_landmarks->getPolyDistances(forward ? query.endRef : query.startRef) : 0;
+	const dtQueryFilter* filter = query.filter;
+	
+	// Remove node from open list and put it in closed list.
+	dtNode* bestNode = openList->pop();
+	bestNode->flags &= ~DT_NODE_OPEN;
+	bestNode->flags |= DT_NODE_CLOSED;
+	
+	// Get current poly and tile.
+	const dtPolyRef bestRef = bestNode->id;
+	const dtMeshTile* bestTile = 0;
+	const dtPoly* bestPoly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(bestRef, &bestTile, &bestPoly)))
+		return false;
+	
+	// Get parent poly and tile. For the backward search the parent is the next polygon toward the end.
+	dtPolyRef parentRef = 0;
+	const dtMeshTile* parentTile = 0;
+	const dtPoly* parentPoly = 0;
+	if (bestNode->pidx)
+		parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+	if (parentRef && dtStatusFailed(m_nav->getTileAndPolyByRef(parentRef, &parentTile, &parentPoly)))
+		return false;
+	
+	for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+	{
+		dtPolyRef neighbourRef = bestTile->links[i].ref;
+		
+		// Skip invalid ids and do not expand back to where we came from.
+		if (!neighbourRef || neighbourRef == parentRef)
+			continue;
+		
+		const dtMeshTile* neighbourTile = 0;
+		const dtPoly* neighbourPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+		
+		if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+			continue;
+		
+		// The backward search may only step to polygons that can move into the current one.
+		if (!forward && !hasLinkTo(neighbourTile, neighbourPoly, bestRef))
+			continue;
+		
+		dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, state);
+		if (!neighbourNode)
+		{
+			query.status |= DT_OUT_OF_NODES;
+			continue;
+		}
+		
+		// If the node is visited the first time, calculate node position.
+		if (neighbourNode->flags == 0)
+		{
+			getLinkMidPoint(i, bestRef, bestPoly, bestTile,
+							neighbourRef, neighbourPoly, neighbourTile,
+							neighbourNode->pos);
+		}
+		
+		// The segment between the two node positions always lies within the current polygon.
+		float curCost;
+		if (forward)
+		{
+			curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+									  parentRef, parentTile, parentPoly,
+									  bestRef, bestTile, bestPoly,
+									  neighbourRef, neighbourTile, neighbourPoly);
+		}
+		else
+		{
+			curCost = filter->getCost(neighbourNode->pos, bestNode->pos,
+									  neighbourRef, neighbourTile, neighbourPoly,
+									  bestRef, bestTile, bestPoly,
+									  parentRef, parentTile, parentPoly);
+		}
+		
+		const float cost = bestNode->cost + curCost;
+		const float heuristic = getHeuristic(neighbourRef, neighbourNode->pos, goalDist, goalPos, !forward);
+		const float total = cost + heuristic;
+		
+		// The node is already in open list and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+			continue;
+		// The node is already visited and process, and the new result is worse, skip.
+		if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+			continue;
+		
+		// Add or update the node.
+		neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+		neighbourNode->id = neighbourRef;
+		neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+		neighbourNode->cost = cost;
+		neighbourNode->total = total;
+		
+		if (neighbourNode->flags & DT_NODE_OPEN)
+		{
+			// Already in open, update node location.
+			openList->modify(neighbourNode);
+		}
+		else
+		{
+			// Put the node in open list.
+			neighbourNode->flags |= DT_NODE_OPEN;
+			openList->push(neighbourNode);
+		}
+		
+		// Update nearest node to target so far.
+		if (forward && heuristic < query.lastBestNodeCost)
+		{
+			query.lastBestNodeCost = heuristic;
+			query.lastBestNode = neighbourNode;
+		}
+		
+		// Join the frontiers if the other search has reached this polygon too.
+		dtNode* otherNode = m_nodePool->findNode(neighbourRef, otherState);
+		if (otherNode && otherNode->flags)
+		{
+			if (forward)
+				joinBidirectional(query, neighbourNode, otherNode);
+			else
+				joinBidirectional(query, otherNode, neighbourNode);
+		}
+	}
+	
+	return true;
+}
+
+void dtNavMeshQuery::joinBidirectional(dtQueryData& query, dtNode* fwdNode, dtNode* bwdNode) const
+{
+	const dtPolyRef ref = fwdNode->id;
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	
+	dtPolyRef prevRef = 0, nextRef = 0;
+	const dtMeshTile* prevTile = 0;
+	const dtMeshTile* nextTile = 0;
+	const dtPoly* prevPoly = 0;
+	const dtPoly* nextPoly = 0;
+	if (fwdNode->pidx)
+	{
+		prevRef = m_nodePool->getNodeAtIdx(fwdNode->pidx)->id;
+		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+	}
+	if (bwdNode->pidx)
+	{
+		nextRef = m_nodePool->getNodeAtIdx(bwdNode->pidx)->id;
+		m_nav->getTileAndPolyByRefUnsafe(nextRef, &nextTile, &nextPoly);
+	}
+	
+	const float joinCost = query.filter->getCost(fwdNode->pos, bwdNode->pos,
+												 prevRef, prevTile, prevPoly,
+												 ref, tile, poly,
+												 nextRef, nextTile, nextPoly);
+	const float cost = fwdNode->cost + joinCost + bwdNode->cost;
+	if (cost < query.meetCost)
+	{
+		query.meetCost = cost;
+		query.meetNode[0] = fwdNode;
+		query.meetNode[1] = bwdNode;
+	}
+}
+
+dtStatus dtNavMeshQuery::getBidirectionalPath(const dtQueryData& query, dtPolyRef* path, int* pathCount, int maxPath) const
+{
+	// The frontiers never met, return the path toward the polygon nearest to the end.
+	if (!query.meetNode[0])
+	{
+		dtAssert(query.lastBestNode);
+		return getPathToNode(query.lastBestNode, path, pathCount, maxPath) | DT_PARTIAL_RESULT;
+	}
+	
+	// Start to the join polygon.
+	int n = 0;
+	dtStatus status = getPathToNode(query.meetNode[0], path, &n, maxPath);
+	
+	// Join polygon to the end.
+	if (!(status & DT_BUFFER_TOO_SMALL))
+	{
+		for (dtNode* node = m_nodePool->getNodeAtIdx(query.meetNode[1]->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+		{
+			if (n >= maxPath)
+			{
+				status |= DT_BUFFER_TOO_SMALL;
+				break;
+			}
+			path[n++] = node->id;
+		}
+	}
+	
+	*pathCount = n;
+	
+	return status;
+}
+
 dtStatus dtNavMeshQuery::appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref,
-									  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-									  int* straightPathCount, const int maxStraightPath) const
+									  dtStraightPathSink* sink, float* lastPos, int* vertexCount) const
 {
-	if ((*straightPathCount) > 0 && dtVequal(&straightPath[((*straightPathCount)-1)*3], pos))
+	if ((*vertexCount) > 0 && dtVequal(lastPos, pos))
 	{
 		// The vertices are equal, update flags and poly.
-		if (straightPathFlags)
-			straightPathFlags[(*straightPathCount)-1] = flags;
-		if (straightPathRefs)
-			straightPathRefs[(*straightPathCount)-1] = ref;
+		sink->updateVertex(flags, ref);
 	}
 	else
 	{
 		// Append new vertex.
-		dtVcopy(&straightPath[(*straightPathCount)*3], pos);
-		if (straightPathFlags)
-			straightPathFlags[(*straightPathCount)] = flags;
-		if (straightPathRefs)
-			straightPathRefs[(*straightPathCount)] = ref;
-		(*straightPathCount)++;
+		dtVcopy(lastPos, pos);
+		(*vertexCount)++;
 
-		// If there is no space to append more vertices, return.
-		if ((*straightPathCount) >= maxStraightPath)
+		// If the sink does not take more vertices, return.
+		if (!sink->appendVertex(pos, flags, ref))
 		{
 			return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
 		}
@@ -1779,10 +2789,10 @@ dtStatus dtNavMeshQuery::appendVertex(const float* pos, const unsigned char flag
 }
 
 dtStatus dtNavMeshQuery::appendPortals(const int startIdx, const int endIdx, const float* endPos, const dtPolyRef* path,
-									  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
-									  int* straightPathCount, const int maxStraightPath, const int options) const
+									  dtStraightPathSink* sink, float* lastPos, int* vertexCount, const int options) const
 {
-	const float* startPos = &straightPath[(*straightPathCount-1)*3];
+	float startPos[3];
+	dtVcopy(startPos, lastPos);
 	// Append or update last vertex
 	dtStatus stat = 0;
 	for (int i = startIdx; i < endIdx; i++)
@@ -1818,9 +2828,7 @@ dtStatus dtNavMeshQuery::appendPortals(const int startIdx, const int endIdx, con
 			float pt[3];
 			dtVlerp(pt, left,right, t);
 
-			stat = appendVertex(pt, 0, path[i+1],
-								straightPath, straightPathFlags, straightPathRefs,
-								straightPathCount, maxStraightPath);
+			stat = appendVertex(pt, 0, path[i+1], sink, lastPos, vertexCount);
 			if (stat != DT_IN_PROGRESS)
 				return stat;
 		}
@@ -1828,6 +2836,55 @@ dtStatus dtNavMeshQuery::appendPortals(const int startIdx, const int endIdx, con
 	return DT_IN_PROGRESS;
 }
 
+dtStraightPathSink::~dtStraightPathSink()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+/// Writes the straight path to the arrays of findStraightPath.
+class dtStraightPathArraySink : public dtStraightPathSink
+{
+	float* m_verts;
+	unsigned char* m_flags;
+	dtPolyRef* m_refs;
+	int* m_count;
+	const int m_maxCount;
+
+public:
+	dtStraightPathArraySink(float* verts, unsigned char* flags, dtPolyRef* refs, int* count, const int maxCount)
+		: m_verts(verts), m_flags(flags), m_refs(refs), m_count(count), m_maxCount(maxCount)
+	{
+	}
+
+	virtual ~dtStraightPathArraySink();
+
+	bool appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref)
+	{
+		const int n = *m_count;
+		dtVcopy(&m_verts[n*3], pos);
+		if (m_flags)
+			m_flags[n] = flags;
+		if (m_refs)
+			m_refs[n] = ref;
+		(*m_count)++;
+		return (*m_count) < m_maxCount;
+	}
+
+	void updateVertex(const unsigned char flags, const dtPolyRef ref)
+	{
+		const int n = *m_count - 1;
+		if (m_flags)
+			m_flags[n] = flags;
+		if (m_refs)
+			m_refs[n] = ref;
+	}
+};
+
+dtStraightPathArraySink::~dtStraightPathArraySink()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
 /// @par
 /// 
 /// This method peforms what is often called 'string pulling'.
@@ -1857,15 +2914,42 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 
 	*straightPathCount = 0;
 
+	if (!straightPath || maxStraightPath <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtStraightPathArraySink sink(straightPath, straightPathFlags, straightPathRefs, straightPathCount, maxStraightPath);
+	return findStraightPath(startPos, endPos, path, pathSize, &sink, options);
+}
+
+/// @par
+///
+/// The vertices are passed to @p sink as the funnel finds them, so the straight
+/// path needs no output buffer and the query does no more work than is asked for.
+/// The query stops as soon as dtStraightPathSink::appendVertex returns false, which
+/// is reported with #DT_BUFFER_TOO_SMALL, the same as a full buffer in the array
+/// version. For example a sink that only takes the next few corners of a long
+/// corridor does not pay for the rest of the path.
+///
+/// The start position is clamped to the first polygon in the path, and the 
+/// end position is clamped to the last. (See: #findStraightPath)
+///
+dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* endPos,
+										  const dtPolyRef* path, const int pathSize,
+										  dtStraightPathSink* sink, const int options) const
+{
+	dtAssert(m_nav);
+
 	if (!startPos || !dtVisfinite(startPos) ||
 		!endPos || !dtVisfinite(endPos) ||
 		!path || pathSize <= 0 || !path[0] ||
-		maxStraightPath <= 0)
+		!sink)
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 	
 	dtStatus stat = 0;
+	float lastPos[3];
+	int vertexCount = 0;
 	
 	// TODO: Should this be callers responsibility?
 	float closestStartPos[3];
@@ -1878,8 +2962,7 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 	
 	// Add start point.
 	stat = appendVertex(closestStartPos, DT_STRAIGHTPATH_START, path[0],
-						straightPath, straightPathFlags, straightPathRefs,
-						straightPathCount, maxStraightPath);
+						sink, lastPos, &vertexCount);
 	if (stat != DT_IN_PROGRESS)
 		return stat;
 	
@@ -1921,20 +3004,15 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 					}
 
 					// Apeend portals along the current straight path segment.
+					stat = DT_IN_PROGRESS;
 					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
-					{
-						// Ignore status return value as we're just about to return anyway.
-						appendPortals(apexIndex, i, closestEndPos, path,
-											 straightPath, straightPathFlags, straightPathRefs,
-											 straightPathCount, maxStraightPath, options);
-					}
+						stat = appendPortals(apexIndex, i, closestEndPos, path, sink, lastPos, &vertexCount, options);
 
-					// Ignore status return value as we're just about to return anyway.
-					appendVertex(closestEndPos, 0, path[i],
-										straightPath, straightPathFlags, straightPathRefs,
-										straightPathCount, maxStraightPath);
+					// The sink must not be called again once it has stopped the query.
+					if (!dtStatusDetail(stat, DT_BUFFER_TOO_SMALL))
+						stat = appendVertex(closestEndPos, 0, path[i], sink, lastPos, &vertexCount);
 					
-					return DT_SUCCESS | DT_PARTIAL_RESULT | ((*straightPathCount >= maxStraightPath) ? DT_BUFFER_TOO_SMALL : 0);
+					return DT_SUCCESS | DT_PARTIAL_RESULT | (stat & DT_BUFFER_TOO_SMALL);
 				}
 				
 				// If starting really close the portal, advance.
@@ -1970,8 +3048,7 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
 					{
 						stat = appendPortals(apexIndex, leftIndex, portalLeft, path,
-											 straightPath, straightPathFlags, straightPathRefs,
-											 straightPathCount, maxStraightPath, options);
+											 sink, lastPos, &vertexCount, options);
 						if (stat != DT_IN_PROGRESS)
 							return stat;					
 					}
@@ -1988,8 +3065,7 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 					
 					// Append or update vertex
 					stat = appendVertex(portalApex, flags, ref,
-										straightPath, straightPathFlags, straightPathRefs,
-										straightPathCount, maxStraightPath);
+										sink, lastPos, &vertexCount);
 					if (stat != DT_IN_PROGRESS)
 						return stat;
 					
@@ -2021,8 +3097,7 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 					if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
 					{
 						stat = appendPortals(apexIndex, rightIndex, portalRight, path,
-											 straightPath, straightPathFlags, straightPathRefs,
-											 straightPathCount, maxStraightPath, options);
+											 sink, lastPos, &vertexCount, options);
 						if (stat != DT_IN_PROGRESS)
 							return stat;
 					}
@@ -2039,8 +3114,7 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 
 					// Append or update vertex
 					stat = appendVertex(portalApex, flags, ref,
-										straightPath, straightPathFlags, straightPathRefs,
-										straightPathCount, maxStraightPath);
+										sink, lastPos, &vertexCount);
 					if (stat != DT_IN_PROGRESS)
 						return stat;
 					
@@ -2061,19 +3135,15 @@ dtStatus dtNavMeshQuery::findStraightPath(const float* startPos, const float* en
 		if (options & (DT_STRAIGHTPATH_AREA_CROSSINGS | DT_STRAIGHTPATH_ALL_CROSSINGS))
 		{
 			stat = appendPortals(apexIndex, pathSize-1, closestEndPos, path,
-								 straightPath, straightPathFlags, straightPathRefs,
-								 straightPathCount, maxStraightPath, options);
+								 sink, lastPos, &vertexCount, options);
 			if (stat != DT_IN_PROGRESS)
 				return stat;
 		}
 	}
 
-	// Ignore status return value as we're just about to return anyway.
-	appendVertex(closestEndPos, DT_STRAIGHTPATH_END, 0,
-						straightPath, straightPathFlags, straightPathRefs,
-						straightPathCount, maxStraightPath);
+	stat = appendVertex(closestEndPos, DT_STRAIGHTPATH_END, 0, sink, lastPos, &vertexCount);
 	
-	return DT_SUCCESS | ((*straightPathCount >= maxStraightPath) ? DT_BUFFER_TOO_SMALL : 0);
+	return DT_SUCCESS | (stat & DT_BUFFER_TOO_SMALL);
 }
 
 /// @par
@@ -2323,20 +3393,30 @@ dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, dtPolyRef to, float* le
 // Returns portal points between two polygons.
 dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
 										 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
-										 float* left, float* right) const
+										 float* left, float* right)
 {
 	// Find the link that points to the 'to' polygon.
 	const dtLink* link = 0;
+	unsigned int linkIdx = DT_NULL_LINK;
 	for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
 	{
 		if (fromTile->links[i].ref == to)
 		{
 			link = &fromTile->links[i];
+			linkIdx = i;
 			break;
 		}
 	}
 	if (!link)
 		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Use the precomputed portal if the tile has one.
+	if (fromTile->portals)
+	{
+		dtVcopy(left, fromTile->portals[linkIdx].left);
+		dtVcopy(right, fromTile->portals[linkIdx].right);
+		return DT_SUCCESS;
+	}
 	
 	// Handle off-mesh connections.
 	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
@@ -2409,8 +3489,21 @@ dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, dtPolyRef to, float* mi
 
 dtStatus dtNavMeshQuery::getEdgeMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
 										 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
-										 float* mid) const
+										 float* mid)
 {
+	if (fromTile->portals)
+	{
+		for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+		{
+			if (fromTile->links[i].ref == to)
+			{
+				dtVcopy(mid, fromTile->portals[i].mid);
+				return DT_SUCCESS;
+			}
+		}
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
 	float left[3], right[3];
 	if (dtStatusFailed(getPortalPoints(from, fromPoly, fromTile, to, toPoly, toTile, left, right)))
 		return DT_FAILURE | DT_INVALID_PARAM;
@@ -2522,225 +3615,25 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 								 const dtQueryFilter* filter, const unsigned int options,
 								 dtRaycastHit* hit, dtPolyRef prevRef) const
 {
-	dtAssert(m_nav);
-
-	if (!hit)
-		return DT_FAILURE | DT_INVALID_PARAM;
-
-	hit->t = 0;
-	hit->pathCount = 0;
-	hit->pathCost = 0;
-
-	// Validate input
-	if (!m_nav->isValidPolyRef(startRef) ||
-		!startPos || !dtVisfinite(startPos) ||
-		!endPos || !dtVisfinite(endPos) ||
-		!filter ||
-		(prevRef && !m_nav->isValidPolyRef(prevRef)))
-	{
-		return DT_FAILURE | DT_INVALID_PARAM;
-	}
-	
-	float dir[3], curPos[3], lastPos[3];
-	float verts[DT_VERTS_PER_POLYGON*3+3];	
-	int n = 0;
-
-	dtVcopy(curPos, startPos);
-	dtVsub(dir, endPos, startPos);
-	dtVset(hit->hitNormal, 0, 0, 0);
-
-	dtStatus status = DT_SUCCESS;
-
-	const dtMeshTile* prevTile, *tile, *nextTile;
-	const dtPoly* prevPoly, *poly, *nextPoly;
-	dtPolyRef curRef;
-
-	// The API input has been checked already, skip checking internal data.
-	curRef = startRef;
-	tile = 0;
-	poly = 0;
-	m_nav->getTileAndPolyByRefUnsafe(curRef, &tile, &poly);
-	nextTile = prevTile = tile;
-	nextPoly = prevPoly = poly;
-	if (prevRef)
-		m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
-
-	while (curRef)
-	{
-		// Cast ray against current polygon.
-		
-		// Collect vertices.
-		int nv = 0;
-		for (int i = 0; i < (int)poly->vertCount; ++i)
-		{
-			dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
-			nv++;
-		}
-		
-		float tmin, tmax;
-		int segMin, segMax;
-		if (!dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax))
-		{
-			// Could not hit the polygon, keep the old t and report hit.
-			hit->pathCount = n;
-			return status;
-		}
-
-		hit->hitEdgeIndex = segMax;
-
-		// Keep track of furthest t so far.
-		if (tmax > hit->t)
-			hit->t = tmax;
-		
-		// Store visited polygons.
-		if (n < hit->maxPath)
-			hit->path[n++] = curRef;
-		else
-			status |= DT_BUFFER_TOO_SMALL;
-
-		// Ray end is completely inside the polygon.
-		if (segMax == -1)
-		{
-			hit->t = FLT_MAX;
-			hit->pathCount = n;
-			
-			// add the cost
-			if (options & DT_RAYCAST_USE_COSTS)
-				hit->pathCost += filter->getCost(curPos, endPos, prevRef, prevTile, prevPoly, curRef, tile, poly, curRef, tile, poly);
-			return status;
-		}
-
-		// Follow neighbours.
-		dtPolyRef nextRef = 0;
-		
-		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
-		{
-			const dtLink* link = &tile->links[i];
-			
-			// Find link which contains this edge.
-			if ((int)link->edge != segMax)
-				continue;
-			
-			// Get pointer to the next polygon.
-			nextTile = 0;
-			nextPoly = 0;
-			m_nav->getTileAndPolyByRefUnsafe(link->ref, &nextTile, &nextPoly);
-			
-			// Skip off-mesh connections.
-			if (nextPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
-				continue;
-			
-			// Skip links based on filter.
-			if (!filter->passFilter(link->ref, nextTile, nextPoly))
-				continue;
-			
-			// If the link is internal, just return the ref.
-			if (link->side == 0xff)
-			{
-				nextRef = link->ref;
-				break;
-			}
-			
-			// If the link is at tile boundary,
-			
-			// Check if the link spans the whole edge, and accept.
-			if (link->bmin == 0 && link->bmax == 255)
-			{
-				nextRef = link->ref;
-				break;
-			}
-			
-			// Check for partial edge links.
-			const int v0 = poly->verts[link->edge];
-			const int v1 = poly->verts[(link->edge+1) % poly->vertCount];
-			const float* left = &tile->verts[v0*3];
-			const float* right = &tile->verts[v1*3];
-			
-			// Check that the intersection lies inside the link portal.
-			if (link->side == 0 || link->side == 4)
-			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[2] + (right[2] - left[2])*(link->bmin*s);
-				float lmax = left[2] + (right[2] - left[2])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find Z intersection.
-				float z = startPos[2] + (endPos[2]-startPos[2])*tmax;
-				if (z >= lmin && z <= lmax)
-				{
-					nextRef = link->ref;
-					break;
-				}
-			}
-			else if (link->side == 2 || link->side == 6)
-			{
-				// Calculate link size.
-				const float s = 1.0f/255.0f;
-				float lmin = left[0] + (right[0] - left[0])*(link->bmin*s);
-				float lmax = left[0] + (right[0] - left[0])*(link->bmax*s);
-				if (lmin > lmax) dtSwap(lmin, lmax);
-				
-				// Find X intersection.
-				float x = startPos[0] + (endPos[0]-startPos[0])*tmax;
-				if (x >= lmin && x <= lmax)
-				{
-					nextRef = link->ref;
-					break;
-				}
-			}
-		}
-		
-		// add the cost
-		if (options & DT_RAYCAST_USE_COSTS)
-		{
-			// compute the intersection point at the furthest end of the polygon
-			// and correct the height (since the raycast moves in 2d)
-			dtVcopy(lastPos, curPos);
-			dtVmad(curPos, startPos, dir, hit->t);
-			float* e1 = &verts[segMax*3];
-			float* e2 = &verts[((segMax+1)%nv)*3];
-			float eDir[3], diff[3];
-			dtVsub(eDir, e2, e1);
-			dtVsub(diff, curPos, e1);
-			float s = dtSqr(eDir[0]) > dtSqr(eDir[2]) ? diff[0] / eDir[0] : diff[2] / eDir[2];
-			curPos[1] = e1[1] + eDir[1] * s;
-
-			hit->pathCost += filter->getCost(lastPos, curPos, prevRef, prevTile, prevPoly, curRef, tile, poly, nextRef, nextTile, nextPoly);
-		}
-
-		if (!nextRef)
-		{
-			// No neighbour, we hit a wall.
-			
-			// Calculate hit normal.
-			const int a = segMax;
-			const int b = segMax+1 < nv ? segMax+1 : 0;
-			const float* va = &verts[a*3];
-			const float* vb = &verts[b*3];
-			const float dx = vb[0] - va[0];
-			const float dz = vb[2] - va[2];
-			hit->hitNormal[0] = dz;
-			hit->hitNormal[1] = 0;
-			hit->hitNormal[2] = -dx;
-			dtVnormalize(hit->hitNormal);
-			
-			hit->pathCount = n;
-			return status;
-		}
+	return raycastT(startRef, startPos, endPos, filter, options, hit, prevRef);
+}
 
-		// No hit, advance to neighbour polygon.
-		prevRef = curRef;
-		curRef = nextRef;
-		prevTile = tile;
-		tile = nextTile;
-		prevPoly = poly;
-		poly = nextPoly;
-	}
-	
-	hit->pathCount = n;
-	
-	return status;
+/// @par
+///
+/// Gives the same results for each ray as #raycast with the same arguments.
+/// All start positions must be inside @p startRef. The rays are processed in
+/// batches, and the rays of a batch that are in the same polygon share the
+/// vertex fetch and the edge tests against it. Rays cast from one point in
+/// nearby directions stay together for longer, so fans of rays benefit most.
+///
+/// The returned status contains the detail flags of all rays, use @p rayStatus
+/// to find which ray ran out of path buffer.
+///
+dtStatus dtNavMeshQuery::raycastBatch(dtPolyRef startRef, const float* startPos, const float* endPos, const int rayCount,
+									  const dtQueryFilter* filter, const unsigned int options,
+									  dtRaycastHit* hits, dtStatus* rayStatus, dtPolyRef prevRef) const
+{
+	return raycastBatchT(startRef, startPos, endPos, rayCount, filter, options, hits, rayStatus, prevRef);
 }
 
 /// @par
@@ -2868,7 +3761,7 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 			
 			// Find edge and calc distance to the edge.
 			float va[3], vb[3];
-			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+			if (!getLinkPortalPoints(i, bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
 				continue;
 			
 			// If the circle is not touching the next polygon, skip it.
@@ -3049,7 +3942,7 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 			
 			// Find edge and calc distance to the edge.
 			float va[3], vb[3];
-			if (!getPortalPoints(bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+			if (!getLinkPortalPoints(i, bestRef, bestPoly, bestTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
 				continue;
 			
 			// If the poly is not touching the edge to the next polygon, skip the connection it.
@@ -3107,6 +4000,187 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 	return status;
 }
 
+/// @par
+///
+/// The cost of the path from source @p i to target @p j is stored at
+/// <tt>costs[i * targetCount + j]</tt>. It is measured like the cost of a #findPath
+/// result, through the edge midpoints of the polygons, from the source position
+/// to the target position. No corridors are extracted.
+///
+/// Each source runs one Dijkstra search over the whole navigation mesh, which stops
+/// as soon as every target has been settled. Targets that cannot be reached within
+/// the node pool are set to FLT_MAX and the status has #DT_OUT_OF_NODES set. When a
+/// component index is set, targets on other islands are set to FLT_MAX without
+/// searching for them.
+///
+/// The rows are independent, so the sources can be split across threads: give each
+/// thread its own query object (see dtNavMeshQueryPool) and let it compute a range of
+/// rows, passing the matching slices of @p sourceRefs, @p sourcePositions and @p costs.
+dtStatus dtNavMeshQuery::computeCostMatrix(const dtPolyRef* sourceRefs, const float* sourcePositions, const int sourceCount,
+										   const dtPolyRef* targetRefs, const float* targetPositions, const int targetCount,
+										   const dtQueryFilter* filter, float* costs) const
+{
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!sourceRefs || !sourcePositions || sourceCount < 0 ||
+		!targetRefs || !targetPositions || targetCount < 0 ||
+		!filter || !costs)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	for (int i = 0; i < sourceCount; ++i)
+	{
+		if (!m_nav->isValidPolyRef(sourceRefs[i]) || !dtVisfinite(&sourcePositions[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	for (int i = 0; i < targetCount; ++i)
+	{
+		if (!m_nav->isValidPolyRef(targetRefs[i]) || !dtVisfinite(&targetPositions[i*3]))
+			return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	dtStatus status = DT_SUCCESS;
+	for (int i = 0; i < sourceCount; ++i)
+	{
+		status |= computeCostRow(sourceRefs[i], &sourcePositions[i*3],
+								 targetRefs, targetPositions, targetCount,
+								 filter, &costs[i*targetCount]);
+	}
+
+	return status;
+}
+
+dtStatus dtNavMeshQuery::computeCostRow(dtPolyRef sourceRef, const float* sourcePos,
+										const dtPolyRef* targetRefs, const float* targetPositions, const int targetCount,
+										const dtQueryFilter* filter, float* costs) const
+{
+	// Targets on other islands are never settled, do not wait for them.
+	int remaining = 0;
+	for (int i = 0; i < targetCount; ++i)
+	{
+		costs[i] = FLT_MAX;
+		if (isReachable(sourceRef, targetRefs[i], filter))
+			remaining++;
+	}
+	if (!remaining)
+		return DT_SUCCESS;
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(sourceRef);
+	dtVcopy(startNode->pos, sourcePos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = sourceRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtStatus status = DT_SUCCESS;
+
+	while (!m_openList->empty())
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		// Get poly and tile.
+		// The API input has been cheked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		// Get parent poly and tile.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+		// Settle the targets on this polygon.
+		for (int i = 0; i < targetCount; ++i)
+		{
+			if (targetRefs[i] != bestRef)
+				continue;
+			costs[i] = bestNode->total + filter->getCost(bestNode->pos, &targetPositions[i*3],
+														 parentRef, parentTile, parentPoly,
+														 bestRef, bestTile, bestPoly,
+														 0, 0, 0);
+			remaining--;
+		}
+		if (!remaining)
+			break;
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			dtPolyRef neighbourRef = bestTile->links[i].ref;
+			// Skip invalid neighbours and do not follow back to parent.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			// Expand to neighbour
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+			// Do not advance if the polygon is excluded by the filter.
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+			{
+				status |= DT_OUT_OF_NODES;
+				continue;
+			}
+
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
+
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				getLinkMidPoint(i, bestRef, bestPoly, bestTile,
+								neighbourRef, neighbourPoly, neighbourTile,
+								neighbourNode->pos);
+			}
+
+			const float cost = filter->getCost(bestNode->pos, neighbourNode->pos,
+											   parentRef, parentTile, parentPoly,
+											   bestRef, bestTile, bestPoly,
+											   neighbourRef, neighbourTile, neighbourPoly);
+			const float total = bestNode->total + cost;
+
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+
+			neighbourNode->id = neighbourRef;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags = DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+	}
+
+	return status;
+}
+
 dtStatus dtNavMeshQuery::getPathFromDijkstraSearch(dtPolyRef endRef, dtPolyRef* path, int* pathCount, int maxPath) const
 {
 	if (!m_nav->isValidPolyRef(endRef) || !path || !pathCount || maxPath < 0)
@@ -3243,7 +4317,7 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 			
 			// Find edge and calc distance to the edge.
 			float va[3], vb[3];
-			if (!getPortalPoints(curRef, curPoly, curTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
+			if (!getLinkPortalPoints(i, curRef, curPoly, curTile, neighbourRef, neighbourPoly, neighbourTile, va, vb))
 				continue;
 			
 			// If the circle is not touching the next polygon, skip it.
@@ -3522,6 +4596,11 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 ///
 /// The normal will become unpredicable if @p hitDist is a very small number.
 ///
+/// With a wall distance field matching the filter, the search is skipped when the
+/// field proves there is no wall within the radius, and the search radius is
+/// limited to the distance bound of the field otherwise.
+///
+/// @see setWallDistanceField, dtWallDistanceField
 dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* centerPos, const float maxRadius,
 											const dtQueryFilter* filter,
 											float* hitDist, float* hitPos, float* hitNormal) const
@@ -3538,7 +4617,35 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 	{
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
-	
+
+	float minDist, maxDist;
+	if (m_walls && m_walls->matchesFilter(filter) &&
+		m_walls->getDistanceBounds(startRef, centerPos, &minDist, &maxDist))
+	{
+		// No wall within the radius.
+		if (minDist >= maxRadius)
+		{
+			*hitDist = maxRadius;
+			return DT_SUCCESS;
+		}
+		// The nearest wall is within the bound, search only up to it.
+		if (maxDist < maxRadius)
+		{
+			bool hit = false;
+			dtStatus status = findDistanceToWallInRadius(startRef, centerPos, maxDist, filter, hitDist, hitPos, hitNormal, &hit);
+			if (hit)
+				return status;
+		}
+	}
+
+	bool hit = false;
+	return findDistanceToWallInRadius(startRef, centerPos, maxRadius, filter, hitDist, hitPos, hitNormal, &hit);
+}
+
+dtStatus dtNavMeshQuery::findDistanceToWallInRadius(dtPolyRef startRef, const float* centerPos, const float maxRadius,
+													const dtQueryFilter* filter,
+													float* hitDist, float* hitPos, float* hitNormal, bool* hit) const
+{
 	m_nodePool->clear();
 	m_openList->clear();
 	
@@ -3624,6 +4731,7 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			
 			// Hit wall, update radius.
 			radiusSqr = distSqr;
+			*hit = true;
 			// Calculate hit pos.
 			hitPos[0] = vj[0] + (vi[0] - vj[0])*tseg;
 			hitPos[1] = vj[1] + (vi[1] - vj[1])*tseg;
@@ -3673,7 +4781,7 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			// Cost
 			if (neighbourNode->flags == 0)
 			{
-				getEdgeMidPoint(bestRef, bestPoly, bestTile,
+				getLinkMidPoint(i, bestRef, bestPoly, bestTile,
 								neighbourRef, neighbourPoly, neighbourTile, neighbourNode->pos);
 			}
 			
@@ -3723,6 +4831,22 @@ bool dtNavMeshQuery::isValidPolyRef(dtPolyRef ref, const dtQueryFilter* filter)
 	return true;
 }
 
+/// @par
+///
+/// Without a component index, or if the filter does not match any of its filter
+/// classes, the polygons are assumed to be reachable.
+///
+/// @see setComponentIndex, dtComponentIndex
+bool dtNavMeshQuery::isReachable(dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter) const
+{
+	if (!m_components)
+		return true;
+	const int filterClass = m_components->getFilterClass(filter);
+	if (filterClass < 0)
+		return true;
+	return m_components->isReachable(startRef, endRef, filterClass);
+}
+
 /// @par
 ///
 /// The closed list is the list of polygons that were fully evaluated during 
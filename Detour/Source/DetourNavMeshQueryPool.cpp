@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourNavMeshQueryPool.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourAssert.h"
+#include <new>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_InterlockedCompareExchange)
+inline bool dtAtomicCompareExchange(volatile long* value, const long expected, const long desired)
+{
+	return _InterlockedCompareExchange(value, desired, expected) == expected;
+}
+#else
+inline bool dtAtomicCompareExchange(volatile long* value, const long expected, const long desired)
+{
+	return __sync_bool_compare_and_swap(value, expected, desired);
+}
+#endif
+
+dtNavMeshQueryPool* dtAllocNavMeshQueryPool()
+{
+	void* mem = dtAlloc(sizeof(dtNavMeshQueryPool), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtNavMeshQueryPool;
+}
+
+void dtFreeNavMeshQueryPool(dtNavMeshQueryPool* pool)
+{
+	if (!pool) return;
+	pool->~dtNavMeshQueryPool();
+	dtFree(pool);
+}
+
+/// @class dtNavMeshQueryPool
+///
+/// A dtNavMeshQuery keeps its search state in its node pools and open list, even
+/// in the constant query methods, so a query object must only be used by one
+/// thread at a time. The pool owns a number of query objects and leases each one
+/// to a single caller at a time. Leasing and releasing are lock-free and can be
+/// called from any thread. Typically the pool has one query object per worker
+/// thread.
+///
+/// Any number of leased queries can run against the shared navigation mesh at
+/// the same time, as long as no thread modifies the mesh meanwhile. See the
+/// thread safety notes of dtNavMesh for the methods that modify the mesh.
+///
+/// A sliced path query keeps its state in the query object, so keep the query
+/// leased until the sliced query is finalized.
+///
+/// @see dtNavMeshQuery, dtNavMeshQueryLease, #dtAllocNavMeshQueryPool
+
+dtNavMeshQueryPool::dtNavMeshQueryPool() :
+	m_queries(0),
+	m_leased(0),
+	m_maxQueries(0)
+{
+}
+
+dtNavMeshQueryPool::~dtNavMeshQueryPool()
+{
+	purge();
+}
+
+void dtNavMeshQueryPool::purge()
+{
+	for (int i = 0; i < m_maxQueries; ++i)
+		dtFreeNavMeshQuery(m_queries[i]);
+	dtFree(m_queries);
+	m_queries = 0;
+	dtFree((void*)m_leased);
+	m_leased = 0;
+	m_maxQueries = 0;
+}
+
+/// @par
+///
+/// Must not be called while query objects are leased.
+dtStatus dtNavMeshQueryPool::init(const dtNavMesh* nav, const int maxQueries, const int maxNodes)
+{
+	if (!nav || maxQueries <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	m_queries = (dtNavMeshQuery**)dtAlloc(sizeof(dtNavMeshQuery*)*maxQueries, DT_ALLOC_PERM);
+	if (!m_queries)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_queries, 0, sizeof(dtNavMeshQuery*)*maxQueries);
+	m_leased = (volatile long*)dtAlloc(sizeof(long)*maxQueries, DT_ALLOC_PERM);
+	if (!m_leased)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset((void*)m_leased, 0, sizeof(long)*maxQueries);
+	m_maxQueries = maxQueries;
+
+	for (int i = 0; i < m_maxQueries; ++i)
+	{
+		m_queries[i] = dtAllocNavMeshQuery();
+		if (!m_queries[i])
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		dtStatus status = m_queries[i]->init(nav, maxNodes);
+		if (dtStatusFailed(status))
+			return status;
+	}
+
+	return DT_SUCCESS;
+}
+
+dtNavMeshQuery* dtNavMeshQueryPool::acquire()
+{
+	for (int i = 0; i < m_maxQueries; ++i)
+	{
+		if (m_leased[i] == 0 && dtAtomicCompareExchange(&m_leased[i], 0, 1))
+			return m_queries[i];
+	}
+	return 0;
+}
+
+void dtNavMeshQueryPool::release(dtNavMeshQuery* query)
+{
+	for (int i = 0; i < m_maxQueries; ++i)
+	{
+		if (m_queries[i] == query)
+		{
+			// The exchange is also a full barrier, so the query state is published before it is leased again.
+			const bool released = dtAtomicCompareExchange(&m_leased[i], 1, 0);
+			dtAssert(released);
+			dtIgnoreUnused(released);
+			return;
+		}
+	}
+	dtAssert(!"Query object does not belong to the pool");
+}
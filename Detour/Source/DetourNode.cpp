@@ -48,58 +48,121 @@ inline unsigned int dtHashRef(dtPolyRef a)
 #endif
 
 //////////////////////////////////////////////////////////////////////////////////////////
-dtNodePool::dtNodePool(int maxNodes, int hashSize) :
+dtNodePool::dtNodePool(int maxNodes, int hashSize, int maxSpillNodes) :
 	m_nodes(0),
-	m_first(0),
-	m_next(0),
+	m_spill(0),
+	m_slotRefs(0),
+	m_slotNodes(0),
 	m_maxNodes(maxNodes),
-	m_hashSize(hashSize),
-	m_nodeCount(0)
+	m_maxSpillNodes(maxSpillNodes),
+	m_hashSize(0),
+	m_nodeCount(0),
+	m_peakNodeCount(0),
+	m_spillChunkCount(0)
 {
-	dtAssert(dtNextPow2(m_hashSize) == (unsigned int)m_hashSize);
+	dtAssert(dtNextPow2(hashSize) == (unsigned int)hashSize);
 	// pidx is special as 0 means "none" and 1 is the first node. For that reason
 	// we have 1 fewer nodes available than the number of values it can contain.
-	dtAssert(m_maxNodes > 0 && m_maxNodes <= DT_NULL_IDX && m_maxNodes <= (1 << DT_NODE_PARENT_BITS) - 1);
+	dtAssert(m_maxNodes > 0 && m_maxSpillNodes >= 0 && m_maxNodes + m_maxSpillNodes <= DT_NULL_IDX &&
+			 m_maxNodes + m_maxSpillNodes <= (1 << DT_NODE_PARENT_BITS) - 1);
+
+	// Keep the table at most half full, so that probe sequences stay short.
+	m_hashSize = (int)dtMax(dtNextPow2((unsigned int)hashSize), dtNextPow2((unsigned int)m_maxNodes*2));
 
 	m_nodes = (dtNode*)dtAlloc(sizeof(dtNode)*m_maxNodes, DT_ALLOC_PERM);
-	m_next = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*m_maxNodes, DT_ALLOC_PERM);
-	m_first = (dtNodeIndex*)dtAlloc(sizeof(dtNodeIndex)*hashSize, DT_ALLOC_PERM);
+	m_slotRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_hashSize, DT_ALLOC_PERM);
+	m_slotNodes = (unsigned int*)dtAlloc(sizeof(unsigned int)*m_hashSize, DT_ALLOC_PERM);
 
 	dtAssert(m_nodes);
-	dtAssert(m_next);
-	dtAssert(m_first);
+	dtAssert(m_slotRefs);
+	dtAssert(m_slotNodes);
 
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
-	memset(m_next, 0xff, sizeof(dtNodeIndex)*m_maxNodes);
+	if (m_maxSpillNodes > 0)
+	{
+		const int maxChunks = (m_maxSpillNodes + DT_NODE_SPILL_CHUNK-1) / DT_NODE_SPILL_CHUNK;
+		m_spill = (dtNode**)dtAlloc(sizeof(dtNode*)*maxChunks, DT_ALLOC_PERM);
+		dtAssert(m_spill);
+	}
+
+	memset(m_slotNodes, 0xff, sizeof(unsigned int)*m_hashSize);
 }
 
 dtNodePool::~dtNodePool()
 {
+	for (int i = 0; i < m_spillChunkCount; ++i)
+		dtFree(m_spill[i]);
+	dtFree(m_spill);
 	dtFree(m_nodes);
-	dtFree(m_next);
-	dtFree(m_first);
+	dtFree(m_slotRefs);
+	dtFree(m_slotNodes);
 }
 
 void dtNodePool::clear()
 {
-	memset(m_first, 0xff, sizeof(dtNodeIndex)*m_hashSize);
+	m_peakNodeCount = dtMax(m_peakNodeCount, m_nodeCount);
+
+	if (m_nodeCount*8 < m_hashSize)
+	{
+		// Few nodes, empty their slots only. Going from the last node to the first keeps
+		// the probe sequence of each node intact until its slot is found, since a node only
+		// probes past the slots of the nodes added before it.
+		const unsigned int mask = (unsigned int)m_hashSize-1;
+		for (int i = m_nodeCount; i > 0; --i)
+		{
+			const dtNode* node = getNodeAtIdx((unsigned int)i);
+			const unsigned int value = (unsigned int)(i-1) | ((unsigned int)node->state << 16);
+			unsigned int slot = dtHashRef(node->id) & mask;
+			while (m_slotNodes[slot] != value)
+				slot = (slot+1) & mask;
+			m_slotNodes[slot] = DT_NODE_SLOT_EMPTY;
+		}
+	}
+	else
+	{
+		memset(m_slotNodes, 0xff, sizeof(unsigned int)*m_hashSize);
+	}
+
 	m_nodeCount = 0;
 }
 
+int dtNodePool::getMemUsed() const
+{
+	int mem = sizeof(*this) +
+		sizeof(dtNode)*m_maxNodes +
+		(sizeof(dtPolyRef) + sizeof(unsigned int))*m_hashSize;
+	if (m_spill)
+	{
+		mem += sizeof(dtNode*)*((m_maxSpillNodes + DT_NODE_SPILL_CHUNK-1) / DT_NODE_SPILL_CHUNK);
+		mem += sizeof(dtNode)*DT_NODE_SPILL_CHUNK*m_spillChunkCount;
+	}
+	return mem;
+}
+
+unsigned int dtNodePool::getSpillNodeIdx(const dtNode* node) const
+{
+	for (int i = 0; i < m_spillChunkCount; ++i)
+	{
+		if (node >= m_spill[i] && node < m_spill[i] + DT_NODE_SPILL_CHUNK)
+			return (unsigned int)(m_maxNodes + i*DT_NODE_SPILL_CHUNK + (node - m_spill[i])) + 1;
+	}
+	dtAssert(false);
+	return 0;
+}
+
 unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNodes)
 {
 	int n = 0;
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)m_hashSize-1;
+	unsigned int slot = dtHashRef(id) & mask;
+	while (m_slotNodes[slot] != DT_NODE_SLOT_EMPTY)
 	{
-		if (m_nodes[i].id == id)
+		if (m_slotRefs[slot] == id)
 		{
 			if (n >= maxNodes)
 				return n;
-			nodes[n++] = &m_nodes[i];
+			nodes[n++] = getNodeAtIdx((m_slotNodes[slot] & 0xffff) + 1);
 		}
-		i = m_next[i];
+		slot = (slot+1) & mask;
 	}
 
 	return n;
@@ -107,37 +170,41 @@ unsigned int dtNodePool::findNodes(dtPolyRef id, dtNode** nodes, const int maxNo
 
 dtNode* dtNodePool::findNode(dtPolyRef id, unsigned char state)
 {
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)m_hashSize-1;
+	unsigned int slot = dtHashRef(id) & mask;
+	while (m_slotNodes[slot] != DT_NODE_SLOT_EMPTY)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state)
-			return &m_nodes[i];
-		i = m_next[i];
+		if (m_slotRefs[slot] == id && (m_slotNodes[slot] >> 16) == state)
+			return getNodeAtIdx((m_slotNodes[slot] & 0xffff) + 1);
+		slot = (slot+1) & mask;
 	}
 	return 0;
 }
 
 dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 {
-	unsigned int bucket = dtHashRef(id) & (m_hashSize-1);
-	dtNodeIndex i = m_first[bucket];
-	dtNode* node = 0;
-	while (i != DT_NULL_IDX)
+	const unsigned int mask = (unsigned int)m_hashSize-1;
+	unsigned int slot = dtHashRef(id) & mask;
+	while (m_slotNodes[slot] != DT_NODE_SLOT_EMPTY)
 	{
-		if (m_nodes[i].id == id && m_nodes[i].state == state)
-			return &m_nodes[i];
-		i = m_next[i];
+		if (m_slotRefs[slot] == id && (m_slotNodes[slot] >> 16) == state)
+			return getNodeAtIdx((m_slotNodes[slot] & 0xffff) + 1);
+		slot = (slot+1) & mask;
 	}
-	
-	if (m_nodeCount >= m_maxNodes)
+
+	// Keep the table at most half full when spilling.
+	if ((m_nodeCount+1)*2 > m_hashSize)
+	{
+		if (!growTable())
+			return 0;
+		return getNode(id, state);
+	}
+
+	dtNode* node = allocNode();
+	if (!node)
 		return 0;
 	
-	i = (dtNodeIndex)m_nodeCount;
-	m_nodeCount++;
-	
 	// Init node
-	node = &m_nodes[i];
 	node->pidx = 0;
 	node->cost = 0;
 	node->total = 0;
@@ -145,15 +212,73 @@ dtNode* dtNodePool::getNode(dtPolyRef id, unsigned char state)
 	node->state = state;
 	node->flags = 0;
 	
-	m_next[i] = m_first[bucket];
-	m_first[bucket] = i;
+	m_slotRefs[slot] = id;
+	m_slotNodes[slot] = (unsigned int)(m_nodeCount-1) | ((unsigned int)state << 16);
 	
 	return node;
 }
 
+dtNode* dtNodePool::allocNode()
+{
+	if (m_nodeCount < m_maxNodes)
+		return &m_nodes[m_nodeCount++];
+
+	const int spillIdx = m_nodeCount - m_maxNodes;
+	if (spillIdx >= m_maxSpillNodes)
+		return 0;
+
+	const int chunk = spillIdx / DT_NODE_SPILL_CHUNK;
+	if (chunk >= m_spillChunkCount)
+	{
+		m_spill[chunk] = (dtNode*)dtAlloc(sizeof(dtNode)*DT_NODE_SPILL_CHUNK, DT_ALLOC_PERM);
+		if (!m_spill[chunk])
+			return 0;
+		m_spillChunkCount++;
+	}
+
+	m_nodeCount++;
+	return &m_spill[chunk][spillIdx % DT_NODE_SPILL_CHUNK];
+}
+
+bool dtNodePool::growTable()
+{
+	if (m_nodeCount >= m_maxNodes + m_maxSpillNodes)
+		return false;
+
+	const int hashSize = m_hashSize*2;
+	dtPolyRef* slotRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*hashSize, DT_ALLOC_PERM);
+	unsigned int* slotNodes = (unsigned int*)dtAlloc(sizeof(unsigned int)*hashSize, DT_ALLOC_PERM);
+	if (!slotRefs || !slotNodes)
+	{
+		dtFree(slotRefs);
+		dtFree(slotNodes);
+		return false;
+	}
+	memset(slotNodes, 0xff, sizeof(unsigned int)*hashSize);
+
+	// Reinsert in node order, which keeps clear() able to walk the probe sequences backwards.
+	const unsigned int mask = (unsigned int)hashSize-1;
+	for (int i = 0; i < m_nodeCount; ++i)
+	{
+		const dtNode* node = getNodeAtIdx((unsigned int)i+1);
+		unsigned int slot = dtHashRef(node->id) & mask;
+		while (slotNodes[slot] != DT_NODE_SLOT_EMPTY)
+			slot = (slot+1) & mask;
+		slotRefs[slot] = node->id;
+		slotNodes[slot] = (unsigned int)i | ((unsigned int)node->state << 16);
+	}
+
+	dtFree(m_slotRefs);
+	dtFree(m_slotNodes);
+	m_slotRefs = slotRefs;
+	m_slotNodes = slotNodes;
+	m_hashSize = hashSize;
+	return true;
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
-dtNodeQueue::dtNodeQueue(int n) :
+dtBinaryNodeQueue::dtBinaryNodeQueue(int n) :
 	m_heap(0),
 	m_capacity(n),
 	m_size(0)
@@ -164,12 +289,12 @@ dtNodeQueue::dtNodeQueue(int n) :
 	dtAssert(m_heap);
 }
 
-dtNodeQueue::~dtNodeQueue()
+dtBinaryNodeQueue::~dtBinaryNodeQueue()
 {
 	dtFree(m_heap);
 }
 
-void dtNodeQueue::bubbleUp(int i, dtNode* node)
+void dtBinaryNodeQueue::bubbleUp(int i, dtNode* node)
 {
 	int parent = (i-1)/2;
 	// note: (index > 0) means there is a parent
@@ -182,7 +307,7 @@ void dtNodeQueue::bubbleUp(int i, dtNode* node)
 	m_heap[i] = node;
 }
 
-void dtNodeQueue::trickleDown(int i, dtNode* node)
+void dtBinaryNodeQueue::trickleDown(int i, dtNode* node)
 {
 	int child = (i*2)+1;
 	while (child < m_size)
@@ -198,3 +323,55 @@ void dtNodeQueue::trickleDown(int i, dtNode* node)
 	}
 	bubbleUp(i, node);
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////
+dtDaryNodeQueue::dtDaryNodeQueue(int n) :
+	m_heap(0),
+	m_capacity(n),
+	m_size(0)
+{
+	dtAssert(m_capacity > 0);
+
+	m_heap = (dtItem*)dtAlloc(sizeof(dtItem)*(m_capacity+1), DT_ALLOC_PERM);
+	dtAssert(m_heap);
+}
+
+dtDaryNodeQueue::~dtDaryNodeQueue()
+{
+	dtFree(m_heap);
+}
+
+void dtDaryNodeQueue::bubbleUp(int i, dtItem item)
+{
+	while (i > 0)
+	{
+		const int parent = (i-1)/4;
+		if (m_heap[parent].total <= item.total)
+			break;
+		m_heap[i] = m_heap[parent];
+		i = parent;
+	}
+	m_heap[i] = item;
+}
+
+void dtDaryNodeQueue::trickleDown(int i, dtItem item)
+{
+	for (;;)
+	{
+		const int first = i*4+1;
+		if (first >= m_size)
+			break;
+		const int last = dtMin(first+4, m_size);
+		int best = first;
+		for (int c = first+1; c < last; ++c)
+		{
+			if (m_heap[c].total < m_heap[best].total)
+				best = c;
+		}
+		if (m_heap[best].total >= item.total)
+			break;
+		m_heap[i] = m_heap[best];
+		i = best;
+	}
+	m_heap[i] = item;
+}
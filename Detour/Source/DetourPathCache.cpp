@@ -0,0 +1,328 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourPathCache.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+static const int DT_PATHCACHE_NULL = -1;
+
+// FNV-1a over the bytes of a value.
+inline unsigned int dtHashBytes(unsigned int h, const void* data, const int size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	for (int i = 0; i < size; ++i)
+	{
+		h ^= p[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/// @par
+///
+/// With #DT_VIRTUAL_QUERYFILTER defined, a derived filter may pass and cost
+/// polygons on other data too. Pass a hash covering that data to dtPathCache::find
+/// and dtPathCache::store instead.
+unsigned int dtHashQueryFilter(const dtQueryFilter* filter)
+{
+	unsigned int h = 2166136261u;
+	const unsigned short include = filter->getIncludeFlags();
+	const unsigned short exclude = filter->getExcludeFlags();
+	h = dtHashBytes(h, &include, sizeof(include));
+	h = dtHashBytes(h, &exclude, sizeof(exclude));
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+	{
+		const float cost = filter->getAreaCost(i);
+		h = dtHashBytes(h, &cost, sizeof(cost));
+	}
+	return h;
+}
+
+dtPathCache* dtAllocPathCache()
+{
+	void* mem = dtAlloc(sizeof(dtPathCache), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtPathCache;
+}
+
+void dtFreePathCache(dtPathCache* cache)
+{
+	if (!cache) return;
+	cache->~dtPathCache();
+	dtFree(cache);
+}
+
+/// @class dtPathCache
+///
+/// The cache maps a start polygon, an end polygon and a filter hash to the polygon
+/// corridor found for them. The start and end positions are not part of the key;
+/// a cached corridor is returned for any positions within the two polygons.
+///
+/// Polygon references contain the salt of their tile, which changes whenever the
+/// tile is removed, e.g. when a dtTileCache rebuilds it. Every lookup validates the
+/// references of the cached corridor, and a corridor crossing a removed or rebuilt
+/// tile is dropped instead of returned. Changes that do not touch the corridor are
+/// not detected: a tile added elsewhere may open a shorter route, and changed polygon
+/// flags are not seen. Call clear() after such changes if this matters.
+///
+/// Only complete paths are cached.
+///
+/// The cache is not thread safe. Use one cache per thread, or guard it with a lock.
+///
+/// @see dtNavMeshQuery::findPath, #dtAllocPathCache
+
+dtPathCache::dtPathCache() :
+	m_entries(0),
+	m_paths(0),
+	m_buckets(0),
+	m_maxEntries(0),
+	m_maxPathLength(0),
+	m_bucketMask(0),
+	m_entryCount(0),
+	m_head(DT_PATHCACHE_NULL),
+	m_tail(DT_PATHCACHE_NULL),
+	m_free(DT_PATHCACHE_NULL),
+	m_hits(0),
+	m_misses(0)
+{
+}
+
+dtPathCache::~dtPathCache()
+{
+	purge();
+}
+
+void dtPathCache::purge()
+{
+	dtFree(m_entries);
+	m_entries = 0;
+	dtFree(m_paths);
+	m_paths = 0;
+	dtFree(m_buckets);
+	m_buckets = 0;
+	m_maxEntries = 0;
+	m_maxPathLength = 0;
+	m_bucketMask = 0;
+	m_entryCount = 0;
+	m_head = m_tail = m_free = DT_PATHCACHE_NULL;
+}
+
+dtStatus dtPathCache::init(const int maxEntries, const int maxPathLength)
+{
+	if (maxEntries <= 0 || maxPathLength <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	const int bucketCount = (int)dtNextPow2((unsigned int)maxEntries);
+	m_entries = (dtPathCacheEntry*)dtAlloc(sizeof(dtPathCacheEntry)*maxEntries, DT_ALLOC_PERM);
+	m_paths = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*maxEntries*maxPathLength, DT_ALLOC_PERM);
+	m_buckets = (int*)dtAlloc(sizeof(int)*bucketCount, DT_ALLOC_PERM);
+	if (!m_entries || !m_paths || !m_buckets)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	m_maxEntries = maxEntries;
+	m_maxPathLength = maxPathLength;
+	m_bucketMask = bucketCount - 1;
+	clear();
+
+	return DT_SUCCESS;
+}
+
+void dtPathCache::clear()
+{
+	for (int i = 0; i <= m_bucketMask && m_buckets; ++i)
+		m_buckets[i] = DT_PATHCACHE_NULL;
+	m_free = DT_PATHCACHE_NULL;
+	for (int i = m_maxEntries-1; i >= 0; --i)
+	{
+		m_entries[i].next = m_free;
+		m_free = i;
+	}
+	m_head = m_tail = DT_PATHCACHE_NULL;
+	m_entryCount = 0;
+	m_hits = 0;
+	m_misses = 0;
+}
+
+unsigned int dtPathCache::hashKey(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const
+{
+	unsigned int h = 2166136261u;
+	h = dtHashBytes(h, &startRef, sizeof(startRef));
+	h = dtHashBytes(h, &endRef, sizeof(endRef));
+	h = dtHashBytes(h, &filterHash, sizeof(filterHash));
+	return h & (unsigned int)m_bucketMask;
+}
+
+int dtPathCache::findEntry(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const
+{
+	int i = m_buckets[hashKey(startRef, endRef, filterHash)];
+	while (i != DT_PATHCACHE_NULL)
+	{
+		const dtPathCacheEntry& e = m_entries[i];
+		if (e.startRef == startRef && e.endRef == endRef && e.filterHash == filterHash)
+			return i;
+		i = e.hashNext;
+	}
+	return DT_PATHCACHE_NULL;
+}
+
+void dtPathCache::unlinkEntry(const int idx)
+{
+	dtPathCacheEntry& e = m_entries[idx];
+	if (e.prev != DT_PATHCACHE_NULL)
+		m_entries[e.prev].next = e.next;
+	else
+		m_head = e.next;
+	if (e.next != DT_PATHCACHE_NULL)
+		m_entries[e.next].prev = e.prev;
+	else
+		m_tail = e.prev;
+}
+
+void dtPathCache::linkFront(const int idx)
+{
+	dtPathCacheEntry& e = m_entries[idx];
+	e.prev = DT_PATHCACHE_NULL;
+	e.next = m_head;
+	if (m_head != DT_PATHCACHE_NULL)
+		m_entries[m_head].prev = idx;
+	m_head = idx;
+	if (m_tail == DT_PATHCACHE_NULL)
+		m_tail = idx;
+}
+
+void dtPathCache::removeEntry(const int idx)
+{
+	dtPathCacheEntry& e = m_entries[idx];
+
+	// Remove from the hash bucket.
+	int* link = &m_buckets[hashKey(e.startRef, e.endRef, e.filterHash)];
+	while (*link != idx)
+		link = &m_entries[*link].hashNext;
+	*link = e.hashNext;
+
+	unlinkEntry(idx);
+
+	e.next = m_free;
+	m_free = idx;
+	m_entryCount--;
+}
+
+bool dtPathCache::find(const dtNavMesh* nav, dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash,
+					   dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	if (!m_entries || !nav || !path || !pathCount)
+		return false;
+
+	const int idx = findEntry(startRef, endRef, filterHash);
+	if (idx == DT_PATHCACHE_NULL || m_entries[idx].pathCount > maxPath)
+	{
+		m_misses++;
+		return false;
+	}
+
+	// A polygon reference is invalid once the salt of its tile changed.
+	const dtPathCacheEntry& e = m_entries[idx];
+	const dtPolyRef* cached = &m_paths[idx*m_maxPathLength];
+	for (int i = 0; i < e.pathCount; ++i)
+	{
+		if (!nav->isValidPolyRef(cached[i]))
+		{
+			removeEntry(idx);
+			m_misses++;
+			return false;
+		}
+	}
+
+	memcpy(path, cached, sizeof(dtPolyRef)*e.pathCount);
+	*pathCount = e.pathCount;
+
+	unlinkEntry(idx);
+	linkFront(idx);
+	m_hits++;
+
+	return true;
+}
+
+void dtPathCache::store(const unsigned int filterHash, const dtPolyRef* path, const int pathCount)
+{
+	if (!m_entries || !path || pathCount <= 0 || pathCount > m_maxPathLength)
+		return;
+
+	const dtPolyRef startRef = path[0];
+	const dtPolyRef endRef = path[pathCount-1];
+
+	int idx = findEntry(startRef, endRef, filterHash);
+	if (idx != DT_PATHCACHE_NULL)
+	{
+		unlinkEntry(idx);
+	}
+	else
+	{
+		if (m_free == DT_PATHCACHE_NULL)
+			removeEntry(m_tail);
+		idx = m_free;
+		m_free = m_entries[idx].next;
+		m_entryCount++;
+
+		dtPathCacheEntry& e = m_entries[idx];
+		e.startRef = startRef;
+		e.endRef = endRef;
+		e.filterHash = filterHash;
+		const unsigned int bucket = hashKey(startRef, endRef, filterHash);
+		e.hashNext = m_buckets[bucket];
+		m_buckets[bucket] = idx;
+	}
+
+	m_entries[idx].pathCount = pathCount;
+	memcpy(&m_paths[idx*m_maxPathLength], path, sizeof(dtPolyRef)*pathCount);
+	linkFront(idx);
+}
+
+dtStatus dtPathCache::findPath(const dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+							   const float* startPos, const float* endPos,
+							   const dtQueryFilter* filter,
+							   dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	if (!query || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const unsigned int filterHash = dtHashQueryFilter(filter);
+	if (find(query->getAttachedNavMesh(), startRef, endRef, filterHash, path, pathCount, maxPath))
+		return DT_SUCCESS;
+
+	const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+	if (dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT) &&
+		*pathCount > 0 && path[*pathCount-1] == endRef)
+	{
+		store(filterHash, path, *pathCount);
+	}
+
+	return status;
+}
+
+int dtPathCache::getMemUsed() const
+{
+	return (int)(sizeof(*this) + sizeof(dtPathCacheEntry)*m_maxEntries +
+				 sizeof(dtPolyRef)*m_maxEntries*m_maxPathLength + sizeof(int)*(m_bucketMask+1));
+}
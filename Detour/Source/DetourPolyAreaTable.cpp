@@ -0,0 +1,307 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <string.h>
+#include "DetourPolyAreaTable.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+// Finds the entry a random number maps to in a cumulative table, skipping entries with no area.
+// Returns -1 if the table is empty.
+static int dtFindCumulative(const float* cdf, const int n, const float u)
+{
+	if (n <= 0 || cdf[n-1] <= 0.0f)
+		return -1;
+	const float total = cdf[n-1];
+	const float target = u*total;
+	int lo = 0, hi = n-1;
+	while (lo < hi)
+	{
+		const int mid = (lo+hi)/2;
+		if (cdf[mid] > target)
+			hi = mid;
+		else
+			lo = mid+1;
+	}
+	if (cdf[lo] > target)
+		return lo;
+	// Rounding pushed the target to the total, take the last entry with area.
+	lo = 0;
+	hi = n-1;
+	while (lo < hi)
+	{
+		const int mid = (lo+hi)/2;
+		if (cdf[mid] >= total)
+			hi = mid;
+		else
+			lo = mid+1;
+	}
+	return lo;
+}
+
+dtPolyAreaTable* dtAllocPolyAreaTable()
+{
+	void* mem = dtAlloc(sizeof(dtPolyAreaTable), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtPolyAreaTable;
+}
+
+void dtFreePolyAreaTable(dtPolyAreaTable* table)
+{
+	if (!table) return;
+	table->~dtPolyAreaTable();
+	dtFree(table);
+}
+
+/// @class dtPolyAreaTable
+///
+/// Each tile keeps the running sum of the areas of its ground polygons that pass
+/// the filter, and the table keeps the running sum of the tile areas over the tile
+/// indices. Picking a polygon weighted by area is then a binary search over the
+/// tiles followed by a binary search over the polygons of the tile. When a tile is
+/// added or removed only that tile is summed again, the tile prefix is rebuilt in
+/// time linear to the maximum number of tiles.
+///
+/// The filter pointer is stored and must stay valid for the lifetime of the table.
+/// Changing polygon flags does not notify the table; call rebuildTile() for the
+/// tiles affected.
+///
+/// Assign the table to a query with dtNavMeshQuery::setPolyAreaTable() to speed up
+/// dtNavMeshQuery::findRandomPoint() and dtNavMeshQuery::sampleRandomPointAroundCircle().
+///
+/// @see dtNavMeshQuery, #dtAllocPolyAreaTable
+
+dtPolyAreaTable::dtPolyAreaTable() :
+	m_nav(0),
+	m_filter(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_tileCdf(0)
+{
+}
+
+dtPolyAreaTable::~dtPolyAreaTable()
+{
+	purge();
+}
+
+void dtPolyAreaTable::purge()
+{
+	if (m_nav)
+		m_nav->removeTileListener(this);
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(i);
+	dtFree(m_tiles);
+	m_tiles = 0;
+	dtFree(m_tileCdf);
+	m_tileCdf = 0;
+	m_maxTiles = 0;
+	m_filter = 0;
+	m_nav = 0;
+}
+
+dtStatus dtPolyAreaTable::init(dtNavMesh* nav, const dtQueryFilter* filter)
+{
+	if (!nav || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtAreaTile*)dtAlloc(sizeof(dtAreaTile)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtAreaTile)*m_maxTiles);
+	m_tileCdf = (float*)dtAlloc(sizeof(float)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tileCdf)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tileCdf, 0, sizeof(float)*m_maxTiles);
+
+	m_nav = nav;
+	m_filter = filter;
+
+	dtStatus status = m_nav->addTileListener(this);
+	if (dtStatusFailed(status))
+	{
+		m_nav = 0;
+		return status;
+	}
+
+	const dtNavMesh* cnav = m_nav;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (tile->header && !buildTile(tile))
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	rebuildPrefix();
+
+	return DT_SUCCESS;
+}
+
+bool dtPolyAreaTable::matchesFilter(const dtQueryFilter* filter) const
+{
+	return dtEquivalentFilters(m_filter, filter);
+}
+
+int dtPolyAreaTable::getTileIndex(const dtMeshTile* tile) const
+{
+	if (!m_nav || !tile || !tile->header)
+		return -1;
+	const int tileIndex = (int)m_nav->decodePolyIdTile(m_nav->getTileRef(tile));
+	if (tileIndex >= m_maxTiles || m_tiles[tileIndex].salt != tile->salt)
+		return -1;
+	return tileIndex;
+}
+
+void dtPolyAreaTable::freeTile(const int tileIndex)
+{
+	dtAreaTile& at = m_tiles[tileIndex];
+	dtFree(at.cdf);
+	memset(&at, 0, sizeof(dtAreaTile));
+}
+
+bool dtPolyAreaTable::buildTile(const dtMeshTile* tile)
+{
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	const int tileIndex = (int)m_nav->decodePolyIdTile(base);
+	const int polyCount = tile->header->polyCount;
+
+	freeTile(tileIndex);
+	if (!polyCount)
+		return true;
+
+	dtAreaTile& at = m_tiles[tileIndex];
+	at.cdf = (float*)dtAlloc(sizeof(float)*polyCount, DT_ALLOC_PERM);
+	if (!at.cdf)
+		return false;
+	at.salt = tile->salt;
+	at.polyCount = polyCount;
+
+	float sum = 0.0f;
+	for (int i = 0; i < polyCount; ++i)
+	{
+		const dtPoly* p = &tile->polys[i];
+		// Off-mesh connections and filtered polygons get no area.
+		if (p->getType() == DT_POLYTYPE_GROUND && m_filter->passFilter(base | (dtPolyRef)i, tile, p))
+		{
+			// dtTriArea2D returns twice the triangle area.
+			float polyArea = 0.0f;
+			for (int j = 2; j < p->vertCount; ++j)
+			{
+				const float* va = &tile->verts[p->verts[0]*3];
+				const float* vb = &tile->verts[p->verts[j-1]*3];
+				const float* vc = &tile->verts[p->verts[j]*3];
+				polyArea += dtTriArea2D(va,vb,vc);
+			}
+			sum += polyArea*0.5f;
+		}
+		at.cdf[i] = sum;
+	}
+
+	return true;
+}
+
+void dtPolyAreaTable::rebuildPrefix()
+{
+	float sum = 0.0f;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtAreaTile& at = m_tiles[i];
+		if (at.cdf)
+			sum += at.cdf[at.polyCount-1];
+		m_tileCdf[i] = sum;
+	}
+}
+
+void dtPolyAreaTable::rebuildTile(const dtMeshTile* tile)
+{
+	if (!m_tiles || !tile || !tile->header)
+		return;
+	buildTile(tile);
+	rebuildPrefix();
+}
+
+void dtPolyAreaTable::tileAdded(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	buildTile(tile);
+	rebuildPrefix();
+}
+
+void dtPolyAreaTable::tileRemoved(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	freeTile((int)m_nav->decodePolyIdTile(m_nav->getTileRef(tile)));
+	rebuildPrefix();
+}
+
+float dtPolyAreaTable::getTotalArea() const
+{
+	if (!m_maxTiles)
+		return 0.0f;
+	return m_tileCdf[m_maxTiles-1];
+}
+
+float dtPolyAreaTable::getTileArea(const dtMeshTile* tile) const
+{
+	const int tileIndex = getTileIndex(tile);
+	if (tileIndex < 0 || !m_tiles[tileIndex].cdf)
+		return 0.0f;
+	const dtAreaTile& at = m_tiles[tileIndex];
+	return at.cdf[at.polyCount-1];
+}
+
+dtPolyRef dtPolyAreaTable::samplePoly(const float u) const
+{
+	const int tileIndex = dtFindCumulative(m_tileCdf, m_maxTiles, u);
+	if (tileIndex < 0)
+		return 0;
+
+	// Map the random number into the range of the picked tile to pick the polygon.
+	const float tileMin = tileIndex > 0 ? m_tileCdf[tileIndex-1] : 0.0f;
+	const float tileArea = m_tileCdf[tileIndex] - tileMin;
+	const float v = dtClamp((u*m_tileCdf[m_maxTiles-1] - tileMin) / tileArea, 0.0f, 1.0f);
+
+	const dtAreaTile& at = m_tiles[tileIndex];
+	const int polyIndex = dtFindCumulative(at.cdf, at.polyCount, v);
+	if (polyIndex < 0)
+		return 0;
+	return m_nav->encodePolyId(at.salt, (unsigned int)tileIndex, (unsigned int)polyIndex);
+}
+
+dtPolyRef dtPolyAreaTable::samplePolyInTile(const dtMeshTile* tile, const float u) const
+{
+	const int tileIndex = getTileIndex(tile);
+	if (tileIndex < 0)
+		return 0;
+	const dtAreaTile& at = m_tiles[tileIndex];
+	const int polyIndex = dtFindCumulative(at.cdf, at.polyCount, u);
+	if (polyIndex < 0)
+		return 0;
+	return m_nav->encodePolyId(at.salt, (unsigned int)tileIndex, (unsigned int)polyIndex);
+}
+
+int dtPolyAreaTable::getMemUsed() const
+{
+	int mem = sizeof(*this) + (sizeof(dtAreaTile) + sizeof(float))*m_maxTiles;
+	for (int i = 0; i < m_maxTiles; ++i)
+		mem += sizeof(float)*m_tiles[i].polyCount;
+	return mem;
+}
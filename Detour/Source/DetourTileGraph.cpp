@@ -0,0 +1,914 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <float.h>
+#include <string.h>
+#include "DetourTileGraph.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+static const float H_SCALE = 0.999f; // Search heuristic scale.
+
+// Node id of the abstract goal. Entrance ids always have a non-zero tile part, see encodeEntrance().
+static const dtPolyRef DT_TILEGRAPH_GOAL = 1;
+
+inline dtPolyRef encodeEntrance(const int tileIndex, const int entrance)
+{
+	return ((dtPolyRef)(tileIndex+1) << 8) | (dtPolyRef)entrance;
+}
+
+inline void decodeEntrance(const dtPolyRef id, int& tileIndex, int& entrance)
+{
+	tileIndex = (int)(id >> 8) - 1;
+	entrance = (int)(id & 0xff);
+}
+
+// Returns the portal segment of a link the same way dtNavMeshQuery::getPortalPoints() does.
+static void getLinkPortal(const dtNavMesh* nav, const dtMeshTile* tile, const dtPoly* poly, const dtLink* link,
+						  float* left, float* right)
+{
+	if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		const float* v = &tile->verts[poly->verts[link->edge]*3];
+		dtVcopy(left, v);
+		dtVcopy(right, v);
+		return;
+	}
+
+	const dtMeshTile* neiTile = 0;
+	const dtPoly* neiPoly = 0;
+	nav->getTileAndPolyByRefUnsafe(link->ref, &neiTile, &neiPoly);
+	if (neiPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		// The off-mesh connection end point is stored on the link back to this polygon.
+		const dtPolyRef ref = nav->getPolyRefBase(tile) | (dtPolyRef)(poly - tile->polys);
+		for (unsigned int i = neiPoly->firstLink; i != DT_NULL_LINK; i = neiTile->links[i].next)
+		{
+			if (neiTile->links[i].ref == ref)
+			{
+				const float* v = &neiTile->verts[neiPoly->verts[neiTile->links[i].edge]*3];
+				dtVcopy(left, v);
+				dtVcopy(right, v);
+				return;
+			}
+		}
+	}
+
+	const float* va = &tile->verts[poly->verts[link->edge]*3];
+	const float* vb = &tile->verts[poly->verts[(link->edge+1) % (int)poly->vertCount]*3];
+	if (link->side != 0xff && (link->bmin != 0 || link->bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		dtVlerp(left, va, vb, link->bmin*s);
+		dtVlerp(right, va, vb, link->bmax*s);
+	}
+	else
+	{
+		dtVcopy(left, va);
+		dtVcopy(right, vb);
+	}
+}
+
+dtTileGraph* dtAllocTileGraph()
+{
+	void* mem = dtAlloc(sizeof(dtTileGraph), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtTileGraph;
+}
+
+void dtFreeTileGraph(dtTileGraph* graph)
+{
+	if (!graph) return;
+	graph->~dtTileGraph();
+	dtFree(graph);
+}
+
+/// @class dtTileGraph
+///
+/// The graph has one node per tile entrance. An entrance is a run of contiguous
+/// portals that lead from a tile to the same neighbour tile, represented by the
+/// portal closest to the middle of the run. Entrances of the same tile are connected
+/// by the costs found by a Dijkstra search limited to the tile, and entrances facing
+/// each other across a tile border are connected directly: an entrance crosses to the
+/// entrance of the neighbour tile whose run contains the polygon the representative
+/// portal leads to.
+///
+/// The graph registers itself as a tile listener, so tiles added or removed after
+/// init(), e.g. by a dtTileCache rebuilding obstacles, update the changed tile and its
+/// neighbours. The navigation mesh keeps a pointer to the graph until the graph is
+/// destroyed, so free the graph before the navigation mesh. Changing polygon flags or areas does not notify the graph; call
+/// rebuildTile() for the tiles affected.
+///
+/// The precomputed costs depend on the filter passed to init(). The filter pointer
+/// is stored and must stay valid for the lifetime of the graph.
+///
+/// Paths found through the graph are not guaranteed to be optimal, they are usually
+/// within a few percent of the cost of a flat search.
+///
+/// @see dtNavMeshQuery, #dtAllocTileGraph
+
+dtTileGraph::dtTileGraph() :
+	m_nav(0),
+	m_filter(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_startCosts(0),
+	m_endCosts(0),
+	m_nodePool(0),
+	m_openList(0)
+{
+}
+
+dtTileGraph::~dtTileGraph()
+{
+	purge();
+}
+
+void dtTileGraph::purge()
+{
+	if (m_nav)
+		m_nav->removeTileListener(this);
+	for (int i = 0; i < m_maxTiles; ++i)
+		clearTile(i);
+	dtFree(m_tiles);
+	m_tiles = 0;
+	m_maxTiles = 0;
+	dtFree(m_startCosts);
+	m_startCosts = 0;
+	dtFree(m_endCosts);
+	m_endCosts = 0;
+	if (m_nodePool)
+		m_nodePool->~dtNodePool();
+	dtFree(m_nodePool);
+	m_nodePool = 0;
+	if (m_openList)
+		m_openList->~dtNodeQueue();
+	dtFree(m_openList);
+	m_openList = 0;
+	m_nav = 0;
+	m_filter = 0;
+}
+
+/// @par
+///
+/// The node pool is used both for the searches within a tile and for the search over
+/// the abstract graph, so @p maxNodes should be at least the maximum number of polygons
+/// per tile.
+dtStatus dtTileGraph::init(dtNavMesh* nav, const dtQueryFilter* filter, const int maxNodes)
+{
+	if (!nav || !filter || maxNodes <= 0 || maxNodes > DT_NULL_IDX || maxNodes > (1 << DT_NODE_PARENT_BITS) - 1)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtGraphTile*)dtAlloc(sizeof(dtGraphTile)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtGraphTile)*m_maxTiles);
+
+	m_startCosts = (float*)dtAlloc(sizeof(float)*DT_TILEGRAPH_MAX_ENTRANCES, DT_ALLOC_PERM);
+	m_endCosts = (float*)dtAlloc(sizeof(float)*DT_TILEGRAPH_MAX_ENTRANCES, DT_ALLOC_PERM);
+	if (!m_startCosts || !m_endCosts)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	m_nodePool = new (dtAlloc(sizeof(dtNodePool), DT_ALLOC_PERM)) dtNodePool(maxNodes, dtNextPow2(maxNodes/4));
+	if (!m_nodePool)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_openList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(maxNodes);
+	if (!m_openList)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	m_nav = nav;
+	m_filter = filter;
+
+	dtStatus status = m_nav->addTileListener(this);
+	if (dtStatusFailed(status))
+	{
+		m_nav = 0;
+		return status;
+	}
+
+	const dtNavMesh* cnav = m_nav;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (tile->header)
+			rebuildTile(tile);
+	}
+
+	return DT_SUCCESS;
+}
+
+void dtTileGraph::clearTile(const int tileIndex)
+{
+	dtGraphTile& gt = m_tiles[tileIndex];
+	dtFree(gt.entrances);
+	dtFree(gt.costs);
+	dtFree(gt.portalRefs);
+	gt.entrances = 0;
+	gt.costs = 0;
+	gt.portalRefs = 0;
+	gt.entranceCount = 0;
+}
+
+void dtTileGraph::tileAdded(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	rebuildTile(tile);
+	rebuildNeighbours(tile);
+}
+
+void dtTileGraph::tileRemoved(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	clearTile(m_nav->decodePolyIdTile(m_nav->getTileRef(tile)));
+	rebuildNeighbours(tile);
+}
+
+void dtTileGraph::rebuildNeighbours(const dtMeshTile* tile)
+{
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	for (int y = tile->header->y-1; y <= tile->header->y+1; ++y)
+	{
+		for (int x = tile->header->x-1; x <= tile->header->x+1; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				if (neis[j] != tile)
+					rebuildTile(neis[j]);
+			}
+		}
+	}
+}
+
+/// @par
+///
+/// Portals are grouped into entrances by neighbour tile and contiguity. Each
+/// off-mesh connection crossing the tile border becomes an entrance of its own.
+/// At most #DT_TILEGRAPH_MAX_ENTRANCES entrances are kept per tile.
+void dtTileGraph::rebuildTile(const dtMeshTile* tile)
+{
+	if (!m_tiles || !tile || !tile->header)
+		return;
+
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	const int tileIndex = (int)m_nav->decodePolyIdTile(base);
+	clearTile(tileIndex);
+
+	struct Portal
+	{
+		dtPolyRef ref, neiRef;
+		float left[3], right[3], mid[3];
+		int neiTile;
+		int group;
+		bool offMesh;
+	};
+
+	// Collect the portals leading out of the tile.
+	const int maxPortals = tile->header->maxLinkCount;
+	Portal* portals = (Portal*)dtAlloc(sizeof(Portal)*maxPortals, DT_ALLOC_TEMP);
+	if (!portals)
+		return;
+	int nportals = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			const dtLink* link = &tile->links[j];
+			const int neiTile = (int)m_nav->decodePolyIdTile(link->ref);
+			if (!link->ref || neiTile == tileIndex || nportals >= maxPortals)
+				continue;
+
+			const dtMeshTile* nt = 0;
+			const dtPoly* np = 0;
+			m_nav->getTileAndPolyByRefUnsafe(link->ref, &nt, &np);
+
+			Portal& p = portals[nportals++];
+			p.ref = base | (dtPolyRef)i;
+			p.neiRef = link->ref;
+			p.neiTile = neiTile;
+			p.group = nportals-1;
+			p.offMesh = poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION || np->getType() == DT_POLYTYPE_OFFMESH_CONNECTION;
+			getLinkPortal(m_nav, tile, poly, link, p.left, p.right);
+			dtVlerp(p.mid, p.left, p.right, 0.5f);
+		}
+	}
+
+	// Merge contiguous portals leading to the same tile.
+	static const float EPS_SQR = 0.01f*0.01f;
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (int i = 0; i < nportals; ++i)
+		{
+			const Portal& a = portals[i];
+			if (a.offMesh)
+				continue;
+			for (int j = i+1; j < nportals; ++j)
+			{
+				const Portal& b = portals[j];
+				if (b.offMesh || b.neiTile != a.neiTile || b.group == a.group)
+					continue;
+				if (dtVdistSqr(a.left, b.left) > EPS_SQR && dtVdistSqr(a.left, b.right) > EPS_SQR &&
+					dtVdistSqr(a.right, b.left) > EPS_SQR && dtVdistSqr(a.right, b.right) > EPS_SQR)
+					continue;
+				const int from = dtMax(a.group, b.group);
+				const int to = dtMin(a.group, b.group);
+				for (int k = 0; k < nportals; ++k)
+				{
+					if (portals[k].group == from)
+						portals[k].group = to;
+				}
+				merged = true;
+			}
+		}
+	}
+
+	// Pick the portal closest to the middle of each group as the entrance.
+	dtTileEntrance* entrances = (dtTileEntrance*)dtAlloc(sizeof(dtTileEntrance)*DT_TILEGRAPH_MAX_ENTRANCES, DT_ALLOC_TEMP);
+	dtPolyRef* portalRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*dtMax(nportals, 1), DT_ALLOC_TEMP);
+	if (!entrances || !portalRefs)
+	{
+		dtFree(entrances);
+		dtFree(portalRefs);
+		dtFree(portals);
+		return;
+	}
+	int nentrances = 0;
+	int nportalRefs = 0;
+	for (int i = 0; i < nportals && nentrances < DT_TILEGRAPH_MAX_ENTRANCES; ++i)
+	{
+		if (portals[i].group != i)
+			continue;
+		float center[3] = {0,0,0};
+		int n = 0;
+		for (int j = i; j < nportals; ++j)
+		{
+			if (portals[j].group != i)
+				continue;
+			dtVadd(center, center, portals[j].mid);
+			n++;
+		}
+		dtVscale(center, center, 1.0f/(float)n);
+		int best = i;
+		float bestDist = FLT_MAX;
+		for (int j = i; j < nportals; ++j)
+		{
+			if (portals[j].group != i)
+				continue;
+			const float d = dtVdistSqr(center, portals[j].mid);
+			if (d < bestDist)
+			{
+				bestDist = d;
+				best = j;
+			}
+		}
+		dtTileEntrance& e = entrances[nentrances++];
+		e.ref = portals[best].ref;
+		e.neiRef = portals[best].neiRef;
+		e.neiTile = portals[best].neiTile;
+		dtVcopy(e.pos, portals[best].mid);
+		e.firstPortal = nportalRefs;
+		for (int j = i; j < nportals; ++j)
+		{
+			if (portals[j].group == i)
+				portalRefs[nportalRefs++] = portals[j].ref;
+		}
+		e.portalCount = nportalRefs - e.firstPortal;
+	}
+	dtFree(portals);
+
+	if (!nentrances)
+	{
+		dtFree(entrances);
+		dtFree(portalRefs);
+		return;
+	}
+
+	dtGraphTile& gt = m_tiles[tileIndex];
+	gt.entrances = (dtTileEntrance*)dtAlloc(sizeof(dtTileEntrance)*nentrances, DT_ALLOC_PERM);
+	gt.costs = (float*)dtAlloc(sizeof(float)*nentrances*nentrances, DT_ALLOC_PERM);
+	gt.portalRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*nportalRefs, DT_ALLOC_PERM);
+	if (!gt.entrances || !gt.costs || !gt.portalRefs)
+	{
+		dtFree(entrances);
+		dtFree(portalRefs);
+		clearTile(tileIndex);
+		return;
+	}
+	memcpy(gt.entrances, entrances, sizeof(dtTileEntrance)*nentrances);
+	memcpy(gt.portalRefs, portalRefs, sizeof(dtPolyRef)*nportalRefs);
+	gt.entranceCount = nentrances;
+	dtFree(entrances);
+	dtFree(portalRefs);
+
+	for (int i = 0; i < nentrances; ++i)
+		searchTile(tile, gt.entrances[i].ref, gt.entrances[i].pos, gt.entrances, nentrances, &gt.costs[i*nentrances]);
+}
+
+void dtTileGraph::searchTile(const dtMeshTile* tile, dtPolyRef startRef, const float* startPos,
+							 const dtTileEntrance* targets, const int ntargets, float* costs)
+{
+	for (int i = 0; i < ntargets; ++i)
+		costs[i] = FLT_MAX;
+
+	const unsigned int tileIndex = m_nav->decodePolyIdTile(startRef);
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	dtNode* startNode = m_nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = 0;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	int remaining = ntargets;
+
+	while (!m_openList->empty() && remaining > 0)
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		const dtPolyRef bestRef = bestNode->id;
+		const dtPoly* bestPoly = &tile->polys[m_nav->decodePolyIdPoly(bestRef)];
+
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+		{
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+		}
+
+		// Settle the targets located in this polygon.
+		for (int i = 0; i < ntargets; ++i)
+		{
+			if (targets[i].ref != bestRef || costs[i] != FLT_MAX)
+				continue;
+			costs[i] = bestNode->cost + m_filter->getCost(bestNode->pos, targets[i].pos,
+														  parentRef, parentTile, parentPoly,
+														  bestRef, tile, bestPoly,
+														  0, 0, 0);
+			remaining--;
+		}
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		{
+			const dtLink* link = &tile->links[i];
+			const dtPolyRef neighbourRef = link->ref;
+
+			// Stay within the tile and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef || m_nav->decodePolyIdTile(neighbourRef) != tileIndex)
+				continue;
+
+			const dtPoly* neighbourPoly = &tile->polys[m_nav->decodePolyIdPoly(neighbourRef)];
+			if (!m_filter->passFilter(neighbourRef, tile, neighbourPoly))
+				continue;
+
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+				continue;
+			if (neighbourNode->flags & DT_NODE_CLOSED)
+				continue;
+
+			// If the node is visited the first time, calculate node position.
+			if (neighbourNode->flags == 0)
+			{
+				float left[3], right[3];
+				getLinkPortal(m_nav, tile, bestPoly, link, left, right);
+				dtVlerp(neighbourNode->pos, left, right, 0.5f);
+			}
+
+			const float cost = bestNode->cost + m_filter->getCost(bestNode->pos, neighbourNode->pos,
+																	parentRef, parentTile, parentPoly,
+																	bestRef, tile, bestPoly,
+																	neighbourRef, tile, neighbourPoly);
+
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && cost >= neighbourNode->total)
+				continue;
+
+			neighbourNode->id = neighbourRef;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->cost = cost;
+			neighbourNode->total = cost;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags = DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+	}
+}
+
+dtNode* dtTileGraph::searchGraph(dtPolyRef startRef, dtPolyRef endRef,
+								 const float* startPos, const float* endPos)
+{
+	const dtMeshTile* startTile = 0;
+	const dtMeshTile* endTile = 0;
+	const dtPoly* poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(startRef, &startTile, &poly);
+	m_nav->getTileAndPolyByRefUnsafe(endRef, &endTile, &poly);
+	const int startIndex = (int)m_nav->decodePolyIdTile(startRef);
+	const int endIndex = (int)m_nav->decodePolyIdTile(endRef);
+	const dtGraphTile& st = m_tiles[startIndex];
+	const dtGraphTile& et = m_tiles[endIndex];
+
+	// Costs from the start to its tile entrances, and from each end tile entrance to the end.
+	// The latter are searched from the entrances so that costs which depend on the direction
+	// of travel are accounted for the same way as in the refined path.
+	searchTile(startTile, startRef, startPos, st.entrances, st.entranceCount, m_startCosts);
+	dtTileEntrance goal;
+	memset(&goal, 0, sizeof(goal));
+	goal.ref = endRef;
+	dtVcopy(goal.pos, endPos);
+	for (int i = 0; i < et.entranceCount; ++i)
+		searchTile(endTile, et.entrances[i].ref, et.entrances[i].pos, &goal, 1, &m_endCosts[i]);
+
+	m_nodePool->clear();
+	m_openList->clear();
+
+	for (int i = 0; i < st.entranceCount; ++i)
+	{
+		if (m_startCosts[i] == FLT_MAX)
+			continue;
+		dtNode* node = m_nodePool->getNode(encodeEntrance(startIndex, i));
+		if (!node)
+			break;
+		dtVcopy(node->pos, st.entrances[i].pos);
+		node->pidx = 0;
+		node->cost = m_startCosts[i];
+		node->total = node->cost + dtVdist(node->pos, endPos)*H_SCALE;
+		node->id = encodeEntrance(startIndex, i);
+		node->flags = DT_NODE_OPEN;
+		m_openList->push(node);
+	}
+
+	while (!m_openList->empty())
+	{
+		dtNode* bestNode = m_openList->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+
+		if (bestNode->id == DT_TILEGRAPH_GOAL)
+			return bestNode;
+
+		int tileIndex, entrance;
+		decodeEntrance(bestNode->id, tileIndex, entrance);
+		const dtGraphTile& gt = m_tiles[tileIndex];
+		const dtTileEntrance& e = gt.entrances[entrance];
+
+		// Edges to the other entrances of the tile, the entrance across the border and the goal.
+		const int maxEdges = gt.entranceCount + 2;
+		for (int k = 0; k < maxEdges; ++k)
+		{
+			dtPolyRef id = 0;
+			float cost = 0;
+			const float* pos = 0;
+			if (k < gt.entranceCount)
+			{
+				const float c = gt.costs[entrance*gt.entranceCount + k];
+				if (k == entrance || c == FLT_MAX)
+					continue;
+				id = encodeEntrance(tileIndex, k);
+				cost = c;
+				pos = gt.entrances[k].pos;
+			}
+			else if (k == gt.entranceCount)
+			{
+				// Cross to the entrance of the neighbour tile whose run contains the polygon
+				// the portal leads to. The refined path enters the neighbour tile there too.
+				const dtGraphTile& nt = m_tiles[e.neiTile];
+				int cross = -1;
+				for (int j = 0; j < nt.entranceCount && cross == -1; ++j)
+				{
+					const dtTileEntrance& ne = nt.entrances[j];
+					if (ne.neiTile != tileIndex)
+						continue;
+					for (int p = 0; p < ne.portalCount; ++p)
+					{
+						if (nt.portalRefs[ne.firstPortal + p] == e.neiRef)
+						{
+							cross = j;
+							break;
+						}
+					}
+				}
+				if (cross == -1)
+					continue;
+
+				const dtMeshTile* prevTile = 0;
+				const dtPoly* prevPoly = 0;
+				const dtMeshTile* curTile = 0;
+				const dtPoly* curPoly = 0;
+				m_nav->getTileAndPolyByRefUnsafe(e.ref, &prevTile, &prevPoly);
+				m_nav->getTileAndPolyByRefUnsafe(e.neiRef, &curTile, &curPoly);
+				if (!m_filter->passFilter(e.neiRef, curTile, curPoly))
+					continue;
+
+				id = encodeEntrance(e.neiTile, cross);
+				pos = nt.entrances[cross].pos;
+				cost = m_filter->getCost(e.pos, pos,
+										 e.ref, prevTile, prevPoly,
+										 e.neiRef, curTile, curPoly,
+										 0, 0, 0);
+			}
+			else
+			{
+				if (tileIndex != endIndex || m_endCosts[entrance] == FLT_MAX)
+					continue;
+				id = DT_TILEGRAPH_GOAL;
+				cost = m_endCosts[entrance];
+				pos = endPos;
+			}
+
+			dtNode* neighbourNode = m_nodePool->getNode(id);
+			if (!neighbourNode)
+				continue;
+			if (neighbourNode->flags == 0)
+				dtVcopy(neighbourNode->pos, pos);
+
+			const float total = bestNode->cost + cost + dtVdist(pos, endPos)*H_SCALE;
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && total >= neighbourNode->total)
+				continue;
+
+			neighbourNode->id = id;
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->cost = bestNode->cost + cost;
+			neighbourNode->total = total;
+			neighbourNode->flags &= ~DT_NODE_CLOSED;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				m_openList->modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				m_openList->push(neighbourNode);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/// @par
+///
+/// Queries between polygons in the same or in adjacent tiles are passed directly to
+/// dtNavMeshQuery::findPath(). Otherwise the abstract graph is searched first, and
+/// the resulting route is refined with one dtNavMeshQuery::findPath() call per tile,
+/// so the node pool of @p query only needs to cover a single tile.
+///
+/// If the graph has no route between the polygons, the flat search is used, which
+/// returns a partial path toward the end.
+dtStatus dtTileGraph::findPath(dtNavMeshQuery* query, dtPolyRef startRef, dtPolyRef endRef,
+							   const float* startPos, const float* endPos,
+							   dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	dtAssert(m_nav);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+
+	if (!query || !m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!path || maxPath <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	const dtMeshTile* startTile = 0;
+	const dtMeshTile* endTile = 0;
+	const dtPoly* poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(startRef, &startTile, &poly);
+	m_nav->getTileAndPolyByRefUnsafe(endRef, &endTile, &poly);
+	if (dtAbs(startTile->header->x - endTile->header->x) <= 1 && dtAbs(startTile->header->y - endTile->header->y) <= 1)
+		return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+
+	dtNode* goal = searchGraph(startRef, endRef, startPos, endPos);
+	if (!goal)
+		return query->findPath(startRef, endRef, startPos, endPos, m_filter, path, pathCount, maxPath);
+
+	// Collect the entrances along the route.
+	int nroute = 0;
+	for (dtNode* node = m_nodePool->getNodeAtIdx(goal->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+		nroute++;
+	dtPolyRef* route = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*nroute, DT_ALLOC_TEMP);
+	if (!route)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	int i = nroute;
+	for (dtNode* node = m_nodePool->getNodeAtIdx(goal->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+		route[--i] = node->id;
+
+	// Refine the route one tile at a time. Each leg ends at an entrance where the route crosses to another tile.
+	dtStatus status = DT_SUCCESS;
+	dtPolyRef curRef = startRef;
+	float curPos[3];
+	dtVcopy(curPos, startPos);
+	int n = 0;
+	for (int k = 0; k <= nroute; ++k)
+	{
+		const dtTileEntrance* e = 0;
+		if (k < nroute)
+		{
+			int tileIndex, entrance;
+			decodeEntrance(route[k], tileIndex, entrance);
+			if (k+1 < nroute)
+			{
+				int nextTile, nextEntrance;
+				decodeEntrance(route[k+1], nextTile, nextEntrance);
+				if (nextTile == tileIndex)
+					continue;
+			}
+			else
+			{
+				// The last entrance leads into the end tile.
+				continue;
+			}
+			e = &m_tiles[tileIndex].entrances[entrance];
+		}
+
+		const dtPolyRef legEnd = e ? e->ref : endRef;
+		const float* legPos = e ? e->pos : endPos;
+
+		// Overwrite the last polygon of the previous leg, the leg starts with it.
+		const int offset = n > 0 ? n-1 : 0;
+		int m = 0;
+		const dtStatus legStatus = query->findPath(curRef, legEnd, curPos, legPos, m_filter, path+offset, &m, maxPath-offset);
+		if (dtStatusFailed(legStatus))
+		{
+			status = legStatus;
+			break;
+		}
+		n = offset + m;
+		status |= legStatus & DT_STATUS_DETAIL_MASK;
+		if (n == 0 || path[n-1] != legEnd)
+		{
+			status |= DT_PARTIAL_RESULT;
+			break;
+		}
+		if (!e)
+			break;
+
+		// Cross the tile border.
+		if (n >= maxPath)
+		{
+			status |= DT_BUFFER_TOO_SMALL;
+			break;
+		}
+		path[n++] = e->neiRef;
+		curRef = e->neiRef;
+		dtVcopy(curPos, e->pos);
+	}
+
+	dtFree(route);
+
+	*pathCount = n;
+
+	return status;
+}
+
+dtStatus dtTileGraph::findTileCorridor(dtPolyRef startRef, dtPolyRef endRef,
+									   const float* startPos, const float* endPos,
+									   dtTileRef* tiles, int* tileCount, const int maxTiles)
+{
+	dtAssert(m_nav);
+
+	if (!tileCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*tileCount = 0;
+
+	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!tiles || maxTiles <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	const dtNavMesh* nav = m_nav;
+	const int startIndex = (int)m_nav->decodePolyIdTile(startRef);
+	if (startIndex == (int)m_nav->decodePolyIdTile(endRef))
+	{
+		tiles[0] = nav->getTileRef(nav->getTile(startIndex));
+		*tileCount = 1;
+		return DT_SUCCESS;
+	}
+
+	dtNode* goal = searchGraph(startRef, endRef, startPos, endPos);
+	if (!goal)
+		return DT_FAILURE;
+
+	// Count the tile changes along the route.
+	int length = 1;
+	int prevTile = (int)m_nav->decodePolyIdTile(endRef);
+	for (dtNode* node = m_nodePool->getNodeAtIdx(goal->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+	{
+		int tileIndex, entrance;
+		decodeEntrance(node->id, tileIndex, entrance);
+		if (tileIndex != prevTile)
+			length++;
+		prevTile = tileIndex;
+	}
+
+	// Write the tiles from the end of the route, skipping the ones that do not fit.
+	int i = length-1;
+	prevTile = (int)m_nav->decodePolyIdTile(endRef);
+	if (i < maxTiles)
+		tiles[i] = nav->getTileRef(nav->getTile(prevTile));
+	for (dtNode* node = m_nodePool->getNodeAtIdx(goal->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+	{
+		int tileIndex, entrance;
+		decodeEntrance(node->id, tileIndex, entrance);
+		if (tileIndex != prevTile)
+		{
+			i--;
+			if (i < maxTiles)
+				tiles[i] = nav->getTileRef(nav->getTile(tileIndex));
+		}
+		prevTile = tileIndex;
+	}
+
+	*tileCount = dtMin(length, maxTiles);
+
+	if (length > maxTiles)
+		return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
+
+	return DT_SUCCESS;
+}
+
+const dtTileEntrance* dtTileGraph::getTileEntrances(const int tileIndex, int* count) const
+{
+	if (!m_tiles || tileIndex < 0 || tileIndex >= m_maxTiles)
+	{
+		if (count) *count = 0;
+		return 0;
+	}
+	if (count) *count = m_tiles[tileIndex].entranceCount;
+	return m_tiles[tileIndex].entrances;
+}
+
+float dtTileGraph::getEntranceCost(const int tileIndex, const int from, const int to) const
+{
+	if (!m_tiles || tileIndex < 0 || tileIndex >= m_maxTiles)
+		return FLT_MAX;
+	const dtGraphTile& gt = m_tiles[tileIndex];
+	if (from < 0 || to < 0 || from >= gt.entranceCount || to >= gt.entranceCount)
+		return FLT_MAX;
+	return gt.costs[from*gt.entranceCount + to];
+}
+
+int dtTileGraph::getMemUsed() const
+{
+	int mem = sizeof(*this) + sizeof(dtGraphTile)*m_maxTiles + sizeof(float)*DT_TILEGRAPH_MAX_ENTRANCES*2;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const int n = m_tiles[i].entranceCount;
+		mem += sizeof(dtTileEntrance)*n + sizeof(float)*n*n;
+		for (int j = 0; j < n; ++j)
+			mem += sizeof(dtPolyRef)*m_tiles[i].entrances[j].portalCount;
+	}
+	if (m_nodePool)
+		mem += m_nodePool->getMemUsed();
+	if (m_openList)
+		mem += m_openList->getMemUsed();
+	return mem;
+}
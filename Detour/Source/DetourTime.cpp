@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include "DetourTime.h"
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+static dtTimeVal dtGetTimeUsecDefault()
+{
+	static LARGE_INTEGER freq = { 0 };
+	if (freq.QuadPart == 0)
+		QueryPerformanceFrequency(&freq);
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	// Split to avoid overflowing the multiplication on long uptimes.
+	const dtTimeVal secs = count.QuadPart / freq.QuadPart;
+	const dtTimeVal rem = count.QuadPart % freq.QuadPart;
+	return secs*1000000 + rem*1000000 / freq.QuadPart;
+}
+
+#else
+
+#include <time.h>
+
+static dtTimeVal dtGetTimeUsecDefault()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (dtTimeVal)now.tv_sec*1000000 + (dtTimeVal)(now.tv_nsec / 1000);
+}
+
+#endif
+
+static dtTimeFunc* sTimeFunc = dtGetTimeUsecDefault;
+
+void dtTimeSetCustom(dtTimeFunc* timeFunc)
+{
+	sTimeFunc = timeFunc ? timeFunc : dtGetTimeUsecDefault;
+}
+
+dtTimeVal dtGetTimeUsec()
+{
+	return sTimeFunc();
+}
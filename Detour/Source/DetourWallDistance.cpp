@@ -0,0 +1,303 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+
+#include <float.h>
+#include <string.h>
+#include "DetourWallDistance.h"
+#include "DetourCommon.h"
+#include "DetourMath.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+// Relative tolerance added to the distance bounds, covers the rounding of the stored distances.
+static const float DT_WALL_DIST_TOLERANCE = 1e-3f;
+
+dtWallDistanceField* dtAllocWallDistanceField()
+{
+	void* mem = dtAlloc(sizeof(dtWallDistanceField), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtWallDistanceField;
+}
+
+void dtFreeWallDistanceField(dtWallDistanceField* field)
+{
+	if (!field) return;
+	field->~dtWallDistanceField();
+	dtFree(field);
+}
+
+/// @class dtWallDistanceField
+///
+/// The distance of each polygon is computed with dtNavMeshQuery::findDistanceToWall()
+/// from the center of the polygon, with the maximum distance of the field as the
+/// search radius. The distance from any other location of the polygon differs from
+/// it by at most the distance between the location and the center, which gives the
+/// bounds returned by getDistanceBounds(). Off-mesh connections are not stored.
+///
+/// Walls depend on the neighbour tiles, since unconnected tile borders are walls.
+/// When a tile is added or removed, the tiles within the maximum distance of it are
+/// computed again. Keep the maximum distance small compared to the tile size so
+/// that this stays within the direct neighbours.
+///
+/// The filter pointer is stored and must stay valid for the lifetime of the field.
+/// Changing polygon flags does not notify the field; call rebuildTile() for the
+/// tiles affected and their neighbours.
+///
+/// Assign the field to a query with dtNavMeshQuery::setWallDistanceField() to speed
+/// up dtNavMeshQuery::findDistanceToWall().
+///
+/// @see dtNavMeshQuery, #dtAllocWallDistanceField
+
+dtWallDistanceField::dtWallDistanceField() :
+	m_nav(0),
+	m_query(0),
+	m_filter(0),
+	m_maxDist(0),
+	m_tiles(0),
+	m_maxTiles(0)
+{
+}
+
+dtWallDistanceField::~dtWallDistanceField()
+{
+	purge();
+}
+
+void dtWallDistanceField::purge()
+{
+	if (m_nav)
+		m_nav->removeTileListener(this);
+	for (int i = 0; i < m_maxTiles; ++i)
+		freeTile(i);
+	dtFree(m_tiles);
+	m_tiles = 0;
+	m_maxTiles = 0;
+	dtFreeNavMeshQuery(m_query);
+	m_query = 0;
+	m_filter = 0;
+	m_maxDist = 0;
+	m_nav = 0;
+}
+
+dtStatus dtWallDistanceField::init(dtNavMesh* nav, const dtQueryFilter* filter, const float maxDist, const int maxNodes)
+{
+	if (!nav || !filter || !(maxDist > 0.0f) || !dtMathIsfinite(maxDist))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	m_query = dtAllocNavMeshQuery();
+	if (!m_query)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	dtStatus status = m_query->init(nav, maxNodes);
+	if (dtStatusFailed(status))
+		return status;
+
+	m_maxTiles = nav->getMaxTiles();
+	m_tiles = (dtWallTile*)dtAlloc(sizeof(dtWallTile)*m_maxTiles, DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(dtWallTile)*m_maxTiles);
+
+	m_nav = nav;
+	m_filter = filter;
+	m_maxDist = maxDist;
+
+	status = m_nav->addTileListener(this);
+	if (dtStatusFailed(status))
+	{
+		m_nav = 0;
+		return status;
+	}
+
+	const dtNavMesh* cnav = m_nav;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = cnav->getTile(i);
+		if (tile->header && !buildTile(tile))
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	return DT_SUCCESS;
+}
+
+bool dtWallDistanceField::matchesFilter(const dtQueryFilter* filter) const
+{
+	return dtEquivalentFilters(m_filter, filter);
+}
+
+void dtWallDistanceField::freeTile(const int tileIndex)
+{
+	dtWallTile& wt = m_tiles[tileIndex];
+	dtFree(wt.dist);
+	memset(&wt, 0, sizeof(dtWallTile));
+}
+
+bool dtWallDistanceField::buildTile(const dtMeshTile* tile)
+{
+	const dtPolyRef base = m_nav->getPolyRefBase(tile);
+	const int tileIndex = (int)m_nav->decodePolyIdTile(base);
+	const int polyCount = tile->header->polyCount;
+
+	freeTile(tileIndex);
+	if (!polyCount)
+		return true;
+
+	dtWallTile& wt = m_tiles[tileIndex];
+	wt.dist = (float*)dtAlloc(sizeof(float)*2*polyCount, DT_ALLOC_PERM);
+	if (!wt.dist)
+		return false;
+	wt.salt = tile->salt;
+	wt.polyCount = polyCount;
+
+	for (int i = 0; i < polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		float* d = &wt.dist[i*2];
+		// Negative distance marks polygons that are not in the field.
+		d[0] = -1.0f;
+		d[1] = 0.0f;
+		if (poly->getType() != DT_POLYTYPE_GROUND)
+			continue;
+		const dtPolyRef ref = base | (dtPolyRef)i;
+		if (!m_filter->passFilter(ref, tile, poly))
+			continue;
+
+		float center[3];
+		dtCalcPolyCenter(center, poly->verts, poly->vertCount, tile->verts);
+		float hitDist = m_maxDist, hitPos[3], hitNormal[3];
+		const dtStatus status = m_query->findDistanceToWall(ref, center, m_maxDist, m_filter, &hitDist, hitPos, hitNormal);
+		// An incomplete search could miss the nearest wall.
+		if (dtStatusFailed(status) || dtStatusDetail(status, DT_OUT_OF_NODES))
+			continue;
+
+		float radiusSqr = 0.0f;
+		for (int j = 0; j < poly->vertCount; ++j)
+			radiusSqr = dtMax(radiusSqr, dtVdist2DSqr(center, &tile->verts[poly->verts[j]*3]));
+		d[0] = hitDist;
+		d[1] = dtMathSqrtf(radiusSqr);
+	}
+
+	return true;
+}
+
+void dtWallDistanceField::rebuildNeighbours(const dtMeshTile* tile)
+{
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	// Walls within the maximum distance of the tile can change the distances.
+	const dtNavMeshParams* params = m_nav->getParams();
+	const int range = dtMax(1, (int)dtMathCeilf(m_maxDist / dtMin(params->tileWidth, params->tileHeight)));
+	for (int y = tile->header->y-range; y <= tile->header->y+range; ++y)
+	{
+		for (int x = tile->header->x-range; x <= tile->header->x+range; ++x)
+		{
+			const int nneis = m_nav->getTilesAt(x, y, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				if (neis[j] != tile)
+					buildTile(neis[j]);
+			}
+		}
+	}
+}
+
+void dtWallDistanceField::rebuildTile(const dtMeshTile* tile)
+{
+	if (!m_tiles || !tile || !tile->header)
+		return;
+	buildTile(tile);
+}
+
+void dtWallDistanceField::tileAdded(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	buildTile(tile);
+	rebuildNeighbours(tile);
+}
+
+void dtWallDistanceField::tileRemoved(const dtNavMesh* /*nav*/, const dtMeshTile* tile)
+{
+	// The links to the tile are already removed, its borders are walls for the neighbours.
+	freeTile((int)m_nav->decodePolyIdTile(m_nav->getTileRef(tile)));
+	rebuildNeighbours(tile);
+}
+
+const float* dtWallDistanceField::getPolyData(dtPolyRef ref, const dtMeshTile** tile, const dtPoly** poly) const
+{
+	if (!m_nav)
+		return 0;
+	unsigned int salt, it, ip;
+	m_nav->decodePolyId(ref, salt, it, ip);
+	if ((int)it >= m_maxTiles)
+		return 0;
+	const dtWallTile& wt = m_tiles[it];
+	if (!wt.dist || wt.salt != salt || (int)ip >= wt.polyCount)
+		return 0;
+	const float* d = &wt.dist[ip*2];
+	if (d[0] < 0.0f)
+		return 0;
+	if (tile && poly)
+		m_nav->getTileAndPolyByRefUnsafe(ref, tile, poly);
+	return d;
+}
+
+bool dtWallDistanceField::getPolyWallDistance(dtPolyRef ref, float* dist) const
+{
+	const float* d = getPolyData(ref, 0, 0);
+	if (!d)
+		return false;
+	*dist = d[0];
+	return true;
+}
+
+float dtWallDistanceField::getPolyClearance(dtPolyRef ref) const
+{
+	const float* d = getPolyData(ref, 0, 0);
+	if (!d)
+		return 0.0f;
+	return dtMax(0.0f, d[0] - d[1]);
+}
+
+bool dtWallDistanceField::getDistanceBounds(dtPolyRef ref, const float* pos, float* minDist, float* maxDist) const
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	const float* d = getPolyData(ref, &tile, &poly);
+	if (!d)
+		return false;
+
+	float center[3];
+	dtCalcPolyCenter(center, poly->verts, poly->vertCount, tile->verts);
+	const float offset = dtVdist2D(pos, center);
+	const float tolerance = DT_WALL_DIST_TOLERANCE*(d[0] + offset + 1.0f);
+	*minDist = dtMax(0.0f, d[0] - offset - tolerance);
+	// The stored distance is only a lower bound when no wall was found.
+	*maxDist = d[0] < m_maxDist ? d[0] + offset + tolerance : FLT_MAX;
+	return true;
+}
+
+int dtWallDistanceField::getMemUsed() const
+{
+	int mem = sizeof(*this) + sizeof(dtWallTile)*m_maxTiles;
+	for (int i = 0; i < m_maxTiles; ++i)
+		mem += sizeof(float)*2*m_tiles[i].polyCount;
+	return mem;
+}
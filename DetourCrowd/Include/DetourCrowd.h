@@ -25,6 +25,7 @@
 #include "DetourPathCorridor.h"
 #include "DetourProximityGrid.h"
 #include "DetourPathQueue.h"
+#include "DetourIncrementalPath.h"
 
 /// The maximum number of neighbors that a crowd agent can take into account
 /// for steering decisions.
@@ -206,8 +207,10 @@ class dtCrowd
 	dtCrowdAgent* m_agents;
 	dtCrowdAgent** m_activeAgents;
 	dtCrowdAgentAnimation* m_agentAnims;
+	dtIncrementalPathQuery** m_replanners;
 	
 	dtPathQueue m_pathq;
+	int m_pathqTimeBudgetUsec;
 
 	dtObstacleAvoidanceParams m_obstacleQueryParams[DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS];
 	dtObstacleAvoidanceQuery* m_obstacleQuery;
@@ -287,6 +290,15 @@ public:
 	/// Removes the agent from the crowd.
 	///  @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
 	void removeAgent(const int idx);
+
+	/// Sets the incremental path query used to repair the path of the specified agent.
+	/// When the agent's path becomes invalid and the goal of the query is the agent's
+	/// target polygon, the path is repaired with the query instead of being replanned
+	/// through the path queue. The query should use the agent's filter. It is not owned
+	/// by the crowd, and it is unset when an agent is added at the index.
+	///  @param[in]		idx			The agent index. [Limits: 0 <= value < #getAgentCount()]
+	///  @param[in]		replanner	The query to use, or null to always use the path queue.
+	void setAgentReplanner(const int idx, dtIncrementalPathQuery* replanner);
 	
 	/// Submits a new move request for the specified agent.
 	///  @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
@@ -341,6 +353,14 @@ public:
 	/// @return The crowd's proximity grid.
 	const dtProximityGrid* getGrid() const { return m_grid; }
 
+	/// Sets the per update time budget of the path request queue.
+	///  @param[in]		maxTimeUsec		The budget in microseconds, or zero to budget by iteration count.
+	void setPathQueueTimeBudget(const int maxTimeUsec) { m_pathqTimeBudgetUsec = maxTimeUsec > 0 ? maxTimeUsec : 0; }
+
+	/// Gets the per update time budget of the path request queue.
+	/// @return The budget in microseconds, or zero if the queue is budgeted by iteration count.
+	int getPathQueueTimeBudget() const { return m_pathqTimeBudgetUsec; }
+
 	/// Gets the crowd's path request queue.
 	/// @return The crowd's path request queue.
 	const dtPathQueue* getPathQueue() const { return &m_pathq; }
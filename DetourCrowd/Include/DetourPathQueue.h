@@ -51,6 +51,7 @@ class dtPathQueue
 	dtNavMeshQuery* m_navquery;
 	
 	void purge();
+	int updateRequests(const int maxIters, const dtTimeVal* deadline);
 	
 public:
 	dtPathQueue();
@@ -60,6 +61,12 @@ public:
 	
 	void update(const int maxIters);
 	
+	/// Updates the path requests until they are done or the time budget runs out.
+	///  @param[in]		maxTimeUsec		The time budget in microseconds.
+	///  @param[out]	doneIters		The number of pathfinder iterations completed. [opt]
+	///  @param[out]	doneTimeUsec	The actual time spent, in microseconds. [opt]
+	void updateTimed(const int maxTimeUsec, int* doneIters = 0, int* doneTimeUsec = 0);
+	
 	dtPathQueueRef request(dtPolyRef startRef, dtPolyRef endRef,
 						   const float* startPos, const float* endPos, 
 						   const dtQueryFilter* filter);
@@ -333,6 +333,8 @@ dtCrowd::dtCrowd() :
 	m_agents(0),
 	m_activeAgents(0),
 	m_agentAnims(0),
+	m_replanners(0),
+	m_pathqTimeBudgetUsec(0),
 	m_obstacleQuery(0),
 	m_grid(0),
 	m_pathResult(0),
@@ -361,6 +363,9 @@ void dtCrowd::purge()
 
 	dtFree(m_agentAnims);
 	m_agentAnims = 0;
+
+	dtFree(m_replanners);
+	m_replanners = 0;
 	
 	dtFree(m_pathResult);
 	m_pathResult = 0;
@@ -446,9 +451,14 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 			return false;
 	}
 
+	m_replanners = (dtIncrementalPathQuery**)dtAlloc(sizeof(dtIncrementalPathQuery*)*m_maxAgents, DT_ALLOC_PERM);
+	if (!m_replanners)
+		return false;
+
 	for (int i = 0; i < m_maxAgents; ++i)
 	{
 		m_agentAnims[i].active = false;
+		m_replanners[i] = 0;
 	}
 
 	// The navquery is mostly used for local searches, no need for large node pool.
@@ -526,6 +536,7 @@ int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 	dtCrowdAgent* ag = &m_agents[idx];		
 
 	updateAgentParameters(idx, params);
+	m_replanners[idx] = 0;
 	
 	// Find nearest position on navmesh and place the agent there.
 	float nearest[3];
@@ -577,6 +588,12 @@ void dtCrowd::removeAgent(const int idx)
 	}
 }
 
+void dtCrowd::setAgentReplanner(const int idx, dtIncrementalPathQuery* replanner)
+{
+	if (idx >= 0 && idx < m_maxAgents)
+		m_replanners[idx] = replanner;
+}
+
 bool dtCrowd::requestMoveTargetReplan(const int idx, dtPolyRef ref, const float* pos)
 {
 	if (idx < 0 || idx >= m_maxAgents)
@@ -604,6 +621,11 @@ bool dtCrowd::requestMoveTargetReplan(const int idx, dtPolyRef ref, const float*
 /// The position will be constrained to the surface of the navigation mesh.
 ///
 /// The request will be processed during the next #update().
+///
+/// If the target cannot be reached, the agent moves to the closest reachable
+/// point found by a partial path search. The crowd relies on these partial paths,
+/// so its queries do not use a component index (see dtNavMeshQuery::setComponentIndex),
+/// which would cut them down to the agent's current polygon.
 bool dtCrowd::requestMoveTarget(const int idx, dtPolyRef ref, const float* pos)
 {
 	if (idx < 0 || idx >= m_maxAgents)
@@ -779,7 +801,10 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 
 	
 	// Update requests.
-	m_pathq.update(MAX_ITERS_PER_UPDATE);
+	if (m_pathqTimeBudgetUsec > 0)
+		m_pathq.updateTimed(m_pathqTimeBudgetUsec);
+	else
+		m_pathq.update(MAX_ITERS_PER_UPDATE);
 
 	dtStatus status;
 
@@ -1037,6 +1062,22 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 		{
 			if (ag->targetState != DT_CROWDAGENT_TARGET_NONE)
 			{
+				// Repair the path in place if the agent has a search tree toward its target.
+				dtIncrementalPathQuery* replanner = m_replanners[idx];
+				if (replanner && ag->targetState == DT_CROWDAGENT_TARGET_VALID && replanner->getGoalRef() == ag->targetRef)
+				{
+					int npath = 0;
+					const dtStatus status = replanner->findPath(agentRef, m_pathResult, &npath, m_maxPathResult);
+					if (dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT) &&
+						!dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+					{
+						ag->corridor.setCorridor(ag->targetPos, m_pathResult, npath);
+						ag->partial = false;
+						ag->boundary.reset();
+						ag->targetReplanTime = 0;
+						continue;
+					}
+				}
 				requestMoveTargetReplan(idx, ag->targetRef, ag->targetPos);
 			}
 		}
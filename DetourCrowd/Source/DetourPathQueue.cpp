@@ -75,12 +75,30 @@ bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNa
 }
 
 void dtPathQueue::update(const int maxIters)
+{
+	updateRequests(maxIters, 0);
+}
+
+void dtPathQueue::updateTimed(const int maxTimeUsec, int* doneIters, int* doneTimeUsec)
+{
+	const dtTimeVal startTime = dtGetTimeUsec();
+	const dtTimeVal deadline = startTime + maxTimeUsec;
+	const int iters = updateRequests(0, &deadline);
+	if (doneIters)
+		*doneIters = iters;
+	if (doneTimeUsec)
+		*doneTimeUsec = (int)(dtGetTimeUsec() - startTime);
+}
+
+int dtPathQueue::updateRequests(const int maxIters, const dtTimeVal* deadline)
 {
 	static const int MAX_KEEP_ALIVE = 2; // in update ticks.
 
 	// Update path request until there is nothing to update
-	// or upto maxIters pathfinder iterations has been consumed.
+	// or upto maxIters pathfinder iterations has been consumed,
+	// or the deadline has passed.
 	int iterCount = maxIters;
+	int doneIters = 0;
 	
 	for (int i = 0; i < MAX_QUEUE; ++i)
 	{
@@ -117,19 +135,25 @@ void dtPathQueue::update(const int maxIters)
 		if (dtStatusInProgress(q.status))
 		{
 			int iters = 0;
-			q.status = m_navquery->updateSlicedFindPath(iterCount, &iters);
+			if (deadline)
+				q.status = m_navquery->updateSlicedFindPathTimed(*deadline, &iters, 0);
+			else
+				q.status = m_navquery->updateSlicedFindPath(iterCount, &iters);
 			iterCount -= iters;
+			doneIters += iters;
 		}
 		if (dtStatusSucceed(q.status))
 		{
 			q.status = m_navquery->finalizeSlicedFindPath(q.path, &q.npath, m_maxPathSize);
 		}
 
-		if (iterCount <= 0)
+		if (deadline ? dtGetTimeUsec() >= *deadline : iterCount <= 0)
 			break;
 
 		m_queueHead++;
 	}
+
+	return doneIters;
 }
 
 dtPathQueueRef dtPathQueue::request(dtPolyRef startRef, dtPolyRef endRef,
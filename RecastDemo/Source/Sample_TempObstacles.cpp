@@ -1421,7 +1421,7 @@ void Sample_TempObstacles::getTilePos(const float* pos, int& tx, int& ty)
 }
 
 static const int TILECACHESET_MAGIC = 'T'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'TSET';
-static const int TILECACHESET_VERSION = 1;
+static const int TILECACHESET_VERSION = 3;
 
 struct TileCacheSetHeader
 {
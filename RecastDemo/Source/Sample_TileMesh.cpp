@@ -609,6 +609,7 @@ bool Sample_TileMesh::handleBuild()
 	}
 
 	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
 	rcVcopy(params.orig, m_geom->getNavMeshBoundsMin());
 	params.tileWidth = m_tileSize * m_cellSize; // 计算 tile 的宽度
 	params.tileHeight = m_tileSize * m_cellSize; // 计算 tile 的高度
@@ -1157,6 +1158,7 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 		params.cs = m_cfg.cs;
 		params.ch = m_cfg.ch;
 		params.buildBvTree = true;
+		params.buildWideBvTree = true;
 		
 		if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
 		{
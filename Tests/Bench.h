@@ -0,0 +1,67 @@
+#ifndef TESTS_BENCH_H
+#define TESTS_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0
+#include <time.h>
+
+// Process CPU time, so that other load on the machine does not skew the results.
+inline int64_t NowNanos() {
+	struct timespec tp;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_nsec + 1000000000LL * tp.tv_sec;
+}
+#else
+#include <chrono>
+
+// Wall clock time where the process CPU time is not available.
+inline int64_t NowNanos() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#define TESTS_BENCHMARKS 1
+
+#define BM(name, iterations) \
+	struct BM_ ## name { \
+		static void Run() { \
+			int64_t begin_time = NowNanos(); \
+			for (int i = 0 ; i < iterations; i++) { \
+				Body(); \
+			} \
+			int64_t nanos = NowNanos() - begin_time; \
+			printf("BM_%-35s %lld iterations in %10lld nanos: %10.2f nanos/it\n", #name ":", (long long)iterations, (long long)nanos, double(nanos) / iterations); \
+		} \
+		static void Body(); \
+	}; \
+	TEST_CASE(#name) { \
+		BM_ ## name::Run(); \
+	} \
+	void BM_ ## name::Body()
+
+// Prevent compiler from eliding a calculation.
+#if defined(_MSC_VER)
+#include <intrin.h>
+
+template <typename T>
+void DoNotOptimize(T* v) {
+	// The volatile store keeps the pointer alive, the barrier keeps the writes through it.
+	static T* volatile sink;
+	sink = v;
+	_ReadWriteBarrier();
+}
+#else
+template <typename T>
+void DoNotOptimize(T* v) {
+	asm volatile ("" : "+r" (v) : : "memory");
+}
+#endif
+
+#endif  // TESTS_BENCH_H
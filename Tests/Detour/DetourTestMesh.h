@@ -0,0 +1,267 @@
+#ifndef DETOURTESTMESH_H
+#define DETOURTESTMESH_H
+
+#include <float.h>
+#include <string.h>
+#include <vector>
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+
+// Builds navigation meshes out of a regular grid of unit quads, one polygon per grid cell,
+// so the Detour tests can run queries without going through the Recast pipeline.
+struct TestGridMesh
+{
+	int tilesX;			// Number of tiles along the x-axis.
+	int tilesZ;			// Number of tiles along the z-axis.
+	int cellsPerTile;	// Number of grid cells along each side of a tile.
+	std::vector<char> blocked;	// One entry per grid cell, non-zero cells get no polygon.
+	bool wideBvTree;	// Build the tiles with the 4-wide bounding volume tree.
+
+	TestGridMesh(const int tx, const int tz, const int cells) :
+		tilesX(tx), tilesZ(tz), cellsPerTile(cells),
+		blocked(tx * cells * tz * cells, 0), wideBvTree(false)
+	{
+	}
+
+	int cellsX() const { return tilesX * cellsPerTile; }
+	int cellsZ() const { return tilesZ * cellsPerTile; }
+
+	bool isBlocked(const int x, const int z) const
+	{
+		if (x < 0 || z < 0 || x >= cellsX() || z >= cellsZ())
+			return true;
+		return blocked[z * cellsX() + x] != 0;
+	}
+
+	void block(const int x, const int z) { blocked[z * cellsX() + x] = 1; }
+
+	// Returns the world position of the center of a grid cell.
+	static void cellCenter(const int x, const int z, float* pos)
+	{
+		pos[0] = x + 0.5f;
+		pos[1] = 0.0f;
+		pos[2] = z + 0.5f;
+	}
+
+	// Builds the tile data for the specified tile. Returns false if the tile has no polygons.
+	bool buildTile(const int tx, const int tz, unsigned char** outData, int* outDataSize) const
+	{
+		const int n = cellsPerTile;
+		const int vertsPerSide = n + 1;
+		// Each cell is 2x2 voxels so that a cell is 1x1 world units.
+		std::vector<unsigned short> verts;
+		for (int z = 0; z < vertsPerSide; ++z)
+		{
+			for (int x = 0; x < vertsPerSide; ++x)
+			{
+				verts.push_back((unsigned short)(x * 2));
+				verts.push_back(0);
+				verts.push_back((unsigned short)(z * 2));
+			}
+		}
+
+		std::vector<int> polyIndex(n * n, -1);
+		int polyCount = 0;
+		for (int z = 0; z < n; ++z)
+		{
+			for (int x = 0; x < n; ++x)
+			{
+				if (!isBlocked(tx * n + x, tz * n + z))
+					polyIndex[z * n + x] = polyCount++;
+			}
+		}
+		if (!polyCount)
+			return false;
+
+		const int nvp = 4;
+		std::vector<unsigned short> polys(polyCount * nvp * 2, 0);
+		std::vector<unsigned short> flags(polyCount, 1);
+		std::vector<unsigned char> areas(polyCount, 0);
+		for (int z = 0; z < n; ++z)
+		{
+			for (int x = 0; x < n; ++x)
+			{
+				const int pi = polyIndex[z * n + x];
+				if (pi < 0)
+					continue;
+				unsigned short* p = &polys[pi * nvp * 2];
+				// Vertices and the neighbour across the edge starting at each vertex.
+				p[0] = (unsigned short)(z * vertsPerSide + x);
+				p[1] = (unsigned short)((z + 1) * vertsPerSide + x);
+				p[2] = (unsigned short)((z + 1) * vertsPerSide + x + 1);
+				p[3] = (unsigned short)(z * vertsPerSide + x + 1);
+				static const int dx[4] = { -1, 0, 1, 0 };
+				static const int dz[4] = { 0, 1, 0, -1 };
+				for (int e = 0; e < 4; ++e)
+				{
+					const int nx = x + dx[e];
+					const int nz = z + dz[e];
+					if (nx >= 0 && nz >= 0 && nx < n && nz < n)
+					{
+						const int ni = polyIndex[nz * n + nx];
+						p[nvp + e] = ni >= 0 ? (unsigned short)ni : 0xffff;
+					}
+					else
+					{
+						// Tile border, marked as portal toward the neighbour tile.
+						p[nvp + e] = (unsigned short)(0x8000 | e);
+					}
+				}
+			}
+		}
+
+		dtNavMeshCreateParams params;
+		memset(&params, 0, sizeof(params));
+		params.verts = &verts[0];
+		params.vertCount = vertsPerSide * vertsPerSide;
+		params.polys = &polys[0];
+		params.polyFlags = &flags[0];
+		params.polyAreas = &areas[0];
+		params.polyCount = polyCount;
+		params.nvp = nvp;
+		params.tileX = tx;
+		params.tileY = tz;
+		params.bmin[0] = (float)(tx * n);
+		params.bmin[1] = 0.0f;
+		params.bmin[2] = (float)(tz * n);
+		params.bmax[0] = (float)((tx + 1) * n);
+		params.bmax[1] = 1.0f;
+		params.bmax[2] = (float)((tz + 1) * n);
+		params.walkableHeight = 2.0f;
+		params.walkableRadius = 0.5f;
+		params.walkableClimb = 0.5f;
+		params.cs = 0.5f;
+		params.ch = 0.5f;
+		params.buildBvTree = true;
+		params.buildWideBvTree = wideBvTree;
+
+		return dtCreateNavMeshData(&params, outData, outDataSize);
+	}
+
+	// Creates a tiled navigation mesh containing all tiles of the grid.
+	dtNavMesh* createNavMesh(const int flags = 0, const float polyGridCellSize = 0.0f) const
+	{
+		dtNavMeshParams params;
+		memset(&params, 0, sizeof(params));
+		params.tileWidth = (float)cellsPerTile;
+		params.tileHeight = (float)cellsPerTile;
+		params.maxTiles = tilesX * tilesZ;
+		params.maxPolys = cellsPerTile * cellsPerTile;
+		params.flags = flags;
+		params.polyGridCellSize = polyGridCellSize;
+
+		dtNavMesh* nav = dtAllocNavMesh();
+		if (!nav || dtStatusFailed(nav->init(&params)))
+		{
+			dtFreeNavMesh(nav);
+			return 0;
+		}
+
+		for (int z = 0; z < tilesZ; ++z)
+		{
+			for (int x = 0; x < tilesX; ++x)
+				addTile(nav, x, z);
+		}
+		return nav;
+	}
+
+	// Adds a single tile to the navigation mesh.
+	dtTileRef addTile(dtNavMesh* nav, const int tx, const int tz) const
+	{
+		unsigned char* data = 0;
+		int dataSize = 0;
+		if (!buildTile(tx, tz, &data, &dataSize))
+			return 0;
+		dtTileRef ref = 0;
+		if (dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &ref)))
+		{
+			dtFree(data);
+			return 0;
+		}
+		return ref;
+	}
+};
+
+// Returns true if each polygon in the path is linked to the next one.
+inline bool isConnectedPath(const dtNavMesh* nav, const dtPolyRef* path, const int pathCount)
+{
+	for (int i = 0; i + 1 < pathCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		if (dtStatusFailed(nav->getTileAndPolyByRef(path[i], &tile, &poly)))
+			return false;
+		bool found = false;
+		for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+		{
+			if (tile->links[j].ref == path[i + 1])
+				found = true;
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
+// Returns the middle of the portal from a polygon to the next one.
+inline bool portalMidPoint(const dtNavMesh* nav, const dtPolyRef from, const dtPolyRef to, float* mid)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(nav->getTileAndPolyByRef(from, &tile, &poly)))
+		return false;
+	const dtLink* link = 0;
+	for (unsigned int j = poly->firstLink; j != DT_NULL_LINK; j = tile->links[j].next)
+	{
+		if (tile->links[j].ref == to)
+			link = &tile->links[j];
+	}
+	if (!link)
+		return false;
+	const float* va = &tile->verts[poly->verts[link->edge]*3];
+	const float* vb = &tile->verts[poly->verts[(link->edge+1) % poly->vertCount]*3];
+	dtVlerp(mid, va, vb, 0.5f);
+	return true;
+}
+
+// Returns the cost of a path that goes from the start through the middle of each portal
+// of the corridor to the end, as the path searches measure it with a dtQueryFilter.
+inline float pathCost(const dtNavMesh* nav, const dtQueryFilter* filter, const dtPolyRef* path, const int pathCount,
+					  const float* startPos, const float* endPos)
+{
+	float cost = 0.0f;
+	float prev[3];
+	dtVcopy(prev, startPos);
+	for (int i = 0; i < pathCount; ++i)
+	{
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		if (dtStatusFailed(nav->getTileAndPolyByRef(path[i], &tile, &poly)))
+			return FLT_MAX;
+		float next[3] = { 0.0f, 0.0f, 0.0f };
+		if (i + 1 == pathCount)
+			dtVcopy(next, endPos);
+		else if (!portalMidPoint(nav, path[i], path[i + 1], next))
+			return FLT_MAX;
+		cost += dtVdist(prev, next) * filter->getAreaCost(poly->getArea());
+		dtVcopy(prev, next);
+	}
+	return cost;
+}
+
+// Finds the polygon of a grid cell.
+inline dtPolyRef findCellPoly(const dtNavMeshQuery* query, const int x, const int z, float* pos)
+{
+	const float halfExtents[3] = { 0.1f, 1.0f, 0.1f };
+	dtQueryFilter filter;
+	dtPolyRef ref = 0;
+	TestGridMesh::cellCenter(x, z, pos);
+	query->findNearestPoly(pos, halfExtents, &filter, &ref, 0);
+	return ref;
+}
+
+#endif // DETOURTESTMESH_H
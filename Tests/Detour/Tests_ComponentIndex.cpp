@@ -0,0 +1,185 @@
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourComponentIndex.h"
+#include "DetourTestMesh.h"
+
+TEST_CASE("dtComponentIndex")
+{
+	// 3x3 tiles, the right column of tiles is cut off by a wall.
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 0; z < grid.cellsZ(); ++z)
+		grid.block(15, z);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	dtComponentIndex* index = dtAllocComponentIndex();
+	REQUIRE(dtStatusSucceed(index->init(nav, &filter)));
+	query->setComponentIndex(index);
+
+	float startPos[3], islandPos[3], nearPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 1, startPos);
+	const dtPolyRef islandRef = findCellPoly(query, 20, 20, islandPos);
+	const dtPolyRef nearRef = findCellPoly(query, 10, 20, nearPos);
+	REQUIRE(startRef);
+	REQUIRE(islandRef);
+	REQUIRE(nearRef);
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+
+	SECTION("Rejects unreachable polygons without searching")
+	{
+		REQUIRE(index->isReachable(startRef, nearRef, 0));
+		REQUIRE(!index->isReachable(startRef, islandRef, 0));
+		REQUIRE(!query->isReachable(startRef, islandRef, &filter));
+
+		// A different filter object with the same flags shares the class.
+		dtQueryFilter other;
+		REQUIRE(index->getFilterClass(&other) == 0);
+
+		const dtStatus status = query->findPath(startRef, islandRef, startPos, islandPos, &filter, path, &pathCount, 256);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(pathCount == 1);
+		REQUIRE(path[0] == startRef);
+
+		dtStatus slicedStatus = query->initSlicedFindPath(startRef, islandRef, startPos, islandPos, &filter);
+		REQUIRE(!dtStatusInProgress(slicedStatus));
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(path, &pathCount, 256)));
+		REQUIRE(pathCount == 1);
+
+		REQUIRE(!dtStatusDetail(query->findPath(startRef, nearRef, startPos, nearPos, &filter, path, &pathCount, 256), DT_PARTIAL_RESULT));
+	}
+
+	SECTION("Tracks components per filter class")
+	{
+		// Excluding a column of polygons in the middle tiles splits the left side off.
+		dtQueryFilter narrow;
+		narrow.setExcludeFlags(2);
+		const int filterClass = index->addFilterClass(&narrow);
+		REQUIRE(filterClass == 1);
+		for (int z = 0; z < grid.cellsZ(); ++z)
+		{
+			float pos[3];
+			const dtPolyRef ref = findCellPoly(query, 9, z, pos);
+			REQUIRE(dtStatusSucceed(nav->setPolyFlags(ref, 3)));
+		}
+		const dtNavMesh* cnav = nav;
+		for (int z = 0; z < grid.tilesZ; ++z)
+			index->rebuildTile(cnav->getTileAt(1, z, 0));
+
+		REQUIRE(index->isReachable(startRef, nearRef, 0));
+		REQUIRE(!index->isReachable(startRef, nearRef, filterClass));
+	}
+
+	SECTION("Follows tile changes")
+	{
+		const unsigned int before = index->getComponent(startRef, 0);
+		REQUIRE(before);
+
+		// Removing the top left tile does not change the rest of the component.
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 2, 0), 0, 0)));
+		REQUIRE(index->getComponent(startRef, 0) == index->getComponent(nearRef, 0));
+
+		// Removing the middle column of tiles leaves the left column connected on its own.
+		for (int z = 0; z < 3; ++z)
+			REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, z, 0), 0, 0)));
+		float pos[3];
+		REQUIRE(index->isReachable(startRef, findCellPoly(query, 3, 10, pos), 0));
+		REQUIRE(!index->getComponent(nearRef, 0));
+		for (int z = 0; z < 3; ++z)
+			REQUIRE(grid.addTile(nav, 1, z));
+		REQUIRE(grid.addTile(nav, 0, 2));
+
+		const dtPolyRef newNearRef = findCellPoly(query, 10, 20, nearPos);
+		REQUIRE(index->isReachable(startRef, newNearRef, 0));
+		REQUIRE(!index->isReachable(newNearRef, islandRef, 0));
+	}
+
+	dtFreeComponentIndex(index);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtComponentIndex incremental update")
+{
+	// A wall splits off the left strip of the mesh, with a single opening in the bottom left tile.
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 0; z < grid.cellsZ(); ++z)
+	{
+		if (z != 4)
+			grid.block(4, z);
+	}
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	dtComponentIndex* index = dtAllocComponentIndex();
+	REQUIRE(dtStatusSucceed(index->init(nav, &filter)));
+
+	SECTION("Splits a component when the connecting tile is removed")
+	{
+		float pos[3];
+		const dtPolyRef stripRef = findCellPoly(query, 1, 20, pos);
+		const dtPolyRef farRef = findCellPoly(query, 20, 20, pos);
+		REQUIRE(index->isReachable(stripRef, farRef, 0));
+
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 0, 0), 0, 0)));
+		REQUIRE(!index->isReachable(stripRef, farRef, 0));
+
+		REQUIRE(grid.addTile(nav, 0, 0));
+		REQUIRE(index->isReachable(stripRef, farRef, 0));
+	}
+
+	SECTION("Matches a freshly built index after tile changes")
+	{
+		unsigned int seed = 1;
+		for (int iter = 0; iter < 60; ++iter)
+		{
+			seed = seed * 1103515245u + 12345u;
+			const int tx = (int)((seed >> 16) % 3);
+			const int tz = (int)((seed >> 20) % 3);
+			const dtTileRef tileRef = nav->getTileRefAt(tx, tz, 0);
+			if (tileRef)
+				REQUIRE(dtStatusSucceed(nav->removeTile(tileRef, 0, 0)));
+			else
+				REQUIRE(grid.addTile(nav, tx, tz));
+
+			dtComponentIndex* fresh = dtAllocComponentIndex();
+			REQUIRE(dtStatusSucceed(fresh->init(nav, &filter)));
+
+			dtPolyRef refs[36];
+			int nrefs = 0;
+			for (int z = 1; z < grid.cellsZ(); z += 4)
+			{
+				for (int x = 1; x < grid.cellsX(); x += 4)
+				{
+					float pos[3];
+					refs[nrefs++] = findCellPoly(query, x, z, pos);
+				}
+			}
+			for (int i = 0; i < nrefs; ++i)
+			{
+				REQUIRE((index->getComponent(refs[i], 0) != 0) == (fresh->getComponent(refs[i], 0) != 0));
+				for (int j = i + 1; j < nrefs; ++j)
+					REQUIRE(index->isReachable(refs[i], refs[j], 0) == fresh->isReachable(refs[i], refs[j], 0));
+			}
+
+			dtFreeComponentIndex(fresh);
+		}
+	}
+
+	dtFreeComponentIndex(index);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,191 @@
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourIncrementalPath.h"
+#include "DetourTestMesh.h"
+
+// Rebuilds the tile at the specified location from the grid.
+static void rebuildTile(const TestGridMesh& grid, dtNavMesh* nav, const int tx, const int tz)
+{
+	REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(tx, tz, 0), 0, 0)));
+	REQUIRE(grid.addTile(nav, tx, tz));
+}
+
+// Runs a search from scratch and returns the number of expanded polygons.
+static int freshSearch(const dtNavMesh* nav, dtPolyRef startRef, dtPolyRef goalRef, const float* goalPos,
+					   const dtQueryFilter* filter, int* pathCount)
+{
+	dtIncrementalPathQuery* fresh = dtAllocIncrementalPathQuery();
+	REQUIRE(dtStatusSucceed(fresh->init(nav, 4096)));
+	REQUIRE(dtStatusSucceed(fresh->setGoal(goalRef, goalPos, filter)));
+	dtPolyRef path[256];
+	REQUIRE(dtStatusSucceed(fresh->findPath(startRef, path, pathCount, 256)));
+	const int expanded = fresh->getExpandedCount();
+	dtFreeIncrementalPathQuery(fresh);
+	return expanded;
+}
+
+TEST_CASE("dtIncrementalPathQuery")
+{
+	TestGridMesh grid(4, 4, 8);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+
+	float startPos[3], goalPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 2, 16, startPos);
+	const dtPolyRef goalRef = findCellPoly(query, 29, 16, goalPos);
+	REQUIRE(startRef);
+	REQUIRE(goalRef);
+
+	dtIncrementalPathQuery* replanner = dtAllocIncrementalPathQuery();
+	REQUIRE(replanner);
+	REQUIRE(dtStatusSucceed(replanner->init(nav, 4096)));
+	REQUIRE(dtStatusSucceed(replanner->setGoal(goalRef, goalPos, &filter)));
+	REQUIRE(dtStatusSucceed(nav->addTileListener(replanner)));
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+	dtStatus status = replanner->findPath(startRef, path, &pathCount, 256);
+	REQUIRE(dtStatusSucceed(status));
+	REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+	REQUIRE(path[0] == startRef);
+	REQUIRE(path[pathCount-1] == goalRef);
+	REQUIRE(isConnectedPath(nav, path, pathCount));
+	// The straight route along the row.
+	REQUIRE(pathCount == 28);
+	const int initialExpanded = replanner->getExpandedCount();
+	REQUIRE(initialExpanded > 0);
+
+	SECTION("Unchanged searches reuse the tree")
+	{
+		REQUIRE(dtStatusSucceed(replanner->findPath(startRef, path, &pathCount, 256)));
+		REQUIRE(replanner->getExpandedCount() == 0);
+		REQUIRE(pathCount == 28);
+	}
+
+	SECTION("Moving the start along the path")
+	{
+		const dtPolyRef nextRef = path[5];
+		REQUIRE(dtStatusSucceed(replanner->findPath(nextRef, path, &pathCount, 256)));
+		REQUIRE(path[0] == nextRef);
+		REQUIRE(path[pathCount-1] == goalRef);
+		REQUIRE(pathCount == 23);
+		REQUIRE(replanner->getExpandedCount() < initialExpanded);
+	}
+
+	SECTION("Rebuilding tiles away from the path only checks the tree")
+	{
+		grid.block(4, 4);
+		rebuildTile(grid, nav, 0, 0);
+		rebuildTile(grid, nav, 3, 3);
+
+		REQUIRE(dtStatusSucceed(replanner->findPath(startRef, path, &pathCount, 256)));
+		REQUIRE(replanner->getExpandedCount() == 0);
+		REQUIRE(pathCount == 28);
+	}
+
+	SECTION("Repairs the path around an obstacle added to rebuilt tiles")
+	{
+		// The agent's tile is rebuilt too, so its polygon gets a new reference.
+		for (int z = 14; z < 19; ++z)
+			grid.block(5, z);
+		rebuildTile(grid, nav, 0, 1);
+		rebuildTile(grid, nav, 0, 2);
+		REQUIRE(!nav->isValidPolyRef(startRef));
+		const dtPolyRef newStartRef = findCellPoly(query, 2, 16, startPos);
+		REQUIRE(newStartRef);
+
+		status = replanner->findPath(newStartRef, path, &pathCount, 256);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[0] == newStartRef);
+		REQUIRE(path[pathCount-1] == goalRef);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(nav->isValidPolyRef(path[i]));
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+
+		int freshCount = 0;
+		const int freshExpanded = freshSearch(nav, newStartRef, goalRef, goalPos, &filter, &freshCount);
+		REQUIRE(pathCount == freshCount);
+		REQUIRE(replanner->getExpandedCount() <= freshExpanded);
+
+		SECTION("And back to the straight path when the obstacle is removed")
+		{
+			for (int z = 14; z < 19; ++z)
+				grid.blocked[z * grid.cellsX() + 5] = 0;
+			rebuildTile(grid, nav, 0, 1);
+			rebuildTile(grid, nav, 0, 2);
+
+			REQUIRE(dtStatusSucceed(replanner->findPath(findCellPoly(query, 2, 16, startPos), path, &pathCount, 256)));
+			REQUIRE(pathCount == 28);
+			REQUIRE(isConnectedPath(nav, path, pathCount));
+		}
+	}
+
+	SECTION("Reports a partial result when the goal is walled in")
+	{
+		for (int z = 0; z < grid.cellsZ(); ++z)
+			grid.block(20, z);
+		for (int tz = 0; tz < 4; ++tz)
+			rebuildTile(grid, nav, 2, tz);
+
+		status = replanner->findPath(startRef, path, &pathCount, 256);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(pathCount == 1);
+		REQUIRE(path[0] == startRef);
+	}
+
+	nav->removeTileListener(replanner);
+	dtFreeIncrementalPathQuery(replanner);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtIncrementalPathQuery reuses the nodes of removed polygons")
+{
+	TestGridMesh grid(4, 4, 8);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+
+	float startPos[3], goalPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 2, 16, startPos);
+	const dtPolyRef goalRef = findCellPoly(query, 29, 16, goalPos);
+
+	// The search tree of the path holds less than a hundred polygons.
+	const int maxNodes = 128;
+	dtIncrementalPathQuery* replanner = dtAllocIncrementalPathQuery();
+	REQUIRE(dtStatusSucceed(replanner->init(nav, maxNodes)));
+	REQUIRE(dtStatusSucceed(replanner->setGoal(goalRef, goalPos, &filter)));
+	REQUIRE(dtStatusSucceed(nav->addTileListener(replanner)));
+
+	// Each rebuild replaces the polygons of a tile on the path, more in total than the tree can hold.
+	const int rebuilds = 20;
+	dtPolyRef path[256];
+	int pathCount = 0;
+	for (int i = 0; i <= rebuilds; ++i)
+	{
+		if (i > 0)
+			rebuildTile(grid, nav, 1, 2);
+		const dtStatus status = replanner->findPath(startRef, path, &pathCount, 256);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_OUT_OF_NODES));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(pathCount == 28);
+		REQUIRE(path[pathCount-1] == goalRef);
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+		REQUIRE(replanner->getNodeCount() <= maxNodes);
+	}
+
+	nav->removeTileListener(replanner);
+	dtFreeIncrementalPathQuery(replanner);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
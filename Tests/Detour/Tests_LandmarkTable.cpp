@@ -0,0 +1,260 @@
+#include <stdlib.h>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourLandmarkTable.h"
+#include "DetourTestMesh.h"
+
+TEST_CASE("dtLandmarkTable")
+{
+	// 4x4 tiles with a long wall, the straight line heuristic leads the search into the dead end.
+	TestGridMesh grid(4, 4, 8);
+	for (int z = 0; z < grid.cellsZ() - 2; ++z)
+		grid.block(16, z);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	dtLandmarkTable* table = dtAllocLandmarkTable();
+	REQUIRE(dtStatusSucceed(table->init(nav, &filter, 4)));
+	REQUIRE(dtStatusSucceed(table->build()));
+	for (int i = 0; i < table->getLandmarkCount(); ++i)
+		REQUIRE(nav->isValidPolyRef(table->getLandmarkRef(i)));
+
+	float startPos[3], endPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 14, 1, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 18, 1, endPos);
+	REQUIRE(startRef);
+	REQUIRE(endRef);
+
+	dtPolyRef path[512];
+	int pathCount = 0;
+	dtPolyRef altPath[512];
+	int altPathCount = 0;
+
+	SECTION("Finds the same path with fewer nodes")
+	{
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 512)));
+		const int nodeCount = query->getNodePool()->getNodeCount();
+
+		query->setLandmarkTable(table);
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, altPath, &altPathCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(altPath[altPathCount - 1] == endRef);
+		REQUIRE(isConnectedPath(nav, altPath, altPathCount));
+		REQUIRE(abs(altPathCount - pathCount) <= 2);
+		REQUIRE(query->getNodePool()->getNodeCount() < nodeCount);
+
+		// The sliced search uses the table as well.
+		dtStatus slicedStatus = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter);
+		while (dtStatusInProgress(slicedStatus))
+			slicedStatus = query->updateSlicedFindPath(16, 0);
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(path, &pathCount, 512)));
+		REQUIRE(pathCount == altPathCount);
+	}
+
+	SECTION("Stores and restores the distances")
+	{
+		std::vector<unsigned char> data(table->getDataSize());
+		REQUIRE(dtStatusSucceed(table->store(&data[0], (int)data.size())));
+
+		dtLandmarkTable* restored = dtAllocLandmarkTable();
+		REQUIRE(dtStatusSucceed(restored->init(nav, &filter, 4)));
+		REQUIRE(dtStatusSucceed(restored->restore(&data[0], (int)data.size())));
+		for (int i = 0; i < 4; ++i)
+			REQUIRE(restored->getLandmarkRef(i) == table->getLandmarkRef(i));
+		const float* a = table->getPolyDistances(endRef);
+		const float* b = restored->getPolyDistances(endRef);
+		REQUIRE(a);
+		REQUIRE(b);
+		for (int i = 0; i < 4; ++i)
+			REQUIRE(a[i] == b[i]);
+		dtFreeLandmarkTable(restored);
+	}
+
+	SECTION("Follows tile removal and re-adding")
+	{
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(2, 0, 0), 0, 0)));
+		REQUIRE(!table->getPolyDistances(endRef));
+
+		REQUIRE(grid.addTile(nav, 2, 0));
+		const dtPolyRef newEndRef = findCellPoly(query, 18, 1, endPos);
+		const float* dist = table->getPolyDistances(newEndRef);
+		REQUIRE(dist);
+		for (int i = 0; i < table->getLandmarkCount(); ++i)
+			REQUIRE(dist[i] >= 0.0f);
+
+		query->setLandmarkTable(table);
+		const dtStatus status = query->findPath(startRef, newEndRef, startPos, endPos, &filter, altPath, &altPathCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(isConnectedPath(nav, altPath, altPathCount));
+	}
+
+	dtFreeLandmarkTable(table);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+// Finds paths between random cells with and without the table and checks that the
+// table's bound never exceeds the cost of the rest of the corridor. Returns the number
+// of pairs with a complete path.
+static int checkLowerBounds(const TestGridMesh& grid, dtNavMesh* nav, dtNavMeshQuery* query,
+							const dtQueryFilter* filter, const dtLandmarkTable* table, unsigned int seed)
+{
+	dtPolyRef path[512];
+	int pathCount = 0;
+	dtPolyRef altPath[512];
+	int altPathCount = 0;
+	int pairCount = 0;
+	const int cellCount = grid.cellsX() * grid.cellsZ();
+	for (int i = 0; i < 200; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		const int cell0 = (int)((seed >> 8) % cellCount);
+		seed = seed * 1103515245u + 12345u;
+		const int cell1 = (int)((seed >> 8) % cellCount);
+		if (grid.blocked[cell0] || grid.blocked[cell1])
+			continue;
+		float startPos[3], endPos[3];
+		const dtPolyRef startRef = findCellPoly(query, cell0 % grid.cellsX(), cell0 / grid.cellsX(), startPos);
+		const dtPolyRef endRef = findCellPoly(query, cell1 % grid.cellsX(), cell1 / grid.cellsX(), endPos);
+		REQUIRE(startRef);
+		REQUIRE(endRef);
+
+		query->setLandmarkTable(0);
+		dtStatus status = query->findPath(startRef, endRef, startPos, endPos, filter, path, &pathCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		if (dtStatusDetail(status, DT_PARTIAL_RESULT))
+			continue;
+		pairCount++;
+
+		// Wherever the corridor enters a polygon, the bound to the end is at most the rest of the corridor.
+		const float* endDist = table->getPolyDistances(endRef);
+		REQUIRE(endDist);
+		for (int j = 1; j < pathCount; ++j)
+		{
+			float mid[3];
+			REQUIRE(portalMidPoint(nav, path[j-1], path[j], mid));
+			const float rest = pathCost(nav, filter, path + j, pathCount - j, mid, endPos);
+			const float* dist = table->getPolyDistances(path[j]);
+			REQUIRE(dist);
+			REQUIRE(table->getLowerBound(dist, endDist) <= rest + 1e-4f);
+		}
+
+		// So the table does not lead the search to a more expensive corridor.
+		query->setLandmarkTable(table);
+		status = query->findPath(startRef, endRef, startPos, endPos, filter, altPath, &altPathCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(altPath[0] == path[0]);
+		REQUIRE(altPath[altPathCount - 1] == path[pathCount - 1]);
+		REQUIRE(pathCost(nav, filter, altPath, altPathCount, startPos, endPos) <=
+				Catch::Approx(pathCost(nav, filter, path, pathCount, startPos, endPos)).epsilon(1e-4));
+	}
+	return pairCount;
+}
+
+TEST_CASE("dtLandmarkTable lower bound")
+{
+	// Scattered obstacles and area costs, so that the portal mid points the searches
+	// walk through are far from the straight lines between the polygon centers.
+	TestGridMesh grid(3, 3, 8);
+	unsigned int seed = 12345;
+	std::vector<unsigned char> areas(grid.cellsX() * grid.cellsZ(), 0);
+	for (int i = 0; i < (int)areas.size(); ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		const unsigned int r = (seed >> 16) % 10;
+		if (r == 0)
+			grid.blocked[i] = 1;
+		else if (r < 4)
+			areas[i] = (unsigned char)r;
+	}
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	filter.setAreaCost(1, 1.5f);
+	filter.setAreaCost(2, 4.0f);
+	filter.setAreaCost(3, 0.5f);
+	float pos[3];
+	for (int z = 0; z < grid.cellsZ(); ++z)
+	{
+		for (int x = 0; x < grid.cellsX(); ++x)
+		{
+			if (!grid.isBlocked(x, z) && areas[z * grid.cellsX() + x])
+				REQUIRE(dtStatusSucceed(nav->setPolyArea(findCellPoly(query, x, z, pos), areas[z * grid.cellsX() + x])));
+		}
+	}
+
+	dtLandmarkTable* table = dtAllocLandmarkTable();
+	REQUIRE(dtStatusSucceed(table->init(nav, &filter, 8)));
+	REQUIRE(dtStatusSucceed(table->build()));
+
+	SECTION("After building")
+	{
+		REQUIRE(checkLowerBounds(grid, nav, query, &filter, table, seed) > 100);
+	}
+
+	SECTION("After removing and re-adding a tile")
+	{
+		// The middle tile comes back without its obstacles, opening shorter routes around it.
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 1, 0), 0, 0)));
+		for (int z = 8; z < 16; ++z)
+		{
+			for (int x = 8; x < 16; ++x)
+			{
+				grid.blocked[z * grid.cellsX() + x] = 0;
+			}
+		}
+		REQUIRE(grid.addTile(nav, 1, 1));
+		REQUIRE(checkLowerBounds(grid, nav, query, &filter, table, seed) > 100);
+	}
+
+	SECTION("After restoring")
+	{
+		std::vector<unsigned char> data(table->getDataSize());
+		REQUIRE(dtStatusSucceed(table->store(&data[0], (int)data.size())));
+
+		// Remove a tile, the restored table has to rebuild it and its neighbours.
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(2, 1, 0), 0, 0)));
+		REQUIRE(grid.addTile(nav, 2, 1));
+
+		dtLandmarkTable* restored = dtAllocLandmarkTable();
+		REQUIRE(dtStatusSucceed(restored->init(nav, &filter, 8)));
+		REQUIRE(dtStatusSucceed(restored->restore(&data[0], (int)data.size())));
+		REQUIRE(checkLowerBounds(grid, nav, query, &filter, restored, seed) > 100);
+		dtFreeLandmarkTable(restored);
+	}
+
+	SECTION("Rejects a truncated or corrupt buffer")
+	{
+		std::vector<unsigned char> data(table->getDataSize());
+		REQUIRE(dtStatusSucceed(table->store(&data[0], (int)data.size())));
+
+		dtLandmarkTable* restored = dtAllocLandmarkTable();
+		REQUIRE(dtStatusSucceed(restored->init(nav, &filter, 8)));
+		REQUIRE(dtStatusFailed(restored->restore(&data[0], (int)data.size() - 1)));
+
+		// A huge link count must not wrap around the size check.
+		int* counts = (int*)&data[sizeof(int) * 4 + sizeof(dtPolyRef) * DT_MAX_LANDMARKS + sizeof(dtTileRef)];
+		counts[1] = 0x7fffffff;
+		REQUIRE(dtStatusFailed(restored->restore(&data[0], (int)data.size())));
+		dtFreeLandmarkTable(restored);
+	}
+
+	dtFreeLandmarkTable(table);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
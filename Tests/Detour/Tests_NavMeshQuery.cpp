@@ -0,0 +1,1489 @@
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <limits>
+#include <set>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNavMeshQueryTemplates.h"
+#include "DetourTestMesh.h"
+
+TEST_CASE("dtNavMeshQuery::findPath bidirectional")
+{
+	// 3x3 tiles with a wall that has a single gap, forcing a detour through several tiles.
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 0; z < grid.cellsZ() - 2; ++z)
+		grid.block(12, z);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	float startPos[3], endPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 1, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 22, 2, endPos);
+	REQUIRE(startRef);
+	REQUIRE(endRef);
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+	dtPolyRef biPath[256];
+	int biPathCount = 0;
+
+	SECTION("Finds a complete connected path")
+	{
+		// On an open grid the two searches can settle on different corridors of slightly
+		// different cost, so only the end points and the connectivity are compared here.
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)));
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, biPath, &biPathCount, 256, DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(biPath[0] == startRef);
+		REQUIRE(biPath[biPathCount - 1] == endRef);
+		REQUIRE(isConnectedPath(nav, biPath, biPathCount));
+		REQUIRE(biPath[0] == path[0]);
+		REQUIRE(biPath[biPathCount - 1] == path[pathCount - 1]);
+	}
+
+	SECTION("Takes the cheaper way around a loop")
+	{
+		// A one cell wide loop, so each polygon on the cheaper side is entered through one edge
+		// only and both searches must return a corridor of the optimal cost. Most of one side is
+		// costly, so the geometrically shorter way is not always the cheaper one.
+		TestGridMesh loop(2, 2, 6);
+		for (int z = 0; z < loop.cellsZ(); ++z)
+		{
+			for (int x = 0; x < loop.cellsX(); ++x)
+			{
+				const bool onLoop = x >= 1 && x <= 10 && z >= 1 && z <= 8 && (x == 1 || x == 10 || z == 1 || z == 8);
+				if (!onLoop)
+					loop.block(x, z);
+			}
+		}
+		dtNavMesh* loopNav = loop.createNavMesh();
+		REQUIRE(dtStatusSucceed(query->init(loopNav, 2048)));
+		filter.setAreaCost(1, 2.5f);
+		for (int z = 2; z <= 7; ++z)
+		{
+			float pos[3];
+			REQUIRE(dtStatusSucceed(loopNav->setPolyArea(findCellPoly(query, 10, z, pos), 1)));
+		}
+
+		static const int pairs[][4] = {
+			{ 1, 1, 10, 6 }, { 3, 1, 10, 8 }, { 5, 1, 8, 8 }, { 10, 3, 1, 7 }, { 10, 7, 2, 1 },
+			{ 1, 2, 10, 6 }, { 3, 1, 3, 8 }, { 1, 4, 10, 5 } };
+		for (int p = 0; p < 8; ++p)
+		{
+			const dtPolyRef s = findCellPoly(query, pairs[p][0], pairs[p][1], startPos);
+			const dtPolyRef e = findCellPoly(query, pairs[p][2], pairs[p][3], endPos);
+			REQUIRE(s);
+			REQUIRE(e);
+			REQUIRE(dtStatusSucceed(query->findPath(s, e, startPos, endPos, &filter, path, &pathCount, 256)));
+			REQUIRE(dtStatusSucceed(query->findPath(s, e, startPos, endPos, &filter, biPath, &biPathCount, 256, DT_FINDPATH_BIDIRECTIONAL)));
+			REQUIRE(biPath[0] == path[0]);
+			REQUIRE(biPath[biPathCount - 1] == path[pathCount - 1]);
+			REQUIRE(isConnectedPath(loopNav, biPath, biPathCount));
+			REQUIRE(pathCost(loopNav, &filter, biPath, biPathCount, startPos, endPos) ==
+					Catch::Approx(pathCost(loopNav, &filter, path, pathCount, startPos, endPos)).epsilon(1e-5));
+		}
+		dtFreeNavMesh(loopNav);
+	}
+
+	SECTION("Rejects any-angle together with bidirectional")
+	{
+		const dtStatus status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter,
+														  DT_FINDPATH_ANY_ANGLE | DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusFailed(status));
+		REQUIRE(dtStatusDetail(status, DT_INVALID_PARAM));
+	}
+
+	SECTION("Sliced search returns the same path")
+	{
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, biPath, &biPathCount, 256, DT_FINDPATH_BIDIRECTIONAL)));
+
+		dtStatus status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter, DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusInProgress(status));
+		while (dtStatusInProgress(status))
+			status = query->updateSlicedFindPath(7, 0);
+		REQUIRE(dtStatusSucceed(status));
+		status = query->finalizeSlicedFindPath(path, &pathCount, 256);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(pathCount == biPathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(path[i] == biPath[i]);
+	}
+
+	SECTION("Unreachable end returns a partial path")
+	{
+		// The cell at the far corner is walled in.
+		grid.block(grid.cellsX() - 2, grid.cellsZ() - 1);
+		grid.block(grid.cellsX() - 1, grid.cellsZ() - 2);
+		grid.block(grid.cellsX() - 2, grid.cellsZ() - 2);
+		dtNavMesh* nav2 = grid.createNavMesh();
+		REQUIRE(dtStatusSucceed(query->init(nav2, 2048)));
+		float islandPos[3];
+		const dtPolyRef s = findCellPoly(query, 1, 1, startPos);
+		const dtPolyRef islandRef = findCellPoly(query, grid.cellsX() - 1, grid.cellsZ() - 1, islandPos);
+		REQUIRE(islandRef);
+
+		const dtStatus status = query->findPath(s, islandRef, startPos, islandPos, &filter, biPath, &biPathCount, 256, DT_FINDPATH_BIDIRECTIONAL);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(biPath[0] == s);
+		REQUIRE(biPath[biPathCount - 1] != islandRef);
+		REQUIRE(isConnectedPath(nav2, biPath, biPathCount));
+		dtFreeNavMesh(nav2);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery::findPositionHeights")
+{
+	TestGridMesh grid(2, 2, 8);
+	grid.block(3, 3);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.1f, 2.0f, 0.1f };
+
+	SECTION("Finds the height of a single point")
+	{
+		const float center[3] = { 5.25f, 0.5f, 2.75f };
+		float height = -1.0f;
+		REQUIRE(dtStatusSucceed(query->findPositionHeight(center, halfExtents, &filter, &height)));
+		REQUIRE(height == Catch::Approx(0.0f));
+
+		const float hole[3] = { 3.5f, 0.5f, 3.5f };
+		height = -1.0f;
+		REQUIRE(dtStatusFailed(query->findPositionHeight(hole, halfExtents, &filter, &height)));
+		REQUIRE(height == -1.0f);
+	}
+
+	SECTION("Batched heights match single queries")
+	{
+		static const int count = 200;
+		float centers[count * 3];
+		srand(1);
+		for (int i = 0; i < count; ++i)
+		{
+			centers[i * 3 + 0] = (rand() % 1600) / 100.0f;
+			centers[i * 3 + 1] = 0.5f;
+			centers[i * 3 + 2] = (rand() % 1600) / 100.0f;
+		}
+		// One point in the hole.
+		centers[0] = 3.5f;
+		centers[2] = 3.5f;
+
+		float heights[count];
+		bool found[count];
+		for (int i = 0; i < count; ++i)
+			heights[i] = -1.0f;
+		REQUIRE(dtStatusSucceed(query->findPositionHeights(centers, count, halfExtents, &filter, heights, found)));
+		REQUIRE(!found[0]);
+		REQUIRE(heights[0] == -1.0f);
+
+		for (int i = 0; i < count; ++i)
+		{
+			float height = -1.0f;
+			const dtStatus status = query->findPositionHeight(&centers[i * 3], halfExtents, &filter, &height);
+			REQUIRE(dtStatusSucceed(status) == found[i]);
+			REQUIRE(height == heights[i]);
+		}
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery::findNearestPolys")
+{
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 4; z < 20; ++z)
+		grid.block(12, z);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1.5f, 2.0f, 1.5f };
+
+	static const int count = 300;
+	float centers[count * 3];
+	srand(7);
+	for (int i = 0; i < count; ++i)
+	{
+		// Include points outside the mesh and over the wall.
+		centers[i * 3 + 0] = (rand() % 2800) / 100.0f - 2.0f;
+		centers[i * 3 + 1] = (rand() % 200) / 100.0f - 1.0f;
+		centers[i * 3 + 2] = (rand() % 2800) / 100.0f - 2.0f;
+	}
+
+	dtPolyRef refs[count];
+	float points[count * 3];
+	bool overPoly[count];
+	REQUIRE(dtStatusSucceed(query->findNearestPolys(centers, count, halfExtents, &filter, refs, points, overPoly)));
+
+	for (int i = 0; i < count; ++i)
+	{
+		dtPolyRef ref = 0;
+		float pt[3];
+		bool over = false;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(&centers[i * 3], halfExtents, &filter, &ref, pt, &over)));
+		REQUIRE(refs[i] == ref);
+		if (ref)
+		{
+			REQUIRE(points[i * 3 + 0] == pt[0]);
+			REQUIRE(points[i * 3 + 1] == pt[1]);
+			REQUIRE(points[i * 3 + 2] == pt[2]);
+			REQUIRE(overPoly[i] == over);
+		}
+	}
+
+	SECTION("Rejects invalid search boxes")
+	{
+		const float negativeExtents[3] = { 1.5f, -2.0f, 1.5f };
+		REQUIRE(query->findNearestPolys(centers, count, negativeExtents, &filter, refs, 0, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		const float nanExtents[3] = { 1.5f, nan, 1.5f };
+		REQUIRE(query->findNearestPolys(centers, count, nanExtents, &filter, refs, 0, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+
+		centers[5] = nan;
+		REQUIRE(query->findNearestPolys(centers, count, halfExtents, &filter, refs, 0, 0) == (DT_FAILURE | DT_INVALID_PARAM));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery::findNearestPoly best-first")
+{
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 4; z < 20; ++z)
+		grid.block(12, z);
+	for (int x = 2; x < 7; ++x)
+		grid.block(x, 17);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+
+	dtQueryFilter filter;
+	const float extents[3][3] = { { 1.5f, 2.0f, 1.5f }, { 6.0f, 10.0f, 6.0f }, { 30.0f, 30.0f, 30.0f } };
+
+	srand(11);
+	for (int i = 0; i < 600; ++i)
+	{
+		// Points on grid vertices and edges have several polygons at the same distance.
+		float center[3];
+		const float snap = (i % 3) == 0 ? 2.0f : 100.0f;
+		center[0] = (float)(rand() % (int)(28 * snap)) / snap - 2.0f;
+		center[1] = (rand() % 1200) / 100.0f - 4.0f;
+		center[2] = (float)(rand() % (int)(28 * snap)) / snap - 2.0f;
+		const float* halfExtents = extents[i % 3];
+
+		// The reference result from visiting every polygon in the search box.
+		dtFindNearestPolyQuery expected(query, center);
+		REQUIRE(dtStatusSucceed(query->queryPolygons(center, halfExtents, &filter, &expected)));
+
+		dtPolyRef ref = 0;
+		float pt[3];
+		bool over = false;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, &filter, &ref, pt, &over)));
+		REQUIRE(ref == expected.nearestRef());
+		if (ref)
+		{
+			REQUIRE(pt[0] == expected.nearestPoint()[0]);
+			REQUIRE(pt[1] == expected.nearestPoint()[1]);
+			REQUIRE(pt[2] == expected.nearestPoint()[2]);
+			REQUIRE(over == expected.isOverPoly());
+		}
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery::findPolyAt")
+{
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 4; z < 20; ++z)
+		grid.block(12, z);
+	for (int x = 2; x < 7; ++x)
+		grid.block(x, 17);
+
+	dtNavMesh* plain = grid.createNavMesh();
+	dtNavMesh* fine = grid.createNavMesh(DT_NAVMESH_POLY_GRID);
+	dtNavMesh* coarse = grid.createNavMesh(DT_NAVMESH_POLY_GRID, 3.0f);
+	REQUIRE(plain);
+	REQUIRE(fine);
+	REQUIRE(coarse);
+
+	SECTION("Reports the grid memory")
+	{
+		REQUIRE(plain->getPolyGridMemUsed() == 0);
+		REQUIRE(fine->getPolyGridMemUsed() > 0);
+		REQUIRE(coarse->getPolyGridMemUsed() > 0);
+		REQUIRE(coarse->getPolyGridMemUsed() < fine->getPolyGridMemUsed());
+
+		const int before = fine->getPolyGridMemUsed();
+		REQUIRE(dtStatusSucceed(fine->removeTile(fine->getTileRefAt(1, 1, 0), 0, 0)));
+		REQUIRE(fine->getPolyGridMemUsed() < before);
+		REQUIRE(grid.addTile(fine, 1, 1));
+		REQUIRE(fine->getPolyGridMemUsed() == before);
+	}
+
+	SECTION("Finds the same polygons with and without the grid")
+	{
+		dtNavMesh* navs[3] = { plain, fine, coarse };
+		dtNavMeshQuery* queries[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			queries[i] = dtAllocNavMeshQuery();
+			REQUIRE(dtStatusSucceed(queries[i]->init(navs[i], 256)));
+		}
+
+		dtQueryFilter filter;
+		srand(5);
+		for (int i = 0; i < 500; ++i)
+		{
+			// Keep the positions off the polygon edges so that each is inside a single polygon.
+			const int cx = rand() % 28 - 2;
+			const int cz = rand() % 28 - 2;
+			float pos[3];
+			pos[0] = cx + 0.05f + (rand() % 90) / 100.0f;
+			pos[1] = (rand() % 300) / 100.0f - 1.5f;
+			pos[2] = cz + 0.05f + (rand() % 90) / 100.0f;
+			const float maxHeightDiff = 1.0f;
+			const bool expected = !grid.isBlocked(cx, cz) && dtAbs(pos[1]) <= maxHeightDiff;
+
+			for (int j = 0; j < 3; ++j)
+			{
+				dtPolyRef ref = 0;
+				float height = -1.0f;
+				REQUIRE(dtStatusSucceed(queries[j]->findPolyAt(pos, maxHeightDiff, &filter, &ref, &height)));
+				if (expected)
+				{
+					float center[3];
+					REQUIRE(ref == findCellPoly(queries[j], cx, cz, center));
+					REQUIRE(height == Catch::Approx(0.0f).margin(1e-4f));
+				}
+				else
+				{
+					REQUIRE(ref == 0);
+				}
+			}
+		}
+
+		for (int i = 0; i < 3; ++i)
+			dtFreeNavMeshQuery(queries[i]);
+	}
+
+	dtFreeNavMesh(coarse);
+	dtFreeNavMesh(fine);
+	dtFreeNavMesh(plain);
+}
+
+// Builds a single 8x8 polygon whose detail mesh is a bumpy 4x4 grid of quads, 32 triangles in all.
+static bool buildBumpyTile(unsigned char** outData, int* outDataSize)
+{
+	const unsigned short verts[4*3] = { 0,0,0, 0,0,16, 16,0,16, 16,0,0 };
+	const unsigned short polys[4*2] = { 0, 1, 2, 3, 0xffff, 0xffff, 0xffff, 0xffff };
+	const unsigned short polyFlags[1] = { 1 };
+	const unsigned char polyAreas[1] = { 0 };
+
+	// The detail vertices start with the polygon vertices.
+	static const int corners[4][2] = { { 0, 0 }, { 0, 4 }, { 4, 4 }, { 4, 0 } };
+	int index[5][5];
+	float detailVerts[25*3];
+	int nverts = 0;
+	for (int i = 0; i < 4; ++i)
+		index[corners[i][1]][corners[i][0]] = nverts++;
+	for (int z = 0; z < 5; ++z)
+	{
+		for (int x = 0; x < 5; ++x)
+		{
+			const bool corner = (x == 0 || x == 4) && (z == 0 || z == 4);
+			if (!corner)
+				index[z][x] = nverts++;
+		}
+	}
+	for (int z = 0; z < 5; ++z)
+	{
+		for (int x = 0; x < 5; ++x)
+		{
+			float* v = &detailVerts[index[z][x]*3];
+			v[0] = x * 2.0f;
+			v[1] = (x == 0 || x == 4) && (z == 0 || z == 4) ? 0.0f : 0.1f * (float)((x * 3 + z * 5) % 7);
+			v[2] = z * 2.0f;
+		}
+	}
+	unsigned char detailTris[32*4];
+	int ntris = 0;
+	for (int z = 0; z < 4; ++z)
+	{
+		for (int x = 0; x < 4; ++x)
+		{
+			const int tris[2][3][2] = { { { x, z }, { x, z+1 }, { x+1, z+1 } }, { { x, z }, { x+1, z+1 }, { x+1, z } } };
+			for (int i = 0; i < 2; ++i)
+			{
+				unsigned char* t = &detailTris[ntris*4];
+				t[3] = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					const int* va = tris[i][k];
+					const int* vb = tris[i][(k+1) % 3];
+					t[k] = (unsigned char)index[va[1]][va[0]];
+					// Flag the edges on the polygon boundary.
+					if ((va[0] == vb[0] && (va[0] == 0 || va[0] == 4)) || (va[1] == vb[1] && (va[1] == 0 || va[1] == 4)))
+						t[3] |= (unsigned char)(DT_DETAIL_EDGE_BOUNDARY << (k*2));
+				}
+				ntris++;
+			}
+		}
+	}
+	const unsigned int detailMeshes[4] = { 0, (unsigned int)nverts, 0, (unsigned int)ntris };
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = verts;
+	params.vertCount = 4;
+	params.polys = polys;
+	params.polyFlags = polyFlags;
+	params.polyAreas = polyAreas;
+	params.polyCount = 1;
+	params.nvp = 4;
+	params.detailMeshes = detailMeshes;
+	params.detailVerts = detailVerts;
+	params.detailVertsCount = nverts;
+	params.detailTris = detailTris;
+	params.detailTriCount = ntris;
+	params.bmax[0] = 8.0f;
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = 8.0f;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.5f;
+	params.walkableClimb = 0.5f;
+	params.cs = 0.5f;
+	params.ch = 0.5f;
+	params.buildBvTree = true;
+	return dtCreateNavMeshData(&params, outData, outDataSize);
+}
+
+static dtNavMesh* createBumpyNavMesh(const int flags)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 8.0f;
+	params.tileHeight = 8.0f;
+	params.maxTiles = 1;
+	params.maxPolys = 1;
+	params.flags = flags;
+
+	unsigned char* data = 0;
+	int dataSize = 0;
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(&params)) || !buildBumpyTile(&data, &dataSize))
+	{
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	if (dtStatusFailed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)))
+	{
+		dtFree(data);
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	return nav;
+}
+
+TEST_CASE("dtNavMesh detail planes")
+{
+	dtNavMesh* plain = createBumpyNavMesh(0);
+	dtNavMesh* planes = createBumpyNavMesh(DT_NAVMESH_DETAIL_PLANES);
+	REQUIRE(plain);
+	REQUIRE(planes);
+	REQUIRE(plain->getDetailPlanesMemUsed() == 0);
+	REQUIRE(planes->getDetailPlanesMemUsed() > 0);
+
+	dtNavMeshQuery* plainQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* planesQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(plainQuery->init(plain, 64)));
+	REQUIRE(dtStatusSucceed(planesQuery->init(planes, 64)));
+
+	const dtPolyRef plainRef = plain->getPolyRefBase(plain->getTileAt(0, 0, 0));
+	const dtPolyRef planesRef = planes->getPolyRefBase(planes->getTileAt(0, 0, 0));
+
+	SECTION("Heights match the plain search")
+	{
+		// Samples on triangle edges, vertices and grid cell borders as well as in between.
+		int bumps = 0;
+		for (int z = -2; z <= 66; ++z)
+		{
+			for (int x = -2; x <= 66; ++x)
+			{
+				const float pos[3] = { x * 0.125f, 5.0f, z * 0.125f + (x % 3) * 0.01f };
+				float plainHeight = -1.0f, planesHeight = -1.0f;
+				const dtStatus plainStatus = plainQuery->getPolyHeight(plainRef, pos, &plainHeight);
+				const dtStatus planesStatus = planesQuery->getPolyHeight(planesRef, pos, &planesHeight);
+				REQUIRE(plainStatus == planesStatus);
+				REQUIRE(plainHeight == planesHeight);
+				if (plainHeight > 0.0f)
+					bumps++;
+
+				float plainClosest[3], planesClosest[3];
+				bool plainOver = false, planesOver = false;
+				REQUIRE(dtStatusSucceed(plainQuery->closestPointOnPoly(plainRef, pos, plainClosest, &plainOver)));
+				REQUIRE(dtStatusSucceed(planesQuery->closestPointOnPoly(planesRef, pos, planesClosest, &planesOver)));
+				REQUIRE(plainOver == planesOver);
+				REQUIRE(dtVequal(plainClosest, planesClosest));
+			}
+		}
+		REQUIRE(bumps > 0);
+	}
+
+	SECTION("Tables are rebuilt with the tile")
+	{
+		const int memUsed = planes->getDetailPlanesMemUsed();
+		REQUIRE(dtStatusSucceed(planes->removeTile(planes->getTileRefAt(0, 0, 0), 0, 0)));
+		REQUIRE(planes->getDetailPlanesMemUsed() == 0);
+
+		unsigned char* data = 0;
+		int dataSize = 0;
+		REQUIRE(buildBumpyTile(&data, &dataSize));
+		REQUIRE(dtStatusSucceed(planes->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+		REQUIRE(planes->getDetailPlanesMemUsed() == memUsed);
+	}
+
+	dtFreeNavMeshQuery(planesQuery);
+	dtFreeNavMeshQuery(plainQuery);
+	dtFreeNavMesh(planes);
+	dtFreeNavMesh(plain);
+}
+
+TEST_CASE("dtNavMeshQuery::findPathToAny")
+{
+	// 3x3 tiles with a wall that has a single gap at the far end.
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 0; z < grid.cellsZ() - 2; ++z)
+		grid.block(12, z);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	float startPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 1, startPos);
+	REQUIRE(startRef);
+
+	// The first goal is closer in a straight line, but behind the wall.
+	dtPolyRef goalRefs[2];
+	float goalPositions[6];
+	goalRefs[0] = findCellPoly(query, 14, 1, &goalPositions[0]);
+	goalRefs[1] = findCellPoly(query, 1, 20, &goalPositions[3]);
+	REQUIRE(goalRefs[0]);
+	REQUIRE(goalRefs[1]);
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+	int goalIndex = -1;
+
+	SECTION("Finds the path to the cheapest goal")
+	{
+		const dtStatus status = query->findPathToAny(startRef, startPos, goalRefs, goalPositions, 2, &filter,
+													 path, &pathCount, 256, &goalIndex);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(goalIndex == 1);
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount-1] == goalRefs[1]);
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+
+		dtPolyRef single[256];
+		int singleCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, goalRefs[1], startPos, &goalPositions[3], &filter, single, &singleCount, 256)));
+		REQUIRE(pathCount == singleCount);
+	}
+
+	SECTION("Reaches a goal that is the only one left")
+	{
+		const dtStatus status = query->findPathToAny(startRef, startPos, goalRefs, goalPositions, 1, &filter,
+													 path, &pathCount, 256, &goalIndex);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(goalIndex == 0);
+		REQUIRE(path[pathCount-1] == goalRefs[0]);
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+	}
+
+	SECTION("Returns the start polygon when it is a goal")
+	{
+		goalRefs[1] = startRef;
+		REQUIRE(dtStatusSucceed(query->findPathToAny(startRef, startPos, goalRefs, goalPositions, 2, &filter,
+													 path, &pathCount, 256, &goalIndex)));
+		REQUIRE(pathCount == 1);
+		REQUIRE(goalIndex == 1);
+	}
+
+	SECTION("Rejects invalid goals")
+	{
+		goalRefs[1] = 0;
+		REQUIRE(dtStatusFailed(query->findPathToAny(startRef, startPos, goalRefs, goalPositions, 2, &filter,
+													path, &pathCount, 256, &goalIndex)));
+		REQUIRE(goalIndex == -1);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery::computeCostMatrix")
+{
+	// 3x3 tiles with a wall that has a single gap, and a walled in island in the top right corner.
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 0; z < grid.cellsZ() - 2; ++z)
+		grid.block(12, z);
+	for (int i = 18; i < 24; ++i)
+	{
+		grid.block(18, i);
+		grid.block(i, 18);
+	}
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	const int cells[4][2] = { { 1, 1 }, { 10, 1 }, { 14, 1 }, { 21, 21 } };
+	dtPolyRef refs[4];
+	float positions[12];
+	for (int i = 0; i < 4; ++i)
+	{
+		refs[i] = findCellPoly(query, cells[i][0], cells[i][1], &positions[i*3]);
+		REQUIRE(refs[i]);
+	}
+
+	float costs[16];
+	REQUIRE(dtStatusSucceed(query->computeCostMatrix(refs, positions, 4, refs, positions, 4, &filter, costs)));
+
+	for (int i = 0; i < 3; ++i)
+	{
+		REQUIRE(costs[i*4 + i] == 0.0f);
+		for (int j = 0; j < 3; ++j)
+			REQUIRE(costs[i*4 + j] >= dtVdist(&positions[i*3], &positions[j*3]) * 0.999f);
+
+		// The island cannot be reached in either direction.
+		REQUIRE(costs[i*4 + 3] == FLT_MAX);
+		REQUIRE(costs[3*4 + i] == FLT_MAX);
+	}
+
+	// The target behind the wall takes the detour through the gap, about 44.6 units
+	// along the shortest path and a bit more along the edge midpoints.
+	REQUIRE(costs[0*4 + 1] < 10.0f);
+	REQUIRE(costs[0*4 + 2] > 44.5f);
+	REQUIRE(costs[0*4 + 2] < 50.0f);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// A filter that does not derive from dtQueryFilter, rejecting a set of polygons.
+struct BlockedSetFilter
+{
+	std::set<dtPolyRef> blocked;
+
+	bool passFilter(const dtPolyRef ref, const dtMeshTile*, const dtPoly*) const
+	{
+		return blocked.find(ref) == blocked.end();
+	}
+
+	float getCost(const float* pa, const float* pb,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*,
+				  const dtPolyRef, const dtMeshTile*, const dtPoly*) const
+	{
+		return dtVdist(pa, pb);
+	}
+};
+}
+
+TEST_CASE("dtNavMeshQuery filter templates")
+{
+	// The polygons of a wall with a single gap are excluded by the filters instead of
+	// being left out of the mesh.
+	TestGridMesh grid(3, 3, 8);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	BlockedSetFilter custom;
+	dtQueryFilter flags;
+	flags.setExcludeFlags(2);
+	float pos[3];
+	for (int z = 0; z < grid.cellsZ() - 2; ++z)
+	{
+		const dtPolyRef ref = findCellPoly(query, 12, z, pos);
+		REQUIRE(ref);
+		custom.blocked.insert(ref);
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(ref, 2)));
+	}
+
+	float startPos[3], endPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 1, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 22, 2, endPos);
+
+	SECTION("findPathT matches findPath")
+	{
+		dtPolyRef path[256], pathT[256];
+		int pathCount = 0, pathCountT = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &flags, path, &pathCount, 256)));
+		REQUIRE(dtStatusSucceed(query->findPathT(startRef, endRef, startPos, endPos, &custom, pathT, &pathCountT, 256)));
+		REQUIRE(pathCount == pathCountT);
+		for (int i = 0; i < pathCount; ++i)
+		{
+			REQUIRE(path[i] == pathT[i]);
+			REQUIRE(custom.passFilter(pathT[i], 0, 0));
+		}
+	}
+
+	SECTION("raycastT matches raycast")
+	{
+		dtRaycastHit hit, hitT;
+		memset(&hit, 0, sizeof(hit));
+		memset(&hitT, 0, sizeof(hitT));
+		REQUIRE(dtStatusSucceed(query->raycast(startRef, startPos, endPos, &flags, 0, &hit)));
+		REQUIRE(dtStatusSucceed(query->raycastT(startRef, startPos, endPos, &custom, 0, &hitT)));
+		REQUIRE(hit.t < 1.0f);
+		REQUIRE(hitT.t == hit.t);
+	}
+
+	SECTION("findNearestPolyT matches findNearestPoly")
+	{
+		float center[3];
+		TestGridMesh::cellCenter(12, 5, center);
+		const float halfExtents[3] = { 2.0f, 1.0f, 2.0f };
+		dtPolyRef ref = 0, refT = 0;
+		float nearest[3], nearestT[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, &flags, &ref, nearest)));
+		REQUIRE(dtStatusSucceed(query->findNearestPolyT(center, halfExtents, &custom, &refT, nearestT)));
+		REQUIRE(refT);
+		REQUIRE(refT == ref);
+		REQUIRE(custom.passFilter(refT, 0, 0));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// A fake clock that advances one microsecond per read.
+dtTimeVal s_fakeTime = 0;
+dtTimeVal fakeTimeUsec()
+{
+	return s_fakeTime++;
+}
+}
+
+TEST_CASE("dtNavMeshQuery::updateSlicedFindPathTimed")
+{
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 0; z < grid.cellsZ() - 2; ++z)
+		grid.block(12, z);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+
+	float startPos[3], endPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 1, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 22, 2, endPos);
+	REQUIRE(startRef);
+	REQUIRE(endRef);
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+	dtStatus status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter);
+	while (dtStatusInProgress(status))
+		status = query->updateSlicedFindPath(8, 0);
+	REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(path, &pathCount, 256)));
+
+	dtTimeSetCustom(fakeTimeUsec);
+	s_fakeTime = 0;
+
+	SECTION("Stops at the deadline and reports the work done")
+	{
+		status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter);
+		REQUIRE(dtStatusInProgress(status));
+
+		// The update reads the clock once on entry and once after each batch,
+		// so the deadline is hit after three batches.
+		int doneIters = 0, doneTime = 0;
+		status = query->updateSlicedFindPathTimed(dtGetTimeUsec() + 4, &doneIters, &doneTime, 5);
+		REQUIRE(dtStatusInProgress(status));
+		REQUIRE(doneIters == 15);
+		REQUIRE(doneTime == 3);
+
+		// A deadline in the past still runs one batch.
+		status = query->updateSlicedFindPathTimed(0, &doneIters, &doneTime, 5);
+		REQUIRE(dtStatusInProgress(status));
+		REQUIRE(doneIters == 5);
+		REQUIRE(doneTime == 1);
+	}
+
+	SECTION("Finds the same path as the iteration budgeted update")
+	{
+		status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter);
+		int updates = 0, totalIters = 0;
+		while (dtStatusInProgress(status))
+		{
+			int doneIters = 0;
+			status = query->updateSlicedFindPathTimed(dtGetTimeUsec() + 2, &doneIters, 0, 8);
+			REQUIRE(doneIters > 0);
+			totalIters += doneIters;
+			updates++;
+		}
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(updates > 1);
+		REQUIRE(totalIters > 0);
+
+		dtPolyRef slicedPath[256];
+		int slicedCount = 0;
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(slicedPath, &slicedCount, 256)));
+		REQUIRE(slicedCount == pathCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(slicedPath[i] == path[i]);
+	}
+
+	dtTimeSetCustom(0);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery weighted and anytime search")
+{
+	// A long wall with a gap at the far end forces a detour.
+	TestGridMesh grid(4, 4, 8);
+	for (int z = 0; z < grid.cellsZ() - 3; ++z)
+		grid.block(16, z);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 4096)));
+	dtQueryFilter filter;
+
+	float startPos[3], endPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 2, 2, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 30, 4, endPos);
+	REQUIRE(startRef);
+	REQUIRE(endRef);
+
+	dtPolyRef path[512];
+	int pathCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 512)));
+	REQUIRE(path[pathCount - 1] == endRef);
+	const float optimalCost = query->getNodePool()->findNode(endRef, 0)->cost;
+	const int optimalNodes = query->getNodePool()->getNodeCount();
+
+	SECTION("Weighted search stays within the cost bound")
+	{
+		const float weight = 3.0f;
+		const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 512, 0, weight);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[pathCount - 1] == endRef);
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+		const float cost = query->getNodePool()->findNode(endRef, 0)->cost;
+		REQUIRE(cost >= optimalCost - 0.001f);
+		REQUIRE(cost <= optimalCost * weight);
+		REQUIRE(query->getNodePool()->getNodeCount() < optimalNodes);
+	}
+
+	SECTION("Invalid weights are rejected")
+	{
+		REQUIRE(dtStatusFailed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 512, 0, 0.5f)));
+		REQUIRE(dtStatusFailed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 512,
+											   DT_FINDPATH_BIDIRECTIONAL, 2.0f)));
+		REQUIRE(dtStatusFailed(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter,
+														 DT_FINDPATH_ANYTIME | DT_FINDPATH_BIDIRECTIONAL, 2.0f)));
+	}
+
+	SECTION("Anytime search refines the path to the optimal one")
+	{
+		dtStatus status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter, DT_FINDPATH_ANYTIME, 3.0f);
+		REQUIRE(dtStatusInProgress(status));
+		REQUIRE(query->getSlicedFindPathBound() == FLT_MAX);
+
+		float lastBound = FLT_MAX;
+		float firstCost = FLT_MAX;
+		int boundChanges = 0;
+		while (dtStatusInProgress(status))
+		{
+			status = query->updateSlicedFindPath(8, 0);
+			const float bound = query->getSlicedFindPathBound();
+			REQUIRE(bound <= lastBound);
+			if (bound < lastBound)
+			{
+				if (lastBound == FLT_MAX)
+					firstCost = query->getNodePool()->findNode(endRef, 0)->cost;
+				boundChanges++;
+			}
+			lastBound = bound;
+		}
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(boundChanges > 1);
+		REQUIRE(lastBound == 1.0f);
+		// The node positions depend on the order the polygons were first reached in,
+		// so the refined cost can differ slightly from the cost found by findPath.
+		const float cost = query->getNodePool()->findNode(endRef, 0)->cost;
+		REQUIRE(cost <= firstCost);
+		REQUIRE(cost <= optimalCost * 1.05f);
+
+		dtPolyRef slicedPath[512];
+		int slicedCount = 0;
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(slicedPath, &slicedCount, 512)));
+		REQUIRE(slicedPath[0] == startRef);
+		REQUIRE(slicedPath[slicedCount - 1] == endRef);
+		REQUIRE(isConnectedPath(nav, slicedPath, slicedCount));
+	}
+
+	SECTION("The first anytime path can be taken before the refinement ends")
+	{
+		dtStatus status = query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter, DT_FINDPATH_ANYTIME, 3.0f);
+		while (dtStatusInProgress(status) && query->getSlicedFindPathBound() == FLT_MAX)
+			status = query->updateSlicedFindPath(8, 0);
+		REQUIRE(dtStatusInProgress(status));
+		REQUIRE(query->getSlicedFindPathBound() <= 3.0f);
+
+		dtPolyRef slicedPath[512];
+		int slicedCount = 0;
+		status = query->finalizeSlicedFindPath(slicedPath, &slicedCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(slicedPath[slicedCount - 1] == endRef);
+		REQUIRE(isConnectedPath(nav, slicedPath, slicedCount));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh::init options")
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 8.0f;
+	params.tileHeight = 8.0f;
+	params.maxTiles = 4;
+	params.maxPolys = 64;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+
+	SECTION("Accepts the known options")
+	{
+		params.flags = DT_NAVMESH_PORTAL_TABLE | DT_NAVMESH_POLY_GRID | DT_NAVMESH_DETAIL_PLANES;
+		REQUIRE(dtStatusSucceed(nav->init(&params)));
+	}
+
+	SECTION("Rejects unknown option bits")
+	{
+		params.flags = 0x100;
+		REQUIRE(nav->init(&params) == (DT_FAILURE | DT_INVALID_PARAM));
+	}
+
+	SECTION("Rejects an invalid poly grid cell size")
+	{
+		params.polyGridCellSize = -1.0f;
+		REQUIRE(nav->init(&params) == (DT_FAILURE | DT_INVALID_PARAM));
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh portal table")
+{
+	TestGridMesh grid(3, 2, 6);
+	for (int z = 2; z < 10; ++z)
+		grid.block(7, z);
+	grid.block(12, 3);
+	dtNavMesh* plain = grid.createNavMesh();
+	dtNavMesh* table = grid.createNavMesh(DT_NAVMESH_PORTAL_TABLE);
+	REQUIRE(plain);
+	REQUIRE(table);
+	const dtNavMesh* constPlain = plain;
+	const dtNavMesh* constTable = table;
+
+	dtNavMeshQuery* plainQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* tableQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(plainQuery->init(plain, 512)));
+	REQUIRE(dtStatusSucceed(tableQuery->init(table, 512)));
+	dtQueryFilter filter;
+
+	SECTION("Stores the portal of each link")
+	{
+		for (int i = 0; i < table->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = constTable->getTile(i);
+			if (!tile->header)
+				continue;
+			REQUIRE(tile->portals);
+			REQUIRE(!constPlain->getTile(i)->portals);
+			for (int j = 0; j < tile->header->polyCount; ++j)
+			{
+				const dtPoly* poly = &tile->polys[j];
+				for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+				{
+					const dtLink* link = &tile->links[k];
+					const dtLinkPortal* portal = &tile->portals[k];
+					const float* va = &tile->verts[poly->verts[link->edge]*3];
+					const float* vb = &tile->verts[poly->verts[(link->edge+1) % poly->vertCount]*3];
+					REQUIRE(dtVequal(portal->left, va));
+					REQUIRE(dtVequal(portal->right, vb));
+					REQUIRE(portal->mid[0] == Catch::Approx((va[0] + vb[0]) * 0.5f));
+					REQUIRE(portal->mid[2] == Catch::Approx((va[2] + vb[2]) * 0.5f));
+				}
+			}
+		}
+	}
+
+	SECTION("Queries match the mesh without the table")
+	{
+		REQUIRE(dtStatusSucceed(table->removeTile(table->getTileRefAt(1, 0, 0), 0, 0)));
+		REQUIRE(grid.addTile(table, 1, 0));
+		REQUIRE(table->getTileAt(1, 0, 0)->portals);
+
+		static const int pairs[][4] = { { 1, 1, 16, 10 }, { 3, 5, 9, 5 }, { 15, 1, 0, 11 } };
+		for (int p = 0; p < 3; ++p)
+		{
+			float startPos[3], endPos[3];
+			const dtPolyRef plainStart = findCellPoly(plainQuery, pairs[p][0], pairs[p][1], startPos);
+			const dtPolyRef plainEnd = findCellPoly(plainQuery, pairs[p][2], pairs[p][3], endPos);
+			const dtPolyRef tableStart = findCellPoly(tableQuery, pairs[p][0], pairs[p][1], startPos);
+			const dtPolyRef tableEnd = findCellPoly(tableQuery, pairs[p][2], pairs[p][3], endPos);
+
+			dtPolyRef plainPath[128], tablePath[128];
+			int plainCount = 0, tableCount = 0;
+			REQUIRE(dtStatusSucceed(plainQuery->findPath(plainStart, plainEnd, startPos, endPos, &filter, plainPath, &plainCount, 128)));
+			REQUIRE(dtStatusSucceed(tableQuery->findPath(tableStart, tableEnd, startPos, endPos, &filter, tablePath, &tableCount, 128)));
+			REQUIRE(plainCount == tableCount);
+
+			float plainStraight[128*3], tableStraight[128*3];
+			int plainStraightCount = 0, tableStraightCount = 0;
+			REQUIRE(dtStatusSucceed(plainQuery->findStraightPath(startPos, endPos, plainPath, plainCount,
+																 plainStraight, 0, 0, &plainStraightCount, 128)));
+			REQUIRE(dtStatusSucceed(tableQuery->findStraightPath(startPos, endPos, tablePath, tableCount,
+																 tableStraight, 0, 0, &tableStraightCount, 128)));
+			REQUIRE(plainStraightCount == tableStraightCount);
+			for (int i = 0; i < plainStraightCount; ++i)
+				REQUIRE(dtVequal(&plainStraight[i*3], &tableStraight[i*3]));
+		}
+	}
+
+	dtFreeNavMeshQuery(tableQuery);
+	dtFreeNavMeshQuery(plainQuery);
+	dtFreeNavMesh(table);
+	dtFreeNavMesh(plain);
+}
+
+TEST_CASE("dtNavMeshQuery::raycastBatch")
+{
+	TestGridMesh grid(3, 3, 8);
+	for (int i = 0; i < 40; ++i)
+	{
+		const int x = (i * 7 + 3) % grid.cellsX();
+		const int z = (i * 13 + 5) % grid.cellsZ();
+		if (abs(x - 12) > 1 || abs(z - 12) > 1)
+			grid.block(x, z);
+	}
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	float center[3];
+	const dtPolyRef startRef = findCellPoly(query, 12, 12, center);
+	REQUIRE(startRef);
+
+	// A fan of rays of varying length, more than fit in one batch, from slightly
+	// different points of the start polygon.
+	static const int RAY_COUNT = 100;
+	float startPos[RAY_COUNT*3], endPos[RAY_COUNT*3];
+	for (int i = 0; i < RAY_COUNT; ++i)
+	{
+		const float a = (float)i / RAY_COUNT * 6.2831853f;
+		const float len = 3.0f + (i % 5) * 2.5f;
+		startPos[i*3+0] = center[0] + ((i % 3) - 1) * 0.2f;
+		startPos[i*3+1] = center[1];
+		startPos[i*3+2] = center[2] + ((i % 4) - 1.5f) * 0.1f;
+		endPos[i*3+0] = center[0] + cosf(a) * len;
+		endPos[i*3+1] = center[1];
+		endPos[i*3+2] = center[2] + sinf(a) * len;
+	}
+
+	const unsigned int options[2] = { 0, DT_RAYCAST_USE_COSTS };
+	const int maxPaths[2] = { 64, 3 };
+	for (int o = 0; o < 2; ++o)
+	{
+		for (int m = 0; m < 2; ++m)
+		{
+			dtPolyRef batchPaths[RAY_COUNT][64];
+			dtRaycastHit batchHits[RAY_COUNT];
+			dtStatus rayStatus[RAY_COUNT];
+			for (int i = 0; i < RAY_COUNT; ++i)
+			{
+				batchHits[i].path = batchPaths[i];
+				batchHits[i].maxPath = maxPaths[m];
+			}
+			const dtStatus batchStatus = query->raycastBatch(startRef, startPos, endPos, RAY_COUNT, &filter, options[o], batchHits, rayStatus);
+			REQUIRE(dtStatusSucceed(batchStatus));
+
+			dtStatus combined = DT_SUCCESS;
+			int wallHits = 0;
+			for (int i = 0; i < RAY_COUNT; ++i)
+			{
+				dtPolyRef path[64];
+				dtRaycastHit hit;
+				hit.path = path;
+				hit.maxPath = maxPaths[m];
+				const dtStatus status = query->raycast(startRef, &startPos[i*3], &endPos[i*3], &filter, options[o], &hit);
+				combined |= status;
+				if (hit.t < 1.0f)
+					wallHits++;
+
+				const dtRaycastHit& batch = batchHits[i];
+				REQUIRE(rayStatus[i] == status);
+				REQUIRE(batch.t == hit.t);
+				REQUIRE(batch.pathCount == hit.pathCount);
+				REQUIRE(batch.pathCost == hit.pathCost);
+				for (int j = 0; j < hit.pathCount; ++j)
+					REQUIRE(batch.path[j] == hit.path[j]);
+				REQUIRE(batch.hitEdgeIndex == hit.hitEdgeIndex);
+				for (int j = 0; j < 3; ++j)
+					REQUIRE(batch.hitNormal[j] == hit.hitNormal[j]);
+			}
+			REQUIRE(batchStatus == combined);
+			REQUIRE(wallHits > 0);
+			REQUIRE(wallHits < RAY_COUNT);
+			REQUIRE(dtStatusDetail(combined, DT_BUFFER_TOO_SMALL) == (maxPaths[m] < 64));
+		}
+	}
+
+	SECTION("Rejects invalid input")
+	{
+		dtRaycastHit hits[RAY_COUNT];
+		REQUIRE(dtStatusFailed(query->raycastBatch(0, startPos, endPos, RAY_COUNT, &filter, 0, hits)));
+		REQUIRE(dtStatusFailed(query->raycastBatch(startRef, 0, endPos, RAY_COUNT, &filter, 0, hits)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+// Collects the straight path into vectors, optionally stopping after a number of vertices.
+struct VectorPathSink : public dtStraightPathSink
+{
+	std::vector<float> verts;
+	std::vector<unsigned char> flags;
+	std::vector<dtPolyRef> refs;
+	int maxVerts;
+
+	explicit VectorPathSink(const int maxCount = 0x7fffffff) : maxVerts(maxCount) {}
+
+	bool appendVertex(const float* pos, const unsigned char f, const dtPolyRef ref)
+	{
+		verts.insert(verts.end(), pos, pos + 3);
+		flags.push_back(f);
+		refs.push_back(ref);
+		return (int)flags.size() < maxVerts;
+	}
+
+	void updateVertex(const unsigned char f, const dtPolyRef ref)
+	{
+		flags.back() = f;
+		refs.back() = ref;
+	}
+};
+}
+
+TEST_CASE("dtNavMeshQuery::findStraightPath sink")
+{
+	// A zig-zag corridor through walls with alternating gaps.
+	TestGridMesh grid(3, 1, 8);
+	for (int wall = 4; wall < grid.cellsX(); wall += 4)
+	{
+		const int gap = (wall / 4) % 2 ? grid.cellsZ() - 1 : 0;
+		for (int z = 0; z < grid.cellsZ(); ++z)
+		{
+			if (z != gap)
+				grid.block(wall, z);
+		}
+	}
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	float startPos[3], endPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 4, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 22, 4, endPos);
+	dtPolyRef path[256];
+	int pathCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)));
+
+	const int options[2] = { 0, DT_STRAIGHTPATH_ALL_CROSSINGS };
+	for (int o = 0; o < 2; ++o)
+	{
+		float straight[256*3];
+		unsigned char flags[256];
+		dtPolyRef refs[256];
+		int count = 0;
+		REQUIRE(dtStatusSucceed(query->findStraightPath(startPos, endPos, path, pathCount, straight, flags, refs, &count, 256, options[o])));
+		REQUIRE(count > 6);
+
+		// Emits the same vertices as the array version.
+		{
+			VectorPathSink sink;
+			const dtStatus status = query->findStraightPath(startPos, endPos, path, pathCount, &sink, options[o]);
+			REQUIRE(status == DT_SUCCESS);
+			REQUIRE((int)sink.flags.size() == count);
+			for (int i = 0; i < count; ++i)
+			{
+				REQUIRE(dtVequal(&sink.verts[i*3], &straight[i*3]));
+				REQUIRE(sink.flags[i] == flags[i]);
+				REQUIRE(sink.refs[i] == refs[i]);
+			}
+			REQUIRE(sink.flags.back() == DT_STRAIGHTPATH_END);
+		}
+
+		// Stops after the requested number of corners.
+		{
+			for (int k = 1; k < count; ++k)
+			{
+				VectorPathSink sink(k);
+				const dtStatus status = query->findStraightPath(startPos, endPos, path, pathCount, &sink, options[o]);
+
+				float partial[256*3];
+				int partialCount = 0;
+				const dtStatus partialStatus = query->findStraightPath(startPos, endPos, path, pathCount, partial, 0, 0, &partialCount, k, options[o]);
+				REQUIRE(status == partialStatus);
+				REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+				REQUIRE((int)sink.flags.size() == k);
+				REQUIRE(partialCount == k);
+				for (int i = 0; i < k; ++i)
+					REQUIRE(dtVequal(&sink.verts[i*3], &straight[i*3]));
+			}
+		}
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+// Converts tile data without the 4-wide tree to the version 7 layout, which has a shorter header.
+static void convertToVersion7(unsigned char* data, int* dataSize)
+{
+	const int headerSize = dtGetMeshHeaderSize(DT_NAVMESH_VERSION);
+	const int oldHeaderSize = dtGetMeshHeaderSize(7);
+	((dtMeshHeader*)data)->version = 7;
+	memmove(data + oldHeaderSize, data + headerSize, *dataSize - headerSize);
+	*dataSize -= headerSize - oldHeaderSize;
+}
+
+// Removes the later copies of repeated references and returns the new count. The binary tree
+// can report the first polygon of a tile twice, through the unused last node of the tree.
+static int removeRepeatedRefs(dtPolyRef* refs, const int count)
+{
+	int n = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		bool repeated = false;
+		for (int j = 0; j < n; ++j)
+			repeated = repeated || refs[j] == refs[i];
+		if (!repeated)
+			refs[n++] = refs[i];
+	}
+	return n;
+}
+
+TEST_CASE("dtNavMeshQuery 4-wide BV tree")
+{
+	SECTION("Tests the children like dtOverlapQuantBounds")
+	{
+		srand(7);
+		for (int i = 0; i < 4000; ++i)
+		{
+			// Small ranges touch often, the offset exercises the unsigned comparisons.
+			const unsigned short offset = (i & 1) ? 0xfff0 : 0;
+			dtBVWideNode node;
+			unsigned short qmin[3], qmax[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				for (int k = 0; k < DT_BVWIDE_CHILDREN; ++k)
+				{
+					const unsigned short a = (unsigned short)(rand() % 16);
+					const unsigned short b = (unsigned short)(rand() % 16);
+					node.bmin[j][k] = (unsigned short)(dtMin(a, b) + offset);
+					node.bmax[j][k] = (unsigned short)(dtMax(a, b) + offset);
+				}
+				const unsigned short a = (unsigned short)(rand() % 16);
+				const unsigned short b = (unsigned short)(rand() % 16);
+				qmin[j] = (unsigned short)(dtMin(a, b) + offset);
+				qmax[j] = (unsigned short)(dtMax(a, b) + offset);
+			}
+			if (i % 3 == 0)
+			{
+				// Unused slot.
+				for (int j = 0; j < 3; ++j)
+				{
+					node.bmin[j][3] = 0xffff;
+					node.bmax[j][3] = 0;
+				}
+			}
+
+			const unsigned int mask = dtOverlapQuantBoundsWide(qmin, qmax, &node);
+			REQUIRE(mask < (1u << DT_BVWIDE_CHILDREN));
+			for (int k = 0; k < DT_BVWIDE_CHILDREN; ++k)
+			{
+				const unsigned short cmin[3] = { node.bmin[0][k], node.bmin[1][k], node.bmin[2][k] };
+				const unsigned short cmax[3] = { node.bmax[0][k], node.bmax[1][k], node.bmax[2][k] };
+				REQUIRE(((mask >> k) & 1) == (dtOverlapQuantBounds(qmin, qmax, cmin, cmax) ? 1u : 0u));
+			}
+		}
+	}
+
+	SECTION("Queries match the binary tree and version 7 tiles")
+	{
+		TestGridMesh grid(3, 2, 7);
+		for (int z = 1; z < 12; ++z)
+			grid.block(9, z);
+		grid.block(3, 3);
+		grid.block(17, 0);
+		dtNavMesh* plain = grid.createNavMesh();
+		dtNavMesh* old = grid.createNavMesh();
+		grid.wideBvTree = true;
+		dtNavMesh* wide = grid.createNavMesh();
+		REQUIRE(plain);
+		REQUIRE(old);
+		REQUIRE(wide);
+
+		// Replace the tiles of the old mesh with version 7 data, keeping the references.
+		for (int tz = 0; tz < grid.tilesZ; ++tz)
+		{
+			for (int tx = 0; tx < grid.tilesX; ++tx)
+			{
+				const dtTileRef ref = old->getTileRefAt(tx, tz, 0);
+				REQUIRE(dtStatusSucceed(old->removeTile(ref, 0, 0)));
+				unsigned char* data = 0;
+				int dataSize = 0;
+				grid.wideBvTree = false;
+				REQUIRE(grid.buildTile(tx, tz, &data, &dataSize));
+				convertToVersion7(data, &dataSize);
+				REQUIRE(dtStatusSucceed(old->addTile(data, dataSize, DT_TILE_FREE_DATA, ref, 0)));
+
+				const dtMeshTile* oldTile = old->getTileAt(tx, tz, 0);
+				const dtMeshTile* wideTile = wide->getTileAt(tx, tz, 0);
+				REQUIRE(oldTile->header->version == 7);
+				REQUIRE(oldTile->bvTree);
+				REQUIRE(!oldTile->bvWideTree);
+				REQUIRE(wideTile->header->version == DT_NAVMESH_VERSION);
+				REQUIRE(wideTile->bvTree);
+				REQUIRE(wideTile->bvWideTree);
+				REQUIRE(!plain->getTileAt(tx, tz, 0)->bvWideTree);
+			}
+		}
+
+		dtNavMesh* meshes[3] = { plain, old, wide };
+		dtNavMeshQuery* queries[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			queries[i] = dtAllocNavMeshQuery();
+			REQUIRE(dtStatusSucceed(queries[i]->init(meshes[i], 64)));
+		}
+
+		dtQueryFilter filter;
+		srand(11);
+		for (int i = 0; i < 300; ++i)
+		{
+			// Half of the boxes are snapped to the cell borders.
+			const float snap = (i & 1) ? 2.0f : 100.0f;
+			const float center[3] = {
+				(float)(rand() % (int)(25 * snap)) / snap - 2.0f,
+				(float)(rand() % (int)(2 * snap)) / snap - 0.5f,
+				(float)(rand() % (int)(18 * snap)) / snap - 2.0f };
+			const float halfExtents[3] = {
+				(float)(rand() % (int)(4 * snap)) / snap,
+				(float)(1 + rand() % 2),
+				(float)(rand() % (int)(4 * snap)) / snap };
+
+			dtPolyRef polys[3][128];
+			int counts[3];
+			for (int j = 0; j < 3; ++j)
+			{
+				REQUIRE(dtStatusSucceed(queries[j]->queryPolygons(center, halfExtents, &filter, polys[j], &counts[j], 128)));
+				counts[j] = removeRepeatedRefs(polys[j], counts[j]);
+			}
+			for (int j = 1; j < 3; ++j)
+			{
+				REQUIRE(counts[j] == counts[0]);
+				for (int k = 0; k < counts[0]; ++k)
+					REQUIRE(polys[j][k] == polys[0][k]);
+			}
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			dtFreeNavMeshQuery(queries[i]);
+			dtFreeNavMesh(meshes[i]);
+		}
+	}
+
+	SECTION("Swaps the endianness of the tree")
+	{
+		TestGridMesh grid(1, 1, 9);
+		grid.wideBvTree = true;
+		unsigned char* data = 0;
+		int dataSize = 0;
+		REQUIRE(grid.buildTile(0, 0, &data, &dataSize));
+		const std::vector<unsigned char> original(data, data + dataSize);
+		const dtMeshHeader* header = (const dtMeshHeader*)data;
+		int swappedCount = header->bvWideNodeCount;
+		REQUIRE(swappedCount > 0);
+		dtSwapEndian(&swappedCount);
+
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(header->bvWideNodeCount == swappedCount);
+		REQUIRE(memcmp(&original[0], data, dataSize) != 0);
+		REQUIRE(dtNavMeshHeaderSwapEndian(data, dataSize));
+		REQUIRE(dtNavMeshDataSwapEndian(data, dataSize));
+		REQUIRE(memcmp(&original[0], data, dataSize) == 0);
+		dtFree(data);
+	}
+}
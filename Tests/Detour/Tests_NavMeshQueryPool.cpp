@@ -0,0 +1,181 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNavMeshQueryPool.h"
+#include "DetourTestMesh.h"
+
+namespace
+{
+struct QueryCase
+{
+	float startPos[3];
+	float endPos[3];
+	dtPolyRef startRef;
+	dtPolyRef endRef;
+	int pathCount;
+	dtPolyRef lastRef;
+	float rayT;
+};
+
+// Runs the queries of a case and stores the results.
+void runCase(dtNavMeshQuery* query, const dtQueryFilter* filter, QueryCase& c)
+{
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	query->findNearestPoly(c.startPos, halfExtents, filter, &c.startRef, 0);
+	query->findNearestPoly(c.endPos, halfExtents, filter, &c.endRef, 0);
+
+	dtPolyRef path[256];
+	c.pathCount = 0;
+	query->findPath(c.startRef, c.endRef, c.startPos, c.endPos, filter, path, &c.pathCount, 256);
+	c.lastRef = c.pathCount ? path[c.pathCount - 1] : 0;
+
+	float hitNormal[3];
+	int rayPathCount = 0;
+	c.rayT = 0;
+	query->raycast(c.startRef, c.startPos, c.endPos, filter, &c.rayT, hitNormal, path, &rayPathCount, 256);
+}
+}
+
+TEST_CASE("dtNavMeshQueryPool")
+{
+	TestGridMesh grid(4, 4, 8);
+	for (int z = 0; z < grid.cellsZ() - 3; ++z)
+		grid.block(15, z);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+
+	static const int queryCount = 4;
+	dtNavMeshQueryPool* pool = dtAllocNavMeshQueryPool();
+	REQUIRE(dtStatusSucceed(pool->init(nav, queryCount, 1024)));
+
+	SECTION("Leases each query object once")
+	{
+		dtNavMeshQuery* leased[queryCount];
+		for (int i = 0; i < queryCount; ++i)
+		{
+			leased[i] = pool->acquire();
+			REQUIRE(leased[i]);
+			for (int j = 0; j < i; ++j)
+				REQUIRE(leased[i] != leased[j]);
+		}
+		REQUIRE(!pool->acquire());
+		pool->release(leased[2]);
+		REQUIRE(pool->acquire() == leased[2]);
+		for (int i = 0; i < queryCount; ++i)
+			pool->release(leased[i]);
+
+		dtNavMeshQueryLease lease(pool);
+		REQUIRE(lease.get());
+	}
+
+	SECTION("Concurrent queries match single threaded results")
+	{
+		dtQueryFilter filter;
+		std::vector<QueryCase> cases(64);
+		for (size_t i = 0; i < cases.size(); ++i)
+		{
+			TestGridMesh::cellCenter((int)(i * 7) % grid.cellsX(), (int)(i * 13) % grid.cellsZ(), cases[i].startPos);
+			TestGridMesh::cellCenter((int)(i * 11 + 20) % grid.cellsX(), (int)(i * 5 + 3) % grid.cellsZ(), cases[i].endPos);
+		}
+
+		// Reference results.
+		dtNavMeshQuery* query = pool->acquire();
+		REQUIRE(query);
+		std::vector<QueryCase> expected = cases;
+		for (size_t i = 0; i < expected.size(); ++i)
+			runCase(query, &filter, expected[i]);
+		pool->release(query);
+
+		static const int threadCount = 8;
+		static const int iterations = 50;
+		std::atomic<int> mismatches(0);
+		std::atomic<int> inUse(0);
+		std::atomic<int> maxInUse(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; ++t)
+		{
+			threads.push_back(std::thread([&, t]()
+			{
+				for (int it = 0; it < iterations; ++it)
+				{
+					dtNavMeshQuery* q = 0;
+					while (!(q = pool->acquire()))
+						std::this_thread::yield();
+
+					const int n = ++inUse;
+					int prev = maxInUse.load();
+					while (n > prev && !maxInUse.compare_exchange_weak(prev, n)) {}
+
+					const size_t i = (size_t)(t * iterations + it) % cases.size();
+					QueryCase c = cases[i];
+					runCase(q, &filter, c);
+					const QueryCase& e = expected[i];
+					if (c.startRef != e.startRef || c.endRef != e.endRef || c.pathCount != e.pathCount ||
+						c.lastRef != e.lastRef || c.rayT != e.rayT)
+						mismatches++;
+
+					--inUse;
+					pool->release(q);
+				}
+			}));
+		}
+		for (size_t t = 0; t < threads.size(); ++t)
+			threads[t].join();
+
+		REQUIRE(mismatches.load() == 0);
+		REQUIRE(maxInUse.load() <= queryCount);
+	}
+
+	SECTION("Cost matrix rows split across threads")
+	{
+		dtQueryFilter filter;
+		static const int pointCount = 24;
+		dtPolyRef refs[pointCount];
+		float positions[pointCount * 3];
+		dtNavMeshQuery* query = pool->acquire();
+		REQUIRE(query);
+		for (int i = 0; i < pointCount; ++i)
+		{
+			refs[i] = findCellPoly(query, (i * 7) % grid.cellsX(), (i * 13) % grid.cellsZ(), &positions[i * 3]);
+			REQUIRE(refs[i]);
+		}
+
+		std::vector<float> expected(pointCount * pointCount);
+		REQUIRE(dtStatusSucceed(query->computeCostMatrix(refs, positions, pointCount, refs, positions, pointCount,
+														 &filter, &expected[0])));
+		pool->release(query);
+
+		// Each thread computes a range of rows with its own query.
+		static const int rowsPerThread = pointCount / queryCount;
+		std::vector<float> costs(pointCount * pointCount, -1.0f);
+		std::atomic<int> failures(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < queryCount; ++t)
+		{
+			threads.push_back(std::thread([&, t]()
+			{
+				dtNavMeshQueryLease lease(pool);
+				const int first = t * rowsPerThread;
+				if (!lease.get() ||
+					dtStatusFailed(lease.get()->computeCostMatrix(&refs[first], &positions[first * 3], rowsPerThread,
+																	refs, positions, pointCount, &filter,
+																	&costs[first * pointCount])))
+					failures++;
+			}));
+		}
+		for (size_t t = 0; t < threads.size(); ++t)
+			threads[t].join();
+
+		REQUIRE(failures.load() == 0);
+		REQUIRE(costs == expected);
+	}
+
+	dtFreeNavMeshQueryPool(pool);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,108 @@
+#include <set>
+
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourTestMesh.h"
+
+TEST_CASE("dtNodePool")
+{
+	SECTION("Finds nodes by reference and state")
+	{
+		dtNodePool pool(64, 16);
+		dtNode* a = pool.getNode(10);
+		dtNode* b = pool.getNode(10, 1);
+		dtNode* c = pool.getNode(11);
+		REQUIRE(a);
+		REQUIRE(b);
+		REQUIRE(c);
+		REQUIRE(a != b);
+		REQUIRE(pool.getNode(10) == a);
+		REQUIRE(pool.findNode(10, 1) == b);
+		REQUIRE(pool.findNode(12, 0) == 0);
+
+		dtNode* nodes[DT_MAX_STATES_PER_NODE];
+		REQUIRE(pool.findNodes(10, nodes, DT_MAX_STATES_PER_NODE) == 2);
+		REQUIRE(pool.getNodeAtIdx(pool.getNodeIdx(c)) == c);
+
+		pool.clear();
+		REQUIRE(pool.getNodeCount() == 0);
+		REQUIRE(pool.findNode(10, 0) == 0);
+		REQUIRE(pool.getPeakNodeCount() == 3);
+	}
+
+	SECTION("Runs out of nodes without spill nodes")
+	{
+		dtNodePool pool(64, 16);
+		for (int i = 0; i < 64; ++i)
+			REQUIRE(pool.getNode((dtPolyRef)(i + 1)));
+		REQUIRE(!pool.getNode(1000));
+		REQUIRE(pool.getNode(1));
+	}
+
+	SECTION("Allocates spill nodes on demand")
+	{
+		dtNodePool pool(64, 16, 2000);
+		const int baseMem = pool.getMemUsed();
+		for (int round = 0; round < 2; ++round)
+		{
+			for (int i = 0; i < 2064; ++i)
+			{
+				dtNode* node = pool.getNode((dtPolyRef)(i * 7 + 1), (unsigned char)(i & 1));
+				REQUIRE(node);
+				REQUIRE(pool.getNodeAtIdx(pool.getNodeIdx(node)) == node);
+			}
+			REQUIRE(!pool.getNode(100000));
+			for (int i = 0; i < 2064; ++i)
+				REQUIRE(pool.findNode((dtPolyRef)(i * 7 + 1), (unsigned char)(i & 1)));
+
+			// Every node is reachable through the hash slots.
+			std::set<dtNodeIndex> visited;
+			for (int i = 0; i < pool.getHashSize(); ++i)
+			{
+				for (dtNodeIndex j = pool.getFirst(i); j != DT_NULL_IDX; j = pool.getNext(j))
+					visited.insert(j);
+			}
+			REQUIRE((int)visited.size() == 2064);
+
+			pool.clear();
+			REQUIRE(!pool.findNode(1, 0));
+		}
+		REQUIRE(pool.getPeakNodeCount() == 2064);
+		REQUIRE(pool.getMemUsed() > baseMem + 2000 * (int)sizeof(dtNode));
+	}
+}
+
+TEST_CASE("dtNavMeshQuery with spill nodes")
+{
+	TestGridMesh grid(3, 3, 8);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+
+	float startPos[3], endPos[3];
+	dtQueryFilter filter;
+	dtPolyRef path[256];
+	int pathCount = 0;
+
+	REQUIRE(dtStatusSucceed(query->init(nav, 32)));
+	const dtPolyRef startRef = findCellPoly(query, 0, 0, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 23, 23, endPos);
+	dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256);
+	REQUIRE(dtStatusDetail(status, DT_OUT_OF_NODES));
+
+	REQUIRE(dtStatusSucceed(query->init(nav, 32, 2048)));
+	status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256);
+	REQUIRE(dtStatusSucceed(status));
+	REQUIRE(!dtStatusDetail(status, DT_OUT_OF_NODES | DT_PARTIAL_RESULT));
+	REQUIRE(path[pathCount - 1] == endRef);
+	REQUIRE(isConnectedPath(nav, path, pathCount));
+	REQUIRE(query->getNodePool()->getPeakNodeCount() > 32);
+
+	REQUIRE(dtStatusFailed(query->init(nav, 32, 65535)));
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,434 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+
+#include "Recast.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+
+#include "Bench.h"
+
+namespace
+{
+unsigned int s_seed = 1;
+
+void seedRandom(const unsigned int seed) { s_seed = seed; }
+
+float frand()
+{
+	s_seed = s_seed * 1103515245u + 12345u;
+	return (float)((s_seed >> 8) & 0xffff) / 65536.0f;
+}
+}
+
+TEMPLATE_TEST_CASE("Node queues pop in cost order", "", dtBinaryNodeQueue, dtDaryNodeQueue)
+{
+	static const int count = 512;
+	std::vector<dtNode> nodes(count);
+	TestType queue(count);
+	seedRandom(7);
+
+	SECTION("Push, modify and pop all")
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			nodes[i].total = frand() * 100.0f;
+			queue.push(&nodes[i]);
+		}
+		for (int i = 0; i < count; i += 3)
+		{
+			nodes[i].total *= 0.5f;
+			queue.modify(&nodes[i]);
+		}
+
+		float last = 0.0f;
+		int popped = 0;
+		while (!queue.empty())
+		{
+			REQUIRE(queue.top() == queue.top());
+			const dtNode* node = queue.pop();
+			REQUIRE(node->total >= last);
+			last = node->total;
+			popped++;
+		}
+		REQUIRE(popped == count);
+	}
+
+	SECTION("Monotone search pattern")
+	{
+		// Like a Dijkstra search, every pushed cost is at least the last popped one.
+		int pushed = 0;
+		nodes[pushed].total = 0.0f;
+		queue.push(&nodes[pushed++]);
+
+		float last = 0.0f;
+		int popped = 0;
+		while (!queue.empty())
+		{
+			const dtNode* node = queue.pop();
+			REQUIRE(node->total >= last);
+			last = node->total;
+			popped++;
+
+			for (int i = 0; i < 3 && pushed < count; ++i)
+			{
+				nodes[pushed].total = last + frand() * 10.0f;
+				queue.push(&nodes[pushed++]);
+			}
+		}
+		REQUIRE(popped == count);
+
+		queue.clear();
+		REQUIRE(queue.empty());
+	}
+}
+
+#ifdef TESTS_BENCHMARKS
+
+// Compares the open list implementations on A* searches over navigation meshes built
+// from the RecastDemo meshes. The meshes are copied next to the test executable.
+namespace
+{
+bool loadObj(const char* path, std::vector<float>& verts, std::vector<int>& tris)
+{
+	FILE* fp = fopen(path, "r");
+	if (!fp)
+		return false;
+
+	char line[512];
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (line[0] == 'v' && line[1] == ' ')
+		{
+			float x, y, z;
+			if (sscanf(line + 2, "%f %f %f", &x, &y, &z) == 3)
+			{
+				verts.push_back(x);
+				verts.push_back(y);
+				verts.push_back(z);
+			}
+		}
+		else if (line[0] == 'f' && line[1] == ' ')
+		{
+			// Triangulate the face as a fan, skipping texture and normal indices.
+			int face[32];
+			int n = 0;
+			char* s = line + 2;
+			while (n < 32)
+			{
+				char* end = 0;
+				const long idx = strtol(s, &end, 10);
+				if (end == s)
+					break;
+				face[n++] = idx < 0 ? (int)(verts.size() / 3 + idx) : (int)idx - 1;
+				s = end;
+				while (*s && *s != ' ' && *s != '\t')
+					s++;
+			}
+			for (int i = 2; i < n; ++i)
+			{
+				tris.push_back(face[0]);
+				tris.push_back(face[i - 1]);
+				tris.push_back(face[i]);
+			}
+		}
+	}
+	fclose(fp);
+	return !tris.empty();
+}
+
+// Builds a single tile navigation mesh with the RecastDemo default settings.
+dtNavMesh* buildNavMesh(const char* path)
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+	if (!loadObj(path, verts, tris))
+		return 0;
+	const int nverts = (int)verts.size() / 3;
+	const int ntris = (int)tris.size() / 3;
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = 0.3f;
+	cfg.ch = 0.2f;
+	cfg.walkableSlopeAngle = 45.0f;
+	cfg.walkableHeight = (int)ceilf(2.0f / cfg.ch);
+	cfg.walkableClimb = (int)floorf(0.9f / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(0.6f / cfg.cs);
+	cfg.maxEdgeLen = (int)(12.0f / cfg.cs);
+	cfg.maxSimplificationError = 1.3f;
+	cfg.minRegionArea = 8 * 8;
+	cfg.mergeRegionArea = 20 * 20;
+	cfg.maxVertsPerPoly = 6;
+	cfg.detailSampleDist = cfg.cs * 6.0f;
+	cfg.detailSampleMaxError = cfg.ch * 1.0f;
+	rcCalcBounds(&verts[0], nverts, cfg.bmin, cfg.bmax);
+	rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
+
+	rcContext ctx(false);
+	rcHeightfield* solid = rcAllocHeightfield();
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	rcContourSet* cset = rcAllocContourSet();
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+	std::vector<unsigned char> areas(ntris, 0);
+
+	bool ok = rcCreateHeightfield(&ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch);
+	if (ok)
+	{
+		rcMarkWalkableTriangles(&ctx, cfg.walkableSlopeAngle, &verts[0], nverts, &tris[0], ntris, &areas[0]);
+		ok = rcRasterizeTriangles(&ctx, &verts[0], nverts, &tris[0], &areas[0], ntris, *solid, cfg.walkableClimb);
+	}
+	if (ok)
+	{
+		rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, *solid);
+		rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, *solid);
+		rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, *solid);
+		ok = rcBuildCompactHeightfield(&ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf) &&
+			 rcErodeWalkableArea(&ctx, cfg.walkableRadius, *chf) &&
+			 rcBuildDistanceField(&ctx, *chf) &&
+			 rcBuildRegions(&ctx, *chf, 0, cfg.minRegionArea, cfg.mergeRegionArea) &&
+			 rcBuildContours(&ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset) &&
+			 rcBuildPolyMesh(&ctx, *cset, cfg.maxVertsPerPoly, *pmesh) &&
+			 rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *dmesh);
+	}
+
+	dtNavMesh* nav = 0;
+	if (ok)
+	{
+		for (int i = 0; i < pmesh->npolys; ++i)
+			pmesh->flags[i] = 1;
+
+		dtNavMeshCreateParams params;
+		memset(&params, 0, sizeof(params));
+		params.verts = pmesh->verts;
+		params.vertCount = pmesh->nverts;
+		params.polys = pmesh->polys;
+		params.polyAreas = pmesh->areas;
+		params.polyFlags = pmesh->flags;
+		params.polyCount = pmesh->npolys;
+		params.nvp = pmesh->nvp;
+		params.detailMeshes = dmesh->meshes;
+		params.detailVerts = dmesh->verts;
+		params.detailVertsCount = dmesh->nverts;
+		params.detailTris = dmesh->tris;
+		params.detailTriCount = dmesh->ntris;
+		params.walkableHeight = 2.0f;
+		params.walkableRadius = 0.6f;
+		params.walkableClimb = 0.9f;
+		rcVcopy(params.bmin, pmesh->bmin);
+		rcVcopy(params.bmax, pmesh->bmax);
+		params.cs = cfg.cs;
+		params.ch = cfg.ch;
+		params.buildBvTree = true;
+
+		unsigned char* data = 0;
+		int dataSize = 0;
+		if (dtCreateNavMeshData(&params, &data, &dataSize))
+		{
+			nav = dtAllocNavMesh();
+			if (dtStatusFailed(nav->init(data, dataSize, DT_TILE_FREE_DATA)))
+			{
+				dtFree(data);
+				dtFreeNavMesh(nav);
+				nav = 0;
+			}
+		}
+	}
+
+	rcFreeHeightField(solid);
+	rcFreeCompactHeightfield(chf);
+	rcFreeContourSet(cset);
+	rcFreePolyMesh(pmesh);
+	rcFreePolyMeshDetail(dmesh);
+	return nav;
+}
+
+static const int kMaxBenchNodes = 4096;
+static const int kBenchPairs = 256;
+
+struct BenchMesh
+{
+	dtNavMesh* nav;
+	dtNavMeshQuery* query;
+	dtNodePool* nodePool;
+	dtQueryFilter filter;
+	dtPolyRef startRefs[kBenchPairs];
+	dtPolyRef endRefs[kBenchPairs];
+	float startPos[kBenchPairs * 3];
+	float endPos[kBenchPairs * 3];
+};
+
+// Builds the benchmark mesh once, returns null if the mesh file is not available.
+BenchMesh* getBenchMesh(const int index)
+{
+	static const char* paths[] = { "Meshes/dungeon.obj", "Meshes/nav_test.obj", "Meshes/undulating.obj" };
+	static BenchMesh* meshes[3] = { 0, 0, 0 };
+	static bool loaded[3] = { false, false, false };
+	if (loaded[index])
+		return meshes[index];
+	loaded[index] = true;
+
+	dtNavMesh* nav = buildNavMesh(paths[index]);
+	if (!nav)
+	{
+		WARN("Skipping benchmark, could not build " << paths[index]);
+		return 0;
+	}
+
+	BenchMesh* mesh = new BenchMesh;
+	mesh->nav = nav;
+	mesh->query = dtAllocNavMeshQuery();
+	mesh->query->init(nav, kMaxBenchNodes);
+	mesh->nodePool = new dtNodePool(kMaxBenchNodes, (int)dtNextPow2(kMaxBenchNodes / 4));
+	seedRandom(1234);
+	for (int i = 0; i < kBenchPairs; ++i)
+	{
+		mesh->query->findRandomPoint(&mesh->filter, frand, &mesh->startRefs[i], &mesh->startPos[i * 3]);
+		mesh->query->findRandomPoint(&mesh->filter, frand, &mesh->endRefs[i], &mesh->endPos[i * 3]);
+	}
+	meshes[index] = mesh;
+	return mesh;
+}
+
+// The open list part of dtNavMeshQuery::findPath, run with the specified queue.
+// Returns the cost of the path to the end polygon, or -1 if it was not reached.
+template <class Queue>
+float searchPath(BenchMesh* mesh, Queue& openList, const int pair)
+{
+	const dtNavMesh* nav = mesh->nav;
+	dtNodePool* nodePool = mesh->nodePool;
+	const dtQueryFilter* filter = &mesh->filter;
+	const dtPolyRef startRef = mesh->startRefs[pair];
+	const dtPolyRef endRef = mesh->endRefs[pair];
+	const float* endPos = &mesh->endPos[pair * 3];
+
+	nodePool->clear();
+	openList.clear();
+
+	dtNode* startNode = nodePool->getNode(startRef);
+	dtVcopy(startNode->pos, &mesh->startPos[pair * 3]);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startNode->pos, endPos) * 0.999f;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	openList.push(startNode);
+
+	while (!openList.empty())
+	{
+		dtNode* bestNode = openList.pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		if (bestNode->id == endRef)
+			return bestNode->cost;
+
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+		const dtPolyRef parentRef = bestNode->pidx ? nodePool->getNodeAtIdx(bestNode->pidx)->id : 0;
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			const dtPolyRef neighbourRef = bestTile->links[i].ref;
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			dtNode* neighbourNode = nodePool->getNode(neighbourRef);
+			if (!neighbourNode)
+				continue;
+			if (neighbourNode->flags == 0)
+			{
+				// Midpoint of the shared edge.
+				const int edge = bestTile->links[i].edge;
+				const float* va = &bestTile->verts[bestPoly->verts[edge] * 3];
+				const float* vb = &bestTile->verts[bestPoly->verts[(edge + 1) % bestPoly->vertCount] * 3];
+				dtVlerp(neighbourNode->pos, va, vb, 0.5f);
+			}
+
+			float cost = bestNode->cost + filter->getCost(bestNode->pos, neighbourNode->pos,
+														  0, 0, 0, bestRef, bestTile, bestPoly,
+														  neighbourRef, neighbourTile, neighbourPoly);
+			float heuristic = 0;
+			if (neighbourRef == endRef)
+				cost += dtVdist(neighbourNode->pos, endPos);
+			else
+				heuristic = dtVdist(neighbourNode->pos, endPos) * 0.999f;
+			const float total = cost + heuristic;
+
+			if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && total >= neighbourNode->total)
+				continue;
+
+			neighbourNode->pidx = nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				openList.modify(neighbourNode);
+			}
+			else
+			{
+				neighbourNode->flags |= DT_NODE_OPEN;
+				openList.push(neighbourNode);
+			}
+		}
+	}
+	return -1.0f;
+}
+
+template <class Queue>
+void runQueueBench(const int meshIndex)
+{
+	BenchMesh* mesh = getBenchMesh(meshIndex);
+	if (!mesh)
+		return;
+	Queue openList(kMaxBenchNodes);
+	float totalCost = 0;
+	for (int i = 0; i < kBenchPairs; ++i)
+		totalCost += searchPath(mesh, openList, i);
+	DoNotOptimize(&totalCost);
+}
+}
+
+TEST_CASE("Node queues find paths of equal cost")
+{
+	for (int m = 0; m < 3; ++m)
+	{
+		BenchMesh* mesh = getBenchMesh(m);
+		if (!mesh)
+			continue;
+		dtBinaryNodeQueue binary(kMaxBenchNodes);
+		dtDaryNodeQueue dary(kMaxBenchNodes);
+		for (int i = 0; i < kBenchPairs; ++i)
+		{
+			const float cost = searchPath(mesh, binary, i);
+			REQUIRE(searchPath(mesh, dary, i) == Catch::Approx(cost));
+		}
+	}
+}
+
+const int kNumQueueLoops = 10;
+
+BM(NodeQueue_Binary_Dungeon, kNumQueueLoops) { runQueueBench<dtBinaryNodeQueue>(0); }
+BM(NodeQueue_Dary_Dungeon, kNumQueueLoops) { runQueueBench<dtDaryNodeQueue>(0); }
+BM(NodeQueue_Binary_NavTest, kNumQueueLoops) { runQueueBench<dtBinaryNodeQueue>(1); }
+BM(NodeQueue_Dary_NavTest, kNumQueueLoops) { runQueueBench<dtDaryNodeQueue>(1); }
+BM(NodeQueue_Binary_Undulating, kNumQueueLoops) { runQueueBench<dtBinaryNodeQueue>(2); }
+BM(NodeQueue_Dary_Undulating, kNumQueueLoops) { runQueueBench<dtDaryNodeQueue>(2); }
+
+#endif  // TESTS_BENCHMARKS
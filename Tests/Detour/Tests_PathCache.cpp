@@ -0,0 +1,95 @@
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourPathCache.h"
+#include "DetourTestMesh.h"
+
+TEST_CASE("dtPathCache")
+{
+	TestGridMesh grid(3, 1, 8);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtPathCache* cache = dtAllocPathCache();
+	REQUIRE(cache);
+	REQUIRE(dtStatusSucceed(cache->init(2, 256)));
+
+	dtQueryFilter filter;
+	float startPos[3], endPos[3], otherPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 4, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 22, 4, endPos);
+	const dtPolyRef otherRef = findCellPoly(query, 4, 4, otherPos);
+	REQUIRE(startRef);
+	REQUIRE(endRef);
+	REQUIRE(otherRef);
+
+	dtPolyRef expected[256];
+	int expectedCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, expected, &expectedCount, 256)));
+
+	dtPolyRef path[256];
+	int pathCount = 0;
+	REQUIRE(dtStatusSucceed(cache->findPath(query, startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)));
+	REQUIRE(cache->getMissCount() == 1);
+	REQUIRE(cache->getEntryCount() == 1);
+
+	SECTION("Returns the cached path")
+	{
+		pathCount = 0;
+		REQUIRE(dtStatusSucceed(cache->findPath(query, startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)));
+		REQUIRE(cache->getHitCount() == 1);
+		REQUIRE(pathCount == expectedCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(path[i] == expected[i]);
+	}
+
+	SECTION("Drops paths crossing a rebuilt tile")
+	{
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 0, 0), 0, 0)));
+		REQUIRE(grid.addTile(nav, 1, 0));
+
+		REQUIRE(!cache->find(nav, startRef, endRef, dtHashQueryFilter(&filter), path, &pathCount, 256));
+		REQUIRE(cache->getEntryCount() == 0);
+
+		REQUIRE(dtStatusSucceed(cache->findPath(query, startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256)));
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+		REQUIRE(path[pathCount-1] == endRef);
+	}
+
+	SECTION("Keeps paths when an unrelated tile changes")
+	{
+		const dtPolyRef nearRef = findCellPoly(query, 4, 4, otherPos);
+		REQUIRE(dtStatusSucceed(cache->findPath(query, startRef, nearRef, startPos, otherPos, &filter, path, &pathCount, 256)));
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(2, 0, 0), 0, 0)));
+		REQUIRE(cache->find(nav, startRef, nearRef, dtHashQueryFilter(&filter), path, &pathCount, 256));
+	}
+
+	SECTION("Evicts the least recently used path")
+	{
+		REQUIRE(dtStatusSucceed(cache->findPath(query, startRef, otherRef, startPos, otherPos, &filter, path, &pathCount, 256)));
+		REQUIRE(dtStatusSucceed(cache->findPath(query, endRef, otherRef, endPos, otherPos, &filter, path, &pathCount, 256)));
+		REQUIRE(cache->getEntryCount() == 2);
+
+		const unsigned int filterHash = dtHashQueryFilter(&filter);
+		REQUIRE(!cache->find(nav, startRef, endRef, filterHash, path, &pathCount, 256));
+		REQUIRE(cache->find(nav, startRef, otherRef, filterHash, path, &pathCount, 256));
+		REQUIRE(cache->find(nav, endRef, otherRef, filterHash, path, &pathCount, 256));
+	}
+
+	SECTION("Keeps paths of different filters apart")
+	{
+		dtQueryFilter costly;
+		costly.setAreaCost(0, 2.0f);
+		REQUIRE(dtHashQueryFilter(&costly) != dtHashQueryFilter(&filter));
+		REQUIRE(dtStatusSucceed(cache->findPath(query, startRef, endRef, startPos, endPos, &costly, path, &pathCount, 256)));
+		REQUIRE(cache->getHitCount() == 0);
+		REQUIRE(cache->getEntryCount() == 2);
+	}
+
+	dtFreePathCache(cache);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,161 @@
+#include "catch_amalgamated.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourComponentIndex.h"
+#include "DetourPolyAreaTable.h"
+#include "DetourTestMesh.h"
+
+static unsigned int randomSeed = 1;
+
+static float testRandom()
+{
+	randomSeed = randomSeed * 1664525u + 1013904223u;
+	return (float)(randomSeed >> 8) * (1.0f / 16777216.0f);
+}
+
+TEST_CASE("dtPolyAreaTable")
+{
+	// 3x3 tiles, the right column of tiles is cut off by a wall and the first tile has a hole.
+	TestGridMesh grid(3, 3, 8);
+	for (int z = 0; z < grid.cellsZ(); ++z)
+		grid.block(15, z);
+	for (int z = 2; z < 6; ++z)
+		for (int x = 2; x < 6; ++x)
+			grid.block(x, z);
+	int openCells = 0;
+	for (int z = 0; z < grid.cellsZ(); ++z)
+		for (int x = 0; x < grid.cellsX(); ++x)
+			openCells += grid.isBlocked(x, z) ? 0 : 1;
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	const dtNavMesh* cnav = nav;
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	dtPolyAreaTable* areas = dtAllocPolyAreaTable();
+	REQUIRE(dtStatusSucceed(areas->init(nav, &filter)));
+	query->setPolyAreaTable(areas);
+	randomSeed = 1;
+
+	REQUIRE(areas->getTotalArea() == Catch::Approx((float)openCells));
+	REQUIRE(areas->getTileArea(cnav->getTileAt(0, 0, 0)) == Catch::Approx(48.0f));
+	REQUIRE(areas->getTileArea(cnav->getTileAt(0, 1, 0)) == Catch::Approx(64.0f));
+
+	SECTION("Samples polygons weighted by area")
+	{
+		int tileCounts[9] = { 0 };
+		const int sampleCount = 9000;
+		for (int i = 0; i < sampleCount; ++i)
+		{
+			dtPolyRef ref = 0;
+			float pt[3];
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, testRandom, &ref, pt)));
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			REQUIRE(dtStatusSucceed(cnav->getTileAndPolyByRef(ref, &tile, &poly)));
+			REQUIRE(pt[0] >= tile->header->bmin[0]);
+			REQUIRE(pt[0] <= tile->header->bmax[0]);
+			REQUIRE(pt[2] >= tile->header->bmin[2]);
+			REQUIRE(pt[2] <= tile->header->bmax[2]);
+			REQUIRE(!grid.isBlocked((int)pt[0], (int)pt[2]));
+			tileCounts[tile->header->y * 3 + tile->header->x]++;
+		}
+		for (int i = 0; i < 9; ++i)
+		{
+			const float area = areas->getTileArea(cnav->getTileAt(i % 3, i / 3, 0));
+			const float expected = sampleCount * area / areas->getTotalArea();
+			REQUIRE(tileCounts[i] > expected * 0.85f);
+			REQUIRE(tileCounts[i] < expected * 1.15f);
+		}
+	}
+
+	SECTION("Follows tile changes")
+	{
+		const dtTileRef removedRef = nav->getTileRefAt(0, 1, 0);
+		REQUIRE(dtStatusSucceed(nav->removeTile(removedRef, 0, 0)));
+		REQUIRE(areas->getTotalArea() == Catch::Approx((float)(openCells - 64)));
+		for (int i = 0; i < 1000; ++i)
+		{
+			dtPolyRef ref = 0;
+			float pt[3];
+			REQUIRE(dtStatusSucceed(query->findRandomPoint(&filter, testRandom, &ref, pt)));
+			REQUIRE(nav->isValidPolyRef(ref));
+			REQUIRE(nav->decodePolyIdTile(ref) != nav->decodePolyIdTile((dtPolyRef)removedRef));
+		}
+
+		REQUIRE(grid.addTile(nav, 0, 1));
+		REQUIRE(areas->getTotalArea() == Catch::Approx((float)openCells));
+	}
+
+	SECTION("Samples large circles within the start component")
+	{
+		dtComponentIndex* components = dtAllocComponentIndex();
+		REQUIRE(dtStatusSucceed(components->init(nav, &filter)));
+		query->setComponentIndex(components);
+
+		float centerPos[3];
+		const dtPolyRef startRef = findCellPoly(query, 12, 12, centerPos);
+		REQUIRE(startRef);
+		const float radius = 6.0f;
+		const float maxHeight = 1.0f;
+		int sampledCount = 0;
+		for (int i = 0; i < 500; ++i)
+		{
+			// The sampled path does not touch the node pool, the search fallback does.
+			query->getNodePool()->clear();
+			dtPolyRef ref = 0;
+			float pt[3];
+			REQUIRE(dtStatusSucceed(query->sampleRandomPointAroundCircle(startRef, centerPos, radius, maxHeight, &filter, testRandom, &ref, pt)));
+			REQUIRE(pt[0] < 15.0f);
+			REQUIRE(components->isReachable(startRef, ref, 0));
+			if (query->getNodePool()->getNodeCount() == 0)
+			{
+				REQUIRE(dtVdist2D(pt, centerPos) <= radius + 0.001f);
+				REQUIRE(dtAbs(pt[1] - centerPos[1]) <= maxHeight);
+				sampledCount++;
+			}
+		}
+		REQUIRE(sampledCount > 490);
+
+		// The search keeps its stronger contract and does not sample.
+		query->getNodePool()->clear();
+		dtPolyRef ref = 0;
+		float pt[3];
+		REQUIRE(dtStatusSucceed(query->findRandomPointAroundCircle(startRef, centerPos, radius, &filter, testRandom, &ref, pt)));
+		REQUIRE(query->getNodePool()->getNodeCount() > 0);
+
+		// No polygon is within the height range of a center above the mesh, the search is used instead.
+		const float highPos[3] = { centerPos[0], centerPos[1] + 5.0f, centerPos[2] };
+		for (int i = 0; i < 20; ++i)
+		{
+			query->getNodePool()->clear();
+			REQUIRE(dtStatusSucceed(query->sampleRandomPointAroundCircle(startRef, highPos, radius, maxHeight, &filter, testRandom, &ref, pt)));
+			REQUIRE(query->getNodePool()->getNodeCount() > 0);
+			REQUIRE(components->isReachable(startRef, ref, 0));
+		}
+		REQUIRE(query->sampleRandomPointAroundCircle(startRef, centerPos, radius, -1.0f, &filter, testRandom, &ref, pt) == (DT_FAILURE | DT_INVALID_PARAM));
+
+		query->setComponentIndex(0);
+		dtFreeComponentIndex(components);
+	}
+
+	SECTION("Falls back to the scan for other filters")
+	{
+		dtQueryFilter other;
+		other.setExcludeFlags(2);
+		REQUIRE(!areas->matchesFilter(&other));
+		dtPolyRef ref = 0;
+		float pt[3];
+		REQUIRE(dtStatusSucceed(query->findRandomPoint(&other, testRandom, &ref, pt)));
+		REQUIRE(nav->isValidPolyRef(ref));
+	}
+
+	dtFreePolyAreaTable(areas);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
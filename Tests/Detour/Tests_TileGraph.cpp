@@ -0,0 +1,98 @@
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourTileGraph.h"
+#include "DetourTestMesh.h"
+
+TEST_CASE("dtTileGraph")
+{
+	// 6x6 tiles split by a wall with a single gap in tile (3, 2).
+	TestGridMesh grid(6, 6, 8);
+	for (int z = 0; z < grid.cellsZ(); ++z)
+	{
+		if (z != 20)
+			grid.block(24, z);
+	}
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 512)));
+
+	dtQueryFilter filter;
+	dtTileGraph* graph = dtAllocTileGraph();
+	REQUIRE(dtStatusSucceed(graph->init(nav, &filter, 512)));
+
+	float startPos[3], endPos[3];
+	const dtPolyRef startRef = findCellPoly(query, 1, 1, startPos);
+	const dtPolyRef endRef = findCellPoly(query, 46, 2, endPos);
+
+	dtPolyRef path[512];
+	int pathCount = 0;
+
+	SECTION("Finds a complete path across many tiles")
+	{
+		const dtStatus status = graph->findPath(query, startRef, endRef, startPos, endPos, path, &pathCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount - 1] == endRef);
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+
+		dtTileRef tiles[64];
+		int tileCount = 0;
+		REQUIRE(dtStatusSucceed(graph->findTileCorridor(startRef, endRef, startPos, endPos, tiles, &tileCount, 64)));
+		REQUIRE(tileCount >= 6);
+		REQUIRE(tiles[0] == nav->getTileRefAt(0, 0, 0));
+		REQUIRE(tiles[tileCount - 1] == nav->getTileRefAt(5, 0, 0));
+	}
+
+	SECTION("Path costs stay close to the flat search")
+	{
+		dtNavMeshQuery* flatQuery = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(flatQuery->init(nav, 4096)));
+		dtPolyRef flatPath[512];
+		int flatPathCount = 0;
+
+		static const int pairs[][4] = { { 1, 1, 46, 2 }, { 2, 45, 40, 40 }, { 20, 3, 30, 44 }, { 5, 20, 47, 20 } };
+		for (int p = 0; p < 4; ++p)
+		{
+			const dtPolyRef s = findCellPoly(query, pairs[p][0], pairs[p][1], startPos);
+			const dtPolyRef e = findCellPoly(query, pairs[p][2], pairs[p][3], endPos);
+			REQUIRE(s);
+			REQUIRE(e);
+			const dtStatus status = graph->findPath(query, s, e, startPos, endPos, path, &pathCount, 512);
+			REQUIRE(dtStatusSucceed(status));
+			REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+			REQUIRE(isConnectedPath(nav, path, pathCount));
+			REQUIRE(dtStatusSucceed(flatQuery->findPath(s, e, startPos, endPos, &filter, flatPath, &flatPathCount, 512)));
+			const float cost = pathCost(nav, &filter, path, pathCount, startPos, endPos);
+			const float flatCost = pathCost(nav, &filter, flatPath, flatPathCount, startPos, endPos);
+			REQUIRE(cost <= flatCost * 1.1f);
+		}
+
+		dtFreeNavMeshQuery(flatQuery);
+	}
+
+	SECTION("Follows tile removal and re-adding")
+	{
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(3, 2, 0), 0, 0)));
+
+		dtStatus status = graph->findPath(query, startRef, endRef, startPos, endPos, path, &pathCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+		REQUIRE(grid.addTile(nav, 3, 2));
+
+		status = graph->findPath(query, startRef, endRef, startPos, endPos, path, &pathCount, 512);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(path[pathCount - 1] == endRef);
+		REQUIRE(isConnectedPath(nav, path, pathCount));
+	}
+
+	dtFreeTileGraph(graph);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
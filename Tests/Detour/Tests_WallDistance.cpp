@@ -0,0 +1,108 @@
+#include "catch_amalgamated.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+#include "DetourWallDistance.h"
+#include "DetourTestMesh.h"
+
+// Checks that the field gives the same wall distances as the search at a few points of each cell.
+static void requireSameDistances(const TestGridMesh& grid, dtNavMeshQuery* plain, dtNavMeshQuery* fast, const dtQueryFilter* filter)
+{
+	static const float offsets[3][2] = { { 0.0f, 0.0f }, { 0.3f, -0.2f }, { -0.45f, 0.45f } };
+	static const float radii[3] = { 0.75f, 2.5f, 20.0f };
+	for (int z = 0; z < grid.cellsZ(); ++z)
+	{
+		for (int x = 0; x < grid.cellsX(); ++x)
+		{
+			if (grid.isBlocked(x, z))
+				continue;
+			float center[3];
+			const dtPolyRef ref = findCellPoly(plain, x, z, center);
+			if (!ref)
+				continue;
+			for (int i = 0; i < 3; ++i)
+			{
+				const float pos[3] = { center[0] + offsets[i][0], center[1], center[2] + offsets[i][1] };
+				for (int j = 0; j < 3; ++j)
+				{
+					float plainDist = 0, fastDist = 0, hitPos[3], hitNormal[3];
+					REQUIRE(dtStatusSucceed(plain->findDistanceToWall(ref, pos, radii[j], filter, &plainDist, hitPos, hitNormal)));
+					REQUIRE(dtStatusSucceed(fast->findDistanceToWall(ref, pos, radii[j], filter, &fastDist, hitPos, hitNormal)));
+					REQUIRE(fastDist == Catch::Approx(plainDist).margin(1e-4));
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE("dtWallDistanceField")
+{
+	// 2x2 tiles with a hole in the first tile and a wall across the upper tiles.
+	TestGridMesh grid(2, 2, 8);
+	for (int z = 5; z < 8; ++z)
+		for (int x = 5; x < 8; ++x)
+			grid.block(x, z);
+	for (int x = 2; x < 13; ++x)
+		grid.block(x, 11);
+
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* plain = dtAllocNavMeshQuery();
+	dtNavMeshQuery* fast = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(plain->init(nav, 2048)));
+	REQUIRE(dtStatusSucceed(fast->init(nav, 2048)));
+
+	dtQueryFilter filter;
+	dtWallDistanceField* walls = dtAllocWallDistanceField();
+	REQUIRE(dtStatusSucceed(walls->init(nav, &filter, 4.0f)));
+	fast->setWallDistanceField(walls);
+
+	SECTION("Matches the search")
+	{
+		requireSameDistances(grid, plain, fast, &filter);
+	}
+
+	SECTION("Skips the search when no wall is close")
+	{
+		float pos[3];
+		const dtPolyRef ref = findCellPoly(fast, 12, 4, pos);
+		REQUIRE(ref);
+		float dist = 0, hitPos[3], hitNormal[3];
+		fast->getNodePool()->clear();
+		REQUIRE(dtStatusSucceed(fast->findDistanceToWall(ref, pos, 1.0f, &filter, &dist, hitPos, hitNormal)));
+		REQUIRE(dist == 1.0f);
+		REQUIRE(fast->getNodePool()->getNodeCount() == 0);
+
+		float centerDist = 0;
+		REQUIRE(walls->getPolyWallDistance(ref, &centerDist));
+		REQUIRE(centerDist == Catch::Approx(3.5f));
+		REQUIRE(walls->getPolyClearance(ref) < centerDist);
+		REQUIRE(walls->getPolyClearance(ref) > 2.5f);
+	}
+
+	SECTION("Follows tile changes")
+	{
+		float pos[3];
+		const dtPolyRef ref = findCellPoly(fast, 7, 1, pos);
+		float dist = 0;
+		REQUIRE(walls->getPolyWallDistance(ref, &dist));
+		REQUIRE(dist == Catch::Approx(1.5f));
+
+		// The border toward the removed tile becomes a wall.
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 0, 0), 0, 0)));
+		REQUIRE(walls->getPolyWallDistance(ref, &dist));
+		REQUIRE(dist == Catch::Approx(0.5f));
+		requireSameDistances(grid, plain, fast, &filter);
+
+		REQUIRE(grid.addTile(nav, 1, 0));
+		REQUIRE(walls->getPolyWallDistance(ref, &dist));
+		REQUIRE(dist == Catch::Approx(1.5f));
+		requireSameDistances(grid, plain, fast, &filter);
+	}
+
+	dtFreeWallDistanceField(walls);
+	dtFreeNavMeshQuery(fast);
+	dtFreeNavMeshQuery(plain);
+	dtFreeNavMesh(nav);
+}
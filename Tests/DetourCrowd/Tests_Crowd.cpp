@@ -0,0 +1,78 @@
+#include "catch_amalgamated.hpp"
+
+#include "DetourCrowd.h"
+#include "DetourIncrementalPath.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "Detour/DetourTestMesh.h"
+
+TEST_CASE("dtCrowd repairs paths with an agent replanner")
+{
+	TestGridMesh grid(4, 4, 8);
+	dtNavMesh* nav = grid.createNavMesh();
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	dtCrowd* crowd = dtAllocCrowd();
+	REQUIRE(crowd);
+	REQUIRE(crowd->init(4, 0.6f, nav));
+
+	float agentPos[3], targetPos[3];
+	REQUIRE(findCellPoly(query, 2, 16, agentPos));
+	const dtPolyRef targetRef = findCellPoly(query, 29, 16, targetPos);
+	REQUIRE(targetRef);
+
+	dtCrowdAgentParams params;
+	memset(&params, 0, sizeof(params));
+	params.radius = 0.3f;
+	params.height = 2.0f;
+	params.maxAcceleration = 8.0f;
+	params.maxSpeed = 3.5f;
+	params.collisionQueryRange = params.radius * 12.0f;
+	params.pathOptimizationRange = params.radius * 30.0f;
+	const int idx = crowd->addAgent(agentPos, &params);
+	REQUIRE(idx >= 0);
+	REQUIRE(crowd->requestMoveTarget(idx, targetRef, targetPos));
+
+	// Let the path queue find the initial path.
+	const dtCrowdAgent* ag = crowd->getAgent(idx);
+	for (int i = 0; i < 10 && ag->targetState != DT_CROWDAGENT_TARGET_VALID; ++i)
+		crowd->update(0.01f, 0);
+	REQUIRE(ag->targetState == DT_CROWDAGENT_TARGET_VALID);
+	REQUIRE(ag->corridor.getLastPoly() == targetRef);
+
+	dtIncrementalPathQuery* replanner = dtAllocIncrementalPathQuery();
+	REQUIRE(replanner);
+	REQUIRE(dtStatusSucceed(replanner->init(nav, 4096)));
+	REQUIRE(dtStatusSucceed(replanner->setGoal(targetRef, targetPos, crowd->getFilter(ag->params.queryFilterType))));
+	REQUIRE(dtStatusSucceed(nav->addTileListener(replanner)));
+	crowd->setAgentReplanner(idx, replanner);
+
+	// Rebuild the next tile along the corridor with a wall across the row of the agent.
+	// The corridor then refers to removed polygons within the validity check lookahead.
+	for (int z = 12; z <= 20; ++z)
+		grid.block(10, z);
+	REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 2, 0), 0, 0)));
+	REQUIRE(grid.addTile(nav, 1, 2));
+
+	// The replanner repairs the corridor within the update, without going through the path queue.
+	crowd->update(0.01f, 0);
+	REQUIRE(replanner->getExpandedCount() > 0);
+	REQUIRE(ag->targetState == DT_CROWDAGENT_TARGET_VALID);
+	REQUIRE(!ag->partial);
+	const dtPolyRef* path = ag->corridor.getPath();
+	const int pathCount = ag->corridor.getPathCount();
+	REQUIRE(pathCount > 0);
+	REQUIRE(path[pathCount - 1] == targetRef);
+	REQUIRE(isConnectedPath(nav, path, pathCount));
+	for (int i = 0; i < pathCount; ++i)
+		REQUIRE(nav->isValidPolyRef(path[i]));
+
+	crowd->setAgentReplanner(idx, 0);
+	nav->removeTileListener(replanner);
+	dtFreeIncrementalPathQuery(replanner);
+	dtFreeCrowd(crowd);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}